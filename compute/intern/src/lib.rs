@@ -1,8 +1,42 @@
 #[cxx::bridge]
 mod intern_ffi {
+    /// See `math_accel::runtime::RuntimeConfig`.
+    struct ComputeRuntimeConfig {
+        threads: usize,
+        cores: Vec<usize>,
+        thread_name: String,
+        cooperative: bool,
+    }
+
+    /// Time spent in one kernel since the last reset.
+    struct ComputeCounter {
+        name: String,
+        calls: u64,
+        nanoseconds: u64,
+        max_nanoseconds: u64,
+    }
+
+    // Runtime Functions
+    extern "Rust" {
+        fn compute_runtime_init_rs(config: &ComputeRuntimeConfig) -> String;
+        fn compute_runtime_lend_thread_rs() -> bool;
+        fn compute_runtime_reclaim_threads_rs();
+        fn compute_runtime_threads_rs() -> usize;
+        fn compute_counters_rs() -> Vec<ComputeCounter>;
+        fn compute_counters_reset_rs();
+    }
+
     // Math Functions
     extern "Rust" {
-        fn compute_matrices_rs(locals: &[f32], worlds: &mut [f32], count: usize);
+        fn compute_world_matrices_rs(locals: &[f32], parents: &[u32], worlds: &mut [f32]);
+        fn compute_transforms_rs(
+            columns: &[f32],
+            stride: usize,
+            parents: &[u32],
+            locals: &mut [f32],
+            worlds: &mut [f32],
+        );
+        fn multiply_matrices_rs(a: &[f32], b: &[f32], outs: &mut [f32]);
         fn compute_matrix_vector_muls_rs(
             matrices: &[f32],
             vectors: &[f32],
@@ -12,11 +46,172 @@ mod intern_ffi {
         fn add_vectors_rs(a_vecs: &[f32], b_vecs: &[f32], outs: &mut [f32], count: usize);
         fn dot_products_rs(a_vecs: &[f32], b_vecs: &[f32], outs: &mut [f32], count: usize);
     }
+
+    // Mesh Functions, on the `MVert`, `MLoop` and `MPoly` arrays of `dna::Mesh`
+    extern "Rust" {
+        fn mesh_face_normals_rs(verts: &[f32], loops: &[i32], polys: &[i32], normals: &mut [f32]);
+        fn mesh_vertex_normals_rs(
+            verts: &mut [f32],
+            loops: &[i32],
+            polys: &[i32],
+            angle_weighted: bool,
+        );
+        fn mesh_tangents_rs(verts: &[f32], loops: &[i32], polys: &[i32], tangents: &mut [f32]);
+    }
+
+    // Primitive Functions, kinds and parameters of `math_accel::primitives::Primitive`
+    extern "Rust" {
+        fn mesh_primitive_counts_rs(
+            kind: u32,
+            segments: u32,
+            rings: u32,
+            size: f32,
+            depth: f32,
+            counts: &mut [usize],
+        );
+        fn mesh_primitive_rs(
+            kind: u32,
+            segments: u32,
+            rings: u32,
+            size: f32,
+            depth: f32,
+            verts: &mut [f32],
+            edges: &mut [i32],
+            loops: &mut [i32],
+            polys: &mut [i32],
+        );
+    }
+
+    // Bounds Functions
+    extern "Rust" {
+        fn mesh_bounds_rs(verts: &[f32], bounds: &mut [f32]);
+        fn transform_bounds_rs(boxes: &[f32], matrices: &[f32], worlds: &mut [f32]);
+    }
+
+    // Culling Functions
+    extern "Rust" {
+        fn cull_spheres_rs(
+            xs: &[f32],
+            ys: &[f32],
+            zs: &[f32],
+            radii: &[f32],
+            planes: &[f32],
+            visible: &mut [u32],
+        ) -> usize;
+        fn cull_boxes_rs(
+            min_xs: &[f32],
+            min_ys: &[f32],
+            min_zs: &[f32],
+            max_xs: &[f32],
+            max_ys: &[f32],
+            max_zs: &[f32],
+            planes: &[f32],
+            visible: &mut [u32],
+        ) -> usize;
+    }
+
+    // Selection Functions, `verts` holds the address of each object's `MVert` array and
+    // `verts_nums` its length. The arrays are read in place and must outlive the call.
+    extern "Rust" {
+        unsafe fn select_points_in_frustum_rs(
+            verts: &[usize],
+            verts_nums: &[usize],
+            planes: &[f32],
+            hits: &mut [u8],
+        );
+        unsafe fn select_points_in_polygon_rs(
+            verts: &[usize],
+            verts_nums: &[usize],
+            matrices: &[f32],
+            viewport: &[f32],
+            polygon: &[f32],
+            hits: &mut [u8],
+        );
+    }
 }
 
-pub fn compute_matrices_rs(locals: &[f32], worlds: &mut [f32], count: usize) {
+use intern_ffi::{ComputeCounter, ComputeRuntimeConfig};
+use math_accel::runtime;
+
+/// Empty on success, the reason otherwise.
+pub fn compute_runtime_init_rs(config: &ComputeRuntimeConfig) -> String {
+    let result = runtime::init(runtime::RuntimeConfig {
+        threads: config.threads,
+        cores: config.cores.clone(),
+        thread_name: config.thread_name.clone(),
+        cooperative: config.cooperative,
+    });
+    result.err().unwrap_or_default()
+}
+
+pub fn compute_runtime_lend_thread_rs() -> bool {
+    runtime::lend_thread()
+}
+
+pub fn compute_runtime_reclaim_threads_rs() {
+    runtime::reclaim_threads();
+}
+
+pub fn compute_runtime_threads_rs() -> usize {
+    runtime::threads()
+}
+
+pub fn compute_counters_rs() -> Vec<ComputeCounter> {
+    runtime::counter_values()
+        .into_iter()
+        .map(|values| ComputeCounter {
+            name: values.kernel.name().to_string(),
+            calls: values.calls,
+            nanoseconds: values.nanoseconds,
+            max_nanoseconds: values.max_nanoseconds,
+        })
+        .collect()
+}
+
+pub fn compute_counters_reset_rs() {
+    runtime::reset_counters();
+}
+
+pub fn compute_world_matrices_rs(locals: &[f32], parents: &[u32], worlds: &mut [f32]) {
+    let count = parents.len();
+    assert!(locals.len() == count * 16 && worlds.len() == count * 16);
+    unsafe {
+        math_accel::vk_compute_world_matrices(
+            locals.as_ptr(),
+            parents.as_ptr(),
+            worlds.as_mut_ptr(),
+            count,
+        );
+    }
+}
+
+pub fn compute_transforms_rs(
+    columns: &[f32],
+    stride: usize,
+    parents: &[u32],
+    locals: &mut [f32],
+    worlds: &mut [f32],
+) {
+    let count = parents.len();
+    assert!(count <= stride && columns.len() >= math_accel::transform::TRANSFORM_COLUMNS * stride);
+    assert!(locals.len() == count * 16 && worlds.len() == count * 16);
     unsafe {
-        math_accel::vk_compute_world_matrices(locals.as_ptr(), worlds.as_mut_ptr(), count);
+        math_accel::vk_compute_transforms(
+            columns.as_ptr(),
+            stride,
+            parents.as_ptr(),
+            locals.as_mut_ptr(),
+            worlds.as_mut_ptr(),
+            count,
+        );
+    }
+}
+
+pub fn multiply_matrices_rs(a: &[f32], b: &[f32], outs: &mut [f32]) {
+    let count = outs.len() / 16;
+    assert!(a.len() == count * 16 && b.len() == count * 16 && outs.len() == count * 16);
+    unsafe {
+        math_accel::vk_multiply_matrices(a.as_ptr(), b.as_ptr(), outs.as_mut_ptr(), count);
     }
 }
 
@@ -47,3 +242,248 @@ pub fn dot_products_rs(a_vecs: &[f32], b_vecs: &[f32], outs: &mut [f32], count:
         math_accel::vk_dot_products(a_vecs.as_ptr(), b_vecs.as_ptr(), outs.as_mut_ptr(), count);
     }
 }
+
+/// # Safety
+/// `verts[i]` is the address of `verts_nums[i]` `MVert` elements, or null when that is zero.
+pub unsafe fn select_points_in_frustum_rs(
+    verts: &[usize],
+    verts_nums: &[usize],
+    planes: &[f32],
+    hits: &mut [u8],
+) {
+    let count = hits.len();
+    assert!(verts.len() == count && verts_nums.len() == count && planes.len() == count * 24);
+    unsafe {
+        math_accel::vk_select_points_in_frustum(
+            verts.as_ptr() as *const *const f32,
+            verts_nums.as_ptr(),
+            planes.as_ptr(),
+            hits.as_mut_ptr(),
+            count,
+        );
+    }
+}
+
+/// # Safety
+/// See [`select_points_in_frustum_rs`].
+pub unsafe fn select_points_in_polygon_rs(
+    verts: &[usize],
+    verts_nums: &[usize],
+    matrices: &[f32],
+    viewport: &[f32],
+    polygon: &[f32],
+    hits: &mut [u8],
+) {
+    let count = hits.len();
+    assert!(verts.len() == count && verts_nums.len() == count);
+    assert!(matrices.len() == count * 16 && viewport.len() == 2);
+    unsafe {
+        math_accel::vk_select_points_in_polygon(
+            verts.as_ptr() as *const *const f32,
+            verts_nums.as_ptr(),
+            matrices.as_ptr(),
+            viewport[0],
+            viewport[1],
+            polygon.as_ptr(),
+            polygon.len() / 2,
+            hits.as_mut_ptr(),
+            count,
+        );
+    }
+}
+
+fn assert_mesh_arrays(verts: &[f32], loops: &[i32], polys: &[i32]) {
+    use math_accel::normals::{LOOP_LEN, POLY_LEN, VERT_LEN};
+    assert!(verts.len() % VERT_LEN == 0 && loops.len() % LOOP_LEN == 0);
+    assert!(polys.len() % POLY_LEN == 0);
+}
+
+pub fn mesh_face_normals_rs(verts: &[f32], loops: &[i32], polys: &[i32], normals: &mut [f32]) {
+    use math_accel::normals::{LOOP_LEN, POLY_LEN, VERT_LEN};
+    assert_mesh_arrays(verts, loops, polys);
+    assert!(normals.len() == polys.len() / POLY_LEN * 3);
+    unsafe {
+        math_accel::vk_mesh_face_normals(
+            verts.as_ptr(),
+            verts.len() / VERT_LEN,
+            loops.as_ptr(),
+            loops.len() / LOOP_LEN,
+            polys.as_ptr(),
+            polys.len() / POLY_LEN,
+            normals.as_mut_ptr(),
+        );
+    }
+}
+
+pub fn mesh_vertex_normals_rs(
+    verts: &mut [f32],
+    loops: &[i32],
+    polys: &[i32],
+    angle_weighted: bool,
+) {
+    use math_accel::normals::{LOOP_LEN, POLY_LEN, VERT_LEN};
+    assert_mesh_arrays(verts, loops, polys);
+    unsafe {
+        math_accel::vk_mesh_vertex_normals(
+            verts.as_mut_ptr(),
+            verts.len() / VERT_LEN,
+            loops.as_ptr(),
+            loops.len() / LOOP_LEN,
+            polys.as_ptr(),
+            polys.len() / POLY_LEN,
+            angle_weighted,
+        );
+    }
+}
+
+pub fn mesh_tangents_rs(verts: &[f32], loops: &[i32], polys: &[i32], tangents: &mut [f32]) {
+    use math_accel::normals::{LOOP_LEN, POLY_LEN, VERT_LEN};
+    assert_mesh_arrays(verts, loops, polys);
+    assert!(tangents.len() == loops.len() / LOOP_LEN * 4);
+    unsafe {
+        math_accel::vk_mesh_tangents(
+            verts.as_ptr(),
+            verts.len() / VERT_LEN,
+            loops.as_ptr(),
+            loops.len() / LOOP_LEN,
+            polys.as_ptr(),
+            polys.len() / POLY_LEN,
+            tangents.as_mut_ptr(),
+        );
+    }
+}
+
+/// `counts` receives the number of vertices, edges, faces and corners.
+pub fn mesh_primitive_counts_rs(
+    kind: u32,
+    segments: u32,
+    rings: u32,
+    size: f32,
+    depth: f32,
+    counts: &mut [usize],
+) {
+    assert!(counts.len() == 4);
+    unsafe {
+        math_accel::vk_mesh_primitive_counts(
+            kind,
+            segments as usize,
+            rings as usize,
+            size,
+            depth,
+            counts.as_mut_ptr(),
+        );
+    }
+}
+
+pub fn mesh_primitive_rs(
+    kind: u32,
+    segments: u32,
+    rings: u32,
+    size: f32,
+    depth: f32,
+    verts: &mut [f32],
+    edges: &mut [i32],
+    loops: &mut [i32],
+    polys: &mut [i32],
+) {
+    use math_accel::normals::{LOOP_LEN, POLY_LEN, VERT_LEN};
+    use math_accel::primitives::EDGE_LEN;
+    let mut counts = [0usize; 4];
+    mesh_primitive_counts_rs(kind, segments, rings, size, depth, &mut counts);
+    let [verts_num, edges_num, faces_num, corners_num] = counts;
+    assert!(verts.len() == verts_num * VERT_LEN && edges.len() == edges_num * EDGE_LEN);
+    assert!(loops.len() == corners_num * LOOP_LEN && polys.len() == faces_num * POLY_LEN);
+    unsafe {
+        math_accel::vk_mesh_primitive(
+            kind,
+            segments as usize,
+            rings as usize,
+            size,
+            depth,
+            verts.as_mut_ptr(),
+            edges.as_mut_ptr(),
+            loops.as_mut_ptr(),
+            polys.as_mut_ptr(),
+        );
+    }
+}
+
+/// `bounds` receives the local box, min then max, and the radius of the sphere around its
+/// center.
+pub fn mesh_bounds_rs(verts: &[f32], bounds: &mut [f32]) {
+    use math_accel::normals::VERT_LEN;
+    assert!(verts.len() % VERT_LEN == 0 && bounds.len() == math_accel::bounds::BOX_LEN + 1);
+    unsafe {
+        math_accel::vk_mesh_bounds(verts.as_ptr(), verts.len() / VERT_LEN, bounds.as_mut_ptr());
+    }
+}
+
+pub fn transform_bounds_rs(boxes: &[f32], matrices: &[f32], worlds: &mut [f32]) {
+    use math_accel::bounds::BOX_LEN;
+    let count = boxes.len() / BOX_LEN;
+    assert!(boxes.len() == count * BOX_LEN && matrices.len() == count * 16);
+    assert!(worlds.len() == boxes.len());
+    unsafe {
+        math_accel::vk_transform_bounds(
+            boxes.as_ptr(),
+            matrices.as_ptr(),
+            worlds.as_mut_ptr(),
+            count,
+        );
+    }
+}
+
+/// Indices of the visible spheres go to the front of `visible`, returns their number.
+pub fn cull_spheres_rs(
+    xs: &[f32],
+    ys: &[f32],
+    zs: &[f32],
+    radii: &[f32],
+    planes: &[f32],
+    visible: &mut [u32],
+) -> usize {
+    let count = xs.len();
+    assert!(ys.len() == count && zs.len() == count && radii.len() == count);
+    assert!(planes.len() == 24 && visible.len() >= count);
+    unsafe {
+        math_accel::vk_cull_spheres(
+            xs.as_ptr(),
+            ys.as_ptr(),
+            zs.as_ptr(),
+            radii.as_ptr(),
+            count,
+            planes.as_ptr(),
+            visible.as_mut_ptr(),
+        )
+    }
+}
+
+pub fn cull_boxes_rs(
+    min_xs: &[f32],
+    min_ys: &[f32],
+    min_zs: &[f32],
+    max_xs: &[f32],
+    max_ys: &[f32],
+    max_zs: &[f32],
+    planes: &[f32],
+    visible: &mut [u32],
+) -> usize {
+    let count = min_xs.len();
+    let mins = [min_xs.as_ptr(), min_ys.as_ptr(), min_zs.as_ptr()];
+    let maxs = [max_xs.as_ptr(), max_ys.as_ptr(), max_zs.as_ptr()];
+    assert!(
+        [min_ys, min_zs, max_xs, max_ys, max_zs]
+            .iter()
+            .all(|column| column.len() == count)
+    );
+    assert!(planes.len() == 24 && visible.len() >= count);
+    unsafe {
+        math_accel::vk_cull_boxes(
+            mins.as_ptr(),
+            maxs.as_ptr(),
+            count,
+            planes.as_ptr(),
+            visible.as_mut_ptr(),
+        )
+    }
+}
@@ -0,0 +1,156 @@
+//! A small timing harness shared by the benches, with the parts of the criterion API they use.
+//! It keeps the crate free of dev-dependencies, so `cargo build --locked` works with the
+//! workspace lockfile as is.
+//!
+//! Every benchmark is warmed up, then timed over `sample_size` samples of a batch of iterations
+//! sized to take about `MEASURE_TIME / sample_size`. The median and the fastest sample are
+//! printed per iteration, with the throughput of the median. Arguments that are not flags
+//! filter the benchmarks by substring, like `cargo bench -- spheres`.
+
+#![allow(dead_code)]
+
+use std::fmt::Display;
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+const WARM_UP_TIME: Duration = Duration::from_millis(300);
+const MEASURE_TIME: Duration = Duration::from_secs(2);
+const DEFAULT_SAMPLE_SIZE: usize = 50;
+
+pub enum Throughput {
+    Elements(u64),
+}
+
+pub struct BenchmarkId(String);
+
+impl BenchmarkId {
+    pub fn new(name: impl Display, parameter: impl Display) -> Self {
+        BenchmarkId(format!("{name}/{parameter}"))
+    }
+}
+
+pub struct Criterion {
+    filters: Vec<String>,
+}
+
+impl Criterion {
+    fn from_args() -> Self {
+        Criterion {
+            filters: std::env::args()
+                .skip(1)
+                .filter(|arg| !arg.starts_with('-'))
+                .collect(),
+        }
+    }
+
+    pub fn benchmark_group(&mut self, name: &str) -> BenchmarkGroup<'_> {
+        BenchmarkGroup {
+            criterion: self,
+            name: name.to_string(),
+            sample_size: DEFAULT_SAMPLE_SIZE,
+            elements: None,
+        }
+    }
+}
+
+pub struct BenchmarkGroup<'a> {
+    criterion: &'a Criterion,
+    name: String,
+    sample_size: usize,
+    elements: Option<u64>,
+}
+
+impl BenchmarkGroup<'_> {
+    pub fn sample_size(&mut self, sample_size: usize) {
+        self.sample_size = sample_size.max(2);
+    }
+
+    pub fn throughput(&mut self, throughput: Throughput) {
+        let Throughput::Elements(elements) = throughput;
+        self.elements = Some(elements);
+    }
+
+    pub fn bench_function(&mut self, id: BenchmarkId, mut f: impl FnMut(&mut Bencher)) {
+        let name = format!("{}/{}", self.name, id.0);
+        let filters = &self.criterion.filters;
+        if !filters.is_empty() && !filters.iter().any(|filter| name.contains(filter.as_str())) {
+            return;
+        }
+
+        /* Double the batch until it takes a measurable time, for the whole warm-up. */
+        let mut bencher = Bencher {
+            iterations: 1,
+            elapsed: Duration::ZERO,
+        };
+        let warm_up_start = Instant::now();
+        let mut per_iteration = Duration::ZERO;
+        while warm_up_start.elapsed() < WARM_UP_TIME {
+            f(&mut bencher);
+            per_iteration = bencher.elapsed / bencher.iterations as u32;
+            if bencher.elapsed < Duration::from_millis(10) {
+                bencher.iterations *= 2;
+            }
+        }
+
+        let sample_time = MEASURE_TIME / self.sample_size as u32;
+        bencher.iterations =
+            (sample_time.as_nanos() / per_iteration.as_nanos().max(1)).max(1) as u64;
+        let mut samples: Vec<f64> = (0..self.sample_size)
+            .map(|_| {
+                f(&mut bencher);
+                bencher.elapsed.as_secs_f64() / bencher.iterations as f64
+            })
+            .collect();
+        samples.sort_by(f64::total_cmp);
+
+        let median = samples[samples.len() / 2];
+        let throughput = match self.elements {
+            Some(elements) => format!("{:.3} Melem/s", elements as f64 / median / 1e6),
+            None => String::new(),
+        };
+        println!(
+            "{name:<48} {:>12} {:>12} {throughput:>16}",
+            format_time(median),
+            format_time(samples[0])
+        );
+    }
+
+    pub fn finish(self) {}
+}
+
+pub struct Bencher {
+    iterations: u64,
+    elapsed: Duration,
+}
+
+impl Bencher {
+    pub fn iter<R>(&mut self, mut routine: impl FnMut() -> R) {
+        let start = Instant::now();
+        for _ in 0..self.iterations {
+            black_box(routine());
+        }
+        self.elapsed = start.elapsed();
+    }
+}
+
+fn format_time(seconds: f64) -> String {
+    if seconds < 1e-6 {
+        format!("{:.2} ns", seconds * 1e9)
+    } else if seconds < 1e-3 {
+        format!("{:.2} us", seconds * 1e6)
+    } else {
+        format!("{:.2} ms", seconds * 1e3)
+    }
+}
+
+/// Run `benches` with the filters from the command line, in place of `criterion_main!`.
+pub fn run(benches: &[fn(&mut Criterion)]) {
+    let mut criterion = Criterion::from_args();
+    println!(
+        "{:<48} {:>12} {:>12} {:>16}",
+        "benchmark", "median", "min", "throughput"
+    );
+    for bench in benches {
+        bench(&mut criterion);
+    }
+}
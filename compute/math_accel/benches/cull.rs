@@ -0,0 +1,88 @@
+//! Batched frustum culling against a per-object loop like the draw manager's sphere test. Run
+//! with `cargo bench -p math_accel --bench cull`.
+
+mod common;
+
+use common::{BenchmarkId, Criterion, Throughput};
+
+use math_accel::cull::{self, Boxes, Spheres};
+
+const COUNTS: [usize; 3] = [10_000, 100_000, 1_000_000];
+
+/* A perspective-like frustum: near and far planes and four tilted sides, unit normals. */
+fn planes() -> [[f32; 4]; 6] {
+    let s = std::f32::consts::FRAC_1_SQRT_2;
+    [
+        [s, 0.0, -s, 0.0],
+        [-s, 0.0, -s, 0.0],
+        [0.0, s, -s, 0.0],
+        [0.0, -s, -s, 0.0],
+        [0.0, 0.0, -1.0, -0.1],
+        [0.0, 0.0, 1.0, 500.0],
+    ]
+}
+
+/* Objects spread around the camera, about a quarter of them visible. */
+fn columns(count: usize) -> [Vec<f32>; 4] {
+    let value = |i: usize, k: usize| ((i * 4 + k) as f32 * 0.618).sin();
+    std::array::from_fn(|k| {
+        (0..count)
+            .map(|i| match k {
+                2 => -value(i, k).abs() * 400.0,
+                3 => value(i, k).abs() * 2.0 + 0.1,
+                _ => value(i, k) * 300.0,
+            })
+            .collect()
+    })
+}
+
+fn cull_spheres_per_object(spheres: Spheres, planes: &[[f32; 4]; 6], visible: &mut Vec<u32>) {
+    visible.clear();
+    for i in 0..spheres.xs.len() {
+        let outside = planes.iter().any(|p| {
+            p[0] * spheres.xs[i] + p[1] * spheres.ys[i] + p[2] * spheres.zs[i] + p[3]
+                < -spheres.radii[i]
+        });
+        if !outside {
+            visible.push(i as u32);
+        }
+    }
+}
+
+fn bench_cull(c: &mut Criterion) {
+    let planes = planes();
+    let mut group = c.benchmark_group("cull");
+    for count in COUNTS {
+        let [xs, ys, zs, radii] = columns(count);
+        let spheres = Spheres {
+            xs: &xs,
+            ys: &ys,
+            zs: &zs,
+            radii: &radii,
+        };
+        let max: [Vec<f32>; 3] =
+            [&xs, &ys, &zs].map(|c| c.iter().zip(&radii).map(|(v, r)| v + r * 2.0).collect());
+        let boxes = Boxes {
+            min: [&xs, &ys, &zs],
+            max: [&max[0], &max[1], &max[2]],
+        };
+        let mut visible = vec![0u32; count];
+        let mut visible_list = Vec::with_capacity(count);
+        group.throughput(Throughput::Elements(count as u64));
+
+        group.bench_function(BenchmarkId::new("spheres_per_object", count), |bench| {
+            bench.iter(|| cull_spheres_per_object(spheres, &planes, &mut visible_list))
+        });
+        group.bench_function(BenchmarkId::new("spheres", count), |bench| {
+            bench.iter(|| cull::cull_spheres(spheres, &planes, &mut visible))
+        });
+        group.bench_function(BenchmarkId::new("boxes", count), |bench| {
+            bench.iter(|| cull::cull_boxes(boxes, &planes, &mut visible))
+        });
+    }
+    group.finish();
+}
+
+fn main() {
+    common::run(&[bench_cull]);
+}
@@ -0,0 +1,108 @@
+//! Batched matrix kernels against the per-item SIMD functions they replace and a scalar loop
+//! written like glm's `mat4 * mat4`. Run with `cargo bench -p math_accel`.
+
+mod common;
+
+use common::{BenchmarkId, Criterion, Throughput};
+use rayon::prelude::*;
+
+use math_accel::{batch, simd};
+
+const COUNTS: [usize; 3] = [1_000, 100_000, 1_000_000];
+
+fn matrices(count: usize, seed: f32) -> Vec<f32> {
+    (0..count * 16)
+        .map(|i| (i as f32 * 0.13 + seed).sin())
+        .collect()
+}
+
+/* glm's operator*(mat4, mat4): one output column at a time, a column of `a` scaled by each
+ * component of the matching column of `b`. */
+fn multiply_glm_scalar(a: &[f32], b: &[f32], out: &mut [f32]) {
+    for ((a, b), out) in a
+        .chunks_exact(16)
+        .zip(b.chunks_exact(16))
+        .zip(out.chunks_exact_mut(16))
+    {
+        for c in 0..4 {
+            for r in 0..4 {
+                out[c * 4 + r] = a[r] * b[c * 4]
+                    + a[4 + r] * b[c * 4 + 1]
+                    + a[8 + r] * b[c * 4 + 2]
+                    + a[12 + r] * b[c * 4 + 3];
+            }
+        }
+    }
+}
+
+/* What the crate did before the batched kernels: one f32x4 multiply per rayon item. */
+fn multiply_per_item(a: &[f32], b: &[f32], out: &mut [f32]) {
+    out.par_chunks_exact_mut(16)
+        .enumerate()
+        .for_each(|(i, out)| unsafe {
+            simd::multiply_matrices_simd(
+                a[i * 16..].as_ptr(),
+                b[i * 16..].as_ptr(),
+                out.as_mut_ptr(),
+            );
+        });
+}
+
+fn transform_per_item(m: &[f32], v: &[f32], out: &mut [f32]) {
+    out.par_chunks_exact_mut(4)
+        .enumerate()
+        .for_each(|(i, out)| unsafe {
+            simd::multiply_matrix_vector_simd(
+                m[i * 16..].as_ptr(),
+                v[i * 4..].as_ptr(),
+                out.as_mut_ptr(),
+            );
+        });
+}
+
+fn bench_multiply(c: &mut Criterion) {
+    let mut group = c.benchmark_group("multiply_matrices");
+    for count in COUNTS {
+        let a = matrices(count, 0.0);
+        let b = matrices(count, 1.0);
+        let mut out = vec![0.0f32; count * 16];
+        group.throughput(Throughput::Elements(count as u64));
+
+        group.bench_function(BenchmarkId::new("glm_scalar", count), |bench| {
+            bench.iter(|| multiply_glm_scalar(&a, &b, &mut out))
+        });
+        group.bench_function(BenchmarkId::new("per_item_simd", count), |bench| {
+            bench.iter(|| multiply_per_item(&a, &b, &mut out))
+        });
+        for isa in batch::available_isas() {
+            group.bench_function(BenchmarkId::new(format!("batch_{isa:?}"), count), |bench| {
+                bench.iter(|| batch::multiply_matrices_with(isa, &a, &b, &mut out))
+            });
+        }
+    }
+    group.finish();
+}
+
+fn bench_transform(c: &mut Criterion) {
+    let mut group = c.benchmark_group("transform_vectors");
+    for count in COUNTS {
+        let m = matrices(count, 0.0);
+        let v: Vec<f32> = (0..count * 4).map(|i| (i as f32 * 0.29).cos()).collect();
+        let mut out = vec![0.0f32; count * 4];
+        group.throughput(Throughput::Elements(count as u64));
+
+        group.bench_function(BenchmarkId::new("per_item_simd", count), |bench| {
+            bench.iter(|| transform_per_item(&m, &v, &mut out))
+        });
+        for isa in batch::available_isas() {
+            group.bench_function(BenchmarkId::new(format!("batch_{isa:?}"), count), |bench| {
+                bench.iter(|| batch::transform_vectors_with(isa, &m, &v, &mut out))
+            });
+        }
+    }
+    group.finish();
+}
+
+fn main() {
+    common::run(&[bench_multiply, bench_transform]);
+}
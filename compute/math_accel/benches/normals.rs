@@ -0,0 +1,72 @@
+//! Vertex normals and tangents of quad grids, up to a few million vertices, against the frame
+//! budget. Run with `cargo bench -p math_accel --bench normals`.
+
+mod common;
+
+use common::{BenchmarkId, Criterion, Throughput};
+
+use math_accel::mikktspace;
+use math_accel::normals::{self, LOOP_LEN, MeshArrays, NormalWeight};
+
+const SIDES: [usize; 3] = [100, 1_000, 2_000];
+
+/* A wavy `side` x `side` quad grid in the `dna::Mesh` layout. */
+fn grid(side: usize) -> (Vec<f32>, Vec<i32>, Vec<i32>) {
+    let mut verts = Vec::with_capacity((side + 1) * (side + 1) * normals::VERT_LEN);
+    for r in 0..=side {
+        for c in 0..=side {
+            let (x, z) = (c as f32, r as f32);
+            let y = (x * 0.1).sin() + (z * 0.07).cos();
+            verts.extend_from_slice(&[x, y, z, 0.0, 1.0, 0.0, x / side as f32, z / side as f32]);
+        }
+    }
+    let mut loops = Vec::with_capacity(side * side * 4 * LOOP_LEN);
+    let mut polys = Vec::with_capacity(side * side * normals::POLY_LEN);
+    let index = |r: usize, c: usize| (r * (side + 1) + c) as i32;
+    for r in 0..side {
+        for c in 0..side {
+            polys.extend_from_slice(&[(loops.len() / LOOP_LEN) as i32, 4]);
+            for v in [
+                index(r, c),
+                index(r + 1, c),
+                index(r + 1, c + 1),
+                index(r, c + 1),
+            ] {
+                loops.extend_from_slice(&[v, 0, 0, 0, 0]);
+            }
+        }
+    }
+    (verts, loops, polys)
+}
+
+fn bench_normals(c: &mut Criterion) {
+    let mut group = c.benchmark_group("mesh_normals");
+    group.sample_size(20);
+    for side in SIDES {
+        let (mut verts, loops, polys) = grid(side);
+        let verts_num = verts.len() / normals::VERT_LEN;
+        group.throughput(Throughput::Elements(verts_num as u64));
+
+        for weight in [NormalWeight::Area, NormalWeight::Angle] {
+            let id = BenchmarkId::new(format!("vertex_{weight:?}"), verts_num);
+            group.bench_function(id, |bench| {
+                bench.iter(|| normals::vertex_normals(&mut verts, &loops, &polys, weight))
+            });
+        }
+
+        let mut tangents = vec![0.0f32; loops.len() / LOOP_LEN * 4];
+        let mesh = MeshArrays {
+            verts: &verts,
+            loops: &loops,
+            polys: &polys,
+        };
+        group.bench_function(BenchmarkId::new("tangents", verts_num), |bench| {
+            bench.iter(|| mikktspace::tangents(mesh, &mut tangents))
+        });
+    }
+    group.finish();
+}
+
+fn main() {
+    common::run(&[bench_normals]);
+}
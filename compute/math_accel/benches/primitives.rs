@@ -0,0 +1,77 @@
+//! Primitives from 10k to 10M faces, the largest being the size of the stress scenes. Run with
+//! `cargo bench -p math_accel --bench primitives`.
+
+mod common;
+
+use common::{BenchmarkId, Criterion, Throughput};
+
+use math_accel::normals::{LOOP_LEN, POLY_LEN, VERT_LEN};
+use math_accel::primitives::{self, EDGE_LEN, Primitive};
+
+/* Segments around, about faces / segments rings. */
+const SIDES: [usize; 3] = [100, 1_000, 3_163];
+
+fn shapes(side: usize) -> [(&'static str, Primitive); 4] {
+    [
+        (
+            "grid",
+            Primitive::Grid {
+                x_segments: side,
+                z_segments: side,
+                size: 2.0,
+            },
+        ),
+        (
+            "uv_sphere",
+            Primitive::UvSphere {
+                segments: side,
+                rings: side,
+                radius: 1.0,
+            },
+        ),
+        (
+            "torus",
+            Primitive::Torus {
+                major_segments: side,
+                minor_segments: side,
+                major_radius: 1.0,
+                minor_radius: 0.25,
+            },
+        ),
+        (
+            "cylinder",
+            Primitive::Cylinder {
+                segments: side,
+                rings: side,
+                radius: 1.0,
+                depth: 2.0,
+            },
+        ),
+    ]
+}
+
+fn bench_primitives(c: &mut Criterion) {
+    let mut group = c.benchmark_group("mesh_primitives");
+    group.sample_size(10);
+    for side in SIDES {
+        for (name, primitive) in shapes(side) {
+            let counts = primitive.counts();
+            /* Allocated once, like the caller's arrays, so only the generation is timed. */
+            let mut verts = vec![0.0f32; counts.verts * VERT_LEN];
+            let mut edges = vec![0i32; counts.edges * EDGE_LEN];
+            let mut loops = vec![0i32; counts.corners * LOOP_LEN];
+            let mut polys = vec![0i32; counts.faces * POLY_LEN];
+            group.throughput(Throughput::Elements(counts.faces as u64));
+            group.bench_function(BenchmarkId::new(name, counts.faces), |bench| {
+                bench.iter(|| {
+                    primitives::generate(primitive, &mut verts, &mut edges, &mut loops, &mut polys)
+                })
+            });
+        }
+    }
+    group.finish();
+}
+
+fn main() {
+    common::run(&[bench_primitives]);
+}
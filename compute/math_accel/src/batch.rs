@@ -0,0 +1,432 @@
+//! Batched 4×4 matrix kernels.
+//!
+//! Matrices are processed [`BLOCK`] at a time in SoA form: within a block, component `k` of
+//! every matrix is stored contiguously, so one SIMD register holds the same component of
+//! several matrices and a multiply costs one multiply-add per component instead of shuffles.
+//! The AoS functions transpose each block on the stack, callers that keep their data blocked
+//! use the `*_blocked` functions directly.
+//!
+//! The instruction set is picked once at runtime, see [`detected_isa`].
+
+use std::sync::OnceLock;
+
+use rayon::prelude::*;
+use wide::f32x8;
+
+#[cfg(target_arch = "x86_64")]
+use std::arch::x86_64::*;
+
+/// Matrices per SoA block, one AVX-512 register or two `f32x8`.
+pub const BLOCK: usize = 16;
+/// Floats in a block of matrices.
+pub const BLOCK_MAT4_LEN: usize = BLOCK * 16;
+/// Floats in a block of 4D vectors.
+pub const BLOCK_VEC4_LEN: usize = BLOCK * 4;
+
+/// Matrices per rayon task, the inputs and outputs of a task (96 KiB) stay in L2.
+const TASK_MATRICES: usize = 512;
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Isa {
+    /// `wide::f32x8`, two SSE registers on x86_64 and NEON on ARM.
+    Baseline,
+    /// AVX2 with FMA, one `__m256` per eight matrices.
+    Avx2,
+    /// AVX-512F, one `__m512` per block.
+    Avx512,
+}
+
+/// The widest instruction set the CPU supports, detected on the first call.
+pub fn detected_isa() -> Isa {
+    static ISA: OnceLock<Isa> = OnceLock::new();
+    *ISA.get_or_init(|| {
+        #[cfg(target_arch = "x86_64")]
+        {
+            if is_x86_feature_detected!("avx512f") {
+                return Isa::Avx512;
+            }
+            if is_x86_feature_detected!("avx2") && is_x86_feature_detected!("fma") {
+                return Isa::Avx2;
+            }
+        }
+        Isa::Baseline
+    })
+}
+
+/// Instruction sets usable on this CPU, narrowest first, for tests and benchmarks.
+pub fn available_isas() -> Vec<Isa> {
+    let mut isas = vec![Isa::Baseline];
+    #[cfg(target_arch = "x86_64")]
+    {
+        if is_x86_feature_detected!("avx2") && is_x86_feature_detected!("fma") {
+            isas.push(Isa::Avx2);
+        }
+        if is_x86_feature_detected!("avx512f") {
+            isas.push(Isa::Avx512);
+        }
+    }
+    isas
+}
+
+/// One SIMD register of floats. The methods are always inlined so that they are compiled with
+/// the target features of the kernel they end up in.
+trait Lanes: Copy {
+    const WIDTH: usize;
+    unsafe fn load(ptr: *const f32) -> Self;
+    unsafe fn store(self, ptr: *mut f32);
+    unsafe fn mul(self, other: Self) -> Self;
+    /// `self * m + a`.
+    unsafe fn mul_add(self, m: Self, a: Self) -> Self;
+}
+
+impl Lanes for f32x8 {
+    const WIDTH: usize = 8;
+    #[inline(always)]
+    unsafe fn load(ptr: *const f32) -> Self {
+        f32x8::from(unsafe { ptr.cast::<[f32; 8]>().read_unaligned() })
+    }
+    #[inline(always)]
+    unsafe fn store(self, ptr: *mut f32) {
+        unsafe { ptr.cast::<[f32; 8]>().write_unaligned(self.to_array()) }
+    }
+    #[inline(always)]
+    unsafe fn mul(self, other: Self) -> Self {
+        self * other
+    }
+    #[inline(always)]
+    unsafe fn mul_add(self, m: Self, a: Self) -> Self {
+        self * m + a
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+impl Lanes for __m256 {
+    const WIDTH: usize = 8;
+    #[inline(always)]
+    unsafe fn load(ptr: *const f32) -> Self {
+        unsafe { _mm256_loadu_ps(ptr) }
+    }
+    #[inline(always)]
+    unsafe fn store(self, ptr: *mut f32) {
+        unsafe { _mm256_storeu_ps(ptr, self) }
+    }
+    #[inline(always)]
+    unsafe fn mul(self, other: Self) -> Self {
+        unsafe { _mm256_mul_ps(self, other) }
+    }
+    #[inline(always)]
+    unsafe fn mul_add(self, m: Self, a: Self) -> Self {
+        unsafe { _mm256_fmadd_ps(self, m, a) }
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+impl Lanes for __m512 {
+    const WIDTH: usize = 16;
+    #[inline(always)]
+    unsafe fn load(ptr: *const f32) -> Self {
+        unsafe { _mm512_loadu_ps(ptr) }
+    }
+    #[inline(always)]
+    unsafe fn store(self, ptr: *mut f32) {
+        unsafe { _mm512_storeu_ps(ptr, self) }
+    }
+    #[inline(always)]
+    unsafe fn mul(self, other: Self) -> Self {
+        unsafe { _mm512_mul_ps(self, other) }
+    }
+    #[inline(always)]
+    unsafe fn mul_add(self, m: Self, a: Self) -> Self {
+        unsafe { _mm512_fmadd_ps(self, m, a) }
+    }
+}
+
+/* `out = a * b` for one block, column-major: out[c][r] = sum over k of a[k][r] * b[c][k]. */
+#[inline(always)]
+unsafe fn multiply_block<L: Lanes>(a: *const f32, b: *const f32, out: *mut f32) {
+    unsafe {
+        let mut lane = 0;
+        while lane < BLOCK {
+            let a_cols: [L; 16] = std::array::from_fn(|k| L::load(a.add(k * BLOCK + lane)));
+            for c in 0..4 {
+                let b_col: [L; 4] =
+                    std::array::from_fn(|k| L::load(b.add((c * 4 + k) * BLOCK + lane)));
+                for r in 0..4 {
+                    let mut v = a_cols[r].mul(b_col[0]);
+                    v = a_cols[4 + r].mul_add(b_col[1], v);
+                    v = a_cols[8 + r].mul_add(b_col[2], v);
+                    v = a_cols[12 + r].mul_add(b_col[3], v);
+                    v.store(out.add((c * 4 + r) * BLOCK + lane));
+                }
+            }
+            lane += L::WIDTH;
+        }
+    }
+}
+
+/* `out = m * v` for one block of matrices and vectors. */
+#[inline(always)]
+unsafe fn transform_block<L: Lanes>(m: *const f32, v: *const f32, out: *mut f32) {
+    unsafe {
+        let mut lane = 0;
+        while lane < BLOCK {
+            let v_comps: [L; 4] = std::array::from_fn(|k| L::load(v.add(k * BLOCK + lane)));
+            for r in 0..4 {
+                let mut o = L::load(m.add(r * BLOCK + lane)).mul(v_comps[0]);
+                o = L::load(m.add((4 + r) * BLOCK + lane)).mul_add(v_comps[1], o);
+                o = L::load(m.add((8 + r) * BLOCK + lane)).mul_add(v_comps[2], o);
+                o = L::load(m.add((12 + r) * BLOCK + lane)).mul_add(v_comps[3], o);
+                o.store(out.add(r * BLOCK + lane));
+            }
+            lane += L::WIDTH;
+        }
+    }
+}
+
+/* Every kernel is compiled once per instruction set, the `#[target_feature]` wrappers let the
+ * intrinsics inline. */
+macro_rules! dispatch_kernel {
+    ($name:ident, $kernel:ident) => {
+        mod $name {
+            use super::*;
+
+            #[inline(always)]
+            unsafe fn run<L: Lanes>(a: *const f32, b: *const f32, out: *mut f32) {
+                unsafe { $kernel::<L>(a, b, out) }
+            }
+
+            #[cfg(target_arch = "x86_64")]
+            #[target_feature(enable = "avx2,fma")]
+            unsafe fn run_avx2(a: *const f32, b: *const f32, out: *mut f32) {
+                unsafe { run::<__m256>(a, b, out) }
+            }
+
+            #[cfg(target_arch = "x86_64")]
+            #[target_feature(enable = "avx512f")]
+            unsafe fn run_avx512(a: *const f32, b: *const f32, out: *mut f32) {
+                unsafe { run::<__m512>(a, b, out) }
+            }
+
+            /// Caller guarantees the block sizes and that `isa` is supported.
+            #[inline]
+            pub(super) unsafe fn call(isa: Isa, a: *const f32, b: *const f32, out: *mut f32) {
+                unsafe {
+                    match isa {
+                        #[cfg(target_arch = "x86_64")]
+                        Isa::Avx2 => run_avx2(a, b, out),
+                        #[cfg(target_arch = "x86_64")]
+                        Isa::Avx512 => run_avx512(a, b, out),
+                        _ => run::<f32x8>(a, b, out),
+                    }
+                }
+            }
+        }
+    };
+}
+
+dispatch_kernel!(multiply_kernel, multiply_block);
+dispatch_kernel!(transform_kernel, transform_block);
+
+/* Copy `count` (at most BLOCK) AoS items of `width` floats into a block, zero padded. */
+#[inline(always)]
+fn aos_to_block(aos: &[f32], width: usize, block: &mut [f32]) {
+    let count = aos.len() / width;
+    if count < BLOCK {
+        block.fill(0.0);
+    }
+    for j in 0..count {
+        for k in 0..width {
+            block[k * BLOCK + j] = aos[j * width + k];
+        }
+    }
+}
+
+#[inline(always)]
+fn block_to_aos(block: &[f32], width: usize, aos: &mut [f32]) {
+    let count = aos.len() / width;
+    for j in 0..count {
+        for k in 0..width {
+            aos[j * width + k] = block[k * BLOCK + j];
+        }
+    }
+}
+
+fn check_isa(isa: Isa) {
+    assert!(
+        available_isas().contains(&isa),
+        "{isa:?} is not supported by this CPU"
+    );
+}
+
+/// `out[i] = a[i] * b[i]` for column-major AoS matrices, 16 floats each.
+pub fn multiply_matrices(a: &[f32], b: &[f32], out: &mut [f32]) {
+    multiply_matrices_with(detected_isa(), a, b, out);
+}
+
+/// [`multiply_matrices`] with a given instruction set.
+pub fn multiply_matrices_with(isa: Isa, a: &[f32], b: &[f32], out: &mut [f32]) {
+    check_isa(isa);
+    assert!(a.len() == out.len() && b.len() == out.len() && out.len() % 16 == 0);
+
+    out.par_chunks_mut(TASK_MATRICES * 16)
+        .enumerate()
+        .for_each(|(task, out_task)| {
+            let base = task * TASK_MATRICES * 16;
+            let mut a_block = [0.0f32; BLOCK_MAT4_LEN];
+            let mut b_block = [0.0f32; BLOCK_MAT4_LEN];
+            let mut out_block = [0.0f32; BLOCK_MAT4_LEN];
+            for (i, out_aos) in out_task.chunks_mut(BLOCK_MAT4_LEN).enumerate() {
+                let range = base + i * BLOCK_MAT4_LEN..base + i * BLOCK_MAT4_LEN + out_aos.len();
+                aos_to_block(&a[range.clone()], 16, &mut a_block);
+                aos_to_block(&b[range], 16, &mut b_block);
+                unsafe {
+                    multiply_kernel::call(
+                        isa,
+                        a_block.as_ptr(),
+                        b_block.as_ptr(),
+                        out_block.as_mut_ptr(),
+                    );
+                }
+                block_to_aos(&out_block, 16, out_aos);
+            }
+        });
+}
+
+/// `out[i] = m[i] * v[i]` for column-major AoS matrices and 4D vectors.
+pub fn transform_vectors(m: &[f32], v: &[f32], out: &mut [f32]) {
+    transform_vectors_with(detected_isa(), m, v, out);
+}
+
+/// [`transform_vectors`] with a given instruction set.
+pub fn transform_vectors_with(isa: Isa, m: &[f32], v: &[f32], out: &mut [f32]) {
+    check_isa(isa);
+    assert!(v.len() == out.len() && m.len() == out.len() * 4 && out.len() % 4 == 0);
+
+    out.par_chunks_mut(TASK_MATRICES * 4)
+        .enumerate()
+        .for_each(|(task, out_task)| {
+            let base = task * TASK_MATRICES;
+            let mut m_block = [0.0f32; BLOCK_MAT4_LEN];
+            let mut v_block = [0.0f32; BLOCK_VEC4_LEN];
+            let mut out_block = [0.0f32; BLOCK_VEC4_LEN];
+            for (i, out_aos) in out_task.chunks_mut(BLOCK_VEC4_LEN).enumerate() {
+                let first = base + i * BLOCK;
+                let count = out_aos.len() / 4;
+                aos_to_block(&m[first * 16..(first + count) * 16], 16, &mut m_block);
+                aos_to_block(&v[first * 4..(first + count) * 4], 4, &mut v_block);
+                unsafe {
+                    transform_kernel::call(
+                        isa,
+                        m_block.as_ptr(),
+                        v_block.as_ptr(),
+                        out_block.as_mut_ptr(),
+                    );
+                }
+                block_to_aos(&out_block, 4, out_aos);
+            }
+        });
+}
+
+/// [`multiply_matrices`] for data already in blocks of [`BLOCK_MAT4_LEN`] floats, component
+/// `k` of matrix `j` of a block at `k * BLOCK + j`. No transposes.
+pub fn multiply_matrices_blocked(a: &[f32], b: &[f32], out: &mut [f32]) {
+    let isa = detected_isa();
+    assert!(a.len() == out.len() && b.len() == out.len() && out.len() % BLOCK_MAT4_LEN == 0);
+
+    out.par_chunks_mut(TASK_MATRICES * 16)
+        .enumerate()
+        .for_each(|(task, out_task)| {
+            let base = task * TASK_MATRICES * 16;
+            for offset in (0..out_task.len()).step_by(BLOCK_MAT4_LEN) {
+                unsafe {
+                    multiply_kernel::call(
+                        isa,
+                        a.as_ptr().add(base + offset),
+                        b.as_ptr().add(base + offset),
+                        out_task.as_mut_ptr().add(offset),
+                    );
+                }
+            }
+        });
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn pattern(len: usize, seed: f32) -> Vec<f32> {
+        (0..len)
+            .map(|i| ((i as f32 * 0.37 + seed).sin() * 4.0).round() * 0.25)
+            .collect()
+    }
+
+    fn multiply_scalar(a: &[f32], b: &[f32]) -> Vec<f32> {
+        let mut out = vec![0.0; a.len()];
+        for m in (0..a.len()).step_by(16) {
+            for c in 0..4 {
+                for r in 0..4 {
+                    out[m + c * 4 + r] = (0..4).map(|k| a[m + k * 4 + r] * b[m + c * 4 + k]).sum();
+                }
+            }
+        }
+        out
+    }
+
+    #[test]
+    fn multiply_matches_scalar_on_every_isa() {
+        /* Values are multiples of 0.25, the products are exact in any order. */
+        for count in [1, 15, 16, 17, 600, 1100] {
+            let a = pattern(count * 16, 0.5);
+            let b = pattern(count * 16, 1.5);
+            let expected = multiply_scalar(&a, &b);
+            for isa in available_isas() {
+                let mut out = vec![0.0; count * 16];
+                multiply_matrices_with(isa, &a, &b, &mut out);
+                assert_eq!(out, expected, "{isa:?}, {count} matrices");
+            }
+        }
+    }
+
+    #[test]
+    fn transform_matches_scalar_on_every_isa() {
+        for count in [3, 16, 530] {
+            let m = pattern(count * 16, 0.25);
+            let v = pattern(count * 4, 2.0);
+            let mut expected = vec![0.0; count * 4];
+            for i in 0..count {
+                for r in 0..4 {
+                    expected[i * 4 + r] =
+                        (0..4).map(|k| m[i * 16 + k * 4 + r] * v[i * 4 + k]).sum();
+                }
+            }
+            for isa in available_isas() {
+                let mut out = vec![0.0; count * 4];
+                transform_vectors_with(isa, &m, &v, &mut out);
+                assert_eq!(out, expected, "{isa:?}, {count} vectors");
+            }
+        }
+    }
+
+    #[test]
+    fn blocked_matches_aos() {
+        let count = BLOCK * 3;
+        let a = pattern(count * 16, 0.75);
+        let b = pattern(count * 16, 3.0);
+        let mut out = vec![0.0; count * 16];
+        multiply_matrices(&a, &b, &mut out);
+
+        let to_blocked = |aos: &[f32]| {
+            let mut blocked = vec![0.0; aos.len()];
+            for (src, dst) in aos
+                .chunks(BLOCK_MAT4_LEN)
+                .zip(blocked.chunks_mut(BLOCK_MAT4_LEN))
+            {
+                aos_to_block(src, 16, dst);
+            }
+            blocked
+        };
+        let mut out_blocked = vec![0.0; count * 16];
+        multiply_matrices_blocked(&to_blocked(&a), &to_blocked(&b), &mut out_blocked);
+        assert_eq!(out_blocked, to_blocked(&out));
+    }
+}
@@ -0,0 +1,237 @@
+//! Frustum culling of bounding spheres and boxes in SoA form, eight objects per step, with the
+//! indices of the visible objects compacted into one list.
+
+use rayon::prelude::*;
+use wide::*;
+
+/// Objects per rayon task, a multiple of the lane count.
+const OBJECTS_PER_TASK: usize = 4096;
+/// Below this, culling runs on the calling thread.
+const MIN_OBJECTS_PARALLEL: usize = 2 * OBJECTS_PER_TASK;
+
+/// Bounding spheres, one column per component.
+#[derive(Clone, Copy)]
+pub struct Spheres<'a> {
+    pub xs: &'a [f32],
+    pub ys: &'a [f32],
+    pub zs: &'a [f32],
+    pub radii: &'a [f32],
+}
+
+/// Axis aligned boxes, one column per component of the min and max corners.
+#[derive(Clone, Copy)]
+pub struct Boxes<'a> {
+    pub min: [&'a [f32]; 3],
+    pub max: [&'a [f32]; 3],
+}
+
+/* Eight values of a column from `first`, zero padded past the end. */
+#[inline(always)]
+fn load(column: &[f32], first: usize) -> f32x8 {
+    match column.get(first..first + 8) {
+        Some(lanes) => f32x8::from(<[f32; 8]>::try_from(lanes).unwrap()),
+        None => {
+            let mut lanes = [0.0f32; 8];
+            let tail = &column[first..];
+            lanes[..tail.len()].copy_from_slice(tail);
+            f32x8::from(lanes)
+        }
+    }
+}
+
+/* Append the objects of `first..end` whose lane is set in `visible_lanes(i)` to `out`, eight
+ * at a time. Returns how many were written. */
+fn cull_range(
+    first: usize,
+    end: usize,
+    out: &mut [u32],
+    visible_lanes: &(impl Fn(usize) -> u32 + Sync),
+) -> usize {
+    let mut written = 0;
+    let mut i = first;
+    while i < end {
+        let mut bits = visible_lanes(i);
+        if end - i < 8 {
+            bits &= (1 << (end - i)) - 1;
+        }
+        while bits != 0 {
+            out[written] = (i + bits.trailing_zeros() as usize) as u32;
+            written += 1;
+            bits &= bits - 1;
+        }
+        i += 8;
+    }
+    written
+}
+
+/* Every task compacts into its own part of `visible`, the parts are then moved together. */
+fn cull(count: usize, visible: &mut [u32], visible_lanes: impl Fn(usize) -> u32 + Sync) -> usize {
+    assert!(visible.len() >= count);
+    if count < MIN_OBJECTS_PARALLEL {
+        return cull_range(0, count, visible, &visible_lanes);
+    }
+    let written: Vec<usize> = visible[..count]
+        .par_chunks_mut(OBJECTS_PER_TASK)
+        .enumerate()
+        .map(|(task, out)| {
+            let first = task * OBJECTS_PER_TASK;
+            cull_range(first, first + out.len(), out, &visible_lanes)
+        })
+        .collect();
+
+    let mut total = 0;
+    for (task, &n) in written.iter().enumerate() {
+        let first = task * OBJECTS_PER_TASK;
+        visible.copy_within(first..first + n, total);
+        total += n;
+    }
+    total
+}
+
+/// Write the indices of the spheres that are not fully outside one of `planes` to the front of
+/// `visible`, in increasing order, and return their number. `visible` holds at least one entry
+/// per sphere.
+///
+/// Planes are `(a, b, c, d)` with unit normals and the inside at `a * x + b * y + c * z + d >=
+/// 0`, in the space of the spheres.
+pub fn cull_spheres(spheres: Spheres, planes: &[[f32; 4]; 6], visible: &mut [u32]) -> usize {
+    let count = spheres.xs.len();
+    assert!(spheres.ys.len() == count && spheres.zs.len() == count);
+    assert!(spheres.radii.len() == count);
+    let planes = planes.map(|p| p.map(f32x8::splat));
+
+    cull(count, visible, |first| {
+        let x = load(spheres.xs, first);
+        let y = load(spheres.ys, first);
+        let z = load(spheres.zs, first);
+        let neg_radius = -load(spheres.radii, first);
+        let mut inside = neg_radius.cmp_eq(neg_radius);
+        for [a, b, c, d] in &planes {
+            let distance = *a * x + *b * y + *c * z + *d;
+            inside = inside & distance.cmp_ge(neg_radius);
+        }
+        inside.move_mask() as u32
+    })
+}
+
+/// Like [`cull_spheres`] for boxes. A box is culled when its corner furthest along the normal
+/// of a plane is outside of it.
+pub fn cull_boxes(boxes: Boxes, planes: &[[f32; 4]; 6], visible: &mut [u32]) -> usize {
+    let count = boxes.min[0].len();
+    assert!(
+        boxes
+            .min
+            .iter()
+            .chain(&boxes.max)
+            .all(|column| column.len() == count)
+    );
+
+    cull(count, visible, |first| {
+        let min = boxes.min.map(|column| load(column, first));
+        let max = boxes.max.map(|column| load(column, first));
+        let zero = f32x8::splat(0.0);
+        let mut inside = zero.cmp_eq(zero);
+        for plane in planes {
+            /* The corner is picked per plane, the same for every lane. */
+            let mut distance = f32x8::splat(plane[3]);
+            for k in 0..3 {
+                let corner = if plane[k] >= 0.0 { max[k] } else { min[k] };
+                distance += f32x8::splat(plane[k]) * corner;
+            }
+            inside = inside & distance.cmp_ge(zero);
+        }
+        inside.move_mask() as u32
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /* A box frustum, -10..10 on every axis, with planes facing inwards. */
+    const PLANES: [[f32; 4]; 6] = [
+        [1.0, 0.0, 0.0, 10.0],
+        [-1.0, 0.0, 0.0, 10.0],
+        [0.0, 1.0, 0.0, 10.0],
+        [0.0, -1.0, 0.0, 10.0],
+        [0.0, 0.0, 1.0, 10.0],
+        [0.0, 0.0, -1.0, 10.0],
+    ];
+
+    fn distance(plane: &[f32; 4], p: [f32; 3]) -> f32 {
+        plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] + plane[3]
+    }
+
+    /* Objects scattered around the frustum, enough for the parallel path. */
+    fn columns(count: usize) -> [Vec<f32>; 4] {
+        let value = |i: usize, k: usize| ((i * 4 + k) as f32 * 0.618).sin() * 14.0;
+        std::array::from_fn(|k| {
+            (0..count)
+                .map(|i| {
+                    if k == 3 {
+                        value(i, k).abs() * 0.2
+                    } else {
+                        value(i, k)
+                    }
+                })
+                .collect()
+        })
+    }
+
+    #[test]
+    fn spheres_match_reference() {
+        for count in [0, 5, 8, 1003, MIN_OBJECTS_PARALLEL * 2 + 13] {
+            let [xs, ys, zs, radii] = columns(count);
+            let spheres = Spheres {
+                xs: &xs,
+                ys: &ys,
+                zs: &zs,
+                radii: &radii,
+            };
+            let mut visible = vec![u32::MAX; count];
+            let n = cull_spheres(spheres, &PLANES, &mut visible);
+
+            let expected: Vec<u32> = (0..count)
+                .filter(|&i| {
+                    let p = [xs[i], ys[i], zs[i]];
+                    PLANES.iter().all(|plane| distance(plane, p) >= -radii[i])
+                })
+                .map(|i| i as u32)
+                .collect();
+            assert_eq!(&visible[..n], &expected[..], "{count} spheres");
+            assert!(count < 100 || (n > count / 4 && n < count));
+        }
+    }
+
+    #[test]
+    fn boxes_match_reference() {
+        for count in [3, 16, MIN_OBJECTS_PARALLEL + 7] {
+            let [xs, ys, zs, sizes] = columns(count);
+            let max: [Vec<f32>; 3] =
+                [&xs, &ys, &zs].map(|c| c.iter().zip(&sizes).map(|(v, s)| v + s).collect());
+            let boxes = Boxes {
+                min: [&xs, &ys, &zs],
+                max: [&max[0], &max[1], &max[2]],
+            };
+            let mut visible = vec![0; count];
+            let n = cull_boxes(boxes, &PLANES, &mut visible);
+
+            /* Any corner inside a plane keeps the box for that plane. */
+            let expected: Vec<u32> = (0..count)
+                .filter(|&i| {
+                    PLANES.iter().all(|plane| {
+                        (0..8).any(|corner| {
+                            let p: [f32; 3] = std::array::from_fn(|k| {
+                                let lo = [xs[i], ys[i], zs[i]][k];
+                                if corner >> k & 1 == 1 { max[k][i] } else { lo }
+                            });
+                            distance(plane, p) >= 0.0
+                        })
+                    })
+                })
+                .map(|i| i as u32)
+                .collect();
+            assert_eq!(&visible[..n], &expected[..], "{count} boxes");
+        }
+    }
+}
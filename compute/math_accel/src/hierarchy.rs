@@ -0,0 +1,173 @@
+use rayon::prelude::*;
+
+use crate::simd;
+
+/// Parent index of a root node.
+pub const NO_PARENT: u32 = u32::MAX;
+
+/// Nodes per rayon task, levels smaller than this run on the calling thread.
+const MIN_NODES_PER_TASK: usize = 256;
+
+/// Evaluate world matrices of a hierarchy. A root's world matrix is its local matrix, any other
+/// node's is its parent's world matrix times its local matrix. Matrices are column-major, 16
+/// floats per node.
+///
+/// `parents[i]` is [`NO_PARENT`] or the index of an earlier node. Consecutive nodes of the same
+/// depth are evaluated in parallel, so breadth first order, where every depth is one run, gives
+/// the most parallelism. Any order with parents before their children is correct.
+pub fn solve_world_matrices(locals: &[f32], parents: &[u32], worlds: &mut [f32]) {
+    let count = parents.len();
+    assert!(locals.len() >= count * 16 && worlds.len() >= count * 16);
+
+    let mut depths = vec![0u32; count];
+    for i in 0..count {
+        let parent = parents[i];
+        if parent != NO_PARENT {
+            assert!(
+                (parent as usize) < i,
+                "node {i} comes before its parent {parent}"
+            );
+            depths[i] = depths[parent as usize] + 1;
+        }
+    }
+
+    /* A parent is one level up, so it always lies in an earlier run than its children. */
+    let mut start = 0;
+    while start < count {
+        let mut end = start + 1;
+        while end < count && depths[end] == depths[start] {
+            end += 1;
+        }
+        let (done, level) = worlds[..end * 16].split_at_mut(start * 16);
+        level
+            .par_chunks_exact_mut(16)
+            .with_min_len(MIN_NODES_PER_TASK)
+            .enumerate()
+            .for_each(|(k, world)| {
+                let i = start + k;
+                let local = &locals[i * 16..i * 16 + 16];
+                match parents[i] {
+                    NO_PARENT => world.copy_from_slice(local),
+                    parent => {
+                        let parent = parent as usize;
+                        let parent_world = &done[parent * 16..parent * 16 + 16];
+                        unsafe {
+                            simd::multiply_matrices_simd(
+                                parent_world.as_ptr(),
+                                local.as_ptr(),
+                                world.as_mut_ptr(),
+                            );
+                        }
+                    }
+                }
+            });
+        start = end;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn multiply_scalar(a: &[f32], b: &[f32]) -> [f32; 16] {
+        let mut out = [0.0; 16];
+        for col in 0..4 {
+            for row in 0..4 {
+                out[col * 4 + row] = (0..4).map(|k| a[k * 4 + row] * b[col * 4 + k]).sum();
+            }
+        }
+        out
+    }
+
+    /* Walks up to the root for every node, independent of the evaluation order. */
+    fn solve_scalar(locals: &[f32], parents: &[u32]) -> Vec<f32> {
+        let mut worlds = vec![0.0; parents.len() * 16];
+        for i in 0..parents.len() {
+            let mut world: [f32; 16] = std::array::from_fn(|k| locals[i * 16 + k]);
+            let mut node = parents[i];
+            while node != NO_PARENT {
+                let n = node as usize;
+                world = multiply_scalar(&locals[n * 16..n * 16 + 16], &world);
+                node = parents[n];
+            }
+            worlds[i * 16..i * 16 + 16].copy_from_slice(&world);
+        }
+        worlds
+    }
+
+    /* Rotation about z, a small scale and a translation, from a simple LCG. */
+    fn random_locals(count: usize) -> Vec<f32> {
+        let mut state = 12345u32;
+        let mut next = || {
+            state = state.wrapping_mul(1664525).wrapping_add(1013904223);
+            (state >> 8) as f32 / (1u32 << 24) as f32
+        };
+        let mut locals = Vec::with_capacity(count * 16);
+        for _ in 0..count {
+            let (s, c) = (next() * 6.28).sin_cos();
+            let scale = 0.9 + next() * 0.2;
+            locals.extend_from_slice(&[
+                c * scale,
+                s * scale,
+                0.0,
+                0.0,
+                -s * scale,
+                c * scale,
+                0.0,
+                0.0,
+                0.0,
+                0.0,
+                scale,
+                0.0,
+                next() - 0.5,
+                next() - 0.5,
+                next() - 0.5,
+                1.0,
+            ]);
+        }
+        locals
+    }
+
+    fn assert_matches_reference(parents: &[u32]) {
+        let locals = random_locals(parents.len());
+        let mut worlds = vec![0.0; parents.len() * 16];
+        solve_world_matrices(&locals, parents, &mut worlds);
+        let expected = solve_scalar(&locals, parents);
+        for (i, (a, b)) in worlds.iter().zip(&expected).enumerate() {
+            assert!(
+                (a - b).abs() <= 1e-3 * b.abs().max(1.0),
+                "float {i}: {a} != {b}"
+            );
+        }
+    }
+
+    #[test]
+    fn breadth_first_tree_matches_reference() {
+        /* Three roots, every node has up to four children. */
+        let mut parents = vec![NO_PARENT; 3];
+        for i in 3..3000 {
+            parents.push(((i - 3) / 4) as u32);
+        }
+        assert_matches_reference(&parents);
+    }
+
+    #[test]
+    fn chain_and_depth_first_order_match_reference() {
+        let chain: Vec<u32> = (0..64u32)
+            .map(|i| if i == 0 { NO_PARENT } else { i - 1 })
+            .collect();
+        assert_matches_reference(&chain);
+
+        /* Depth first: depths go up and down, every run is short. */
+        let depth_first = [NO_PARENT, 0, 1, 1, 0, 4, 5, NO_PARENT, 7, 8, 7];
+        assert_matches_reference(&depth_first);
+    }
+
+    #[test]
+    fn roots_copy_their_local_matrix() {
+        let locals = random_locals(5);
+        let mut worlds = vec![0.0; 5 * 16];
+        solve_world_matrices(&locals, &[NO_PARENT; 5], &mut worlds);
+        assert_eq!(worlds, locals);
+    }
+}
@@ -1,54 +1,92 @@
+pub mod batch;
+pub mod bounds;
+pub mod cull;
+pub mod hierarchy;
+pub mod mikktspace;
+pub mod normals;
+pub mod primitives;
+pub mod runtime;
+pub mod select;
 pub mod simd;
+pub mod transform;
 
 use rayon::prelude::*;
 
+/// World matrices of `count` hierarchy nodes, see [`hierarchy::solve_world_matrices`].
+/// `parents` holds the parent index of each node, [`hierarchy::NO_PARENT`] for roots, parents
+/// before their children, ideally breadth first.
 pub unsafe extern "C" fn vk_compute_world_matrices(
     locals: *const f32,
+    parents: *const u32,
     worlds: *mut f32,
     count: usize,
 ) {
+    let _timer = runtime::time(runtime::Kernel::WorldMatrices);
     let locals_slice = unsafe { std::slice::from_raw_parts(locals, count * 16) };
+    let parents_slice = unsafe { std::slice::from_raw_parts(parents, count) };
     let worlds_slice = unsafe { std::slice::from_raw_parts_mut(worlds, count * 16) };
 
-    worlds_slice
-        .par_chunks_exact_mut(16)
-        .enumerate()
-        .for_each(|(i, world_chunk)| {
-            let local_chunk = &locals_slice[i * 16..i * 16 + 16];
-            unsafe {
-                simd::multiply_matrices_simd(
-                    local_chunk.as_ptr(),
-                    local_chunk.as_ptr(),
-                    world_chunk.as_mut_ptr(),
-                );
-            }
-        });
+    runtime::install(|| hierarchy::solve_world_matrices(locals_slice, parents_slice, worlds_slice));
+}
+
+/// Local and world matrices of `count` rows of a transform table, see
+/// [`transform::compute_transforms`]. `columns` holds [`transform::TRANSFORM_COLUMNS`] columns
+/// of `stride` floats.
+pub unsafe extern "C" fn vk_compute_transforms(
+    columns: *const f32,
+    stride: usize,
+    parents: *const u32,
+    locals: *mut f32,
+    worlds: *mut f32,
+    count: usize,
+) {
+    let _timer = runtime::time(runtime::Kernel::Transforms);
+    let columns_slice =
+        unsafe { std::slice::from_raw_parts(columns, transform::TRANSFORM_COLUMNS * stride) };
+    let parents_slice = unsafe { std::slice::from_raw_parts(parents, count) };
+    let locals_slice = unsafe { std::slice::from_raw_parts_mut(locals, count * 16) };
+    let worlds_slice = unsafe { std::slice::from_raw_parts_mut(worlds, count * 16) };
+
+    runtime::install(|| {
+        transform::compute_transforms(
+            columns_slice,
+            stride,
+            parents_slice,
+            locals_slice,
+            worlds_slice,
+        )
+    });
 }
 
+/// `outs[i] = a[i] * b[i]` for `count` column-major matrices, see [`batch::multiply_matrices`].
+pub unsafe extern "C" fn vk_multiply_matrices(
+    a: *const f32,
+    b: *const f32,
+    outs: *mut f32,
+    count: usize,
+) {
+    let _timer = runtime::time(runtime::Kernel::MultiplyMatrices);
+    let a_slice = unsafe { std::slice::from_raw_parts(a, count * 16) };
+    let b_slice = unsafe { std::slice::from_raw_parts(b, count * 16) };
+    let outs_slice = unsafe { std::slice::from_raw_parts_mut(outs, count * 16) };
+
+    runtime::install(|| batch::multiply_matrices(a_slice, b_slice, outs_slice));
+}
+
+/// `outs[i] = matrices[i] * vectors[i]` for `count` column-major matrices and 4D vectors, see
+/// [`batch::transform_vectors`].
 pub unsafe extern "C" fn vk_compute_matrix_vector_muls(
     matrices: *const f32,
     vectors: *const f32,
     outs: *mut f32,
     count: usize,
 ) {
+    let _timer = runtime::time(runtime::Kernel::MatrixVectorMuls);
     let mats_slice = unsafe { std::slice::from_raw_parts(matrices, count * 16) };
     let vecs_slice = unsafe { std::slice::from_raw_parts(vectors, count * 4) };
     let outs_slice = unsafe { std::slice::from_raw_parts_mut(outs, count * 4) };
 
-    outs_slice
-        .par_chunks_exact_mut(4)
-        .enumerate()
-        .for_each(|(i, out_chunk)| {
-            let mat_chunk = &mats_slice[i * 16..i * 16 + 16];
-            let vec_chunk = &vecs_slice[i * 4..i * 4 + 4];
-            unsafe {
-                simd::multiply_matrix_vector_simd(
-                    mat_chunk.as_ptr(),
-                    vec_chunk.as_ptr(),
-                    out_chunk.as_mut_ptr(),
-                );
-            }
-        });
+    runtime::install(|| batch::transform_vectors(mats_slice, vecs_slice, outs_slice));
 }
 
 pub unsafe extern "C" fn vk_add_vectors(
@@ -57,20 +95,27 @@ pub unsafe extern "C" fn vk_add_vectors(
     outs: *mut f32,
     count: usize,
 ) {
+    let _timer = runtime::time(runtime::Kernel::AddVectors);
     let a_slice = unsafe { std::slice::from_raw_parts(a_vecs, count * 4) };
     let b_slice = unsafe { std::slice::from_raw_parts(b_vecs, count * 4) };
     let outs_slice = unsafe { std::slice::from_raw_parts_mut(outs, count * 4) };
 
-    outs_slice
-        .par_chunks_exact_mut(4)
-        .enumerate()
-        .for_each(|(i, out_chunk)| {
-            let a_chunk = &a_slice[i * 4..i * 4 + 4];
-            let b_chunk = &b_slice[i * 4..i * 4 + 4];
-            unsafe {
-                simd::add_vectors_simd(a_chunk.as_ptr(), b_chunk.as_ptr(), out_chunk.as_mut_ptr());
-            }
-        });
+    runtime::install(|| {
+        outs_slice
+            .par_chunks_exact_mut(4)
+            .enumerate()
+            .for_each(|(i, out_chunk)| {
+                let a_chunk = &a_slice[i * 4..i * 4 + 4];
+                let b_chunk = &b_slice[i * 4..i * 4 + 4];
+                unsafe {
+                    simd::add_vectors_simd(
+                        a_chunk.as_ptr(),
+                        b_chunk.as_ptr(),
+                        out_chunk.as_mut_ptr(),
+                    );
+                }
+            });
+    });
 }
 
 pub unsafe extern "C" fn vk_dot_products(
@@ -79,19 +124,337 @@ pub unsafe extern "C" fn vk_dot_products(
     outs: *mut f32,
     count: usize,
 ) {
+    let _timer = runtime::time(runtime::Kernel::DotProducts);
     let a_slice = unsafe { std::slice::from_raw_parts(a_vecs, count * 4) };
     let b_slice = unsafe { std::slice::from_raw_parts(b_vecs, count * 4) };
     let outs_slice = unsafe { std::slice::from_raw_parts_mut(outs, count) };
 
     // par_iter over elements instead of chunks because output is 1 f32 per vector
-    outs_slice
-        .par_iter_mut()
-        .enumerate()
-        .for_each(|(i, out_val)| {
-            let a_chunk = &a_slice[i * 4..i * 4 + 4];
-            let b_chunk = &b_slice[i * 4..i * 4 + 4];
-            unsafe {
-                *out_val = simd::dot_product_simd(a_chunk.as_ptr(), b_chunk.as_ptr());
-            }
+    runtime::install(|| {
+        outs_slice
+            .par_iter_mut()
+            .enumerate()
+            .for_each(|(i, out_val)| {
+                let a_chunk = &a_slice[i * 4..i * 4 + 4];
+                let b_chunk = &b_slice[i * 4..i * 4 + 4];
+                unsafe {
+                    *out_val = simd::dot_product_simd(a_chunk.as_ptr(), b_chunk.as_ptr());
+                }
+            });
+    });
+}
+
+/// The `MVert` arrays of the `count` objects of a selection kernel, read in place.
+unsafe fn select_object_verts<'a>(
+    verts: *const *const f32,
+    verts_nums: *const usize,
+    count: usize,
+) -> Vec<&'a [f32]> {
+    let verts_slice = unsafe { std::slice::from_raw_parts(verts, count) };
+    let verts_nums_slice = unsafe { std::slice::from_raw_parts(verts_nums, count) };
+    verts_slice
+        .iter()
+        .zip(verts_nums_slice)
+        .map(|(&points, &points_num)| match points_num {
+            0 => &[][..],
+            _ => unsafe { std::slice::from_raw_parts(points, points_num * normals::VERT_LEN) },
+        })
+        .collect()
+}
+
+/// Region selection narrow phase: `hits[i]` becomes 1 when any vertex of object `i` lies inside
+/// that object's six planes (24 floats per object, already in the object's local space).
+/// `verts[i]` points to the `MVert` array of object `i` and `verts_nums[i]` is its length, the
+/// arrays are read in place. Objects run in parallel.
+pub unsafe extern "C" fn vk_select_points_in_frustum(
+    verts: *const *const f32,
+    verts_nums: *const usize,
+    planes: *const f32,
+    hits: *mut u8,
+    count: usize,
+) {
+    let _timer = runtime::time(runtime::Kernel::SelectFrustum);
+    let objects = unsafe { select_object_verts(verts, verts_nums, count) };
+    let planes_slice = unsafe { std::slice::from_raw_parts(planes, count * 24) };
+    let hits_slice = unsafe { std::slice::from_raw_parts_mut(hits, count) };
+
+    runtime::install(|| {
+        hits_slice.par_iter_mut().enumerate().for_each(|(i, hit)| {
+            let object_planes: [[f32; 4]; 6] = std::array::from_fn(|p| {
+                let base = i * 24 + p * 4;
+                [
+                    planes_slice[base],
+                    planes_slice[base + 1],
+                    planes_slice[base + 2],
+                    planes_slice[base + 3],
+                ]
+            });
+            *hit =
+                select::any_point_in_frustum(objects[i], normals::VERT_LEN, &object_planes) as u8;
         });
-}
\ No newline at end of file
+    });
+}
+
+/// Lasso selection narrow phase: `hits[i]` becomes 1 when any vertex of object `i` projects
+/// inside `polygon` (`polygon_count` xy pairs in pixels, origin top-left). `matrices` holds one
+/// column-major model-view-projection per object. Same vertex arrays as
+/// [`vk_select_points_in_frustum`].
+pub unsafe extern "C" fn vk_select_points_in_polygon(
+    verts: *const *const f32,
+    verts_nums: *const usize,
+    matrices: *const f32,
+    viewport_width: f32,
+    viewport_height: f32,
+    polygon: *const f32,
+    polygon_count: usize,
+    hits: *mut u8,
+    count: usize,
+) {
+    let _timer = runtime::time(runtime::Kernel::SelectPolygon);
+    let objects = unsafe { select_object_verts(verts, verts_nums, count) };
+    let matrices_slice = unsafe { std::slice::from_raw_parts(matrices, count * 16) };
+    let polygon_slice: Vec<[f32; 2]> =
+        unsafe { std::slice::from_raw_parts(polygon, polygon_count * 2) }
+            .chunks_exact(2)
+            .map(|xy| [xy[0], xy[1]])
+            .collect();
+    let hits_slice = unsafe { std::slice::from_raw_parts_mut(hits, count) };
+
+    runtime::install(|| {
+        hits_slice.par_iter_mut().enumerate().for_each(|(i, hit)| {
+            let mvp: [f32; 16] = std::array::from_fn(|k| matrices_slice[i * 16 + k]);
+            *hit = select::any_point_in_polygon(
+                objects[i],
+                normals::VERT_LEN,
+                &mvp,
+                [viewport_width, viewport_height],
+                &polygon_slice,
+            ) as u8;
+        });
+    });
+}
+
+/// Unit normals of the `faces_num` faces of a `dna::Mesh`, 3 floats each, see
+/// [`normals::face_normals`]. `verts`, `loops` and `polys` point to the `MVert`, `MLoop` and
+/// `MPoly` arrays.
+pub unsafe extern "C" fn vk_mesh_face_normals(
+    verts: *const f32,
+    verts_num: usize,
+    loops: *const i32,
+    corners_num: usize,
+    polys: *const i32,
+    faces_num: usize,
+    normals_out: *mut f32,
+) {
+    let _timer = runtime::time(runtime::Kernel::FaceNormals);
+    let mesh = unsafe { mesh_arrays(verts, verts_num, loops, corners_num, polys, faces_num) };
+    let normals_slice = unsafe { std::slice::from_raw_parts_mut(normals_out, faces_num * 3) };
+
+    runtime::install(|| normals::face_normals(mesh, normals_slice));
+}
+
+/// Recompute `MVert::no` of a `dna::Mesh` in place, see [`normals::vertex_normals`].
+pub unsafe extern "C" fn vk_mesh_vertex_normals(
+    verts: *mut f32,
+    verts_num: usize,
+    loops: *const i32,
+    corners_num: usize,
+    polys: *const i32,
+    faces_num: usize,
+    angle_weighted: bool,
+) {
+    let _timer = runtime::time(runtime::Kernel::VertexNormals);
+    let verts_slice =
+        unsafe { std::slice::from_raw_parts_mut(verts, verts_num * normals::VERT_LEN) };
+    let loops_slice = unsafe { std::slice::from_raw_parts(loops, corners_num * normals::LOOP_LEN) };
+    let polys_slice = unsafe { std::slice::from_raw_parts(polys, faces_num * normals::POLY_LEN) };
+    let weight = if angle_weighted {
+        normals::NormalWeight::Angle
+    } else {
+        normals::NormalWeight::Area
+    };
+
+    runtime::install(|| normals::vertex_normals(verts_slice, loops_slice, polys_slice, weight));
+}
+
+/// Tangent and bitangent sign of every face corner of a `dna::Mesh`, 4 floats each, see
+/// [`mikktspace::tangents`].
+pub unsafe extern "C" fn vk_mesh_tangents(
+    verts: *const f32,
+    verts_num: usize,
+    loops: *const i32,
+    corners_num: usize,
+    polys: *const i32,
+    faces_num: usize,
+    tangents_out: *mut f32,
+) {
+    let _timer = runtime::time(runtime::Kernel::Tangents);
+    let mesh = unsafe { mesh_arrays(verts, verts_num, loops, corners_num, polys, faces_num) };
+    let tangents_slice = unsafe { std::slice::from_raw_parts_mut(tangents_out, corners_num * 4) };
+
+    runtime::install(|| mikktspace::tangents(mesh, tangents_slice));
+}
+
+/// Local box of a `dna::Mesh` (`verts` points to its `MVert` array) into `bounds_out[..6]`,
+/// the radius of the sphere around the box center into `bounds_out[6]`, see
+/// [`bounds::mesh_bounds`].
+pub unsafe extern "C" fn vk_mesh_bounds(verts: *const f32, verts_num: usize, bounds_out: *mut f32) {
+    let _timer = runtime::time(runtime::Kernel::MeshBounds);
+    let verts_slice = unsafe { std::slice::from_raw_parts(verts, verts_num * normals::VERT_LEN) };
+    let bounds_slice = unsafe { std::slice::from_raw_parts_mut(bounds_out, bounds::BOX_LEN + 1) };
+
+    let (local, radius) = runtime::install(|| bounds::mesh_bounds(verts_slice));
+    bounds_slice[..bounds::BOX_LEN].copy_from_slice(&local);
+    bounds_slice[bounds::BOX_LEN] = radius;
+}
+
+/// World boxes of `count` local boxes under one column-major matrix each, see
+/// [`bounds::transform_boxes`].
+pub unsafe extern "C" fn vk_transform_bounds(
+    boxes: *const f32,
+    matrices: *const f32,
+    worlds: *mut f32,
+    count: usize,
+) {
+    let _timer = runtime::time(runtime::Kernel::TransformBounds);
+    let boxes_slice = unsafe { std::slice::from_raw_parts(boxes, count * bounds::BOX_LEN) };
+    let matrices_slice = unsafe { std::slice::from_raw_parts(matrices, count * 16) };
+    let worlds_slice = unsafe { std::slice::from_raw_parts_mut(worlds, count * bounds::BOX_LEN) };
+
+    runtime::install(|| bounds::transform_boxes(boxes_slice, matrices_slice, worlds_slice));
+}
+
+/// Frustum culling of `count` spheres given as columns, see [`cull::cull_spheres`]. `planes`
+/// holds six `(a, b, c, d)` planes, `visible` room for `count` indices. Returns the number of
+/// visible spheres.
+pub unsafe extern "C" fn vk_cull_spheres(
+    xs: *const f32,
+    ys: *const f32,
+    zs: *const f32,
+    radii: *const f32,
+    count: usize,
+    planes: *const f32,
+    visible: *mut u32,
+) -> usize {
+    let _timer = runtime::time(runtime::Kernel::CullSpheres);
+    let column = |values: *const f32| unsafe { std::slice::from_raw_parts(values, count) };
+    let spheres = cull::Spheres {
+        xs: column(xs),
+        ys: column(ys),
+        zs: column(zs),
+        radii: column(radii),
+    };
+    let planes_array = unsafe { cull_planes(planes) };
+    let visible_slice = unsafe { std::slice::from_raw_parts_mut(visible, count) };
+
+    runtime::install(|| cull::cull_spheres(spheres, &planes_array, visible_slice))
+}
+
+/// Frustum culling of `count` boxes, `mins` and `maxs` point to the x, y and z columns of the
+/// corners, see [`cull::cull_boxes`]. Same planes and output as [`vk_cull_spheres`].
+pub unsafe extern "C" fn vk_cull_boxes(
+    mins: *const *const f32,
+    maxs: *const *const f32,
+    count: usize,
+    planes: *const f32,
+    visible: *mut u32,
+) -> usize {
+    let _timer = runtime::time(runtime::Kernel::CullBoxes);
+    let columns = |corner: *const *const f32| -> [&[f32]; 3] {
+        std::array::from_fn(|k| unsafe { std::slice::from_raw_parts(*corner.add(k), count) })
+    };
+    let boxes = cull::Boxes {
+        min: columns(mins),
+        max: columns(maxs),
+    };
+    let planes_array = unsafe { cull_planes(planes) };
+    let visible_slice = unsafe { std::slice::from_raw_parts_mut(visible, count) };
+
+    runtime::install(|| cull::cull_boxes(boxes, &planes_array, visible_slice))
+}
+
+/// Sizes of the `dna::Mesh` arrays of a primitive into `counts_out`: vertices, edges, faces and
+/// corners. See [`primitives::Primitive::from_parameters`] for the parameters.
+pub unsafe extern "C" fn vk_mesh_primitive_counts(
+    kind: u32,
+    segments: usize,
+    rings: usize,
+    size: f32,
+    depth: f32,
+    counts_out: *mut usize,
+) {
+    let primitive = mesh_primitive(kind, segments, rings, size, depth);
+    let counts = primitive.counts();
+    let counts_slice = unsafe { std::slice::from_raw_parts_mut(counts_out, 4) };
+
+    counts_slice.copy_from_slice(&[counts.verts, counts.edges, counts.faces, counts.corners]);
+}
+
+/// Fill the `MVert`, `MEdge`, `MLoop` and `MPoly` arrays of a primitive, sized by
+/// [`vk_mesh_primitive_counts`], see [`primitives::generate`].
+pub unsafe extern "C" fn vk_mesh_primitive(
+    kind: u32,
+    segments: usize,
+    rings: usize,
+    size: f32,
+    depth: f32,
+    verts: *mut f32,
+    edges: *mut i32,
+    loops: *mut i32,
+    polys: *mut i32,
+) {
+    let _timer = runtime::time(runtime::Kernel::MeshPrimitive);
+    let primitive = mesh_primitive(kind, segments, rings, size, depth);
+    let counts = primitive.counts();
+    let verts_slice =
+        unsafe { std::slice::from_raw_parts_mut(verts, counts.verts * normals::VERT_LEN) };
+    let edges_slice =
+        unsafe { std::slice::from_raw_parts_mut(edges, counts.edges * primitives::EDGE_LEN) };
+    let loops_slice =
+        unsafe { std::slice::from_raw_parts_mut(loops, counts.corners * normals::LOOP_LEN) };
+    let polys_slice =
+        unsafe { std::slice::from_raw_parts_mut(polys, counts.faces * normals::POLY_LEN) };
+
+    runtime::install(|| {
+        primitives::generate(
+            primitive,
+            verts_slice,
+            edges_slice,
+            loops_slice,
+            polys_slice,
+        )
+    });
+}
+
+fn mesh_primitive(
+    kind: u32,
+    segments: usize,
+    rings: usize,
+    size: f32,
+    depth: f32,
+) -> primitives::Primitive {
+    primitives::Primitive::from_parameters(kind, segments, rings, size, depth)
+        .unwrap_or_else(|| panic!("unknown primitive kind {kind}"))
+}
+
+unsafe fn cull_planes(planes: *const f32) -> [[f32; 4]; 6] {
+    let planes_slice = unsafe { std::slice::from_raw_parts(planes, 24) };
+    std::array::from_fn(|p| std::array::from_fn(|k| planes_slice[p * 4 + k]))
+}
+
+unsafe fn mesh_arrays<'a>(
+    verts: *const f32,
+    verts_num: usize,
+    loops: *const i32,
+    corners_num: usize,
+    polys: *const i32,
+    faces_num: usize,
+) -> normals::MeshArrays<'a> {
+    unsafe {
+        normals::MeshArrays {
+            verts: std::slice::from_raw_parts(verts, verts_num * normals::VERT_LEN),
+            loops: std::slice::from_raw_parts(loops, corners_num * normals::LOOP_LEN),
+            polys: std::slice::from_raw_parts(polys, faces_num * normals::POLY_LEN),
+        }
+    }
+}
@@ -0,0 +1,1254 @@
+//! Tangents with MikkTSpace, the tangent space normal maps are baked in by most tools, ported
+//! from Morten S. Mikkelsen's reference implementation (`genTangSpaceDefault`, the default
+//! angular threshold of 180 degrees) and read straight from the arrays of `dna::Mesh`.
+//!
+//! The steps and their order follow the reference, so that float results agree with it:
+//!
+//! 1. Triangles and quads are passed on as faces, quads split along their shorter uv diagonal.
+//!    N-gons are ear clipped and every triangle becomes a face of its own, as Blender feeds
+//!    them to MikkTSpace.
+//! 2. Corners with equal position, normal and uv are welded into one vertex.
+//! 3. Triangles with two equal positions are degenerate and set aside.
+//! 4. Every healthy triangle gets the tangent and bitangent of its uv mapping and a flag for
+//!    whether the mapping preserves orientation. Both triangles of a quad are forced to agree.
+//! 5. At every vertex, triangles connected through shared edges and with the same orientation
+//!    form a group. Each group gets the angle weighted average of its triangles' tangents
+//!    projected into the vertex normal.
+//! 6. Degenerate triangles copy the result of a healthy triangle at the same vertex.
+//!
+//! The per triangle derivatives run in parallel. The grouping walks the mesh and runs on one
+//! thread, like the reference.
+
+use std::collections::HashMap;
+use std::hash::{BuildHasherDefault, Hasher};
+use std::ops::Range;
+
+use rayon::prelude::*;
+
+use crate::normals::MeshArrays;
+
+const MIN_TRIS_PER_TASK: usize = 1024;
+
+type Vec3 = [f32; 3];
+
+/* Vector helpers with the operation order of the reference. */
+
+#[inline(always)]
+fn vadd(a: Vec3, b: Vec3) -> Vec3 {
+    [a[0] + b[0], a[1] + b[1], a[2] + b[2]]
+}
+
+#[inline(always)]
+fn vsub(a: Vec3, b: Vec3) -> Vec3 {
+    [a[0] - b[0], a[1] - b[1], a[2] - b[2]]
+}
+
+#[inline(always)]
+fn vscale(s: f32, a: Vec3) -> Vec3 {
+    [s * a[0], s * a[1], s * a[2]]
+}
+
+#[inline(always)]
+fn vdot(a: Vec3, b: Vec3) -> f32 {
+    a[0] * b[0] + a[1] * b[1] + a[2] * b[2]
+}
+
+#[inline(always)]
+fn length(a: Vec3) -> f32 {
+    vdot(a, a).sqrt()
+}
+
+#[inline(always)]
+fn normalize(a: Vec3) -> Vec3 {
+    vscale(1.0 / length(a), a)
+}
+
+#[inline(always)]
+fn not_zero(x: f32) -> bool {
+    x.abs() > f32::MIN_POSITIVE
+}
+
+#[inline(always)]
+fn vnot_zero(a: Vec3) -> bool {
+    not_zero(a[0]) || not_zero(a[1]) || not_zero(a[2])
+}
+
+/* `a` projected into the plane of the unit vector `n`, normalized unless it vanishes. */
+#[inline(always)]
+fn project(n: Vec3, a: Vec3) -> Vec3 {
+    let p = vsub(a, vscale(vdot(n, a), n));
+    if vnot_zero(p) { normalize(p) } else { p }
+}
+
+const MARK_DEGENERATE: u8 = 1;
+const QUAD_ONE_DEGEN_TRI: u8 = 2;
+const GROUP_WITH_ANY: u8 = 4;
+const ORIENT_PRESERVING: u8 = 8;
+
+const NO_GROUP: u32 = u32::MAX;
+
+/* A face as MikkTSpace sees it: a triangle or a quad of mesh corners. */
+#[derive(Clone, Copy)]
+struct Face {
+    corners: [u32; 4],
+    len: u8,
+}
+
+#[derive(Clone, Copy)]
+struct TriInfo {
+    /* The triangle across edge `i`, from corner `i` to corner `i + 1`, or -1. */
+    neighbors: [i32; 3],
+    /* The group of corner `i`, or `NO_GROUP`. */
+    groups: [u32; 3],
+    os: Vec3,
+    ot: Vec3,
+    mag_s: f32,
+    mag_t: f32,
+    face: u32,
+    /* First tangent space of `face`. */
+    offset: u32,
+    /* Corners of `face` the triangle is made of. */
+    verts: [u8; 3],
+    flag: u8,
+}
+
+struct Group {
+    vert: u32,
+    orient_preserving: bool,
+    tris: Range<usize>,
+}
+
+#[derive(Clone, Copy)]
+struct TSpace {
+    os: Vec3,
+    mag_s: f32,
+    ot: Vec3,
+    mag_t: f32,
+    counter: u8,
+    orient: bool,
+}
+
+impl Default for TSpace {
+    fn default() -> Self {
+        TSpace {
+            os: [1.0, 0.0, 0.0],
+            mag_s: 1.0,
+            ot: [0.0, 1.0, 0.0],
+            mag_t: 1.0,
+            counter: 0,
+            orient: false,
+        }
+    }
+}
+
+/* Welded geometry: every corner maps to the lowest vertex with the same position, normal and
+ * uv, compared exactly as the reference does. */
+struct Welded<'a> {
+    mesh: MeshArrays<'a>,
+    verts: Vec<u32>,
+}
+
+impl Welded<'_> {
+    #[inline(always)]
+    fn corner(&self, corner: u32) -> u32 {
+        self.verts[self.mesh.corner_vert(corner as usize)]
+    }
+
+    #[inline(always)]
+    fn position(&self, vert: u32) -> Vec3 {
+        self.mesh.position(vert as usize)
+    }
+
+    #[inline(always)]
+    fn normal(&self, vert: u32) -> Vec3 {
+        self.mesh.normal(vert as usize)
+    }
+
+    #[inline(always)]
+    fn uv(&self, vert: u32) -> [f32; 2] {
+        self.mesh.uv(vert as usize)
+    }
+}
+
+/* Multiplicative hashing of the float bits, far cheaper than SipHash on a million keys. */
+#[derive(Default)]
+struct WeldHasher(u64);
+
+impl Hasher for WeldHasher {
+    fn finish(&self) -> u64 {
+        self.0
+    }
+
+    fn write(&mut self, bytes: &[u8]) {
+        for chunk in bytes.chunks(8) {
+            let mut word = [0u8; 8];
+            word[..chunk.len()].copy_from_slice(chunk);
+            self.0 = (self.0.rotate_left(5) ^ u64::from_le_bytes(word))
+                .wrapping_mul(0x517c_c1b7_2722_0a95);
+        }
+    }
+}
+
+fn weld(mesh: MeshArrays) -> Vec<u32> {
+    let mut first = HashMap::with_capacity_and_hasher(
+        mesh.verts_num(),
+        BuildHasherDefault::<WeldHasher>::default(),
+    );
+    (0..mesh.verts_num())
+        .map(|vert| {
+            let (p, n, uv) = (mesh.position(vert), mesh.normal(vert), mesh.uv(vert));
+            /* Adding zero turns -0 into +0, which compare equal. */
+            let key =
+                [p[0], p[1], p[2], n[0], n[1], n[2], uv[0], uv[1]].map(|x| (x + 0.0).to_bits());
+            *first.entry(key).or_insert(vert as u32)
+        })
+        .collect()
+}
+
+fn cross2(o: [f32; 2], a: [f32; 2], b: [f32; 2]) -> f32 {
+    (a[0] - o[0]) * (b[1] - o[1]) - (a[1] - o[1]) * (b[0] - o[0])
+}
+
+/* Ear clipping of an n-gon in the plane it faces most, triangles of mesh corners in the
+ * winding of the face. Faces without a clean ear left, self intersecting or degenerate ones,
+ * are clipped at the next corner. */
+fn triangulate(mesh: MeshArrays, corners: Range<usize>, r_faces: &mut Vec<Face>) {
+    let n = mesh.face_normal_scaled(corners.clone());
+    let axis = (0..3)
+        .max_by(|&a, &b| n[a].abs().total_cmp(&n[b].abs()))
+        .unwrap();
+    /* Counter clockwise in the projection, whichever way the face points. */
+    let (u, v) = if n[axis] < 0.0 {
+        ((axis + 2) % 3, (axis + 1) % 3)
+    } else {
+        ((axis + 1) % 3, (axis + 2) % 3)
+    };
+    let points: Vec<[f32; 2]> = corners
+        .clone()
+        .map(|c| {
+            let p = mesh.position(mesh.corner_vert(c));
+            [p[u], p[v]]
+        })
+        .collect();
+
+    let is_ear = |remaining: &[usize], i: usize| {
+        let m = remaining.len();
+        let (a, b, c) = (
+            remaining[(i + m - 1) % m],
+            remaining[i],
+            remaining[(i + 1) % m],
+        );
+        let (pa, pb, pc) = (points[a], points[b], points[c]);
+        if cross2(pa, pb, pc) <= 0.0 {
+            return false;
+        }
+        remaining.iter().all(|&k| {
+            k == a
+                || k == b
+                || k == c
+                || cross2(pa, pb, points[k]) < 0.0
+                || cross2(pb, pc, points[k]) < 0.0
+                || cross2(pc, pa, points[k]) < 0.0
+        })
+    };
+
+    let corner = |i: usize| (corners.start + i) as u32;
+    let mut remaining: Vec<usize> = (0..points.len()).collect();
+    let (mut i, mut misses) = (0, 0);
+    while remaining.len() > 3 {
+        let m = remaining.len();
+        if misses < m && !is_ear(&remaining, i) {
+            i = (i + 1) % m;
+            misses += 1;
+            continue;
+        }
+        let (a, b, c) = (
+            remaining[(i + m - 1) % m],
+            remaining[i],
+            remaining[(i + 1) % m],
+        );
+        r_faces.push(Face {
+            corners: [corner(a), corner(b), corner(c), 0],
+            len: 3,
+        });
+        remaining.remove(i);
+        i %= m - 1;
+        misses = 0;
+    }
+    r_faces.push(Face {
+        corners: [
+            corner(remaining[0]),
+            corner(remaining[1]),
+            corner(remaining[2]),
+            0,
+        ],
+        len: 3,
+    });
+}
+
+fn mikk_faces(mesh: MeshArrays) -> Vec<Face> {
+    let mut faces = Vec::with_capacity(mesh.faces_num());
+    for face in 0..mesh.faces_num() {
+        let corners = mesh.face_corners(face);
+        match corners.len() {
+            3 | 4 => {
+                let mut face = Face {
+                    corners: [0; 4],
+                    len: corners.len() as u8,
+                };
+                for (i, corner) in corners.enumerate() {
+                    face.corners[i] = corner as u32;
+                }
+                faces.push(face);
+            }
+            len if len > 4 => triangulate(mesh, corners, &mut faces),
+            _ => {}
+        }
+    }
+    faces
+}
+
+/* GenerateInitialVerticesIndexList: triangles of welded vertices, quads split along the
+ * shorter uv diagonal, or position diagonal on a tie. Returns the number of tangent spaces. */
+fn initial_triangles(
+    welded: &Welded,
+    faces: &[Face],
+    tris: &mut Vec<TriInfo>,
+    tri_verts: &mut Vec<u32>,
+) -> usize {
+    let mut offset = 0;
+    for (f, face) in faces.iter().enumerate() {
+        let mut push = |verts: [u8; 3]| {
+            tris.push(TriInfo {
+                neighbors: [-1; 3],
+                groups: [NO_GROUP; 3],
+                os: [0.0; 3],
+                ot: [0.0; 3],
+                mag_s: 0.0,
+                mag_t: 0.0,
+                face: f as u32,
+                offset: offset as u32,
+                verts,
+                flag: 0,
+            });
+            for v in verts {
+                tri_verts.push(welded.corner(face.corners[v as usize]));
+            }
+        };
+        if face.len == 3 {
+            push([0, 1, 2]);
+        } else {
+            let vert = |i: usize| welded.mesh.corner_vert(face.corners[i] as usize);
+            let distance_squared = |a: [f32; 2], b: [f32; 2]| {
+                let d = [b[0] - a[0], b[1] - a[1]];
+                d[0] * d[0] + d[1] * d[1]
+            };
+            let uv = |i: usize| welded.mesh.uv(vert(i));
+            let uv_02 = distance_squared(uv(0), uv(2));
+            let uv_13 = distance_squared(uv(1), uv(3));
+            let diagonal_02 = if uv_02 < uv_13 {
+                true
+            } else if uv_13 < uv_02 {
+                false
+            } else {
+                let p = |i: usize| welded.mesh.position(vert(i));
+                let (d02, d13) = (vsub(p(2), p(0)), vsub(p(3), p(1)));
+                !(vdot(d13, d13) < vdot(d02, d02))
+            };
+            if diagonal_02 {
+                push([0, 1, 2]);
+                push([0, 2, 3]);
+            } else {
+                push([0, 1, 3]);
+                push([1, 2, 3]);
+            }
+        }
+        offset += face.len as usize;
+    }
+    offset
+}
+
+/* DegenPrologue: flags quads with exactly one degenerate triangle and moves the healthy
+ * triangles to the front, in order. Returns their number. */
+fn set_degenerate_aside(tris: &mut Vec<TriInfo>, tri_verts: &mut Vec<u32>) -> usize {
+    if tris.iter().all(|tri| tri.flag & MARK_DEGENERATE == 0) {
+        return tris.len();
+    }
+    let mut t = 0;
+    while t + 1 < tris.len() {
+        if tris[t].face == tris[t + 1].face {
+            let degenerate_a = tris[t].flag & MARK_DEGENERATE != 0;
+            let degenerate_b = tris[t + 1].flag & MARK_DEGENERATE != 0;
+            if degenerate_a != degenerate_b {
+                tris[t].flag |= QUAD_ONE_DEGEN_TRI;
+                tris[t + 1].flag |= QUAD_ONE_DEGEN_TRI;
+            }
+            t += 2;
+        } else {
+            t += 1;
+        }
+    }
+
+    let order: Vec<usize> = (0..tris.len())
+        .filter(|&t| tris[t].flag & MARK_DEGENERATE == 0)
+        .chain((0..tris.len()).filter(|&t| tris[t].flag & MARK_DEGENERATE != 0))
+        .collect();
+    let good = order
+        .iter()
+        .take_while(|&&t| tris[t].flag & MARK_DEGENERATE == 0)
+        .count();
+    *tris = order.iter().map(|&t| tris[t]).collect();
+    let mut verts = Vec::with_capacity(tri_verts.len());
+    for &t in &order {
+        verts.extend_from_slice(&tri_verts[t * 3..t * 3 + 3]);
+    }
+    *tri_verts = verts;
+    good
+}
+
+fn tex_area(welded: &Welded, verts: &[u32]) -> f32 {
+    let (t1, t2, t3) = (
+        welded.uv(verts[0]),
+        welded.uv(verts[1]),
+        welded.uv(verts[2]),
+    );
+    let (t21x, t21y) = (t2[0] - t1[0], t2[1] - t1[1]);
+    let (t31x, t31y) = (t3[0] - t1[0], t3[1] - t1[1]);
+    (t21x * t31y - t21y * t31x).abs()
+}
+
+/* InitTriInfo: first order derivatives of every healthy triangle, quads forced to one
+ * orientation, then neighbors across edges. */
+fn init_tri_info(welded: &Welded, tris: &mut [TriInfo], tri_verts: &[u32]) {
+    tris.par_iter_mut()
+        .with_min_len(MIN_TRIS_PER_TASK)
+        .enumerate()
+        .for_each(|(t, tri)| {
+            tri.flag |= GROUP_WITH_ANY;
+            let verts = &tri_verts[t * 3..t * 3 + 3];
+            let (v1, v2, v3) = (
+                welded.position(verts[0]),
+                welded.position(verts[1]),
+                welded.position(verts[2]),
+            );
+            let (t1, t2, t3) = (
+                welded.uv(verts[0]),
+                welded.uv(verts[1]),
+                welded.uv(verts[2]),
+            );
+            let (t21x, t21y) = (t2[0] - t1[0], t2[1] - t1[1]);
+            let (t31x, t31y) = (t3[0] - t1[0], t3[1] - t1[1]);
+            let (d1, d2) = (vsub(v2, v1), vsub(v3, v1));
+
+            let signed_area = t21x * t31y - t21y * t31x;
+            let os = vsub(vscale(t31y, d1), vscale(t21y, d2));
+            let ot = vadd(vscale(-t31x, d1), vscale(t21x, d2));
+            if signed_area > 0.0 {
+                tri.flag |= ORIENT_PRESERVING;
+            }
+            if not_zero(signed_area) {
+                let abs_area = signed_area.abs();
+                let (len_os, len_ot) = (length(os), length(ot));
+                let s = if tri.flag & ORIENT_PRESERVING == 0 {
+                    -1.0
+                } else {
+                    1.0
+                };
+                if not_zero(len_os) {
+                    tri.os = vscale(s / len_os, os);
+                }
+                if not_zero(len_ot) {
+                    tri.ot = vscale(s / len_ot, ot);
+                }
+                tri.mag_s = len_os / abs_area;
+                tri.mag_t = len_ot / abs_area;
+                if not_zero(tri.mag_s) && not_zero(tri.mag_t) {
+                    tri.flag &= !GROUP_WITH_ANY;
+                }
+            }
+        });
+
+    let mut t = 0;
+    while t + 1 < tris.len() {
+        if tris[t].face != tris[t + 1].face {
+            t += 1;
+            continue;
+        }
+        let orient_a = tris[t].flag & ORIENT_PRESERVING != 0;
+        let orient_b = tris[t + 1].flag & ORIENT_PRESERVING != 0;
+        if orient_a != orient_b {
+            /* A quad with a badly folded mapping: the larger uv triangle decides. */
+            let first = tris[t + 1].flag & GROUP_WITH_ANY != 0
+                || tex_area(welded, &tri_verts[t * 3..t * 3 + 3])
+                    >= tex_area(welded, &tri_verts[t * 3 + 3..t * 3 + 6]);
+            let (t0, t1) = if first { (t, t + 1) } else { (t + 1, t) };
+            tris[t1].flag =
+                (tris[t1].flag & !ORIENT_PRESERVING) | (tris[t0].flag & ORIENT_PRESERVING);
+        }
+        t += 2;
+    }
+
+    build_neighbors(tris, tri_verts);
+}
+
+/* Which edge of the triangle `verts` joins `a` and `b`, and its corners in triangle order. */
+fn find_edge(verts: &[u32], a: u32, b: u32) -> (u32, u32, usize) {
+    if verts[0] == a || verts[0] == b {
+        if verts[1] == a || verts[1] == b {
+            (verts[0], verts[1], 0)
+        } else {
+            (verts[2], verts[0], 2)
+        }
+    } else {
+        (verts[1], verts[2], 1)
+    }
+}
+
+/* BuildNeighborsFast: edges sorted by their vertices and triangle, every edge paired with the
+ * first unpaired edge running the other way. */
+fn build_neighbors(tris: &mut [TriInfo], tri_verts: &[u32]) {
+    let mut edges: Vec<(u32, u32, u32)> = (0..tris.len() * 3)
+        .map(|e| {
+            let (t, i) = (e / 3, e % 3);
+            let (i0, i1) = (tri_verts[t * 3 + i], tri_verts[t * 3 + (i + 1) % 3]);
+            (i0.min(i1), i0.max(i1), t as u32)
+        })
+        .collect();
+    edges.par_sort_unstable();
+
+    for e in 0..edges.len() {
+        let (i0, i1, f) = edges[e];
+        let f = f as usize;
+        let (a0, a1, edge_a) = find_edge(&tri_verts[f * 3..f * 3 + 3], i0, i1);
+        if tris[f].neighbors[edge_a] != -1 {
+            continue;
+        }
+        for &(j0, j1, t) in &edges[e + 1..] {
+            if j0 != i0 || j1 != i1 {
+                break;
+            }
+            let t = t as usize;
+            let (b1, b0, edge_b) = find_edge(&tri_verts[t * 3..t * 3 + 3], j0, j1);
+            if a0 == b0 && a1 == b1 && tris[t].neighbors[edge_b] == -1 {
+                tris[f].neighbors[edge_a] = t as i32;
+                tris[t].neighbors[edge_b] = f as i32;
+                break;
+            }
+        }
+    }
+}
+
+#[inline(always)]
+fn corner_of(tri_verts: &[u32], t: usize, vert: u32) -> usize {
+    (0..3).find(|&i| tri_verts[t * 3 + i] == vert).unwrap()
+}
+
+/* AssignRecur, depth first with an explicit stack in the order of the reference's recursion:
+ * triangles around `group.vert` reachable through shared edges and with the group's
+ * orientation. A triangle without a mapping takes the orientation of the first group that
+ * reaches it. */
+fn assign_group(
+    tris: &mut [TriInfo],
+    tri_verts: &[u32],
+    group: u32,
+    vert: u32,
+    orient_preserving: bool,
+    start: [i32; 2],
+    stack: &mut Vec<i32>,
+    r_group_tris: &mut Vec<u32>,
+) {
+    stack.clear();
+    stack.extend_from_slice(&[start[1], start[0]]);
+    while let Some(t) = stack.pop() {
+        if t < 0 {
+            continue;
+        }
+        let t = t as usize;
+        let i = corner_of(tri_verts, t, vert);
+        let tri = &mut tris[t];
+        if tri.groups[i] != NO_GROUP {
+            continue;
+        }
+        if tri.flag & GROUP_WITH_ANY != 0 && tri.groups == [NO_GROUP; 3] {
+            tri.flag &= !ORIENT_PRESERVING;
+            if orient_preserving {
+                tri.flag |= ORIENT_PRESERVING;
+            }
+        }
+        if (tri.flag & ORIENT_PRESERVING != 0) != orient_preserving {
+            continue;
+        }
+        r_group_tris.push(t as u32);
+        tri.groups[i] = group;
+        stack.push(tri.neighbors[(i + 2) % 3]);
+        stack.push(tri.neighbors[i]);
+    }
+}
+
+/* Build4RuleGroups. */
+fn build_groups(
+    tris: &mut [TriInfo],
+    tri_verts: &[u32],
+    r_group_tris: &mut Vec<u32>,
+) -> Vec<Group> {
+    let mut groups = Vec::new();
+    let mut stack = Vec::new();
+    for f in 0..tris.len() {
+        for i in 0..3 {
+            if tris[f].flag & GROUP_WITH_ANY != 0 || tris[f].groups[i] != NO_GROUP {
+                continue;
+            }
+            let index = groups.len() as u32;
+            let vert = tri_verts[f * 3 + i];
+            let orient_preserving = tris[f].flag & ORIENT_PRESERVING != 0;
+            let start = r_group_tris.len();
+            tris[f].groups[i] = index;
+            r_group_tris.push(f as u32);
+            let neighbors = [tris[f].neighbors[i], tris[f].neighbors[(i + 2) % 3]];
+            assign_group(
+                tris,
+                tri_verts,
+                index,
+                vert,
+                orient_preserving,
+                neighbors,
+                &mut stack,
+                r_group_tris,
+            );
+            groups.push(Group {
+                vert,
+                orient_preserving,
+                tris: start..r_group_tris.len(),
+            });
+        }
+    }
+    groups
+}
+
+/* EvalTspace: the angle weighted average of the member triangles at `vert`. */
+fn eval_tspace(
+    welded: &Welded,
+    tris: &[TriInfo],
+    tri_verts: &[u32],
+    members: &[u32],
+    vert: u32,
+) -> TSpace {
+    let mut res = TSpace {
+        os: [0.0; 3],
+        mag_s: 0.0,
+        ot: [0.0; 3],
+        mag_t: 0.0,
+        counter: 0,
+        orient: false,
+    };
+    let mut angle_sum = 0.0f32;
+    for &f in members {
+        let f = f as usize;
+        if tris[f].flag & GROUP_WITH_ANY != 0 {
+            continue;
+        }
+        let i = corner_of(tri_verts, f, vert);
+        let n = welded.normal(tri_verts[f * 3 + i]);
+        let os = project(n, tris[f].os);
+        let ot = project(n, tris[f].ot);
+
+        let i2 = tri_verts[f * 3 + (i + 1) % 3];
+        let i1 = tri_verts[f * 3 + i];
+        let i0 = tri_verts[f * 3 + (i + 2) % 3];
+        let (p0, p1, p2) = (
+            welded.position(i0),
+            welded.position(i1),
+            welded.position(i2),
+        );
+        let v1 = project(n, vsub(p0, p1));
+        let v2 = project(n, vsub(p2, p1));
+
+        let cos = vdot(v1, v2).clamp(-1.0, 1.0);
+        let angle = (cos as f64).acos() as f32;
+        res.os = vadd(res.os, vscale(angle, os));
+        res.ot = vadd(res.ot, vscale(angle, ot));
+        res.mag_s += angle * tris[f].mag_s;
+        res.mag_t += angle * tris[f].mag_t;
+        angle_sum += angle;
+    }
+    if vnot_zero(res.os) {
+        res.os = normalize(res.os);
+    }
+    if vnot_zero(res.ot) {
+        res.ot = normalize(res.ot);
+    }
+    if angle_sum > 0.0 {
+        res.mag_s /= angle_sum;
+        res.mag_t /= angle_sum;
+    }
+    res
+}
+
+/* AvgTSpace, equal spaces are kept as they are so that rounding does not split them later. */
+fn average_tspace(a: &TSpace, b: &TSpace) -> TSpace {
+    if a.mag_s == b.mag_s && a.mag_t == b.mag_t && a.os == b.os && a.ot == b.ot {
+        return *a;
+    }
+    let mut res = *a;
+    res.mag_s = 0.5 * (a.mag_s + b.mag_s);
+    res.mag_t = 0.5 * (a.mag_t + b.mag_t);
+    res.os = vadd(a.os, b.os);
+    res.ot = vadd(a.ot, b.ot);
+    if vnot_zero(res.os) {
+        res.os = normalize(res.os);
+    }
+    if vnot_zero(res.ot) {
+        res.ot = normalize(res.ot);
+    }
+    res
+}
+
+/* GenerateTSpaces. With the default threshold of 180 degrees a group only splits into
+ * subgroups where projected tangents point exactly opposite ways. */
+fn generate_tspaces(
+    welded: &Welded,
+    tris: &[TriInfo],
+    tri_verts: &[u32],
+    groups: &[Group],
+    group_tris: &[u32],
+    tspaces: &mut [TSpace],
+) {
+    const THRESHOLD_COS: f32 = -1.0;
+    /* Scratch reused by all groups: the projected tangents of the group's triangles, and the
+     * subgroups found so far with their members. */
+    let mut projected: Vec<(Vec3, Vec3)> = Vec::new();
+    let mut subgroups: Vec<(Range<usize>, TSpace)> = Vec::new();
+    let mut subgroup_tris: Vec<u32> = Vec::new();
+    let mut members = Vec::new();
+    for (g, group) in groups.iter().enumerate() {
+        let group_tris = &group_tris[group.tris.clone()];
+        let n = welded.normal(group.vert);
+        projected.clear();
+        projected.extend(group_tris.iter().map(|&t| {
+            let tri = &tris[t as usize];
+            (project(n, tri.os), project(n, tri.ot))
+        }));
+        subgroups.clear();
+        subgroup_tris.clear();
+        for (&f, &(os, ot)) in group_tris.iter().zip(&projected) {
+            let f = f as usize;
+            let index = (0..3).find(|&i| tris[f].groups[i] == g as u32).unwrap();
+
+            members.clear();
+            for (&t, &(os2, ot2)) in group_tris.iter().zip(&projected) {
+                let other = &tris[t as usize];
+                let any = (tris[f].flag | other.flag) & GROUP_WITH_ANY != 0;
+                let same_face = tris[f].face == other.face;
+                if any
+                    || same_face
+                    || (vdot(os, os2) > THRESHOLD_COS && vdot(ot, ot2) > THRESHOLD_COS)
+                {
+                    members.push(t);
+                }
+            }
+            members.sort_unstable();
+
+            let found = subgroups
+                .iter()
+                .position(|(range, _)| subgroup_tris[range.clone()] == members[..]);
+            let l = match found {
+                Some(l) => l,
+                None => {
+                    let tspace = eval_tspace(welded, tris, tri_verts, &members, group.vert);
+                    let start = subgroup_tris.len();
+                    subgroup_tris.extend_from_slice(&members);
+                    subgroups.push((start..subgroup_tris.len(), tspace));
+                    subgroups.len() - 1
+                }
+            };
+
+            let out = &mut tspaces[(tris[f].offset + tris[f].verts[index] as u32) as usize];
+            let subgroup = &subgroups[l].1;
+            if out.counter == 1 {
+                *out = average_tspace(out, subgroup);
+                out.counter = 2;
+            } else {
+                *out = *subgroup;
+                out.counter = 1;
+            }
+            out.orient = group.orient_preserving;
+        }
+    }
+}
+
+/* DegenEpilogue: corners of degenerate triangles copy the space of the first healthy corner
+ * of the same vertex. The degenerate corner of a quad with one healthy triangle copies the
+ * corner at the same position. */
+fn fix_degenerate(
+    welded: &Welded,
+    faces: &[Face],
+    tris: &[TriInfo],
+    tri_verts: &[u32],
+    good: usize,
+    tspaces: &mut [TSpace],
+) {
+    if good == tris.len() {
+        return;
+    }
+    let mut first = vec![u32::MAX; welded.verts.len()];
+    for (j, &vert) in tri_verts[..good * 3].iter().enumerate().rev() {
+        first[vert as usize] = j as u32;
+    }
+    for t in good..tris.len() {
+        if tris[t].flag & QUAD_ONE_DEGEN_TRI != 0 {
+            continue;
+        }
+        for i in 0..3 {
+            let j = first[tri_verts[t * 3 + i] as usize] as usize;
+            if j != u32::MAX as usize {
+                let src = &tris[j / 3];
+                let src = (src.offset + src.verts[j % 3] as u32) as usize;
+                tspaces[(tris[t].offset + tris[t].verts[i] as u32) as usize] = tspaces[src];
+            }
+        }
+    }
+
+    for tri in &tris[..good] {
+        if tri.flag & QUAD_ONE_DEGEN_TRI == 0 {
+            continue;
+        }
+        let used = tri.verts.iter().fold(0, |used, &v| used | (1 << v));
+        let missing = (1..4).find(|&i| used & (1 << i) == 0).unwrap_or(0);
+        let face = &faces[tri.face as usize];
+        let position = |i: usize| {
+            welded
+                .mesh
+                .position(welded.mesh.corner_vert(face.corners[i] as usize))
+        };
+        let missing_position = position(missing);
+        if let Some(&v) = tri
+            .verts
+            .iter()
+            .find(|&&v| position(v as usize) == missing_position)
+        {
+            let offset = tri.offset as usize;
+            tspaces[offset + missing] = tspaces[offset + v as usize];
+        }
+    }
+}
+
+/// MikkTSpace tangents, 4 floats per face corner: the unit tangent and the bitangent sign, so
+/// that `bitangent = sign * cross(normal, tangent)`. Reads the vertex normals and the uvs of
+/// `dna::MVert`, corners share both with their vertex.
+///
+/// Corners of faces with fewer than 3 corners, and corners MikkTSpace assigns no space to, get
+/// its default: +x with a sign of -1. A corner of an n-gon in several triangles takes the
+/// space of its last triangle.
+pub fn tangents(mesh: MeshArrays, tangents: &mut [f32]) {
+    assert_eq!(tangents.len(), mesh.corners_num() * 4);
+    for t in tangents.chunks_exact_mut(4) {
+        t.copy_from_slice(&[1.0, 0.0, 0.0, -1.0]);
+    }
+
+    let welded = Welded {
+        mesh,
+        verts: weld(mesh),
+    };
+    let faces = mikk_faces(mesh);
+    let mut tris = Vec::with_capacity(mesh.corners_num());
+    let mut tri_verts = Vec::with_capacity(mesh.corners_num() * 3);
+    let tspaces_num = initial_triangles(&welded, &faces, &mut tris, &mut tri_verts);
+    if tris.is_empty() {
+        return;
+    }
+
+    for (t, tri) in tris.iter_mut().enumerate() {
+        let p = |i: usize| welded.position(tri_verts[t * 3 + i]);
+        if p(0) == p(1) || p(0) == p(2) || p(1) == p(2) {
+            tri.flag |= MARK_DEGENERATE;
+        }
+    }
+    let good = set_degenerate_aside(&mut tris, &mut tri_verts);
+
+    init_tri_info(&welded, &mut tris[..good], &tri_verts[..good * 3]);
+    let mut group_tris = Vec::with_capacity(good * 3);
+    let groups = build_groups(&mut tris[..good], &tri_verts[..good * 3], &mut group_tris);
+
+    let mut tspaces = vec![TSpace::default(); tspaces_num];
+    generate_tspaces(
+        &welded,
+        &tris[..good],
+        &tri_verts[..good * 3],
+        &groups,
+        &group_tris,
+        &mut tspaces,
+    );
+    fix_degenerate(&welded, &faces, &tris, &tri_verts, good, &mut tspaces);
+
+    let mut offset = 0;
+    for face in &faces {
+        for i in 0..face.len as usize {
+            let tspace = &tspaces[offset + i];
+            let sign = if tspace.orient { 1.0 } else { -1.0 };
+            let corner = face.corners[i] as usize;
+            tangents[corner * 4..corner * 4 + 4].copy_from_slice(&[
+                tspace.os[0],
+                tspace.os[1],
+                tspace.os[2],
+                sign,
+            ]);
+        }
+        offset += face.len as usize;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::normals::{LOOP_LEN, NormalWeight, POLY_LEN, VERT_LEN, vertex_normals};
+    use crate::primitives::{self, Primitive};
+
+    struct Arrays {
+        verts: Vec<f32>,
+        loops: Vec<i32>,
+        polys: Vec<i32>,
+    }
+
+    impl Arrays {
+        fn mesh(&self) -> MeshArrays<'_> {
+            MeshArrays {
+                verts: &self.verts,
+                loops: &self.loops,
+                polys: &self.polys,
+            }
+        }
+
+        fn tangents(&self) -> Vec<[f32; 4]> {
+            let mut result = vec![0.0; self.mesh().corners_num() * 4];
+            tangents(self.mesh(), &mut result);
+            result
+                .chunks_exact(4)
+                .map(|t| [t[0], t[1], t[2], t[3]])
+                .collect()
+        }
+
+        /* Tangents keyed by face and vertex, independent of the corner order. */
+        fn tangents_by_face_vert(&self) -> HashMap<(usize, usize), [f32; 4]> {
+            let tangents = self.tangents();
+            let mesh = self.mesh();
+            let mut result = HashMap::new();
+            for face in 0..mesh.faces_num() {
+                for corner in mesh.face_corners(face) {
+                    result.insert((face, mesh.corner_vert(corner)), tangents[corner]);
+                }
+            }
+            result
+        }
+    }
+
+    /* `faces` over vertices of position and uv, with angle weighted normals. */
+    fn build(verts: &[([f32; 3], [f32; 2])], faces: &[Vec<usize>]) -> Arrays {
+        let mut arrays = Arrays {
+            verts: Vec::new(),
+            loops: Vec::new(),
+            polys: Vec::new(),
+        };
+        for (p, uv) in verts {
+            arrays
+                .verts
+                .extend_from_slice(&[p[0], p[1], p[2], 0.0, 1.0, 0.0, uv[0], uv[1]]);
+        }
+        for face in faces {
+            let first = (arrays.loops.len() / LOOP_LEN) as i32;
+            arrays.polys.extend_from_slice(&[first, face.len() as i32]);
+            for &v in face {
+                arrays.loops.extend_from_slice(&[v as i32, 0, 0, 0, 0]);
+            }
+        }
+        vertex_normals(
+            &mut arrays.verts,
+            &arrays.loops,
+            &arrays.polys,
+            NormalWeight::Angle,
+        );
+        arrays
+    }
+
+    /* A `rows` x `cols` grid of quads in the xz plane, `f` places every vertex and its uv. */
+    fn grid(
+        rows: usize,
+        cols: usize,
+        f: impl Fn(f32, f32) -> ([f32; 3], [f32; 2]),
+    ) -> (Vec<([f32; 3], [f32; 2])>, Vec<Vec<usize>>) {
+        let mut verts = Vec::new();
+        for r in 0..=rows {
+            for c in 0..=cols {
+                verts.push(f(c as f32, r as f32));
+            }
+        }
+        let index = |r: usize, c: usize| r * (cols + 1) + c;
+        let mut faces = Vec::new();
+        for r in 0..rows {
+            for c in 0..cols {
+                faces.push(vec![
+                    index(r, c),
+                    index(r + 1, c),
+                    index(r + 1, c + 1),
+                    index(r, c + 1),
+                ]);
+            }
+        }
+        (verts, faces)
+    }
+
+    fn warped(x: f32, z: f32) -> ([f32; 3], [f32; 2]) {
+        let y = (x * 0.7).sin() * (z * 0.4).cos();
+        let u = x / 8.0 + 0.05 * (z * 0.3).sin();
+        let v = z / 6.0 + 0.03 * (x * 0.2).cos();
+        ([x, y, z], [u, v])
+    }
+
+    fn assert_close(a: &[f32], b: &[f32], tolerance: f32) {
+        assert_eq!(a.len(), b.len());
+        for (i, (x, y)) in a.iter().zip(b).enumerate() {
+            assert!((x - y).abs() <= tolerance, "float {i}: {x} != {y}");
+        }
+    }
+
+    #[test]
+    fn tangents_follow_uvs() {
+        /* u along +x and v along +z. The normal is +y, cross(n, +x) is -z against v: sign -1. */
+        let (verts, faces) = grid(3, 4, |x, z| ([x, 0.0, z], [x, z]));
+        for t in build(&verts, &faces).tangents() {
+            assert_close(&t, &[1.0, 0.0, 0.0, -1.0], 1e-6);
+        }
+
+        /* Mirrored u: the tangent flips to -x and the sign to +1. */
+        let (verts, faces) = grid(3, 4, |x, z| ([x, 0.0, z], [-x, z]));
+        for t in build(&verts, &faces).tangents() {
+            assert_close(&t, &[-1.0, 0.0, 0.0, 1.0], 1e-6);
+        }
+    }
+
+    #[test]
+    fn tangents_are_dp_du() {
+        /* u = x and v = x + z: dP/du = (1, 0, -1), the face normal is -y and the mapping keeps
+         * the orientation of the corners. */
+        let verts = [
+            ([0.0, 0.0, 0.0], [0.0, 0.0]),
+            ([1.0, 0.0, 0.0], [1.0, 1.0]),
+            ([0.0, 0.0, 1.0], [0.0, 1.0]),
+        ];
+        let arrays = build(&verts, &[vec![0, 1, 2]]);
+        let d = 0.5f32.sqrt();
+        for t in arrays.tangents() {
+            assert_close(&t, &[d, 0.0, -d, 1.0], 1e-6);
+        }
+    }
+
+    #[test]
+    fn quad_corner_order_is_ignored() {
+        let (verts, faces) = grid(6, 8, warped);
+        let expected = build(&verts, &faces).tangents_by_face_vert();
+
+        /* Quads are split along their shorter uv diagonal, wherever they start. */
+        let rotated: Vec<Vec<usize>> = faces
+            .iter()
+            .enumerate()
+            .map(|(f, face)| {
+                let mut face = face.clone();
+                face.rotate_left(f % 4);
+                face
+            })
+            .collect();
+        let result = build(&verts, &rotated).tangents_by_face_vert();
+        for (key, t) in &expected {
+            assert_close(&result[key], t, 1e-6);
+        }
+
+        /* Nor does the order of the faces matter. */
+        let reversed: Vec<Vec<usize>> = faces.iter().rev().cloned().collect();
+        let result = build(&verts, &reversed).tangents_by_face_vert();
+        let faces_num = faces.len();
+        for (&(face, vert), t) in &expected {
+            assert_close(&result[&(faces_num - 1 - face, vert)], t, 1e-6);
+        }
+    }
+
+    #[test]
+    fn equal_vertices_are_welded() {
+        let (verts, faces) = grid(6, 8, warped);
+        let shared = build(&verts, &faces);
+
+        /* Every face gets copies of its vertices, normals included. */
+        let mut split = Arrays {
+            verts: Vec::new(),
+            loops: shared.loops.clone(),
+            polys: shared.polys.clone(),
+        };
+        for (corner, data) in split.loops.chunks_exact_mut(LOOP_LEN).enumerate() {
+            let v = data[0] as usize;
+            split
+                .verts
+                .extend_from_slice(&shared.verts[v * VERT_LEN..(v + 1) * VERT_LEN]);
+            data[0] = corner as i32;
+        }
+        assert_eq!(split.tangents(), shared.tangents());
+    }
+
+    #[test]
+    fn seams_and_sharp_edges_split() {
+        /* A quad on its own, then with a neighbor across a uv seam and across a sharp edge.
+         * Both neighbors have their own copies of the shared vertices. */
+        let left = [
+            ([0.0, 0.0, 0.0], [0.0, 0.0]),
+            ([0.0, 0.0, 1.0], [0.0, 1.0]),
+            ([1.0, 0.0, 1.0], [1.0, 1.0]),
+            ([1.0, 0.0, 0.0], [1.0, 0.0]),
+        ];
+        let expected = build(&left, &[vec![0, 1, 2, 3]]).tangents();
+
+        let mut seam = left.to_vec();
+        seam.extend_from_slice(&[
+            ([1.0, 0.0, 0.0], [0.0, 0.0]),
+            ([1.0, 0.0, 1.0], [1.0, 0.0]),
+            ([2.0, 0.0, 1.0], [1.0, -1.0]),
+            ([2.0, 0.0, 0.0], [0.0, -1.0]),
+        ]);
+        let faces = [vec![0, 1, 2, 3], vec![4, 5, 6, 7]];
+        let result = build(&seam, &faces).tangents();
+        assert_eq!(&result[..4], &expected[..]);
+        for t in &result[4..] {
+            assert_close(t, &[0.0, 0.0, 1.0, -1.0], 1e-6);
+        }
+
+        let mut sharp = left.to_vec();
+        sharp.extend_from_slice(&[
+            ([1.0, 0.0, 0.0], [1.0, 0.0]),
+            ([1.0, 0.0, 1.0], [1.0, 1.0]),
+            ([1.0, 1.0, 1.0], [2.0, 1.0]),
+            ([1.0, 1.0, 0.0], [2.0, 0.0]),
+        ]);
+        let result = build(&sharp, &faces).tangents();
+        assert_eq!(&result[..4], &expected[..]);
+        for t in &result[4..] {
+            assert_close(t, &[0.0, 1.0, 0.0, -1.0], 1e-6);
+        }
+    }
+
+    #[test]
+    fn mirrored_islands_keep_their_sign() {
+        /* u mirrored at x = 4, the vertices on the mirror line are shared by both halves. */
+        let (verts, faces) = grid(4, 8, |x, z| ([x, 0.0, z], [(x - 4.0).abs(), z]));
+        let arrays = build(&verts, &faces);
+        let tangents = arrays.tangents();
+        let mesh = arrays.mesh();
+        for (f, face) in faces.iter().enumerate() {
+            let mirrored = face.iter().any(|&v| verts[v].0[0] < 4.0);
+            let expected = if mirrored {
+                [-1.0, 0.0, 0.0, 1.0]
+            } else {
+                [1.0, 0.0, 0.0, -1.0]
+            };
+            for corner in mesh.face_corners(f) {
+                assert_close(&tangents[corner], &expected, 1e-6);
+            }
+        }
+    }
+
+    #[test]
+    fn degenerate_triangles_copy_healthy_corners() {
+        /* The last two corners of the quad coincide: its second triangle is degenerate and
+         * its missing corner copies the corner at the same position. */
+        let verts = [
+            ([0.0, 0.0, 0.0], [0.0, 0.0]),
+            ([0.0, 0.0, 1.0], [0.0, 1.0]),
+            ([1.0, 0.0, 1.0], [1.0, 1.0]),
+            ([1.0, 0.0, 1.0], [1.0, 0.5]),
+            /* A sliver triangle with two coinciding corners at the first vertex. */
+            ([2.0, 0.0, 1.0], [2.0, 1.0]),
+            ([2.0, 0.0, 1.0], [2.0, 0.5]),
+        ];
+        let arrays = build(&verts, &[vec![0, 1, 2, 3], vec![0, 4, 5]]);
+        let tangents = arrays.tangents();
+        for t in &tangents[..4] {
+            assert!((vdot([t[0], t[1], t[2]], [t[0], t[1], t[2]]) - 1.0).abs() < 1e-6);
+        }
+        assert_eq!(tangents[2], tangents[3]);
+        /* Vertex 0 copies its space from the quad, the others have no healthy corner and keep
+         * the default. */
+        assert_eq!(tangents[4], tangents[0]);
+        assert_eq!(tangents[5], [1.0, 0.0, 0.0, -1.0]);
+        assert_eq!(tangents[6], [1.0, 0.0, 0.0, -1.0]);
+    }
+
+    #[test]
+    fn ngons_are_ear_clipped() {
+        /* A U shape. A fan from its first corner would fold a triangle over. */
+        let outline = [
+            [0.0, 0.0],
+            [3.0, 0.0],
+            [3.0, 2.0],
+            [2.0, 2.0],
+            [2.0, 1.0],
+            [1.0, 1.0],
+            [1.0, 2.0],
+            [0.0, 2.0f32],
+        ];
+        /* Counter clockwise seen from -y, so the face points down. */
+        let verts: Vec<_> = outline
+            .iter()
+            .map(|&[x, z]| ([x, 0.0, z], [x, z]))
+            .collect();
+        let arrays = build(&verts, &[(0..8).collect()]);
+
+        let mut faces = Vec::new();
+        triangulate(arrays.mesh(), 0..8, &mut faces);
+        assert_eq!(faces.len(), 6);
+        let mut area = 0.0;
+        for face in &faces {
+            let [a, b, c] = [0, 1, 2].map(|i| outline[face.corners[i] as usize]);
+            let doubled = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+            assert!(doubled > 0.0);
+            area += 0.5 * doubled;
+        }
+        assert_eq!(area, 5.0);
+
+        for t in arrays.tangents() {
+            assert_close(&t, &[1.0, 0.0, 0.0, 1.0], 1e-6);
+        }
+    }
+
+    #[test]
+    fn sphere_follows_longitude() {
+        let sphere = Primitive::UvSphere {
+            segments: 32,
+            rings: 16,
+            radius: 1.0,
+        };
+        let counts = sphere.counts();
+        let mut arrays = Arrays {
+            verts: vec![0.0; counts.verts * VERT_LEN],
+            loops: vec![0; counts.corners * LOOP_LEN],
+            polys: vec![0; counts.faces * POLY_LEN],
+        };
+        let mut edges = vec![0; counts.edges * primitives::EDGE_LEN];
+        primitives::generate(
+            sphere,
+            &mut arrays.verts,
+            &mut edges,
+            &mut arrays.loops,
+            &mut arrays.polys,
+        );
+
+        let tangents = arrays.tangents();
+        let mesh = arrays.mesh();
+        let sign = tangents[0][3];
+        for (corner, t) in tangents.iter().enumerate() {
+            let p = mesh.position(mesh.corner_vert(corner));
+            if p[1].abs() > 0.7 {
+                continue;
+            }
+            /* The direction of growing longitude, in either sense depending on the uvs. */
+            let around = normalize([-p[2], 0.0, p[0]]);
+            let cos = vdot([t[0], t[1], t[2]], around);
+            assert!(cos.abs() > 0.99, "corner {corner}: {t:?}");
+            assert_eq!(t[3], sign);
+        }
+    }
+}
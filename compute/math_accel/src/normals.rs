@@ -0,0 +1,610 @@
+//! Face normals and vertex normals of polygon meshes, read straight from the arrays of
+//! `dna::Mesh`. Tangents are in [`crate::mikktspace`].
+//!
+//! Faces and corners are processed in parallel. Vertex results are gathered per vertex through
+//! a vertex to corner map, so that no two tasks write the same value and every sum is taken in
+//! corner order, which keeps the results identical from run to run.
+
+use std::ops::Range;
+use std::sync::atomic::{AtomicU32, Ordering};
+
+use rayon::prelude::*;
+
+/// Floats per `dna::MVert`: position, normal, uv.
+pub const VERT_LEN: usize = 8;
+pub const VERT_NORMAL: usize = 3;
+pub const VERT_UV: usize = 6;
+/// 32 bit words per `dna::MLoop`: vertex, edge, face, uv. Only the vertex is read.
+pub const LOOP_LEN: usize = 5;
+/// Words per `dna::MPoly`: first corner, number of corners.
+pub const POLY_LEN: usize = 2;
+
+const MIN_FACES_PER_TASK: usize = 1024;
+const MIN_VERTS_PER_TASK: usize = 2048;
+/* Atomic counting only pays off with several threads on large meshes. */
+const MIN_CORNERS_PARALLEL_MAP: usize = 1 << 16;
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum NormalWeight {
+    /// Each face counts with its area.
+    Area,
+    /// Each face counts with its angle at the vertex, independent of how faces are split.
+    Angle,
+}
+
+type Vec3 = [f32; 3];
+
+#[inline(always)]
+fn sub(a: Vec3, b: Vec3) -> Vec3 {
+    [a[0] - b[0], a[1] - b[1], a[2] - b[2]]
+}
+
+#[inline(always)]
+fn add(a: Vec3, b: Vec3) -> Vec3 {
+    [a[0] + b[0], a[1] + b[1], a[2] + b[2]]
+}
+
+#[inline(always)]
+fn scale(a: Vec3, s: f32) -> Vec3 {
+    [a[0] * s, a[1] * s, a[2] * s]
+}
+
+#[inline(always)]
+fn dot(a: Vec3, b: Vec3) -> f32 {
+    a[0] * b[0] + a[1] * b[1] + a[2] * b[2]
+}
+
+#[inline(always)]
+fn normalize(a: Vec3) -> Option<Vec3> {
+    let length = dot(a, a).sqrt();
+    (length > 1e-20).then(|| scale(a, 1.0 / length))
+}
+
+/* Disjoint writes from parallel tasks, every index is written by exactly one task. Accessed
+ * through methods so that closures capture the whole wrapper. */
+#[derive(Clone, Copy)]
+struct SharedMut<T>(*mut T);
+unsafe impl<T> Send for SharedMut<T> {}
+unsafe impl<T> Sync for SharedMut<T> {}
+
+impl<T> SharedMut<T> {
+    #[inline(always)]
+    unsafe fn write(self, index: usize, value: T) {
+        unsafe { self.0.add(index).write(value) }
+    }
+
+    unsafe fn slice(self, range: Range<usize>) -> &'static mut [T] {
+        unsafe { std::slice::from_raw_parts_mut(self.0.add(range.start), range.len()) }
+    }
+}
+
+/// Read access to the `dna::Mesh` arrays.
+#[derive(Clone, Copy)]
+pub struct MeshArrays<'a> {
+    pub verts: &'a [f32],
+    pub loops: &'a [i32],
+    pub polys: &'a [i32],
+}
+
+impl MeshArrays<'_> {
+    pub fn verts_num(&self) -> usize {
+        self.verts.len() / VERT_LEN
+    }
+
+    pub fn corners_num(&self) -> usize {
+        self.loops.len() / LOOP_LEN
+    }
+
+    pub fn faces_num(&self) -> usize {
+        self.polys.len() / POLY_LEN
+    }
+
+    #[inline(always)]
+    pub(crate) fn position(&self, vert: usize) -> Vec3 {
+        let co = &self.verts[vert * VERT_LEN..vert * VERT_LEN + 3];
+        [co[0], co[1], co[2]]
+    }
+
+    #[inline(always)]
+    pub(crate) fn normal(&self, vert: usize) -> Vec3 {
+        let no = &self.verts[vert * VERT_LEN + VERT_NORMAL..vert * VERT_LEN + VERT_NORMAL + 3];
+        [no[0], no[1], no[2]]
+    }
+
+    #[inline(always)]
+    pub(crate) fn uv(&self, vert: usize) -> [f32; 2] {
+        [
+            self.verts[vert * VERT_LEN + VERT_UV],
+            self.verts[vert * VERT_LEN + VERT_UV + 1],
+        ]
+    }
+
+    #[inline(always)]
+    pub(crate) fn corner_vert(&self, corner: usize) -> usize {
+        self.loops[corner * LOOP_LEN] as usize
+    }
+
+    #[inline(always)]
+    pub(crate) fn face_corners(&self, face: usize) -> Range<usize> {
+        let first = self.polys[face * POLY_LEN] as usize;
+        first..first + self.polys[face * POLY_LEN + 1] as usize
+    }
+
+    /* Newell's method: the normal scaled by twice the area, also for concave and slightly
+     * non-planar faces. Zero for faces without corners. */
+    pub(crate) fn face_normal_scaled(&self, corners: Range<usize>) -> Vec3 {
+        let mut n = [0.0f32; 3];
+        if corners.is_empty() {
+            return n;
+        }
+        let mut prev = self.position(self.corner_vert(corners.end - 1));
+        for corner in corners {
+            let co = self.position(self.corner_vert(corner));
+            n[0] += (prev[1] - co[1]) * (prev[2] + co[2]);
+            n[1] += (prev[2] - co[2]) * (prev[0] + co[0]);
+            n[2] += (prev[0] - co[0]) * (prev[1] + co[1]);
+            prev = co;
+        }
+        n
+    }
+
+    /* The corners before and after `corner` in its face. */
+    #[inline(always)]
+    fn corner_neighbors(&self, corners: &Range<usize>, corner: usize) -> (usize, usize) {
+        let prev = if corner == corners.start {
+            corners.end - 1
+        } else {
+            corner - 1
+        };
+        let next = if corner + 1 == corners.end {
+            corners.start
+        } else {
+            corner + 1
+        };
+        (self.corner_vert(prev), self.corner_vert(next))
+    }
+
+    fn corner_angle(&self, corners: &Range<usize>, corner: usize) -> f32 {
+        let (prev, next) = self.corner_neighbors(corners, corner);
+        let co = self.position(self.corner_vert(corner));
+        match (
+            normalize(sub(self.position(prev), co)),
+            normalize(sub(self.position(next), co)),
+        ) {
+            (Some(a), Some(b)) => dot(a, b).clamp(-1.0, 1.0).acos(),
+            _ => 0.0,
+        }
+    }
+}
+
+/// Unit normal of every face, 3 floats each. Degenerate faces get a zero vector.
+pub fn face_normals(mesh: MeshArrays, normals: &mut [f32]) {
+    assert_eq!(normals.len(), mesh.faces_num() * 3);
+    normals
+        .par_chunks_exact_mut(3)
+        .with_min_len(MIN_FACES_PER_TASK)
+        .enumerate()
+        .for_each(|(face, normal)| {
+            let n = normalize(mesh.face_normal_scaled(mesh.face_corners(face)));
+            normal.copy_from_slice(&n.unwrap_or([0.0; 3]));
+        });
+}
+
+/* The corners of every vertex: vertex `v` owns `corners[offsets[v]..offsets[v + 1]]`, sorted. */
+struct VertCorners {
+    offsets: Vec<u32>,
+    corners: Vec<u32>,
+}
+
+impl VertCorners {
+    fn build(mesh: MeshArrays) -> Self {
+        if mesh.corners_num() < MIN_CORNERS_PARALLEL_MAP || rayon::current_num_threads() == 1 {
+            Self::build_sequential(mesh)
+        } else {
+            Self::build_parallel(mesh)
+        }
+    }
+
+    /* One counting and one filling pass, the corners come out sorted. */
+    fn build_sequential(mesh: MeshArrays) -> Self {
+        let verts_num = mesh.verts_num();
+        let mut offsets = vec![0u32; verts_num + 1];
+        for corner in 0..mesh.corners_num() {
+            offsets[mesh.corner_vert(corner) + 1] += 1;
+        }
+        for vert in 0..verts_num {
+            offsets[vert + 1] += offsets[vert];
+        }
+        let mut cursors = offsets[..verts_num].to_vec();
+        let mut corners = vec![0u32; mesh.corners_num()];
+        for corner in 0..mesh.corners_num() {
+            let cursor = &mut cursors[mesh.corner_vert(corner)];
+            corners[*cursor as usize] = corner as u32;
+            *cursor += 1;
+        }
+        VertCorners { offsets, corners }
+    }
+
+    /* Atomic counters, then a sort of every vertex, the insertion order depends on scheduling
+     * and the sums must not. */
+    fn build_parallel(mesh: MeshArrays) -> Self {
+        let verts_num = mesh.verts_num();
+        let corners_num = mesh.corners_num();
+
+        let counts: Vec<AtomicU32> = (0..verts_num).map(|_| AtomicU32::new(0)).collect();
+        (0..corners_num)
+            .into_par_iter()
+            .with_min_len(MIN_VERTS_PER_TASK)
+            .for_each(|corner| {
+                counts[mesh.corner_vert(corner)].fetch_add(1, Ordering::Relaxed);
+            });
+
+        let mut offsets = Vec::with_capacity(verts_num + 1);
+        let mut total = 0u32;
+        offsets.push(0);
+        for count in &counts {
+            total += count.load(Ordering::Relaxed);
+            offsets.push(total);
+        }
+
+        /* Reuse the counters as insertion cursors. */
+        for (count, &offset) in counts.iter().zip(&offsets) {
+            count.store(offset, Ordering::Relaxed);
+        }
+        let mut corners = vec![0u32; corners_num];
+        let out = SharedMut(corners.as_mut_ptr());
+        (0..corners_num)
+            .into_par_iter()
+            .with_min_len(MIN_VERTS_PER_TASK)
+            .for_each(|corner| {
+                let slot = counts[mesh.corner_vert(corner)].fetch_add(1, Ordering::Relaxed);
+                unsafe { out.write(slot as usize, corner as u32) };
+            });
+        (0..verts_num)
+            .into_par_iter()
+            .with_min_len(MIN_VERTS_PER_TASK)
+            .for_each(|vert| {
+                let range = offsets[vert] as usize..offsets[vert + 1] as usize;
+                unsafe { out.slice(range) }.sort_unstable();
+            });
+
+        VertCorners { offsets, corners }
+    }
+
+    #[inline(always)]
+    fn of(&self, vert: usize) -> &[u32] {
+        &self.corners[self.offsets[vert] as usize..self.offsets[vert + 1] as usize]
+    }
+}
+
+/// Recompute the normal of every vertex in `verts` (`dna::MVert` layout) from the faces around
+/// it. Vertices without faces keep their normal.
+pub fn vertex_normals(verts: &mut [f32], loops: &[i32], polys: &[i32], weight: NormalWeight) {
+    let mesh = MeshArrays {
+        verts,
+        loops,
+        polys,
+    };
+    let vert_corners = VertCorners::build(mesh);
+
+    /* The weighted face normal each corner adds to its vertex. */
+    let mut contributions = vec![0.0f32; mesh.corners_num() * 3];
+    let out = SharedMut(contributions.as_mut_ptr());
+    (0..mesh.faces_num())
+        .into_par_iter()
+        .with_min_len(MIN_FACES_PER_TASK)
+        .for_each(|face| {
+            let corners = mesh.face_corners(face);
+            let scaled = mesh.face_normal_scaled(corners.clone());
+            let unit = normalize(scaled).unwrap_or([0.0; 3]);
+            for corner in corners.clone() {
+                let value = match weight {
+                    NormalWeight::Area => scale(scaled, 0.5),
+                    NormalWeight::Angle => scale(unit, mesh.corner_angle(&corners, corner)),
+                };
+                for k in 0..3 {
+                    unsafe { out.write(corner * 3 + k, value[k]) };
+                }
+            }
+        });
+
+    verts
+        .par_chunks_exact_mut(VERT_LEN)
+        .with_min_len(MIN_VERTS_PER_TASK)
+        .enumerate()
+        .for_each(|(vert, data)| {
+            let mut sum = [0.0f32; 3];
+            for &corner in vert_corners.of(vert) {
+                let c = corner as usize * 3;
+                sum = add(
+                    sum,
+                    [contributions[c], contributions[c + 1], contributions[c + 2]],
+                );
+            }
+            if let Some(normal) = normalize(sum) {
+                data[VERT_NORMAL..VERT_NORMAL + 3].copy_from_slice(&normal);
+            }
+        });
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /* A `rows` x `cols` grid of quads in the xz plane, split into triangles where
+     * `(row + col) % 3 == 0`, with a bumpy height and uvs following x and z. */
+    fn grid(rows: usize, cols: usize) -> (Vec<f32>, Vec<i32>, Vec<i32>) {
+        let mut verts = Vec::new();
+        for r in 0..=rows {
+            for c in 0..=cols {
+                let (x, z) = (c as f32, r as f32);
+                let y = (x * 0.7).sin() * (z * 0.4).cos();
+                verts.extend_from_slice(&[
+                    x,
+                    y,
+                    z,
+                    0.0,
+                    1.0,
+                    0.0,
+                    x / cols as f32,
+                    z / rows as f32,
+                ]);
+            }
+        }
+        let index = |r: usize, c: usize| (r * (cols + 1) + c) as i32;
+        let mut loops = Vec::new();
+        let mut polys = Vec::new();
+        let mut add_face = |corners: &[i32]| {
+            polys.extend_from_slice(&[(loops.len() / LOOP_LEN) as i32, corners.len() as i32]);
+            for &v in corners {
+                loops.extend_from_slice(&[v, 0, 0, 0, 0]);
+            }
+        };
+        for r in 0..rows {
+            for c in 0..cols {
+                let quad = [
+                    index(r, c),
+                    index(r + 1, c),
+                    index(r + 1, c + 1),
+                    index(r, c + 1),
+                ];
+                if (r + c) % 3 == 0 {
+                    add_face(&[quad[0], quad[1], quad[2]]);
+                    add_face(&[quad[0], quad[2], quad[3]]);
+                } else {
+                    add_face(&quad);
+                }
+            }
+        }
+        (verts, loops, polys)
+    }
+
+    fn faces(loops: &[i32], polys: &[i32]) -> Vec<Vec<usize>> {
+        polys
+            .chunks_exact(POLY_LEN)
+            .map(|p| {
+                (p[0] as usize..(p[0] + p[1]) as usize)
+                    .map(|c| loops[c * LOOP_LEN] as usize)
+                    .collect()
+            })
+            .collect()
+    }
+
+    fn position(verts: &[f32], v: usize) -> Vec3 {
+        [
+            verts[v * VERT_LEN],
+            verts[v * VERT_LEN + 1],
+            verts[v * VERT_LEN + 2],
+        ]
+    }
+
+    fn normal(verts: &[f32], v: usize) -> Vec3 {
+        let no = &verts[v * VERT_LEN + VERT_NORMAL..v * VERT_LEN + VERT_NORMAL + 3];
+        [no[0], no[1], no[2]]
+    }
+
+    fn corner_angle_reference(verts: &[f32], face: &[usize], i: usize) -> f32 {
+        let v = face[i];
+        let prev = face[(i + face.len() - 1) % face.len()];
+        let next = face[(i + 1) % face.len()];
+        let a = normalize(sub(position(verts, prev), position(verts, v))).unwrap();
+        let b = normalize(sub(position(verts, next), position(verts, v))).unwrap();
+        dot(a, b).clamp(-1.0, 1.0).acos()
+    }
+
+    /* Sum of the fan triangle cross products, a different formula than Newell's. */
+    fn face_normal_reference(verts: &[f32], face: &[usize]) -> Vec3 {
+        let p0 = position(verts, face[0]);
+        let mut n = [0.0; 3];
+        for i in 1..face.len() - 1 {
+            let e1 = sub(position(verts, face[i]), p0);
+            let e2 = sub(position(verts, face[i + 1]), p0);
+            n = add(n, cross(e1, e2));
+        }
+        n
+    }
+
+    /* Scatters every face into its vertices, one face after the other. */
+    fn vertex_normals_reference(
+        verts: &[f32],
+        faces: &[Vec<usize>],
+        weight: NormalWeight,
+    ) -> Vec<Vec3> {
+        let mut sums = vec![[0.0f32; 3]; verts.len() / VERT_LEN];
+        for face in faces {
+            let n = face_normal_reference(verts, face);
+            for (i, &v) in face.iter().enumerate() {
+                let w = match weight {
+                    NormalWeight::Area => scale(n, 0.5),
+                    NormalWeight::Angle => scale(
+                        normalize(n).unwrap(),
+                        corner_angle_reference(verts, face, i),
+                    ),
+                };
+                sums[v] = add(sums[v], w);
+            }
+        }
+        sums.into_iter().map(|s| normalize(s).unwrap()).collect()
+    }
+
+    fn cross(a: Vec3, b: Vec3) -> Vec3 {
+        [
+            a[1] * b[2] - a[2] * b[1],
+            a[2] * b[0] - a[0] * b[2],
+            a[0] * b[1] - a[1] * b[0],
+        ]
+    }
+
+    fn assert_close(a: &[f32], b: &[f32], tolerance: f32) {
+        assert_eq!(a.len(), b.len());
+        for (i, (x, y)) in a.iter().zip(b).enumerate() {
+            assert!((x - y).abs() <= tolerance, "float {i}: {x} != {y}");
+        }
+    }
+
+    #[test]
+    fn vert_corner_maps_agree() {
+        let (verts, loops, polys) = grid(30, 40);
+        let mesh = MeshArrays {
+            verts: &verts,
+            loops: &loops,
+            polys: &polys,
+        };
+        let sequential = VertCorners::build_sequential(mesh);
+        let parallel = VertCorners::build_parallel(mesh);
+        assert_eq!(sequential.offsets, parallel.offsets);
+        assert_eq!(sequential.corners, parallel.corners);
+        for vert in 0..mesh.verts_num() {
+            assert!(
+                sequential
+                    .of(vert)
+                    .iter()
+                    .all(|&c| mesh.corner_vert(c as usize) == vert)
+            );
+        }
+    }
+
+    #[test]
+    fn face_normals_match_reference() {
+        let (verts, loops, polys) = grid(20, 30);
+        let mesh = MeshArrays {
+            verts: &verts,
+            loops: &loops,
+            polys: &polys,
+        };
+        let mut normals = vec![0.0; mesh.faces_num() * 3];
+        face_normals(mesh, &mut normals);
+        let expected: Vec<f32> = faces(&loops, &polys)
+            .iter()
+            .flat_map(|face| normalize(face_normal_reference(&verts, face)).unwrap())
+            .collect();
+        /* The bumpy quads are not planar, the two formulas differ slightly. */
+        assert_close(&normals, &expected, 2e-3);
+    }
+
+    #[test]
+    fn vertex_normals_match_reference() {
+        let (mut verts, loops, polys) = grid(40, 25);
+        /* Planar faces, so that both face normal formulas agree. */
+        for v in verts.chunks_exact_mut(VERT_LEN) {
+            v[1] = v[0] * 0.3 - v[2] * 0.2;
+        }
+        for weight in [NormalWeight::Area, NormalWeight::Angle] {
+            let expected = vertex_normals_reference(&verts, &faces(&loops, &polys), weight);
+            vertex_normals(&mut verts, &loops, &polys, weight);
+            let normals: Vec<f32> = verts
+                .chunks_exact(VERT_LEN)
+                .flat_map(|v| [v[3], v[4], v[5]])
+                .collect();
+            assert_close(&normals, &expected.concat(), 1e-5);
+        }
+    }
+
+    #[test]
+    fn angle_weight_ignores_triangulation() {
+        /* A corner of a box: three faces at right angles around vertex 0, the top one split in
+         * two. Angle weighting still points along the diagonal. */
+        let mut verts = Vec::new();
+        for co in [
+            [0.0, 0.0, 0.0],
+            [1.0, 0.0, 0.0],
+            [1.0, 1.0, 0.0],
+            [0.0, 1.0, 0.0],
+            [0.0, 1.0, 1.0],
+            [0.0, 0.0, 1.0],
+            [1.0, 0.0, 1.0],
+        ] {
+            verts.extend_from_slice(&co);
+            verts.extend_from_slice(&[0.0; 5]);
+        }
+        let faces: [&[i32]; 4] = [&[0, 3, 2, 1], &[0, 5, 4, 3], &[0, 1, 6], &[0, 6, 5]];
+        let mut loops = Vec::new();
+        let mut polys = Vec::new();
+        for face in faces {
+            polys.extend_from_slice(&[(loops.len() / LOOP_LEN) as i32, face.len() as i32]);
+            for &v in face {
+                loops.extend_from_slice(&[v, 0, 0, 0, 0]);
+            }
+        }
+        vertex_normals(&mut verts, &loops, &polys, NormalWeight::Angle);
+        let d = -1.0 / 3.0f32.sqrt();
+        assert_close(&verts[3..6], &[d, d, d], 1e-6);
+    }
+
+    #[test]
+    fn concave_ngon_normals_match_reference() {
+        /* An L shaped hexagon in a tilted plane, fanned from a convex corner. */
+        let mut verts = Vec::new();
+        for [x, z] in [
+            [0.0, 0.0],
+            [2.0, 0.0],
+            [2.0, 1.0],
+            [1.0, 1.0],
+            [1.0, 2.0],
+            [0.0, 2.0f32],
+        ] {
+            verts.extend_from_slice(&[x, 0.5 * x + 0.25 * z, z, 0.0, 0.0, 0.0, 0.0, 0.0]);
+        }
+        let face: Vec<usize> = (0..6).rev().collect();
+        let loops: Vec<i32> = face.iter().flat_map(|&v| [v as i32, 0, 0, 0, 0]).collect();
+        let polys = [0, 6];
+        let mesh = MeshArrays {
+            verts: &verts,
+            loops: &loops,
+            polys: &polys,
+        };
+        let mut normals = [0.0; 3];
+        face_normals(mesh, &mut normals);
+        assert_close(
+            &normals,
+            &normalize(face_normal_reference(&verts, &face)).unwrap(),
+            1e-6,
+        );
+
+        vertex_normals(&mut verts, &loops, &polys, NormalWeight::Area);
+        let expected = vertex_normals_reference(&verts, &[face], NormalWeight::Area);
+        for (v, n) in expected.iter().enumerate() {
+            assert_close(&normal(&verts, v), n, 1e-6);
+        }
+    }
+
+    #[test]
+    fn faces_without_corners_are_skipped() {
+        let (mut verts, loops, mut polys) = grid(3, 3);
+        let mut expected = verts.clone();
+        vertex_normals(&mut expected, &loops, &polys, NormalWeight::Area);
+        /* An empty face at the end, pointing past the last corner. */
+        polys.extend_from_slice(&[(loops.len() / LOOP_LEN) as i32, 0]);
+        let mesh = MeshArrays {
+            verts: &verts,
+            loops: &loops,
+            polys: &polys,
+        };
+        let mut normals = vec![1.0; mesh.faces_num() * 3];
+        face_normals(mesh, &mut normals);
+        assert_eq!(&normals[normals.len() - 3..], &[0.0; 3]);
+
+        vertex_normals(&mut verts, &loops, &polys, NormalWeight::Area);
+        assert_eq!(verts, expected);
+    }
+}
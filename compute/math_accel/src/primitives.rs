@@ -0,0 +1,786 @@
+//! Procedural primitives written straight into the arrays of a `dna::Mesh`: vertices, edges,
+//! face corners and faces, with complete topology and uvs.
+//!
+//! All four shapes are a grid of quads, bent around in one or both directions, with triangle
+//! fans closing the top and bottom rows. Where the grid closes on itself the seam column and
+//! row are repeated, with the same positions and normals, so that every vertex has one uv and
+//! the uvs and tangents stay continuous up to the seam. Every element is a function of its
+//! index, so each array is filled in parallel without any shared state.
+
+use std::f32::consts::{PI, TAU};
+
+use rayon::prelude::*;
+
+use crate::normals::{LOOP_LEN, POLY_LEN, VERT_LEN};
+
+/// 32 bit words per `dna::MEdge`: the two vertices.
+pub const EDGE_LEN: usize = 2;
+
+const ELEMENTS_PER_TASK: usize = 4096;
+
+/// Primitive shapes, centered on the origin with +y up. Resolutions below the minimum of a
+/// shape are raised to it.
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum Primitive {
+    /// Square in the xz plane facing +y, at least one segment per side.
+    Grid {
+        x_segments: usize,
+        z_segments: usize,
+        size: f32,
+    },
+    /// At least 3 segments around and 2 rings from pole to pole.
+    UvSphere {
+        segments: usize,
+        rings: usize,
+        radius: f32,
+    },
+    /// Ring around the y axis, at least 3 segments around the axis and around the tube.
+    Torus {
+        major_segments: usize,
+        minor_segments: usize,
+        major_radius: f32,
+        minor_radius: f32,
+    },
+    /// Capped cylinder along y, at least 3 segments around and 1 ring along the side.
+    Cylinder {
+        segments: usize,
+        rings: usize,
+        radius: f32,
+        depth: f32,
+    },
+}
+
+/// Sizes of the mesh arrays of a primitive.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct Counts {
+    pub verts: usize,
+    pub edges: usize,
+    pub faces: usize,
+    pub corners: usize,
+}
+
+/* `columns` quads per row between `rows` rows of `columns + 1` vertices, with a triangle fan
+ * from an extra vertex at each end when `fans`. Closed shapes repeat their seam vertices, the
+ * grid itself never wraps.
+ *
+ * Vertices: the grid row by row, then the top and bottom fan centers.
+ * Edges: along the rows, across the rows, then the top and bottom fan spokes.
+ * Faces: the quads row by row, then the top and bottom fan triangles. */
+#[derive(Clone, Copy)]
+struct Topology {
+    columns: usize,
+    rows: usize,
+    fans: bool,
+}
+
+impl Topology {
+    fn row_len(&self) -> usize {
+        self.columns + 1
+    }
+
+    fn grid_verts(&self) -> usize {
+        self.row_len() * self.rows
+    }
+
+    fn quad_rows(&self) -> usize {
+        self.rows - 1
+    }
+
+    fn quads(&self) -> usize {
+        self.columns * self.quad_rows()
+    }
+
+    fn row_edges(&self) -> usize {
+        self.columns * self.rows
+    }
+
+    fn grid_edges(&self) -> usize {
+        self.row_edges() + self.row_len() * self.quad_rows()
+    }
+
+    /* Spokes of each fan, one per vertex of its row. */
+    fn spokes(&self) -> usize {
+        if self.fans { self.row_len() } else { 0 }
+    }
+
+    fn counts(&self) -> Counts {
+        let fan = if self.fans { self.columns } else { 0 };
+        Counts {
+            verts: self.grid_verts() + 2 * self.fans as usize,
+            edges: self.grid_edges() + 2 * self.spokes(),
+            faces: self.quads() + 2 * fan,
+            corners: 4 * self.quads() + 6 * fan,
+        }
+    }
+
+    /* `i` up to `columns` and `j` below `rows`. */
+    #[inline(always)]
+    fn vert(&self, i: usize, j: usize) -> usize {
+        j * self.row_len() + i
+    }
+
+    /* Fan center, 0 for the top and 1 for the bottom. */
+    #[inline(always)]
+    fn center(&self, fan: usize) -> usize {
+        self.grid_verts() + fan
+    }
+
+    /* Edge from `(i, j)` to `(i + 1, j)`. */
+    #[inline(always)]
+    fn row_edge(&self, i: usize, j: usize) -> usize {
+        j * self.columns + i
+    }
+
+    /* Edge from `(i, j)` to `(i, j + 1)`. */
+    #[inline(always)]
+    fn cross_edge(&self, i: usize, j: usize) -> usize {
+        self.row_edges() + j * self.row_len() + i
+    }
+
+    /* Edge from a fan center to `(i, row)` of the first or last row. */
+    #[inline(always)]
+    fn spoke(&self, fan: usize, i: usize) -> usize {
+        self.grid_edges() + fan * self.spokes() + i
+    }
+
+    fn edge(&self, edge: usize) -> [i32; EDGE_LEN] {
+        let [v1, v2] = if edge < self.row_edges() {
+            let (j, i) = (edge / self.columns, edge % self.columns);
+            [self.vert(i, j), self.vert(i + 1, j)]
+        } else if edge < self.grid_edges() {
+            let cross = edge - self.row_edges();
+            let (j, i) = (cross / self.row_len(), cross % self.row_len());
+            [self.vert(i, j), self.vert(i, j + 1)]
+        } else {
+            let spoke = edge - self.grid_edges();
+            let (fan, i) = (spoke / self.spokes(), spoke % self.spokes());
+            let row = if fan == 0 { 0 } else { self.rows - 1 };
+            [self.center(fan), self.vert(i, row)]
+        };
+        [v1 as i32, v2 as i32]
+    }
+
+    fn poly(&self, face: usize) -> [i32; POLY_LEN] {
+        let quads = self.quads();
+        if face < quads {
+            [(face * 4) as i32, 4]
+        } else {
+            [(quads * 4 + (face - quads) * 3) as i32, 3]
+        }
+    }
+
+    /* Face, vertex and edge to the next corner, and the grid position of the corner: the
+     * column and row, `None` for a fan center. Quads run (i, j), (i + 1, j),
+     * (i + 1, j + 1), (i, j + 1), which faces outwards for every shape. */
+    #[inline(always)]
+    fn corner(&self, corner: usize) -> (usize, usize, usize, Option<(usize, usize)>) {
+        let quads = self.quads();
+        if corner < quads * 4 {
+            let (face, k) = (corner / 4, corner % 4);
+            let (j, i) = (face / self.columns, face % self.columns);
+            let (ci, cj) = [(i, j), (i + 1, j), (i + 1, j + 1), (i, j + 1)][k];
+            let edge = match k {
+                0 => self.row_edge(i, j),
+                1 => self.cross_edge(i + 1, j),
+                2 => self.row_edge(i, j + 1),
+                _ => self.cross_edge(i, j),
+            };
+            return (face, self.vert(ci, cj), edge, Some((ci, cj)));
+        }
+        let tri = (corner - quads * 4) / 3;
+        let k = (corner - quads * 4) % 3;
+        let face = quads + tri;
+        let (fan, i) = (tri / self.columns, tri % self.columns);
+        if fan == 0 {
+            /* Top: center, (i + 1, 0), (i, 0). */
+            match k {
+                0 => (face, self.center(0), self.spoke(0, i + 1), None),
+                1 => (
+                    face,
+                    self.vert(i + 1, 0),
+                    self.row_edge(i, 0),
+                    Some((i + 1, 0)),
+                ),
+                _ => (face, self.vert(i, 0), self.spoke(0, i), Some((i, 0))),
+            }
+        } else {
+            /* Bottom: (i, last), (i + 1, last), center. */
+            let last = self.rows - 1;
+            match k {
+                0 => (
+                    face,
+                    self.vert(i, last),
+                    self.row_edge(i, last),
+                    Some((i, last)),
+                ),
+                1 => (
+                    face,
+                    self.vert(i + 1, last),
+                    self.spoke(1, i + 1),
+                    Some((i + 1, last)),
+                ),
+                _ => (face, self.center(1), self.spoke(1, i), None),
+            }
+        }
+    }
+}
+
+/* Cosine and sine of `offset + step * k` for `k` in `0..=count`. */
+fn angles(count: usize, step: f32, offset: f32) -> Vec<[f32; 2]> {
+    (0..=count)
+        .map(|k| {
+            let angle = offset + step * k as f32;
+            [angle.cos(), angle.sin()]
+        })
+        .collect()
+}
+
+/* `angles` once around the circle in `count` steps. The last angle repeats the first exactly,
+ * so that the seam vertices land on the vertices they repeat. */
+fn circle(count: usize) -> Vec<[f32; 2]> {
+    let mut values = angles(count, TAU / count as f32, 0.0);
+    values[count] = values[0];
+    values
+}
+
+/* A primitive with its resolution clamped and the angles of its columns and rows looked up
+ * once, so that no vertex evaluates trigonometry. */
+struct Generator {
+    primitive: Primitive,
+    topology: Topology,
+    u_angles: Vec<[f32; 2]>,
+    v_angles: Vec<[f32; 2]>,
+}
+
+impl Generator {
+    fn new(primitive: Primitive) -> Self {
+        let (primitive, topology, u_angles, v_angles) = match primitive {
+            Primitive::Grid {
+                x_segments,
+                z_segments,
+                size,
+            } => {
+                let (x_segments, z_segments) = (x_segments.max(1), z_segments.max(1));
+                let topology = Topology {
+                    columns: x_segments,
+                    rows: z_segments + 1,
+                    fans: false,
+                };
+                let primitive = Primitive::Grid {
+                    x_segments,
+                    z_segments,
+                    size,
+                };
+                (primitive, topology, Vec::new(), Vec::new())
+            }
+            Primitive::UvSphere {
+                segments,
+                rings,
+                radius,
+            } => {
+                let (segments, rings) = (segments.max(3), rings.max(2));
+                let topology = Topology {
+                    columns: segments,
+                    rows: rings - 1,
+                    fans: true,
+                };
+                /* Rows start one ring below the north pole. */
+                let step = PI / rings as f32;
+                let v_angles = angles(rings - 2, step, step);
+                let primitive = Primitive::UvSphere {
+                    segments,
+                    rings,
+                    radius,
+                };
+                (primitive, topology, circle(segments), v_angles)
+            }
+            Primitive::Torus {
+                major_segments,
+                minor_segments,
+                major_radius,
+                minor_radius,
+            } => {
+                let (major_segments, minor_segments) =
+                    (major_segments.max(3), minor_segments.max(3));
+                let topology = Topology {
+                    columns: major_segments,
+                    rows: minor_segments + 1,
+                    fans: false,
+                };
+                let primitive = Primitive::Torus {
+                    major_segments,
+                    minor_segments,
+                    major_radius,
+                    minor_radius,
+                };
+                (
+                    primitive,
+                    topology,
+                    circle(major_segments),
+                    circle(minor_segments),
+                )
+            }
+            Primitive::Cylinder {
+                segments,
+                rings,
+                radius,
+                depth,
+            } => {
+                let (segments, rings) = (segments.max(3), rings.max(1));
+                let topology = Topology {
+                    columns: segments,
+                    rows: rings + 1,
+                    fans: true,
+                };
+                let primitive = Primitive::Cylinder {
+                    segments,
+                    rings,
+                    radius,
+                    depth,
+                };
+                (primitive, topology, circle(segments), Vec::new())
+            }
+        };
+        Generator {
+            primitive,
+            topology,
+            u_angles,
+            v_angles,
+        }
+    }
+
+    /* Uv of the grid position `(i, j)`: the seam column and row reach 1. */
+    #[inline(always)]
+    fn grid_uv(&self, i: usize, j: usize) -> [f32; 2] {
+        let t = &self.topology;
+        let u = i as f32 / t.columns as f32;
+        match self.primitive {
+            Primitive::Grid { .. } => [u, j as f32 / (t.rows - 1) as f32],
+            Primitive::UvSphere { rings, .. } => [u, 1.0 - (j + 1) as f32 / rings as f32],
+            Primitive::Torus { .. } => [u, j as f32 / (t.rows - 1) as f32],
+            Primitive::Cylinder { .. } => [u, 1.0 - j as f32 / (t.rows - 1) as f32],
+        }
+    }
+
+    /* Uv of a corner of the fan triangle `i`: the center when `at` is `None`. */
+    #[inline(always)]
+    fn fan_uv(&self, fan: usize, i: usize, at: Option<(usize, usize)>) -> [f32; 2] {
+        match (self.primitive, at) {
+            /* Caps are mapped onto the unit square, seen from outside. */
+            (Primitive::Cylinder { .. }, Some((column, _))) => {
+                let [cos, sin] = self.u_angles[column];
+                let sin = if fan == 0 { -sin } else { sin };
+                [0.5 + 0.5 * cos, 0.5 + 0.5 * sin]
+            }
+            (Primitive::Cylinder { .. }, None) => [0.5, 0.5],
+            (_, Some((column, row))) => self.grid_uv(column, row),
+            /* The pole is split, every triangle gets its own point above the middle of its
+             * edge on the ring. */
+            (_, None) => [
+                (i as f32 + 0.5) / self.topology.columns as f32,
+                if fan == 0 { 1.0 } else { 0.0 },
+            ],
+        }
+    }
+
+    fn vert(&self, vert: usize) -> [f32; VERT_LEN] {
+        let t = &self.topology;
+        if vert >= t.grid_verts() {
+            return self.center_vert(vert - t.grid_verts());
+        }
+        let (j, i) = (vert / t.row_len(), vert % t.row_len());
+        let (co, no) = match self.primitive {
+            Primitive::Grid { size, .. } => {
+                /* Rows run towards -z, so that the quads face +y. */
+                let x = (i as f32 / t.columns as f32 - 0.5) * size;
+                let z = (0.5 - j as f32 / (t.rows - 1) as f32) * size;
+                ([x, 0.0, z], [0.0, 1.0, 0.0])
+            }
+            Primitive::UvSphere { radius, .. } => {
+                let [cos_u, sin_u] = self.u_angles[i];
+                let [cos_v, sin_v] = self.v_angles[j];
+                let no = [sin_v * cos_u, cos_v, sin_v * sin_u];
+                (no.map(|n| n * radius), no)
+            }
+            Primitive::Torus {
+                major_radius,
+                minor_radius,
+                ..
+            } => {
+                /* The tube is walked downwards on its outside, which makes the quads face
+                 * outwards. */
+                let [cos_u, sin_u] = self.u_angles[i];
+                let [cos_v, sin_v] = self.v_angles[j];
+                let no = [cos_v * cos_u, -sin_v, cos_v * sin_u];
+                let ring = major_radius + minor_radius * cos_v;
+                ([ring * cos_u, -minor_radius * sin_v, ring * sin_u], no)
+            }
+            Primitive::Cylinder { radius, depth, .. } => {
+                let [cos_u, sin_u] = self.u_angles[i];
+                let y = (0.5 - j as f32 / (t.rows - 1) as f32) * depth;
+                ([radius * cos_u, y, radius * sin_u], [cos_u, 0.0, sin_u])
+            }
+        };
+        let uv = self.grid_uv(i, j);
+        [co[0], co[1], co[2], no[0], no[1], no[2], uv[0], uv[1]]
+    }
+
+    fn center_vert(&self, fan: usize) -> [f32; VERT_LEN] {
+        let sign = if fan == 0 { 1.0 } else { -1.0 };
+        let (y, uv) = match self.primitive {
+            Primitive::UvSphere { radius, .. } => (radius, [0.5, if fan == 0 { 1.0 } else { 0.0 }]),
+            Primitive::Cylinder { depth, .. } => (depth * 0.5, [0.5, 0.5]),
+            _ => unreachable!("only spheres and cylinders have fans"),
+        };
+        [0.0, sign * y, 0.0, 0.0, sign, 0.0, uv[0], uv[1]]
+    }
+
+    fn corner(&self, corner: usize) -> [i32; LOOP_LEN] {
+        let t = &self.topology;
+        let (face, vert, edge, at) = t.corner(corner);
+        let uv = if face < t.quads() {
+            let (i, j) = at.unwrap();
+            self.grid_uv(i, j)
+        } else {
+            let tri = face - t.quads();
+            self.fan_uv(tri / t.columns, tri % t.columns, at)
+        };
+        [
+            vert as i32,
+            edge as i32,
+            face as i32,
+            uv[0].to_bits() as i32,
+            uv[1].to_bits() as i32,
+        ]
+    }
+}
+
+/* `N` values per element, computed from the element index, in parallel. */
+fn fill<T: Copy + Send, const N: usize>(out: &mut [T], element: impl Fn(usize) -> [T; N] + Sync) {
+    assert_eq!(out.len() % N, 0);
+    out.par_chunks_mut(N * ELEMENTS_PER_TASK)
+        .enumerate()
+        .for_each(|(task, chunk)| {
+            let first = task * ELEMENTS_PER_TASK;
+            for (k, values) in chunk.chunks_exact_mut(N).enumerate() {
+                values.copy_from_slice(&element(first + k));
+            }
+        });
+}
+
+impl Primitive {
+    /// The primitive `kind` of the C interface: 0 grid, 1 uv sphere, 2 torus, 3 cylinder.
+    /// `segments` and `rings` are the resolution around and along the shape, the grid's
+    /// resolution along x and z, the torus' around the axis and around the tube. `size` is the
+    /// radius, the torus' major radius and the grid's side, `depth` the cylinder's depth and
+    /// the torus' minor radius.
+    pub fn from_parameters(
+        kind: u32,
+        segments: usize,
+        rings: usize,
+        size: f32,
+        depth: f32,
+    ) -> Option<Primitive> {
+        match kind {
+            0 => Some(Primitive::Grid {
+                x_segments: segments,
+                z_segments: rings,
+                size,
+            }),
+            1 => Some(Primitive::UvSphere {
+                segments,
+                rings,
+                radius: size,
+            }),
+            2 => Some(Primitive::Torus {
+                major_segments: segments,
+                minor_segments: rings,
+                major_radius: size,
+                minor_radius: depth,
+            }),
+            3 => Some(Primitive::Cylinder {
+                segments,
+                rings,
+                radius: size,
+                depth,
+            }),
+            _ => None,
+        }
+    }
+
+    /// Array sizes to allocate for [`generate`].
+    pub fn counts(&self) -> Counts {
+        Generator::new(*self).topology.counts()
+    }
+}
+
+/// Fill the `dna::Mesh` arrays of `primitive`, sized by [`Primitive::counts`]: `MVert`
+/// positions, normals and uvs, `MEdge`s, `MLoop`s with their vertex, edge to the next corner,
+/// face and uv, and `MPoly`s, quads first.
+pub fn generate(
+    primitive: Primitive,
+    verts: &mut [f32],
+    edges: &mut [i32],
+    loops: &mut [i32],
+    polys: &mut [i32],
+) {
+    let generator = Generator::new(primitive);
+    let counts = generator.topology.counts();
+    assert!(
+        counts.corners <= i32::MAX as usize,
+        "too many corners for 32 bit indices"
+    );
+    assert_eq!(verts.len(), counts.verts * VERT_LEN);
+    assert_eq!(edges.len(), counts.edges * EDGE_LEN);
+    assert_eq!(loops.len(), counts.corners * LOOP_LEN);
+    assert_eq!(polys.len(), counts.faces * POLY_LEN);
+
+    let topology = &generator.topology;
+    fill(verts, |vert| generator.vert(vert));
+    fill(edges, |edge| topology.edge(edge));
+    fill(loops, |corner| generator.corner(corner));
+    fill(polys, |face| topology.poly(face));
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::normals::{self, MeshArrays};
+    use std::collections::HashSet;
+
+    struct Arrays {
+        verts: Vec<f32>,
+        edges: Vec<i32>,
+        loops: Vec<i32>,
+        polys: Vec<i32>,
+    }
+
+    fn build(primitive: Primitive) -> Arrays {
+        let counts = primitive.counts();
+        let mut arrays = Arrays {
+            verts: vec![f32::NAN; counts.verts * VERT_LEN],
+            edges: vec![-1; counts.edges * EDGE_LEN],
+            loops: vec![-1; counts.corners * LOOP_LEN],
+            polys: vec![-1; counts.faces * POLY_LEN],
+        };
+        generate(
+            primitive,
+            &mut arrays.verts,
+            &mut arrays.edges,
+            &mut arrays.loops,
+            &mut arrays.polys,
+        );
+        arrays
+    }
+
+    /* With the Euler characteristic of the closed surface, once the seams are welded. */
+    const SHAPES: [(Primitive, i64); 4] = [
+        (
+            Primitive::Grid {
+                x_segments: 7,
+                z_segments: 3,
+                size: 2.0,
+            },
+            1,
+        ),
+        (
+            Primitive::UvSphere {
+                segments: 12,
+                rings: 7,
+                radius: 1.5,
+            },
+            2,
+        ),
+        (
+            Primitive::Torus {
+                major_segments: 10,
+                minor_segments: 6,
+                major_radius: 2.0,
+                minor_radius: 0.5,
+            },
+            0,
+        ),
+        (
+            Primitive::Cylinder {
+                segments: 9,
+                rings: 4,
+                radius: 1.0,
+                depth: 3.0,
+            },
+            2,
+        ),
+    ];
+
+    #[test]
+    fn topology_is_complete() {
+        for (primitive, euler) in SHAPES {
+            let counts = primitive.counts();
+            let a = build(primitive);
+            assert!(a.verts.iter().all(|v| v.is_finite()), "{primitive:?}");
+
+            /* Every edge is distinct and used by the corners that run along it. */
+            let edges: Vec<[i32; 2]> = a.edges.chunks_exact(2).map(|e| [e[0], e[1]]).collect();
+            let unique: HashSet<[i32; 2]> =
+                edges.iter().map(|&[a, b]| [a.min(b), a.max(b)]).collect();
+            assert_eq!(unique.len(), counts.edges, "{primitive:?}");
+            let mut used = vec![0; counts.edges];
+            for face in 0..counts.faces {
+                let (first, n) = (a.polys[face * 2] as usize, a.polys[face * 2 + 1] as usize);
+                for corner in first..first + n {
+                    let next = if corner + 1 == first + n {
+                        first
+                    } else {
+                        corner + 1
+                    };
+                    let [v, e, f] = [0, 1, 2].map(|k| a.loops[corner * LOOP_LEN + k]);
+                    let [va, vb] = edges[e as usize];
+                    let next_v = a.loops[next * LOOP_LEN];
+                    assert!(
+                        [va, vb] == [v, next_v] || [vb, va] == [v, next_v],
+                        "{primitive:?}"
+                    );
+                    assert_eq!(f as usize, face);
+                    used[e as usize] += 1;
+                }
+            }
+            assert!(used.iter().all(|&n| n == 1 || n == 2));
+
+            /* Cut open along the seams, every shape is a disk. */
+            let euler_found = counts.verts as i64 - counts.edges as i64 + counts.faces as i64;
+            assert_eq!(euler_found, 1, "{primitive:?}");
+
+            /* The repeated seam vertices sit exactly on the ones they repeat: welding vertices
+             * by position closes the surface, every welded edge of a closed shape has two
+             * faces. */
+            let key = |v: i32| -> [u32; 3] {
+                let co = &a.verts[v as usize * VERT_LEN..v as usize * VERT_LEN + 3];
+                [co[0].to_bits(), co[1].to_bits(), co[2].to_bits()]
+            };
+            let welded_verts: HashSet<[u32; 3]> = (0..counts.verts as i32).map(key).collect();
+            let mut welded_edges = std::collections::HashMap::new();
+            for (&[a, b], &n) in edges.iter().zip(&used) {
+                *welded_edges
+                    .entry([key(a).min(key(b)), key(a).max(key(b))])
+                    .or_insert(0) += n;
+            }
+            let welded_euler =
+                welded_verts.len() as i64 - welded_edges.len() as i64 + counts.faces as i64;
+            assert_eq!(welded_euler, euler, "{primitive:?}");
+            if !matches!(primitive, Primitive::Grid { .. }) {
+                assert!(welded_edges.values().all(|&n| n == 2), "{primitive:?}");
+            }
+        }
+    }
+
+    #[test]
+    fn vertex_uvs_match_the_quads() {
+        for (primitive, _) in SHAPES {
+            let a = build(primitive);
+            for face in a.polys.chunks_exact(POLY_LEN).filter(|p| p[1] == 4) {
+                for corner in face[0] as usize..(face[0] + 4) as usize {
+                    let l = &a.loops[corner * LOOP_LEN..(corner + 1) * LOOP_LEN];
+                    let v = l[0] as usize;
+                    let vert_uv = &a.verts[v * VERT_LEN + 6..v * VERT_LEN + 8];
+                    let corner_uv = [f32::from_bits(l[3] as u32), f32::from_bits(l[4] as u32)];
+                    assert_eq!(vert_uv, corner_uv, "{primitive:?} corner {corner}");
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn faces_point_outwards() {
+        for (primitive, _) in SHAPES {
+            let a = build(primitive);
+            let mesh = MeshArrays {
+                verts: &a.verts,
+                loops: &a.loops,
+                polys: &a.polys,
+            };
+            let mut face_normals = vec![0.0; mesh.faces_num() * 3];
+            normals::face_normals(mesh, &mut face_normals);
+
+            for face in 0..mesh.faces_num() {
+                let (first, n) = (a.polys[face * 2] as usize, a.polys[face * 2 + 1] as usize);
+                let mut center = [0.0f32; 3];
+                for corner in first..first + n {
+                    let v = a.loops[corner * LOOP_LEN] as usize;
+                    for k in 0..3 {
+                        center[k] += a.verts[v * VERT_LEN + k] / n as f32;
+                    }
+                }
+                /* Away from the axis or plane the shape is built around. */
+                let outwards = match primitive {
+                    Primitive::Grid { .. } => [0.0, 1.0, 0.0],
+                    Primitive::Torus { major_radius, .. } => {
+                        let ring = (center[0].powi(2) + center[2].powi(2)).sqrt();
+                        let s = major_radius / ring;
+                        [center[0] * (1.0 - s), center[1], center[2] * (1.0 - s)]
+                    }
+                    _ => center,
+                };
+                let normal = &face_normals[face * 3..face * 3 + 3];
+                let d: f32 = (0..3).map(|k| normal[k] * outwards[k]).sum();
+                assert!(d > 0.0, "{primitive:?} face {face}");
+            }
+        }
+    }
+
+    #[test]
+    fn uvs_stay_in_unit_square() {
+        for (primitive, _) in SHAPES {
+            let a = build(primitive);
+            let corner_uvs = a
+                .loops
+                .chunks_exact(LOOP_LEN)
+                .flat_map(|l| [f32::from_bits(l[3] as u32), f32::from_bits(l[4] as u32)]);
+            let vert_uvs = a.verts.chunks_exact(VERT_LEN).flat_map(|v| [v[6], v[7]]);
+            for uv in corner_uvs.chain(vert_uvs) {
+                assert!((0.0..=1.0).contains(&uv), "{primitive:?} {uv}");
+            }
+            /* The seam column of a closed shape ends at u = 1, on its own vertices. */
+            if !matches!(primitive, Primitive::Grid { .. }) {
+                assert!(a.verts.chunks_exact(VERT_LEN).any(|v| v[6] == 1.0));
+            }
+        }
+    }
+
+    #[test]
+    fn counts_match_the_resolution() {
+        let sphere = Primitive::UvSphere {
+            segments: 32,
+            rings: 16,
+            radius: 1.0,
+        };
+        assert_eq!(
+            sphere.counts(),
+            Counts {
+                verts: 33 * 15 + 2,
+                edges: 32 * 15 + 33 * 14 + 66,
+                faces: 32 * 14 + 64,
+                corners: 32 * 14 * 4 + 64 * 3,
+            }
+        );
+        /* Too low resolutions are raised to the minimum. */
+        let flat = Primitive::Cylinder {
+            segments: 0,
+            rings: 0,
+            radius: 1.0,
+            depth: 1.0,
+        };
+        assert_eq!(flat.counts().faces, 3 + 6);
+        /* Large enough for several tasks per array. */
+        let grid = Primitive::Grid {
+            x_segments: 300,
+            z_segments: 200,
+            size: 1.0,
+        };
+        let a = build(grid);
+        assert_eq!(a.polys.len() / POLY_LEN, 60_000);
+        assert!(
+            a.loops
+                .chunks_exact(LOOP_LEN)
+                .all(|l| l[0] >= 0 && l[1] >= 0)
+        );
+    }
+}
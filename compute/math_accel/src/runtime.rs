@@ -0,0 +1,445 @@
+//! The thread pool the kernels run on, and per-kernel timing counters.
+//!
+//! Kernels run on rayon's global pool. [`init`] configures it explicitly, so that the compute
+//! threads can be sized and pinned next to the other threads of the host. Without a call,
+//! rayon creates one thread per core on first use. In cooperative mode the kernels run on a
+//! pool of [`init`] instead, every entry point enters it with [`install`].
+
+use std::panic::{AssertUnwindSafe, catch_unwind, resume_unwind};
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::Instant;
+
+#[derive(Clone, Debug, Default)]
+pub struct RuntimeConfig {
+    /// Worker threads, 0 for one per core.
+    pub threads: usize,
+    /// Pin worker `i` to core `cores[i % cores.len()]`, no pinning when empty. Linux only. Not
+    /// allowed in cooperative mode, the lent threads keep the affinity the host gave them.
+    pub cores: Vec<usize>,
+    /// Workers are named `"{thread_name}:{index}"`, rayon's default when empty.
+    pub thread_name: String,
+    /// Start no threads, the host runs the workers on its own threads with [`lend_thread`].
+    pub cooperative: bool,
+}
+
+/* Cooperative mode. Lent threads run the workers of `pool` until the host takes them back with
+ * `reclaim_threads`, which ends the pool, the next lend starts a new one. The global pool can't
+ * be used, building it waits until every worker runs, and it never ends. */
+struct Cooperative {
+    threads: usize,
+    pool: Option<Arc<rayon::ThreadPool>>,
+    /* Workers of `pool` waiting for a thread. */
+    pending: Arc<Mutex<Vec<rayon::ThreadBuilder>>>,
+    /* Workers of `pool` running on a lent thread. */
+    lent: Arc<AtomicUsize>,
+}
+
+impl Cooperative {
+    fn start_pool(&mut self) -> Result<(), String> {
+        let pending = Arc::new(Mutex::new(Vec::new()));
+        let pool = {
+            let pending = Arc::clone(&pending);
+            rayon::ThreadPoolBuilder::new()
+                .num_threads(self.threads)
+                .spawn_handler(move |worker| {
+                    pending.lock().unwrap().push(worker);
+                    Ok(())
+                })
+                .build()
+                .map_err(|error| error.to_string())?
+        };
+        self.pool = Some(Arc::new(pool));
+        self.pending = pending;
+        self.lent = Arc::new(AtomicUsize::new(0));
+        Ok(())
+    }
+
+    /// The pool when at least one of its workers runs, kernels entering it are picked up.
+    fn running_pool(&self) -> Option<Arc<rayon::ThreadPool>> {
+        match self.lent.load(Ordering::Acquire) {
+            0 => None,
+            _ => self.pool.clone(),
+        }
+    }
+}
+
+static COOPERATIVE: Mutex<Option<Cooperative>> = Mutex::new(None);
+static COOPERATIVE_MODE: AtomicBool = AtomicBool::new(false);
+
+static INITIALIZED: AtomicBool = AtomicBool::new(false);
+
+/// Build the pool. Fails when it already exists, when `cores` is set in cooperative mode, and
+/// outside of cooperative mode when a kernel already ran, which built rayon's global pool.
+pub fn init(config: RuntimeConfig) -> Result<(), String> {
+    if config.cooperative && !config.cores.is_empty() {
+        return Err(
+            "Core affinity can't be set in cooperative mode, the host owns the threads."
+                .to_string(),
+        );
+    }
+    if INITIALIZED.swap(true, Ordering::AcqRel) {
+        return Err("The compute thread pool has already been initialized.".to_string());
+    }
+    if config.cooperative {
+        /* Threads of the host keep their own names and affinity. */
+        let threads = match config.threads {
+            0 => std::thread::available_parallelism().map_or(1, |n| n.get()),
+            threads => threads,
+        };
+        let mut cooperative = Cooperative {
+            threads,
+            pool: None,
+            pending: Arc::default(),
+            lent: Arc::default(),
+        };
+        cooperative.start_pool()?;
+        *COOPERATIVE.lock().unwrap() = Some(cooperative);
+        COOPERATIVE_MODE.store(true, Ordering::Release);
+        return Ok(());
+    }
+    let mut builder = rayon::ThreadPoolBuilder::new().num_threads(config.threads);
+    if !config.thread_name.is_empty() {
+        let name = config.thread_name.clone();
+        builder = builder.thread_name(move |index| format!("{name}:{index}"));
+    }
+    if !config.cores.is_empty() {
+        let cores = config.cores.clone();
+        builder =
+            builder.start_handler(move |index| pin_current_thread(cores[index % cores.len()]));
+    }
+    builder.build_global().map_err(|error| error.to_string())
+}
+
+/// Run `op` on the pool of the kernels, see [`init`]. Every kernel entry point goes through it.
+/// In cooperative mode while no thread is lent, `op` runs single threaded on the caller.
+pub fn install<R: Send>(op: impl FnOnce() -> R + Send) -> R {
+    if !COOPERATIVE_MODE.load(Ordering::Acquire) || rayon::current_thread_index().is_some() {
+        return op();
+    }
+    let pool = COOPERATIVE
+        .lock()
+        .unwrap()
+        .as_ref()
+        .and_then(Cooperative::running_pool);
+    match pool {
+        Some(pool) => pool.install(op),
+        None => run_on_caller(op),
+    }
+}
+
+/// Run `op` on the calling thread as the only worker of a pool of its own, which ends once
+/// `op` returned.
+fn run_on_caller<R: Send>(op: impl FnOnce() -> R + Send) -> R {
+    struct SendPtr<T>(*mut T);
+    unsafe impl<T> Send for SendPtr<T> {}
+    impl<T> SendPtr<T> {
+        fn get(&self) -> *mut T {
+            self.0
+        }
+    }
+
+    let worker = Arc::new(Mutex::new(None));
+    let pool = {
+        let worker = Arc::clone(&worker);
+        rayon::ThreadPoolBuilder::new()
+            .num_threads(1)
+            .spawn_handler(move |thread| {
+                *worker.lock().unwrap() = Some(thread);
+                Ok(())
+            })
+            .build()
+            .expect("A pool without threads of its own can always be built.")
+    };
+
+    let mut result = None;
+    let result_ptr = SendPtr(&mut result as *mut Option<std::thread::Result<R>>);
+    let job: Box<dyn FnOnce() + Send + '_> = Box::new(move || {
+        let value = catch_unwind(AssertUnwindSafe(op));
+        unsafe { *result_ptr.get() = Some(value) };
+    });
+    /* SAFETY: the job borrows from this frame. A pool only ends once its spawned jobs ran, so
+     * `run` below returns after the job, before the frame does. */
+    let job: Box<dyn FnOnce() + Send + 'static> = unsafe { std::mem::transmute(job) };
+    pool.spawn(job);
+    drop(pool);
+    let thread = worker.lock().unwrap().take().unwrap();
+    thread.run();
+
+    match result.unwrap() {
+        Ok(value) => value,
+        Err(panic) => resume_unwind(panic),
+    }
+}
+
+/// Cooperative mode: run a worker of the pool on the calling thread until the host takes the
+/// threads back with [`reclaim_threads`], then return true. Returns false right away when every
+/// worker already has a thread, outside of cooperative mode and on threads of a pool.
+pub fn lend_thread() -> bool {
+    if rayon::current_thread_index().is_some() {
+        return false;
+    }
+    let (worker, lent) = {
+        let mut cooperative = COOPERATIVE.lock().unwrap();
+        let Some(cooperative) = cooperative.as_mut() else {
+            return false;
+        };
+        if cooperative.pool.is_none() && cooperative.start_pool().is_err() {
+            return false;
+        }
+        let Some(worker) = cooperative.pending.lock().unwrap().pop() else {
+            return false;
+        };
+        cooperative.lent.fetch_add(1, Ordering::AcqRel);
+        (worker, Arc::clone(&cooperative.lent))
+    };
+    worker.run();
+    lent.fetch_sub(1, Ordering::AcqRel);
+    true
+}
+
+/// Cooperative mode: end the pool of the lent threads. Each returns from [`lend_thread`] once
+/// the kernels it runs finished, kernels called meanwhile run on their caller.
+pub fn reclaim_threads() {
+    let pool = COOPERATIVE
+        .lock()
+        .unwrap()
+        .as_mut()
+        .and_then(|cooperative| cooperative.pool.take());
+    /* Outside of the lock, the last kernel still in the pool ends it. */
+    drop(pool);
+}
+
+/// Workers of the pool, also in cooperative mode before they have been lent.
+pub fn threads() -> usize {
+    match COOPERATIVE.lock().unwrap().as_ref() {
+        Some(cooperative) => cooperative.threads,
+        None => rayon::current_num_threads(),
+    }
+}
+
+#[cfg(target_os = "linux")]
+fn pin_current_thread(core: usize) {
+    unsafe extern "C" {
+        fn sched_setaffinity(pid: i32, size: usize, mask: *const u64) -> i32;
+    }
+    /* cpu_set_t, 1024 cores. */
+    let mut mask = [0u64; 16];
+    if core < mask.len() * 64 {
+        mask[core / 64] |= 1 << (core % 64);
+        /* Pinning is a hint, the thread keeps running anywhere when it fails. */
+        unsafe { sched_setaffinity(0, std::mem::size_of_val(&mask), mask.as_ptr()) };
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+fn pin_current_thread(_core: usize) {}
+
+/// Entry points with their own timing counter.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Kernel {
+    WorldMatrices,
+    Transforms,
+    MultiplyMatrices,
+    MatrixVectorMuls,
+    AddVectors,
+    DotProducts,
+    SelectFrustum,
+    SelectPolygon,
+    FaceNormals,
+    VertexNormals,
+    Tangents,
+    MeshBounds,
+    TransformBounds,
+    CullSpheres,
+    CullBoxes,
+    MeshPrimitive,
+}
+
+pub const KERNELS: [Kernel; 16] = [
+    Kernel::WorldMatrices,
+    Kernel::Transforms,
+    Kernel::MultiplyMatrices,
+    Kernel::MatrixVectorMuls,
+    Kernel::AddVectors,
+    Kernel::DotProducts,
+    Kernel::SelectFrustum,
+    Kernel::SelectPolygon,
+    Kernel::FaceNormals,
+    Kernel::VertexNormals,
+    Kernel::Tangents,
+    Kernel::MeshBounds,
+    Kernel::TransformBounds,
+    Kernel::CullSpheres,
+    Kernel::CullBoxes,
+    Kernel::MeshPrimitive,
+];
+
+impl Kernel {
+    pub fn name(self) -> &'static str {
+        match self {
+            Kernel::WorldMatrices => "world_matrices",
+            Kernel::Transforms => "transforms",
+            Kernel::MultiplyMatrices => "multiply_matrices",
+            Kernel::MatrixVectorMuls => "matrix_vector_muls",
+            Kernel::AddVectors => "add_vectors",
+            Kernel::DotProducts => "dot_products",
+            Kernel::SelectFrustum => "select_frustum",
+            Kernel::SelectPolygon => "select_polygon",
+            Kernel::FaceNormals => "face_normals",
+            Kernel::VertexNormals => "vertex_normals",
+            Kernel::Tangents => "tangents",
+            Kernel::MeshBounds => "mesh_bounds",
+            Kernel::TransformBounds => "transform_bounds",
+            Kernel::CullSpheres => "cull_spheres",
+            Kernel::CullBoxes => "cull_boxes",
+            Kernel::MeshPrimitive => "mesh_primitive",
+        }
+    }
+}
+
+struct Counter {
+    calls: AtomicU64,
+    nanoseconds: AtomicU64,
+    max_nanoseconds: AtomicU64,
+}
+
+impl Counter {
+    const fn new() -> Self {
+        Counter {
+            calls: AtomicU64::new(0),
+            nanoseconds: AtomicU64::new(0),
+            max_nanoseconds: AtomicU64::new(0),
+        }
+    }
+}
+
+static COUNTERS: [Counter; KERNELS.len()] = [const { Counter::new() }; KERNELS.len()];
+
+/// Adds the time until it is dropped to the counter of its kernel.
+pub struct CallTimer {
+    kernel: Kernel,
+    start: Instant,
+}
+
+pub fn time(kernel: Kernel) -> CallTimer {
+    CallTimer {
+        kernel,
+        start: Instant::now(),
+    }
+}
+
+impl Drop for CallTimer {
+    fn drop(&mut self) {
+        let nanoseconds = self.start.elapsed().as_nanos() as u64;
+        let counter = &COUNTERS[self.kernel as usize];
+        counter.calls.fetch_add(1, Ordering::Relaxed);
+        counter
+            .nanoseconds
+            .fetch_add(nanoseconds, Ordering::Relaxed);
+        counter
+            .max_nanoseconds
+            .fetch_max(nanoseconds, Ordering::Relaxed);
+    }
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct CounterValues {
+    pub kernel: Kernel,
+    pub calls: u64,
+    /// Wall clock time inside the kernel, summed over the calls.
+    pub nanoseconds: u64,
+    pub max_nanoseconds: u64,
+}
+
+/// Counters of every kernel, in [`KERNELS`] order, since the last [`reset_counters`].
+pub fn counter_values() -> Vec<CounterValues> {
+    KERNELS
+        .iter()
+        .zip(&COUNTERS)
+        .map(|(&kernel, counter)| CounterValues {
+            kernel,
+            calls: counter.calls.load(Ordering::Relaxed),
+            nanoseconds: counter.nanoseconds.load(Ordering::Relaxed),
+            max_nanoseconds: counter.max_nanoseconds.load(Ordering::Relaxed),
+        })
+        .collect()
+}
+
+pub fn reset_counters() {
+    for counter in &COUNTERS {
+        counter.calls.store(0, Ordering::Relaxed);
+        counter.nanoseconds.store(0, Ordering::Relaxed);
+        counter.max_nanoseconds.store(0, Ordering::Relaxed);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn timers_add_to_their_kernel() {
+        /* Other tests may run kernels meanwhile, only this kernel is checked. */
+        for _ in 0..3 {
+            let _timer = time(Kernel::AddVectors);
+            std::thread::sleep(std::time::Duration::from_millis(1));
+        }
+        let values = counter_values()[Kernel::AddVectors as usize];
+        assert_eq!(values.kernel, Kernel::AddVectors);
+        assert!(values.calls >= 3);
+        assert!(values.nanoseconds >= 3_000_000 && values.max_nanoseconds >= 1_000_000);
+        assert!(values.max_nanoseconds <= values.nanoseconds);
+    }
+
+    #[test]
+    fn cooperative_pool_runs_on_lent_threads() {
+        /* The only test that builds the pool, other tests running kernels meanwhile run on their
+         * own thread or on the lent ones. */
+        let config = RuntimeConfig {
+            threads: 2,
+            cooperative: true,
+            ..Default::default()
+        };
+        let pinned = RuntimeConfig {
+            cores: vec![0],
+            ..config.clone()
+        };
+        assert!(init(pinned).is_err());
+        init(config).unwrap();
+        assert_eq!(threads(), 2);
+        assert!(init(RuntimeConfig::default()).is_err());
+
+        /* Nothing lent yet, the kernel runs on the caller instead of waiting. */
+        let caller = std::thread::current().id();
+        assert_eq!(install(|| std::thread::current().id()), caller);
+        add_vectors_check();
+
+        for _ in 0..2 {
+            let lenders: Vec<_> = (0..2).map(|_| std::thread::spawn(lend_thread)).collect();
+            while install(|| std::thread::current().id()) == caller {
+                std::thread::yield_now();
+            }
+            assert_eq!(
+                install(rayon::current_thread_index).map(|i| i < 2),
+                Some(true)
+            );
+            add_vectors_check();
+
+            /* Every lent thread comes back, and can be lent again on the next round. */
+            reclaim_threads();
+            for lender in lenders {
+                assert!(lender.join().unwrap());
+            }
+            assert_eq!(install(|| std::thread::current().id()), caller);
+        }
+    }
+
+    fn add_vectors_check() {
+        let a = [1.0f32, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0];
+        let b = [0.5f32; 8];
+        let mut outs = [0.0f32; 8];
+        unsafe { crate::vk_add_vectors(a.as_ptr(), b.as_ptr(), outs.as_mut_ptr(), 2) };
+        assert_eq!(outs, [1.5, 2.5, 3.5, 4.5, 5.5, 6.5, 7.5, 8.5]);
+    }
+}
@@ -0,0 +1,172 @@
+use wide::*;
+
+/// True when any point lies inside all six planes.
+///
+/// `points` holds one point every `stride` floats, xyz first, so the `MVert` array of a mesh is
+/// read in place with a stride of [`crate::normals::VERT_LEN`]. Planes are `(a, b, c, d)` with
+/// the inside at `a * x + b * y + c * z + d >= 0`, given in the same space as the points. Points
+/// are processed four at a time.
+pub fn any_point_in_frustum(points: &[f32], stride: usize, planes: &[[f32; 4]; 6]) -> bool {
+    let count = point_count(points, stride);
+    let zero = f32x4::splat(0.0);
+    let splat_planes = planes.map(|p| {
+        (
+            f32x4::splat(p[0]),
+            f32x4::splat(p[1]),
+            f32x4::splat(p[2]),
+            f32x4::splat(p[3]),
+        )
+    });
+
+    let mut i = 0;
+    while i + 4 <= count {
+        let [x, y, z] = load_points(points, stride, [i, i + 1, i + 2, i + 3]);
+
+        let mut inside = zero.cmp_eq(zero);
+        for (a, b, c, d) in &splat_planes {
+            let dist = (*a * x) + (*b * y) + (*c * z) + *d;
+            inside = inside & dist.cmp_ge(zero);
+        }
+        if inside.any() {
+            return true;
+        }
+        i += 4;
+    }
+
+    (i..count).any(|j| {
+        let co = &points[j * stride..j * stride + 3];
+        planes
+            .iter()
+            .all(|p| p[0] * co[0] + p[1] * co[1] + p[2] * co[2] + p[3] >= 0.0)
+    })
+}
+
+/// Points in `points`, the last one only needs its xyz.
+fn point_count(points: &[f32], stride: usize) -> usize {
+    if points.len() < 3 {
+        0
+    } else {
+        (points.len() - 3) / stride + 1
+    }
+}
+
+/// x, y and z of four strided points, one lane each.
+fn load_points(points: &[f32], stride: usize, lanes: [usize; 4]) -> [f32x4; 3] {
+    std::array::from_fn(|axis| f32x4::from(lanes.map(|lane| points[lane * stride + axis])))
+}
+
+/// True when any point projects inside `polygon`, a closed loop of screen positions in pixels
+/// (origin top-left). Points are laid out as in [`any_point_in_frustum`]. `mvp` is column-major
+/// and takes the points to clip space, points behind the camera never match. Uses the crossing
+/// number rule, four points at a time.
+pub fn any_point_in_polygon(
+    points: &[f32],
+    stride: usize,
+    mvp: &[f32; 16],
+    viewport: [f32; 2],
+    polygon: &[[f32; 2]],
+) -> bool {
+    if polygon.len() < 3 {
+        return false;
+    }
+    let count = point_count(points, stride);
+    let m = mvp.map(f32x4::splat);
+    let half_w = f32x4::splat(viewport[0] * 0.5);
+    let half_h = f32x4::splat(viewport[1] * 0.5);
+    let epsilon = f32x4::splat(1e-6);
+
+    let mut i = 0;
+    while i < count {
+        /* Pad the tail by repeating the last point, it is tested twice which is harmless. */
+        let lanes = std::array::from_fn(|k| (i + k).min(count - 1));
+        let [x, y, z] = load_points(points, stride, lanes);
+
+        let cx = m[0] * x + m[4] * y + m[8] * z + m[12];
+        let cy = m[1] * x + m[5] * y + m[9] * z + m[13];
+        let cw = m[3] * x + m[7] * y + m[11] * z + m[15];
+        let in_front = cw.cmp_gt(epsilon);
+
+        let inv_w = f32x4::splat(1.0) / cw.max(epsilon);
+        let px = (cx * inv_w + f32x4::splat(1.0)) * half_w;
+        let py = (f32x4::splat(1.0) - cy * inv_w) * half_h;
+
+        let mut inside = in_front ^ in_front;
+        let mut j = polygon.len() - 1;
+        for k in 0..polygon.len() {
+            let (xi, yi) = (polygon[k][0], polygon[k][1]);
+            let (xj, yj) = (polygon[j][0], polygon[j][1]);
+            let straddles = py.cmp_lt(f32x4::splat(yi)) ^ py.cmp_lt(f32x4::splat(yj));
+            if straddles.any() {
+                let x_cross = f32x4::splat(xj - xi) * (py - f32x4::splat(yi))
+                    / f32x4::splat(yj - yi)
+                    + f32x4::splat(xi);
+                inside = inside ^ (straddles & px.cmp_lt(x_cross));
+            }
+            j = k;
+        }
+
+        if (inside & in_front).any() {
+            return true;
+        }
+        i += 4;
+    }
+    false
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::normals::VERT_LEN;
+
+    const IDENTITY: [f32; 16] = [
+        1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0,
+    ];
+
+    fn unit_box_planes() -> [[f32; 4]; 6] {
+        [
+            [1.0, 0.0, 0.0, 1.0],
+            [-1.0, 0.0, 0.0, 1.0],
+            [0.0, 1.0, 0.0, 1.0],
+            [0.0, -1.0, 0.0, 1.0],
+            [0.0, 0.0, 1.0, 1.0],
+            [0.0, 0.0, -1.0, 1.0],
+        ]
+    }
+
+    /// `MVert` array of points at `coords`, the normal and uv filled with noise.
+    fn mverts(coords: &[[f32; 3]]) -> Vec<f32> {
+        coords
+            .iter()
+            .flat_map(|co| [co[0], co[1], co[2], 9.0, 9.0, 9.0, -9.0, -9.0])
+            .collect()
+    }
+
+    #[test]
+    fn frustum_hits_only_inside_points() {
+        let planes = unit_box_planes();
+        let coords = [5.0, 6.0, 7.0, 8.0, 9.0, 0.5].map(|x| [x, 0.0, 0.0]);
+        let verts = mverts(&coords);
+        assert!(any_point_in_frustum(&verts, VERT_LEN, &planes));
+        assert!(!any_point_in_frustum(
+            &verts[..5 * VERT_LEN],
+            VERT_LEN,
+            &planes
+        ));
+
+        let packed: Vec<f32> = coords.iter().flatten().copied().collect();
+        assert!(any_point_in_frustum(&packed, 3, &planes));
+        assert!(!any_point_in_frustum(&packed[..15], 3, &planes));
+    }
+
+    #[test]
+    fn polygon_matches_scalar_reference() {
+        /* Square in the middle of a 100x100 viewport, identity projection. */
+        let polygon = [[25.0, 25.0], [75.0, 25.0], [75.0, 75.0], [25.0, 75.0]];
+        let viewport = [100.0, 100.0];
+        for (x, expect) in [(0.0, true), (0.9, false), (-0.6, false), (0.4, true)] {
+            let verts = mverts(&[[x, 0.0, 0.0], [3.0, 3.0, 0.0], [3.0, 3.0, 0.0]]);
+            let hit = any_point_in_polygon(&verts, VERT_LEN, &IDENTITY, viewport, &polygon);
+            assert_eq!(hit, expect, "x = {x}");
+        }
+    }
+}
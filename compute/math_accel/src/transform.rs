@@ -0,0 +1,185 @@
+use rayon::prelude::*;
+use wide::f32x8;
+
+use crate::hierarchy;
+
+/// Float columns of a transform table: location, rotation (XYZ Euler, radians) and scale,
+/// x, y and z each.
+pub const TRANSFORM_COLUMNS: usize = 9;
+
+/// At least this many rows per rayon task.
+const MIN_ROWS_PER_TASK: usize = 512;
+
+/* Up to eight values of a column starting at `row`, zero padded. */
+#[inline(always)]
+fn load(column: &[f32], row: usize, count: usize) -> f32x8 {
+    let mut lanes = [0.0f32; 8];
+    let n = (count - row).min(8);
+    lanes[..n].copy_from_slice(&column[row..row + n]);
+    f32x8::from(lanes)
+}
+
+/// Compose the local matrix of every row, `translate * rotate_x * rotate_y * rotate_z * scale`
+/// like `rna::RNA_object_to_mat4`, eight rows at a time.
+///
+/// `columns` holds [`TRANSFORM_COLUMNS`] columns of `stride` floats, of which the first
+/// `locals.len() / 16` rows are used. `locals` receives column-major matrices, 16 floats per
+/// row.
+pub fn compose_local_matrices(columns: &[f32], stride: usize, locals: &mut [f32]) {
+    let count = locals.len() / 16;
+    assert!(count <= stride && columns.len() >= TRANSFORM_COLUMNS * stride);
+    let column = |c: usize| &columns[c * stride..c * stride + count];
+
+    locals
+        .par_chunks_mut(8 * 16)
+        .with_min_len(MIN_ROWS_PER_TASK / 8)
+        .enumerate()
+        .for_each(|(task, out)| {
+            let row = task * 8;
+            let [lx, ly, lz, rx, ry, rz, sx, sy, sz]: [f32x8; TRANSFORM_COLUMNS] =
+                std::array::from_fn(|c| load(column(c), row, count));
+            let (sa, ca) = rx.sin_cos();
+            let (sb, cb) = ry.sin_cos();
+            let (sc, cc) = rz.sin_cos();
+
+            /* Columns of rotate_x * rotate_y, then times rotate_z. */
+            let zero = f32x8::splat(0.0);
+            let one = f32x8::splat(1.0);
+            let a0 = [cb, sa * sb, zero - ca * sb];
+            let a1 = [zero, ca, sa];
+            let a2 = [sb, zero - sa * cb, ca * cb];
+            let r0: [f32x8; 3] = std::array::from_fn(|k| cc * a0[k] + sc * a1[k]);
+            let r1: [f32x8; 3] = std::array::from_fn(|k| cc * a1[k] - sc * a0[k]);
+
+            let matrix: [f32x8; 16] = [
+                r0[0] * sx,
+                r0[1] * sx,
+                r0[2] * sx,
+                zero,
+                r1[0] * sy,
+                r1[1] * sy,
+                r1[2] * sy,
+                zero,
+                a2[0] * sz,
+                a2[1] * sz,
+                a2[2] * sz,
+                zero,
+                lx,
+                ly,
+                lz,
+                one,
+            ];
+            let matrix = matrix.map(|v| v.to_array());
+            for (lane, local) in out.chunks_exact_mut(16).enumerate() {
+                for k in 0..16 {
+                    local[k] = matrix[k][lane];
+                }
+            }
+        });
+}
+
+/// Compose the local matrices of a transform table, then evaluate the world matrices with
+/// [`hierarchy::solve_world_matrices`]. `parents` has one entry per row and the rows are in
+/// parent first order.
+pub fn compute_transforms(
+    columns: &[f32],
+    stride: usize,
+    parents: &[u32],
+    locals: &mut [f32],
+    worlds: &mut [f32],
+) {
+    compose_local_matrices(columns, stride, locals);
+    hierarchy::solve_world_matrices(locals, parents, worlds);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn multiply(a: &[f32; 16], b: &[f32; 16]) -> [f32; 16] {
+        std::array::from_fn(|i| (0..4).map(|k| a[k * 4 + i % 4] * b[(i / 4) * 4 + k]).sum())
+    }
+
+    /* The matrices RNA_object_to_mat4 multiplies, built one by one. */
+    fn compose_scalar(values: [f32; TRANSFORM_COLUMNS]) -> [f32; 16] {
+        let [lx, ly, lz, rx, ry, rz, sx, sy, sz] = values;
+        let mut t = [0.0; 16];
+        let mut s = [0.0; 16];
+        for i in 0..4 {
+            t[i * 5] = 1.0;
+        }
+        t[12..15].copy_from_slice(&[lx, ly, lz]);
+        s[0] = sx;
+        s[5] = sy;
+        s[10] = sz;
+        s[15] = 1.0;
+        let rotation = |axis: usize, angle: f32| {
+            let (sin, cos) = angle.sin_cos();
+            let (i, j) = ((axis + 1) % 3, (axis + 2) % 3);
+            let mut m = [0.0; 16];
+            m[axis * 5] = 1.0;
+            m[15] = 1.0;
+            m[i * 5] = cos;
+            m[j * 5] = cos;
+            m[i * 4 + j] = sin;
+            m[j * 4 + i] = -sin;
+            m
+        };
+        let m = multiply(&t, &rotation(0, rx));
+        let m = multiply(&m, &rotation(1, ry));
+        let m = multiply(&m, &rotation(2, rz));
+        multiply(&m, &s)
+    }
+
+    #[test]
+    fn composed_matrices_match_reference() {
+        /* 21 rows, not a multiple of the lane count, with spare stride. */
+        let count = 21;
+        let stride = 32;
+        let mut columns = vec![f32::NAN; TRANSFORM_COLUMNS * stride];
+        for c in 0..TRANSFORM_COLUMNS {
+            for row in 0..count {
+                columns[c * stride + row] = ((c * 7 + row * 3) as f32 * 0.71).sin() * 2.0;
+            }
+        }
+        let mut locals = vec![0.0; count * 16];
+        compose_local_matrices(&columns, stride, &mut locals);
+
+        for row in 0..count {
+            let expected = compose_scalar(std::array::from_fn(|c| columns[c * stride + row]));
+            for k in 0..16 {
+                let value = locals[row * 16 + k];
+                assert!(
+                    (value - expected[k]).abs() <= 1e-4,
+                    "row {row}, float {k}: {value} != {}",
+                    expected[k]
+                );
+            }
+        }
+    }
+
+    #[test]
+    fn child_follows_parent() {
+        /* Root moved by (1, 2, 3), child by (0, 0, 1) and rotated a quarter turn about z. */
+        let stride = 16;
+        let mut columns = vec![0.0; TRANSFORM_COLUMNS * stride];
+        for (c, values) in [(0, [1.0, 0.0]), (1, [2.0, 0.0]), (2, [3.0, 1.0])] {
+            columns[c * stride..c * stride + 2].copy_from_slice(&values);
+        }
+        columns[5 * stride + 1] = std::f32::consts::FRAC_PI_2;
+        for c in 6..9 {
+            columns[c * stride..c * stride + 2].fill(1.0);
+        }
+        let mut locals = vec![0.0; 32];
+        let mut worlds = vec![0.0; 32];
+        compute_transforms(
+            &columns,
+            stride,
+            &[hierarchy::NO_PARENT, 0],
+            &mut locals,
+            &mut worlds,
+        );
+        assert_eq!(&worlds[28..31], &[1.0, 2.0, 4.0]);
+        assert!((worlds[16] - 0.0).abs() < 1e-6 && (worlds[17] - 1.0).abs() < 1e-6);
+    }
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/*
+ * Deferred Log Records
+ *
+ * With deferred formatting a CLOG_* call site only stores its format string pointer and raw
+ * arguments, each tagged with a #CLG_ArgType chosen at compile time. The writer thread
+ * formats them with clg_binary_format_message(), or writes them to a binary file read by the
+ * clog_decode tool in source/tests. Native byte order.
+ *
+ *   CLG_BinaryFileHeader
+ *   { uint32_t record type, record }*
+ *
+ * A #CLG_BINARY_RECORD_SITE holds the strings of a call site the first time it logs, every
+ * #CLG_BINARY_RECORD_EVENT refers to a site by index.
+ *
+ * Packed arguments: 32 and 64 bit integers, doubles and pointers by value, strings as a
+ * uint32_t length followed by the characters, without terminator.
+ */
+
+#define CLG_BINARY_MAGIC "VKCLGBIN"
+#define CLG_BINARY_VERSION 1
+
+/** Length of a null string argument. */
+#define CLG_ARG_STRING_NULL UINT32_MAX
+
+enum CLG_ArgType : uint8_t {
+  CLG_ARG_INT32 = 1,
+  CLG_ARG_UINT32,
+  CLG_ARG_INT64,
+  CLG_ARG_UINT64,
+  CLG_ARG_DOUBLE,
+  CLG_ARG_POINTER,
+  CLG_ARG_STRING,
+};
+
+enum CLG_BinaryRecordType : uint32_t {
+  CLG_BINARY_RECORD_SITE = 1,
+  CLG_BINARY_RECORD_EVENT = 2,
+};
+
+struct CLG_BinaryFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t _pad;
+  /** Milliseconds since the epoch that event ticks are relative to. */
+  uint64_t tick_start;
+};
+
+/** Followed by the type identifier, function, format and file:line, not null terminated. */
+struct CLG_BinarySiteRecord {
+  uint32_t site;
+  uint16_t identifier_len;
+  uint16_t fn_len;
+  uint32_t format_len;
+  uint32_t file_line_len;
+};
+
+/** Followed by `arg_count` #CLG_ArgType and `args_len` bytes of packed arguments. */
+struct CLG_BinaryEventRecord {
+  uint32_t site;
+  /** A clog::CLG_Level. */
+  uint32_t level;
+  /** Milliseconds since the epoch. */
+  uint64_t tick;
+  /** Zero unless memory output was enabled. */
+  uint64_t memory_in_use;
+  uint32_t args_len;
+  uint32_t arg_count;
+};
+
+/**
+ * The arguments of `format` that are strings bounded by a `*` precision (`%.*s`), bit `i` for
+ * argument `i`. Their precision is the argument right before them. Parses conversions like
+ * #clg_binary_format_message.
+ */
+inline uint64_t clg_format_precision_strings(const char *format)
+{
+  uint64_t mask = 0;
+  uint32_t arg = 0;
+  for (const char *p = strchr(format, '%'); p; p = strchr(p, '%')) {
+    p++;
+    if (*p == '%') {
+      p++;
+      continue;
+    }
+    p += strspn(p, "-+ #0'");
+    if (*p == '*') {
+      arg++;
+      p++;
+    }
+    else {
+      p += strspn(p, "0123456789");
+    }
+    bool precision_star = false;
+    if (*p == '.') {
+      p++;
+      if (*p == '*') {
+        precision_star = true;
+        arg++;
+        p++;
+      }
+      else {
+        p += strspn(p, "0123456789");
+      }
+    }
+    p += strspn(p, "hljztL");
+    if (*p == '\0') {
+      break;
+    }
+    if (*p++ == 's' && precision_star && arg < 64) {
+      mask |= uint64_t(1) << arg;
+    }
+    arg++;
+  }
+  return mask;
+}
+
+/* `spec` is a single conversion taken from a checked format literal. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+template<typename T>
+inline void clg_binary_append_arg(
+    std::string &r_message, const char *spec, const int *stars, int star_count, T value)
+{
+  char buf[256];
+  auto format = [&](char *dst, size_t dst_len) {
+    switch (star_count) {
+      case 0:
+        return snprintf(dst, dst_len, spec, value);
+      case 1:
+        return snprintf(dst, dst_len, spec, stars[0], value);
+      default:
+        return snprintf(dst, dst_len, spec, stars[0], stars[1], value);
+    }
+  };
+  const int len = format(buf, sizeof(buf));
+  if (len < 0) {
+    return;
+  }
+  if ((size_t)len < sizeof(buf)) {
+    r_message.append(buf, (size_t)len);
+    return;
+  }
+  const size_t offset = r_message.size();
+  r_message.resize(offset + (size_t)len + 1);
+  format(r_message.data() + offset, (size_t)len + 1);
+  r_message.resize(offset + (size_t)len);
+}
+#pragma GCC diagnostic pop
+
+/**
+ * Format `format` like printf, taking the arguments from a packed argument buffer.
+ * Returns false when the arguments run out before the conversions do.
+ */
+inline bool clg_binary_format_message(std::string &r_message,
+                                      const char *format,
+                                      const uint8_t *arg_types,
+                                      uint32_t arg_count,
+                                      const char *args,
+                                      uint32_t args_len)
+{
+  const char *args_end = args + args_len;
+  uint32_t arg = 0;
+  auto read = [&](void *r_value, size_t size) {
+    if (size > (size_t)(args_end - args)) {
+      return false;
+    }
+    memcpy(r_value, args, size);
+    args += size;
+    return true;
+  };
+
+  const char *p = format;
+  while (*p) {
+    if (*p != '%') {
+      const char *next = strchr(p, '%');
+      const size_t len = next ? (size_t)(next - p) : strlen(p);
+      r_message.append(p, len);
+      p += len;
+      continue;
+    }
+    if (p[1] == '%') {
+      r_message += '%';
+      p += 2;
+      continue;
+    }
+
+    /* %[flags][width][.precision][length]conversion, '*' takes an int argument. */
+    const char *spec_start = p++;
+    int stars[2];
+    int star_count = 0;
+    auto scan_number = [&]() {
+      if (*p == '*') {
+        int32_t value = 0;
+        if (arg < arg_count && arg_types[arg] == CLG_ARG_INT32 && read(&value, sizeof(value))) {
+          arg++;
+        }
+        stars[star_count++] = value;
+        p++;
+      }
+      else {
+        p += strspn(p, "0123456789");
+      }
+    };
+    p += strspn(p, "-+ #0'");
+    scan_number();
+    if (*p == '.') {
+      p++;
+      scan_number();
+    }
+    p += strspn(p, "hljztL");
+    if (*p == '\0') {
+      r_message.append(spec_start);
+      break;
+    }
+    const char conversion = *p++;
+
+    char spec[32];
+    const size_t spec_len = (size_t)(p - spec_start);
+    if (spec_len >= sizeof(spec) || conversion == 'n') {
+      continue;
+    }
+    memcpy(spec, spec_start, spec_len);
+    spec[spec_len] = '\0';
+
+    if (arg >= arg_count) {
+      r_message.append(spec);
+      return false;
+    }
+    switch (arg_types[arg++]) {
+      case CLG_ARG_INT32: {
+        int32_t value;
+        if (!read(&value, sizeof(value))) {
+          return false;
+        }
+        clg_binary_append_arg(r_message, spec, stars, star_count, value);
+        break;
+      }
+      case CLG_ARG_UINT32: {
+        uint32_t value;
+        if (!read(&value, sizeof(value))) {
+          return false;
+        }
+        clg_binary_append_arg(r_message, spec, stars, star_count, value);
+        break;
+      }
+      case CLG_ARG_INT64: {
+        int64_t value;
+        if (!read(&value, sizeof(value))) {
+          return false;
+        }
+        clg_binary_append_arg(r_message, spec, stars, star_count, value);
+        break;
+      }
+      case CLG_ARG_UINT64: {
+        uint64_t value;
+        if (!read(&value, sizeof(value))) {
+          return false;
+        }
+        clg_binary_append_arg(r_message, spec, stars, star_count, value);
+        break;
+      }
+      case CLG_ARG_DOUBLE: {
+        double value;
+        if (!read(&value, sizeof(value))) {
+          return false;
+        }
+        clg_binary_append_arg(r_message, spec, stars, star_count, value);
+        break;
+      }
+      case CLG_ARG_POINTER: {
+        uint64_t value;
+        if (!read(&value, sizeof(value))) {
+          return false;
+        }
+        if (conversion == 's') {
+          /* Only the address was stored, the string may be gone. */
+          r_message.append("<?>");
+          break;
+        }
+        clg_binary_append_arg(r_message, spec, stars, star_count, (const void *)(uintptr_t)value);
+        break;
+      }
+      case CLG_ARG_STRING: {
+        uint32_t len;
+        if (!read(&len, sizeof(len))) {
+          return false;
+        }
+        if (len == CLG_ARG_STRING_NULL) {
+          clg_binary_append_arg(r_message, spec, stars, star_count, "(null)");
+          break;
+        }
+        if (len > (size_t)(args_end - args)) {
+          return false;
+        }
+        const std::string value(args, len);
+        args += len;
+        clg_binary_append_arg(r_message, spec, stars, star_count, value.c_str());
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return true;
+}
@@ -1,14 +1,17 @@
+#include <atomic>
 #include <cassert>
 #include <cstdio>
 #include <cstring>
-#include <pthread.h>
+#include <map>
 #include <set>
+#include <string>
 #include <sys/time.h>
 #include <unistd.h>
 
 #include "../gaurdalloc/MEM_gaurdalloc.h"
 #include "CLG_log.h"
 #include "MEM_gaurdalloc.h"
+#include "intern/CLG_async.hh"
 
 namespace clog {
 
@@ -28,11 +31,6 @@ static void clg_str_init(CLogStringBuf *cstr, char *buf_stack, uint buf_stack_le
   cstr->is_alloc = false;
 }
 
-static void *atomic_cas_ptr(void **vptr, void *oldv, void *newv)
-{
-  return __sync_val_compare_and_swap(vptr, oldv, newv);
-}
-
 static void clg_str_free(CLogStringBuf *cstr)
 {
   if (cstr->is_alloc) {
@@ -92,6 +90,59 @@ static enum eCLogColor clg_level_to_color(enum CLG_Level level)
   return COLOR_DEFAULT;
 }
 
+/* Parse a filter pattern: "name", "name.*" for a name and its children, "*part*" for names
+ * containing a part, "*" for all. Writes the text to compare to `r_match`, which has room for
+ * `len` characters and a terminator. */
+static void clg_type_match_compile(const char *type_match,
+                                   const uint len,
+                                   CLG_MatchKind *r_kind,
+                                   char *r_match,
+                                   uint *r_match_len)
+{
+  if (len == 1 && type_match[0] == '*') {
+    *r_kind = CLG_MATCH_ALL;
+    *r_match_len = 0;
+  }
+  else if (len >= 2 && type_match[0] == '*' && type_match[len - 1] == '*') {
+    *r_kind = CLG_MATCH_SUBSTRING;
+    *r_match_len = len - 2;
+    memcpy(r_match, type_match + 1, len - 2);
+  }
+  else if (len >= 2 && STREQLEN(".*", &type_match[len - 2], 2)) {
+    /* Keep the dot, children start with "name.". */
+    *r_kind = CLG_MATCH_CHILDREN;
+    *r_match_len = len - 1;
+    memcpy(r_match, type_match, len - 1);
+  }
+  else {
+    *r_kind = CLG_MATCH_PREFIX;
+    *r_match_len = len;
+    memcpy(r_match, type_match, len);
+  }
+  r_match[*r_match_len] = '\0';
+}
+
+/* Whether `identifier` matches a pattern parsed by clg_type_match_compile(). */
+static bool clg_type_match(const CLG_MatchKind kind,
+                           const char *match,
+                           const uint match_len,
+                           const char *identifier,
+                           const size_t identifier_len)
+{
+  switch (kind) {
+    case CLG_MATCH_ALL:
+      return true;
+    case CLG_MATCH_PREFIX:
+      return (match_len <= identifier_len) && STREQLEN(identifier, match, match_len);
+    case CLG_MATCH_SUBSTRING:
+      return strstr(identifier, match) != nullptr;
+    case CLG_MATCH_CHILDREN:
+      return ((identifier_len == match_len - 1) && STREQLEN(identifier, match, match_len - 1)) ||
+             ((identifier_len >= match_len) && STREQLEN(identifier, match, match_len));
+  }
+  return false;
+}
+
 static bool clg_ctx_filter_check(CLogContext *ctx, const char *identifier)
 {
   if (ctx->filters[0] == nullptr && ctx->filters[1] == nullptr &&
@@ -102,54 +153,184 @@ static bool clg_ctx_filter_check(CLogContext *ctx, const char *identifier)
 
   const size_t identifier_len = strlen(identifier);
   for (uint i = 0; i < 2; i++) {
-    const CLG_IDFilter *flt = ctx->filters[i];
-    while (flt != nullptr) {
-      const size_t len = strlen(flt->match);
-      if (STREQ(flt->match, "*") ||
-          ((len <= identifier_len) && (STREQLEN(identifier, flt->match, len))))
-      {
+    for (const CLG_IDFilter *flt = ctx->filters[i]; flt; flt = flt->next) {
+      if (clg_type_match(flt->kind, flt->match, flt->match_len, identifier, identifier_len)) {
         return (bool)i;
       }
-      if (flt->match[0] == '*' && flt->match[len - 1] == '*') {
-        char *match = static_cast<char *>(
-            mem::MEM_new_array_zeroed_aligned(len - 1, sizeof(char), alignof(char), __func__));
-        memcpy(match, flt->match + 1, len - 2);
-        const bool success = (strstr(identifier, match) != nullptr);
-        mem::MEM_delete(match);
-        if (success) {
-          return (bool)i;
-        }
-      }
-      else if ((len >= 2) && (STREQLEN(".*", &flt->match[len - 2], 2))) {
-        if (((identifier_len == len - 2) && STREQLEN(identifier, flt->match, len - 2)) ||
-            ((identifier_len >= len - 1) && STREQLEN(identifier, flt->match, len - 1)))
-        {
-          return (bool)i;
-        }
-      }
-      flt = flt->next;
     }
   }
   return false;
 }
 
-static CLG_LogType *clg_ctx_type_find_by_name(CLogContext *ctx, const char *identifier)
+/* FNV-1a of the part of `identifier` that fits in CLG_LogType.identifier. */
+static uint32_t clg_type_hash(const char *identifier)
 {
-  for (CLG_LogType *ty = ctx->types; ty; ty = ty->next) {
-    if (STREQ(identifier, ty->identifier)) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < sizeof(CLG_LogType::identifier) - 1 && identifier[i]; i++) {
+    hash = (hash ^ (uint8_t)identifier[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static CLG_LogType *clg_type_bucket_find(CLG_LogType *head,
+                                         const char *identifier,
+                                         const uint32_t hash)
+{
+  /* Types are complete before they are published and never change bucket. */
+  for (CLG_LogType *ty = head; ty; ty = ty->hash_next) {
+    if (ty->hash == hash && STREQLEN(identifier, ty->identifier, sizeof(ty->identifier) - 1)) {
       return ty;
     }
   }
   return nullptr;
 }
 
+static CLG_LogType *clg_ctx_type_find_by_name(CLogContext *ctx, const char *identifier)
+{
+  const uint32_t hash = clg_type_hash(identifier);
+  CLG_LogType **bucket = &ctx->type_buckets[hash & (CLOG_TYPE_BUCKETS - 1)];
+  return clg_type_bucket_find(__atomic_load_n(bucket, __ATOMIC_ACQUIRE), identifier, hash);
+}
+
+/* Suppressed counts of a throttled type are reported this often, on its next record. */
+#define CLOG_THROTTLE_SUMMARY_MS 10000
+
+struct CLG_LogThrottle {
+  /** Records per second, 0 for no limit. */
+  std::atomic<uint> rate_limit{0};
+  /** Log one record in this many, 0 or 1 logs all. */
+  std::atomic<uint> sample_every{0};
+
+  std::atomic<uint64_t> sample_counter{0};
+  /** Second of the current rate limit window and the records passed in it. */
+  std::atomic<uint64_t> window{0};
+  std::atomic<uint> window_count{0};
+
+  std::atomic<uint64_t> suppressed{0};
+  std::atomic<uint64_t> summary_tick{0};
+};
+
+/* Log how many records of `type` were suppressed since `since`, in milliseconds. */
+static void clg_throttle_report(const CLG_LogType *type, const uint64_t since, const uint64_t now)
+{
+  CLG_LogThrottle *throttle = __atomic_load_n(&type->throttle, __ATOMIC_ACQUIRE);
+  const uint64_t suppressed = throttle->suppressed.exchange(0, std::memory_order_relaxed);
+  if (suppressed == 0) {
+    return;
+  }
+  const uint rate_limit = throttle->rate_limit.load(std::memory_order_relaxed);
+  const uint sample_every = throttle->sample_every.load(std::memory_order_relaxed);
+
+  char limits[64] = "";
+  if (rate_limit && sample_every > 1) {
+    snprintf(limits, sizeof(limits), "limit %u/s, sampling 1 in %u", rate_limit, sample_every);
+  }
+  else if (rate_limit) {
+    snprintf(limits, sizeof(limits), "limit %u/s", rate_limit);
+  }
+  else {
+    snprintf(limits, sizeof(limits), "sampling 1 in %u", sample_every);
+  }
+  CLG_logf(type,
+           CLG_LEVEL_INFO,
+           __FILE__ ":" CLO_STRINGIFY(__LINE__),
+           __func__,
+           "%llu messages suppressed in the last %.1f s (%s)",
+           (unsigned long long)suppressed,
+           double(now - since) / 1000.0,
+           limits);
+}
+
+bool CLG_log_throttle_pass(const CLG_LogType *type, enum CLG_Level level)
+{
+  if (level <= CLG_LEVEL_ERROR) {
+    return true;
+  }
+  CLG_LogThrottle *throttle = __atomic_load_n(&type->throttle, __ATOMIC_ACQUIRE);
+  const uint64_t now = clg_timestamp_ticks_get();
+  bool pass = true;
+
+  const uint sample_every = throttle->sample_every.load(std::memory_order_relaxed);
+  if (sample_every > 1 &&
+      throttle->sample_counter.fetch_add(1, std::memory_order_relaxed) % sample_every != 0)
+  {
+    pass = false;
+  }
+
+  const uint rate_limit = throttle->rate_limit.load(std::memory_order_relaxed);
+  if (pass && rate_limit) {
+    const uint64_t second = now / 1000;
+    uint64_t window = throttle->window.load(std::memory_order_relaxed);
+    if (window != second &&
+        throttle->window.compare_exchange_strong(window, second, std::memory_order_relaxed))
+    {
+      throttle->window_count.store(0, std::memory_order_relaxed);
+    }
+    if (throttle->window_count.fetch_add(1, std::memory_order_relaxed) >= rate_limit) {
+      pass = false;
+    }
+  }
+
+  if (!pass) {
+    throttle->suppressed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t summary_tick = throttle->summary_tick.load(std::memory_order_relaxed);
+  if (now - summary_tick >= CLOG_THROTTLE_SUMMARY_MS &&
+      throttle->summary_tick.compare_exchange_strong(
+          summary_tick, now, std::memory_order_relaxed))
+  {
+    clg_throttle_report(type, summary_tick, now);
+  }
+  return pass;
+}
+
+/* Apply the newest rate limit and sampling rules matching `ty`. */
+static void clg_ctx_type_limits_apply(CLogContext *ctx, CLG_LogType *ty)
+{
+  const size_t identifier_len = strlen(ty->identifier);
+  bool has_rate_limit = false, has_sample = false;
+  uint rate_limit = 0, sample_every = 0;
+  for (const CLG_TypeLimit *limit = __atomic_load_n(&ctx->limits, __ATOMIC_ACQUIRE); limit;
+       limit = limit->next)
+  {
+    bool &found = limit->is_rate_limit ? has_rate_limit : has_sample;
+    if (found ||
+        !clg_type_match(
+            limit->kind, limit->match, limit->match_len, ty->identifier, identifier_len))
+    {
+      continue;
+    }
+    found = true;
+    (limit->is_rate_limit ? rate_limit : sample_every) = limit->value;
+  }
+
+  if (ty->throttle == nullptr) {
+    if (rate_limit == 0 && sample_every <= 1) {
+      return;
+    }
+    CLG_LogThrottle *throttle = mem::MEM_new<CLG_LogThrottle>(__func__);
+    throttle->summary_tick.store(clg_timestamp_ticks_get(), std::memory_order_relaxed);
+    throttle->rate_limit.store(rate_limit, std::memory_order_relaxed);
+    throttle->sample_every.store(sample_every, std::memory_order_relaxed);
+    /* Logging threads may already read the type, it is never unset while they run. */
+    __atomic_store_n(&ty->throttle, throttle, __ATOMIC_RELEASE);
+    return;
+  }
+  ty->throttle->rate_limit.store(rate_limit, std::memory_order_relaxed);
+  ty->throttle->sample_every.store(sample_every, std::memory_order_relaxed);
+}
+
+/**
+ * Add a type, or return the one another thread registered under the same name first. The
+ * type is set up completely before it becomes visible, so threads logging for the first time
+ * never wait on each other.
+ */
 static CLG_LogType *clg_ctx_type_register(CLogContext *ctx, const char *identifier)
 {
-  assert(clg_ctx_type_find_by_name(ctx, identifier) == nullptr);
   CLG_LogType *ty = mem::MEM_new_zeroed<CLG_LogType>(__func__);
-  ty->next = ctx->types;
-  ctx->types = ty;
   strncpy(ty->identifier, identifier, sizeof(ty->identifier) - 1);
+  ty->hash = clg_type_hash(identifier);
   ty->clg_ctx = ctx;
 
   if (clg_ctx_filter_check(ctx, ty->identifier)) {
@@ -158,19 +339,66 @@ static CLG_LogType *clg_ctx_type_register(CLogContext *ctx, const char *identifi
   else {
     ty->level = std::min(ctx->default_type.level, CLG_LEVEL_WARN);
   }
+  clg_ctx_type_limits_apply(ctx, ty);
+
+  CLG_LogType **bucket = &ctx->type_buckets[ty->hash & (CLOG_TYPE_BUCKETS - 1)];
+  CLG_LogType *head = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+  do {
+    if (CLG_LogType *existing = clg_type_bucket_find(head, ty->identifier, ty->hash)) {
+      mem::MEM_delete(ty->throttle);
+      mem::MEM_delete(ty);
+      return existing;
+    }
+    ty->hash_next = head;
+  } while (!__atomic_compare_exchange_n(
+      bucket, &head, ty, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
 
+  ty->next = __atomic_load_n(&ctx->types, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(
+      &ctx->types, &ty->next, ty, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+  {
+  }
   return ty;
 }
 
+/* Wait until queued records are written, callbacks write to the same outputs directly. */
+static void clg_ctx_flush(CLogContext *clg_ctx)
+{
+  if (clg_ctx->async) {
+    clg_async_flush(clg_ctx->async);
+  }
+}
+
+static void clg_ctx_output_write(CLogContext *clg_ctx,
+                                 const char *data,
+                                 const uint len,
+                                 enum CLG_Level level)
+{
+  if (clg_ctx->async) {
+    clg_async_push(clg_ctx->async, data, len, level);
+    return;
+  }
+
+  /* Mutex to avoid garbled output with threads and multi line output. */
+  std::scoped_lock lock(LOG_MUTEX);
+  int bytes_written = (int)write(clg_ctx->output, data, len);
+  if (clg_ctx->output_extra != -1) {
+    bytes_written = (int)write(clg_ctx->output_extra, data, len);
+  }
+  (void)bytes_written;
+}
+
 static void clg_ctx_error_action(CLogContext *clg_ctx)
 {
   if (clg_ctx->callbacks.error_fn != nullptr) {
+    clg_ctx_flush(clg_ctx);
     clg_ctx->callbacks.error_fn(clg_ctx->output_file);
   }
 }
 
 static void clg_ctx_fatal_action(CLogContext *clg_ctx)
 {
+  clg_ctx_flush(clg_ctx);
   if (clg_ctx->callbacks.fatal_fn != nullptr) {
     clg_ctx->callbacks.fatal_fn(clg_ctx->output_file);
   }
@@ -180,6 +408,7 @@ static void clg_ctx_fatal_action(CLogContext *clg_ctx)
 
 static void clg_ctx_backtrace(CLogContext *clg_ctx)
 {
+  clg_ctx_flush(clg_ctx);
   clg_ctx->callbacks.backtrace_fn(clg_ctx->output_file);
   fflush(clg_ctx->output_file);
 }
@@ -227,10 +456,10 @@ static void clg_str_append(CLogStringBuf *cstr, const char *str)
   clg_str_append_with_len(cstr, str, strlen(str));
 }
 
-static void write_timestamp(CLogStringBuf *cstr, const uint64_t timestamp_tick_start)
+/* `timestamp` is in milliseconds since #CLogContext.timestamp_tick_start. */
+static void write_timestamp(CLogStringBuf *cstr, const uint64_t timestamp)
 {
   char timestamp_str[128] = {0};
-  const uint64_t timestamp = clg_timestamp_ticks_get() - timestamp_tick_start;
   const int h = int(timestamp / (1000 * 60 * 60));
   const int m = int((timestamp / (1000 * 60)) % 60);
   const int s = int((timestamp / 1000) % 60);
@@ -256,9 +485,9 @@ static void clg_str_append_char(CLogStringBuf *cstr, const char c, const uint le
   cstr->len = len_next;
 }
 
-static void write_memory(CLogStringBuf *cstr)
+static void write_memory(CLogStringBuf *cstr, const uint64_t memory_in_use)
 {
-  const uint64_t mem_in_use = mem::MEM_get_memory_in_use() / (1024 * 1024);
+  const uint64_t mem_in_use = memory_in_use / (1024 * 1024);
   char memory_str[128];
   const uint len = snprintf(memory_str, sizeof(memory_str), "%dM", (int)mem_in_use);
 
@@ -382,10 +611,10 @@ void CLG_log_str(const CLG_LogType *type,
   clg_str_init(&cstr, cstr_stack_buf, sizeof(cstr_stack_buf));
 
   if (type->clg_ctx->use_timestamp) {
-    write_timestamp(&cstr, type->clg_ctx->timestamp_tick_start);
+    write_timestamp(&cstr, clg_timestamp_ticks_get() - type->clg_ctx->timestamp_tick_start);
   }
   if (type->clg_ctx->use_memory) {
-    write_memory(&cstr);
+    write_memory(&cstr, mem::MEM_get_memory_in_use());
   }
   write_type(&cstr, type);
 
@@ -407,14 +636,7 @@ void CLG_log_str(const CLG_LogType *type,
 
   clg_str_append(&cstr, "\n");
 
-  {
-    std::scoped_lock lock(LOG_MUTEX);
-    int bytes_written = (int)write(type->clg_ctx->output, cstr.data, cstr.len);
-    if (type->clg_ctx->output_extra != -1) {
-      bytes_written = (int)write(type->clg_ctx->output_extra, cstr.data, cstr.len);
-    }
-    (void)bytes_written;
-  }
+  clg_ctx_output_write(type->clg_ctx, cstr.data, cstr.len, level);
 
   clg_str_free(&cstr);
 
@@ -427,6 +649,116 @@ void CLG_log_str(const CLG_LogType *type,
   }
 }
 
+void CLG_log_deferred_push(const CLG_LogType *type, char *record, const uint len)
+{
+  CLogContext *ctx = type->clg_ctx;
+  CLG_DeferredRecord *header = reinterpret_cast<CLG_DeferredRecord *>(record);
+  header->tick = (ctx->use_timestamp || ctx->binary_output != -1) ? clg_timestamp_ticks_get() :
+                                                                    0;
+  header->memory_in_use = ctx->use_memory ? mem::MEM_get_memory_in_use() : 0;
+  clg_async_push_deferred(ctx->async, record, len, (CLG_Level)header->level);
+}
+
+struct CLogBinarySites {
+  /** Keyed by format and file:line, identical literals may be merged across call sites. */
+  std::map<std::pair<const void *, const void *>, uint32_t> index;
+};
+
+template<typename T> static void clg_binary_append(std::string &r_out, const T &value)
+{
+  r_out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void clg_deferred_render_binary(CLogContext *ctx,
+                                       const CLG_DeferredRecord *record,
+                                       const char *args,
+                                       const uint args_len,
+                                       std::string &r_out)
+{
+  CLogBinarySites *sites = ctx->binary_sites;
+  auto [item, is_new] = sites->index.try_emplace({record->format, record->file_line},
+                                                 (uint32_t)sites->index.size());
+  const uint32_t site = item->second;
+
+  if (is_new) {
+    CLG_BinarySiteRecord site_record = {};
+    site_record.site = site;
+    site_record.identifier_len = (uint16_t)strlen(record->type->identifier);
+    site_record.fn_len = (uint16_t)strlen(record->fn);
+    site_record.format_len = (uint32_t)strlen(record->format);
+    site_record.file_line_len = (uint32_t)strlen(record->file_line);
+    clg_binary_append(r_out, CLG_BINARY_RECORD_SITE);
+    clg_binary_append(r_out, site_record);
+    r_out.append(record->type->identifier, site_record.identifier_len);
+    r_out.append(record->fn, site_record.fn_len);
+    r_out.append(record->format, site_record.format_len);
+    r_out.append(record->file_line, site_record.file_line_len);
+  }
+
+  CLG_BinaryEventRecord event = {};
+  event.site = site;
+  event.level = record->level;
+  event.tick = record->tick;
+  event.memory_in_use = record->memory_in_use;
+  event.args_len = args_len;
+  event.arg_count = record->arg_count;
+  clg_binary_append(r_out, CLG_BINARY_RECORD_EVENT);
+  clg_binary_append(r_out, event);
+  r_out.append(reinterpret_cast<const char *>(record + 1), record->arg_count);
+  r_out.append(args, args_len);
+}
+
+bool clg_deferred_render(CLogContext *ctx, const char *data, const uint len, std::string &r_out)
+{
+  const CLG_DeferredRecord *record = reinterpret_cast<const CLG_DeferredRecord *>(data);
+  const uint8_t *arg_types = reinterpret_cast<const uint8_t *>(record + 1);
+  const char *args = reinterpret_cast<const char *>(arg_types + record->arg_count);
+  const uint args_len = len - (uint)(args - data);
+  const CLG_LogType *type = record->type;
+  const CLG_Level level = (CLG_Level)record->level;
+
+  r_out.clear();
+  if (ctx->binary_output != -1) {
+    clg_deferred_render_binary(ctx, record, args, args_len, r_out);
+    return true;
+  }
+
+  CLogStringBuf cstr = {nullptr};
+  char cstr_stack_buf[CLOG_BUF_LEN_INIT];
+  clg_str_init(&cstr, cstr_stack_buf, sizeof(cstr_stack_buf));
+
+  if (ctx->use_timestamp) {
+    write_timestamp(&cstr, record->tick - ctx->timestamp_tick_start);
+  }
+  if (ctx->use_memory) {
+    write_memory(&cstr, record->memory_in_use);
+  }
+  write_type(&cstr, type);
+
+  clg_str_append(&cstr, "| ");
+
+  const uint64_t multiline_indent_len = cstr.len;
+
+  write_level(&cstr, level, ctx->use_color);
+
+  clg_binary_format_message(
+      r_out, record->format, arg_types, record->arg_count, args, args_len);
+  clg_str_append_with_len(&cstr, r_out.data(), (uint)r_out.size());
+
+  if (ctx->use_source) {
+    clg_str_append(&cstr, "\n");
+    write_file_line_fn(&cstr, record->file_line, record->fn, ctx->use_basename, ctx->use_color);
+  }
+
+  clg_str_indent_multiline(&cstr, (uint)multiline_indent_len);
+
+  clg_str_append(&cstr, "\n");
+
+  r_out.assign(cstr.data, cstr.len);
+  clg_str_free(&cstr);
+  return false;
+}
+
 static void clg_str_vappendf(CLogStringBuf *cstr, const char *format, va_list args)
 {
   /* Use limit because windows may use '-1' for a formatting error. */
@@ -444,7 +776,7 @@ static void clg_str_vappendf(CLogStringBuf *cstr, const char *format, va_list ar
       break;
     }
 
-    if ((uint)retval <= len_avail) {
+    if ((uint)retval < len_avail) {
       /* Copy was successful. */
       cstr->len += (uint)retval;
       break;
@@ -452,7 +784,7 @@ static void clg_str_vappendf(CLogStringBuf *cstr, const char *format, va_list ar
 
     /* `vsnprintf` was not successful, due to lack of allocated space, `retval` contains expected
      * length of the formatted string, use it to allocate required amount of memory. */
-    uint len_alloc = cstr->len + (uint)retval;
+    uint len_alloc = cstr->len + (uint)retval + 1;
     if (len_alloc >= len_max) {
       /* Safe upper-limit, just in case... */
       break;
@@ -475,10 +807,10 @@ void CLG_logf(const CLG_LogType *type,
   clg_str_init(&cstr, cstr_stack_buf, sizeof(cstr_stack_buf));
 
   if (type->clg_ctx->use_timestamp) {
-    write_timestamp(&cstr, type->clg_ctx->timestamp_tick_start);
+    write_timestamp(&cstr, clg_timestamp_ticks_get() - type->clg_ctx->timestamp_tick_start);
   }
   if (type->clg_ctx->use_memory) {
-    write_memory(&cstr);
+    write_memory(&cstr, mem::MEM_get_memory_in_use());
   }
   write_type(&cstr, type);
 
@@ -506,15 +838,7 @@ void CLG_logf(const CLG_LogType *type,
   clg_str_append(&cstr, "\n");
 
   /* Output could be optional. */
-  {
-    /* Mutex to avoid garbled output with threads and multi line output. */
-    std::scoped_lock lock(LOG_MUTEX);
-    int bytes_written = (int)write(type->clg_ctx->output, cstr.data, cstr.len);
-    if (type->clg_ctx->output_extra != -1) {
-      bytes_written = (int)write(type->clg_ctx->output_extra, cstr.data, cstr.len);
-    }
-    (void)bytes_written;
-  }
+  clg_ctx_output_write(type->clg_ctx, cstr.data, cstr.len, level);
 
   clg_str_free(&cstr);
 
@@ -533,15 +857,12 @@ void CLG_logf(const CLG_LogType *type,
 
 void CLG_log_raw(const CLG_LogType *lg, const char *message)
 {
-  int bytes_written = (int)write(lg->clg_ctx->output, message, strlen(message));
-  if (lg->clg_ctx->output_extra != -1) {
-    bytes_written = (int)write(lg->clg_ctx->output_extra, message, strlen(message));
-  }
-  (void)bytes_written;
+  clg_ctx_output_write(lg->clg_ctx, message, (uint)strlen(message), CLG_LEVEL_INFO);
 }
 
 static void CLG_ctx_output_set(CLogContext *ctx, void *file_handle)
 {
+  clg_ctx_flush(ctx);
   ctx->output_file = static_cast<FILE *>(file_handle);
   ctx->output = fileno(ctx->output_file);
   ctx->use_color = isatty(ctx->output);
@@ -549,6 +870,7 @@ static void CLG_ctx_output_set(CLogContext *ctx, void *file_handle)
 
 static void CLG_ctx_output_extra_set(CLogContext *ctx, void *file_handle)
 {
+  clg_ctx_flush(ctx);
   ctx->output_file_extra = static_cast<FILE *>(file_handle);
   if (ctx->output_file_extra) {
     ctx->output_extra = fileno(ctx->output_file_extra);
@@ -581,6 +903,79 @@ static void CLG_ctx_output_use_memory_set(CLogContext *ctx, int value)
   ctx->use_memory = (bool)value;
 }
 
+static void clg_atexit_flush()
+{
+  if (g_ctx) {
+    clg_ctx_flush(g_ctx);
+  }
+}
+
+static void CLG_ctx_output_async_set(CLogContext *ctx, int value)
+{
+  if (value && !ctx->async) {
+    /* Records still queued when the process exits without CLG_exit() are written. */
+    static bool atexit_registered = false;
+    if (!atexit_registered) {
+      atexit(clg_atexit_flush);
+      atexit_registered = true;
+    }
+    ctx->async = clg_async_start(ctx);
+  }
+  else if (!value && ctx->async) {
+    /* Deferred records need the writer. */
+    ctx->use_deferred = false;
+    clg_async_stop(ctx->async);
+    ctx->async = nullptr;
+  }
+}
+
+static void CLG_ctx_output_deferred_set(CLogContext *ctx, int value)
+{
+  if (value) {
+    CLG_ctx_output_async_set(ctx, 1);
+  }
+  ctx->use_deferred = (bool)value;
+}
+
+static void clg_ctx_binary_output_close(CLogContext *ctx)
+{
+  if (ctx->binary_output_file) {
+    fclose(ctx->binary_output_file);
+    ctx->binary_output_file = nullptr;
+  }
+  ctx->binary_output = -1;
+  mem::MEM_delete(ctx->binary_sites);
+  ctx->binary_sites = nullptr;
+}
+
+static bool CLG_ctx_output_binary_set(CLogContext *ctx, const char *filepath)
+{
+  clg_ctx_flush(ctx);
+  clg_ctx_binary_output_close(ctx);
+  if (filepath == nullptr) {
+    return true;
+  }
+
+  FILE *file = fopen(filepath, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  CLG_BinaryFileHeader header = {};
+  memcpy(header.magic, CLG_BINARY_MAGIC, sizeof(header.magic));
+  header.version = CLG_BINARY_VERSION;
+  header.tick_start = ctx->use_timestamp ? ctx->timestamp_tick_start : clg_timestamp_ticks_get();
+  if (fwrite(&header, sizeof(header), 1, file) != 1 || fflush(file) != 0) {
+    fclose(file);
+    return false;
+  }
+
+  ctx->binary_sites = mem::MEM_new<CLogBinarySites>(__func__);
+  ctx->binary_output_file = file;
+  ctx->binary_output = fileno(file);
+  CLG_ctx_output_deferred_set(ctx, 1);
+  return true;
+}
+
 static void CLT_ctx_error_fn_set(CLogContext *ctx, void (*error_fn)(void *file_handle))
 {
   ctx->callbacks.error_fn = error_fn;
@@ -599,25 +994,42 @@ static void CLG_ctx_backtrace_fn_set(CLogContext *ctx, void (*backtrace_fn)(void
 static CLogContext *CLG_ctx_init()
 {
   CLogContext *ctx = mem::MEM_new_zeroed<CLogContext>(__func__);
-  pthread_mutex_init(&ctx->types_lock, nullptr);
   ctx->default_type.level = CLG_LEVEL_WARN;
   ctx->use_source = true;
   ctx->output_extra = -1;
   ctx->output_file_extra = nullptr;
+  ctx->async_overflow = CLG_ASYNC_OVERFLOW_BLOCK;
+  ctx->binary_output = -1;
   CLG_ctx_output_set(ctx, stdout);
   return ctx;
 }
 
 static void CLG_ctx_free(CLogContext *ctx)
 {
+  const uint64_t now = clg_timestamp_ticks_get();
+  for (CLG_LogType *ty = ctx->types; ty; ty = ty->next) {
+    if (ty->throttle) {
+      clg_throttle_report(ty, ty->throttle->summary_tick.load(std::memory_order_relaxed), now);
+    }
+  }
+
+  CLG_ctx_output_async_set(ctx, 0);
+  clg_ctx_binary_output_close(ctx);
+
   while (ctx->types != nullptr) {
     CLG_LogType *item = ctx->types;
     ctx->types = item->next;
+    mem::MEM_delete(item->throttle);
+    mem::MEM_delete(item);
+  }
+  while (ctx->limits != nullptr) {
+    CLG_TypeLimit *item = ctx->limits;
+    ctx->limits = item->next;
     mem::MEM_delete(item);
   }
 
   for (CLG_LogRef *ref = *clg_all_refs_p(); ref; ref = ref->next) {
-    ref->type = nullptr;
+    ref->type.store(nullptr, std::memory_order_relaxed);
   }
 
   for (uint i = 0; i < 2; i++) {
@@ -632,7 +1044,6 @@ static void CLG_ctx_free(CLogContext *ctx)
   {
     fclose(ctx->output_file_extra);
   }
-  pthread_mutex_destroy(&ctx->types_lock);
   mem::MEM_delete(ctx);
 }
 
@@ -646,6 +1057,7 @@ void CLG_init()
 void CLG_exit()
 {
   CLG_ctx_free(g_ctx);
+  g_ctx = nullptr;
 }
 
 void CLG_output_set(void *file_handle)
@@ -678,6 +1090,44 @@ void CLG_output_use_memory_set(int value)
   CLG_ctx_output_use_memory_set(g_ctx, value);
 }
 
+/**
+ * Move writing to a dedicated thread. Set up outputs first and enable it before other threads
+ * log, the switch itself is not synchronized with logging threads.
+ */
+void CLG_output_async_set(int value)
+{
+  CLG_ctx_output_async_set(g_ctx, value);
+}
+
+void CLG_output_async_overflow_set(CLG_AsyncOverflow overflow)
+{
+  g_ctx->async_overflow = overflow;
+}
+
+/**
+ * Store raw arguments at call sites and format on the writer thread, enables asynchronous
+ * output. Like CLG_output_async_set(), call before other threads log.
+ */
+void CLG_output_deferred_set(int value)
+{
+  CLG_ctx_output_deferred_set(g_ctx, value);
+}
+
+/**
+ * Write deferred records unformatted to `filepath` instead of the outputs, for the
+ * clog_decode tool, or stop with null. Enables deferred output.
+ */
+bool CLG_output_binary_set(const char *filepath)
+{
+  return CLG_ctx_output_binary_set(g_ctx, filepath);
+}
+
+/** Return once every record logged so far has been written. */
+void CLG_flush()
+{
+  clg_ctx_flush(g_ctx);
+}
+
 void CLG_error_fn_set(void (*error_fn)(void *file_handle))
 {
   CLT_ctx_error_fn_set(g_ctx, error_fn);
@@ -693,6 +1143,87 @@ void CLG_backtrace_fn_set(void (*fatal_fn)(void *file_handle))
   CLG_ctx_backtrace_fn_set(g_ctx, fatal_fn);
 }
 
+static void clg_ctx_type_filter_append(CLG_IDFilter **flt_list,
+                                       const char *type_match,
+                                       int type_match_len)
+{
+  if (type_match_len == 0) {
+    return;
+  }
+  CLG_IDFilter *flt = static_cast<CLG_IDFilter *>(mem::MEM_new_array_zeroed_aligned(
+      1, sizeof(*flt) + type_match_len + 1, alignof(CLG_IDFilter), __func__));
+  flt->next = *flt_list;
+  *flt_list = flt;
+  clg_type_match_compile(type_match, type_match_len, &flt->kind, flt->match, &flt->match_len);
+}
+
+static void CLG_ctx_type_filter_exclude(CLogContext *ctx,
+                                        const char *type_match,
+                                        int type_match_len)
+{
+  clg_ctx_type_filter_append(&ctx->filters[0], type_match, type_match_len);
+}
+
+static void CLG_ctx_type_filter_include(CLogContext *ctx,
+                                        const char *type_match,
+                                        int type_match_len)
+{
+  clg_ctx_type_filter_append(&ctx->filters[1], type_match, type_match_len);
+  if (ctx->default_type.level <= CLG_LEVEL_WARN) {
+    ctx->default_type.level = CLG_LEVEL_INFO;
+  }
+}
+
+static void clg_ctx_type_limit_append(CLogContext *ctx,
+                                      const char *type_match,
+                                      int type_match_len,
+                                      bool is_rate_limit,
+                                      uint value)
+{
+  if (type_match_len == 0) {
+    return;
+  }
+  CLG_TypeLimit *limit = static_cast<CLG_TypeLimit *>(mem::MEM_new_array_zeroed_aligned(
+      1, sizeof(*limit) + type_match_len + 1, alignof(CLG_TypeLimit), __func__));
+  limit->next = ctx->limits;
+  limit->is_rate_limit = is_rate_limit;
+  limit->value = value;
+  clg_type_match_compile(
+      type_match, type_match_len, &limit->kind, limit->match, &limit->match_len);
+  /* Types registered by other threads meanwhile may miss the rule, set rules before logging
+   * starts, as CLG_init() does. */
+  __atomic_store_n(&ctx->limits, limit, __ATOMIC_RELEASE);
+
+  for (CLG_LogType *ty = __atomic_load_n(&ctx->types, __ATOMIC_ACQUIRE); ty; ty = ty->next) {
+    clg_ctx_type_limits_apply(ctx, ty);
+  }
+}
+
+void CLG_type_filter_exclude(const char *type_match, int type_match_len)
+{
+  CLG_ctx_type_filter_exclude(g_ctx, type_match, type_match_len);
+}
+
+void CLG_type_filter_include(const char *type_match, int type_match_len)
+{
+  CLG_ctx_type_filter_include(g_ctx, type_match, type_match_len);
+}
+
+/**
+ * Log at most `per_second` records per second of the matching types, 0 removes the limit.
+ * Matches like CLG_type_filter_include(), errors are never suppressed.
+ */
+void CLG_type_rate_limit_set(const char *type_match, int type_match_len, uint per_second)
+{
+  clg_ctx_type_limit_append(g_ctx, type_match, type_match_len, true, per_second);
+}
+
+/** Log one in `every_n` records of the matching types, 0 or 1 logs all. */
+void CLG_type_sample_set(const char *type_match, int type_match_len, uint every_n)
+{
+  clg_ctx_type_limit_append(g_ctx, type_match, type_match_len, false, every_n);
+}
+
 static void CLG_ctx_level_set(CLogContext *ctx, CLG_Level level)
 {
   ctx->default_type.level = level;
@@ -706,6 +1237,11 @@ void CLG_level_set(CLG_Level level)
   CLG_ctx_level_set(g_ctx, level);
 }
 
+CLG_Level CLG_level_get()
+{
+  return g_ctx->default_type.level;
+}
+
 void CLG_quiet_set(bool quiet)
 {
   g_quiet = quiet;
@@ -739,30 +1275,24 @@ void CLG_logref_list_all(void (*callback)(const char *identifier, void *user_dat
   }
 }
 
-void CLG_logref_init(CLG_LogRef *clg_ref)
+CLG_LogType *CLG_logref_init(CLG_LogRef *clg_ref)
 {
   if (g_ctx == nullptr) {
     fprintf(stderr, "CLG logging used without initialization, aborting.\n");
     abort();
   }
 
-  pthread_mutex_lock(&g_ctx->types_lock);
-  if (clg_ref->type == nullptr) {
-    CLG_LogType *clg_ty = clg_ctx_type_find_by_name(g_ctx, clg_ref->identifier);
-    if (clg_ty == nullptr) {
-      clg_ty = clg_ctx_type_register(g_ctx, clg_ref->identifier);
-    }
-    atomic_cas_ptr((void **)&clg_ref->type, clg_ref->type, clg_ty);
-    clg_ref->type = clg_ty;
+  /* Threads racing here all find or register the same type, storing it twice is harmless. */
+  CLG_LogType *clg_ty = clg_ctx_type_find_by_name(g_ctx, clg_ref->identifier);
+  if (clg_ty == nullptr) {
+    clg_ty = clg_ctx_type_register(g_ctx, clg_ref->identifier);
   }
-  pthread_mutex_unlock(&g_ctx->types_lock);
+  clg_ref->type.store(clg_ty, std::memory_order_release);
+  return clg_ty;
 }
 
 int CLG_color_support_get(CLG_LogRef *clg_ref)
 {
-  if (clg_ref->type == nullptr) {
-    CLG_logref_init(clg_ref);
-  }
-  return clg_ref->type->clg_ctx->use_color;
+  return CLG_logref_type(clg_ref)->clg_ctx->use_color;
 }
 }  // namespace clog
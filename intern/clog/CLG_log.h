@@ -1,12 +1,21 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <mutex>
-#include <pthread.h>
 #include <sys/types.h>
+#include <type_traits>
+
+#include "CLG_binary_format.h"
 
 #define CLOG_BUF_LEN_INIT 512
+/* Deferred records are packed on the stack, calls with longer arguments are formatted
+ * right away. */
+#define CLOG_DEFERRED_BUF_LEN 512
+/* Buckets of the type registry, a power of two. */
+#define CLOG_TYPE_BUCKETS 256
 
 #define STREQ(a, b) (strcmp(a, b) == 0)
 #define STREQLEN(a, b, n) (strncmp(a, b, n) == 0)
@@ -39,27 +48,67 @@ enum CLG_Level {
   CLG_LEVEL_TRACE,
 };
 
+/** What a full asynchronous queue does with a new record, errors and fatal errors always wait. */
+enum CLG_AsyncOverflow {
+  /* Drop the record, the writer reports how many were dropped. */
+  CLG_ASYNC_OVERFLOW_DROP = 0,
+  /* Wait for the writer to make room. */
+  CLG_ASYNC_OVERFLOW_BLOCK,
+};
+
 struct CLG_LogType {
   struct CLG_LogType *next;
+  /** Next type in the same registry bucket. */
+  struct CLG_LogType *hash_next;
+  uint32_t hash;
   char identifier[64];
   /** FILE output. */
   struct CLogContext *clg_ctx;
   /** Control behavior. */
   CLG_Level level;
+  /** Rate limit and sampling state, null when the type logs everything. */
+  struct CLG_LogThrottle *throttle;
 };
 
 struct CLG_LogRef {
   explicit CLG_LogRef(const char *identifier);
   const char *identifier;
-  CLG_LogType *type;
+  /** Set once on first use, read without locking by every logging thread. */
+  std::atomic<CLG_LogType *> type;
   struct CLG_LogRef *next;
 };
 
 static std::mutex LOG_MUTEX;
 
+/** How a type filter pattern is matched, parsed once when the filter is added. */
+enum CLG_MatchKind : uint8_t {
+  /* "*", all types. */
+  CLG_MATCH_ALL,
+  /* "name", types starting with the name. */
+  CLG_MATCH_PREFIX,
+  /* "*part*", types containing the part. */
+  CLG_MATCH_SUBSTRING,
+  /* "name.*", the name and its children. */
+  CLG_MATCH_CHILDREN,
+};
+
 struct CLG_IDFilter {
   struct CLG_IDFilter *next;
-  /** Over alloc. */
+  CLG_MatchKind kind;
+  uint match_len;
+  /** Over alloc, the pattern without its wildcards. */
+  char match[0];
+};
+
+/** Throttling of the types matching `match`, the most recently set rule wins. */
+struct CLG_TypeLimit {
+  struct CLG_TypeLimit *next;
+  /** Records per second when true, else log one record in `value`. */
+  bool is_rate_limit;
+  uint value;
+  CLG_MatchKind kind;
+  uint match_len;
+  /** Over alloc, the pattern without its wildcards. */
   char match[0];
 };
 
@@ -83,13 +132,17 @@ enum eCLogColor {
 static const char *clg_color_table[COLOR_LEN] = {nullptr};
 
 struct CLogContext {
-  /** Single linked list of types. */
+  /**
+   * Single linked list of types, also hashed by identifier into `type_buckets`. Types are
+   * only ever added, with a compare and swap, so lookups never lock.
+   */
   CLG_LogType *types;
-
-  pthread_mutex_t types_lock;
+  CLG_LogType *type_buckets[CLOG_TYPE_BUCKETS];
 
   /* exclude, include filters. */
   CLG_IDFilter *filters[2];
+  /** Rate limit and sampling rules, newest first. */
+  CLG_TypeLimit *limits;
   bool use_color;
   bool use_source;
   bool use_basename;
@@ -104,6 +157,17 @@ struct CLogContext {
   int output_extra;
   FILE *output_file_extra;
 
+  /** Writer thread, when set records are queued instead of written by the caller. */
+  struct CLogAsync *async;
+  CLG_AsyncOverflow async_overflow;
+  /** Call sites queue raw arguments, formatting happens on the writer thread. */
+  bool use_deferred;
+  /** Deferred records go to this file unformatted instead of the outputs, -1 when unused. */
+  int binary_output;
+  FILE *binary_output_file;
+  /** Call sites already written to the binary output, owned by the writer thread. */
+  struct CLogBinarySites *binary_sites;
+
   /** For timer (use_timestamp). */
   uint64_t timestamp_tick_start;
 
@@ -119,6 +183,22 @@ struct CLogContext {
   } callbacks;
 };
 
+/**
+ * What a deferred call site queues, followed by `arg_count` #CLG_ArgType and the packed
+ * arguments, see CLG_binary_format.h. All strings have static storage.
+ */
+struct CLG_DeferredRecord {
+  const char *format;
+  const char *file_line;
+  const char *fn;
+  const CLG_LogType *type;
+  /** Filled in by CLG_log_deferred_push(). */
+  uint64_t tick;
+  uint64_t memory_in_use;
+  uint32_t level;
+  uint32_t arg_count;
+};
+
 static struct CLogContext *g_ctx = nullptr;
 static bool g_quiet = false;
 
@@ -139,6 +219,8 @@ void CLG_logf(const CLG_LogType *type,
 
 void CLG_log_raw(const CLG_LogType *lg, const char *message);
 
+void CLG_log_deferred_push(const CLG_LogType *type, char *record, uint len);
+
 void CLG_init();
 void CLG_exit();
 
@@ -148,17 +230,26 @@ void CLG_output_use_source_set(int value);
 void CLG_output_use_basename_set(int value);
 void CLG_output_use_timestamp_set(int value);
 void CLG_output_use_memory_set(int value);
+void CLG_output_async_set(int value);
+void CLG_output_async_overflow_set(CLG_AsyncOverflow overflow);
+void CLG_output_deferred_set(int value);
+bool CLG_output_binary_set(const char *filepath);
+void CLG_flush();
 void CLG_error_fn_set(void (*error_fn)(void *file_handle));
 void CLG_fatal_fn_set(void (*fatal_fn)(void *file_handle));
 void CLG_backtrace_fn_set(void (*fatal_fn)(void *file_handle));
 void CLG_type_filter_exclude(const char *type_match, int type_match_len);
 void CLG_type_filter_include(const char *type_match, int type_match_len);
+void CLG_type_rate_limit_set(const char *type_match, int type_match_len, uint per_second);
+void CLG_type_sample_set(const char *type_match, int type_match_len, uint every_n);
+bool CLG_log_throttle_pass(const CLG_LogType *type, enum CLG_Level level);
 void CLG_level_set(CLG_Level level);
+CLG_Level CLG_level_get();
 
 void CLG_quiet_set(bool quiet);
 bool CLG_quiet_get();
 
-void CLG_logref_init(CLG_LogRef *clg_ref);
+CLG_LogType *CLG_logref_init(CLG_LogRef *clg_ref);
 void CLG_logref_register(CLG_LogRef *clg_ref);
 void CLG_logref_list_all(void (*callback)(const char *identifier, void *user_data),
                          void *user_data);
@@ -182,12 +273,12 @@ static uint64_t clg_timestamp_ticks_get();
 
 static void clg_str_reserve(CLogStringBuf *cstr, uint len);
 static void clg_str_append_with_len(CLogStringBuf *cstr, const char *str, uint len);
-static void write_timestamp(CLogStringBuf *cstr, uint64_t timestamp_tick_start);
+static void write_timestamp(CLogStringBuf *cstr, uint64_t timestamp);
 
 static void clg_str_append(CLogStringBuf *cstr, const char *str);
 
 static void clg_str_append_char(CLogStringBuf *cstr, char c, uint len);
-static void write_memory(CLogStringBuf *cstr);
+static void write_memory(CLogStringBuf *cstr, uint64_t memory_in_use);
 
 static void write_level(CLogStringBuf *cstr, enum CLG_Level level, bool use_color);
 static void write_type(CLogStringBuf *cstr, const CLG_LogType *lg);
@@ -205,18 +296,188 @@ static void CLG_ctx_output_use_source_set(CLogContext *ctx, int value);
 static void CLG_ctx_output_use_basename_set(CLogContext *ctx, int value);
 static void CLG_ctx_output_use_timestamp_set(CLogContext *ctx, int value);
 static void CLG_ctx_output_use_memory_set(CLogContext *ctx, int value);
+static void CLG_ctx_output_async_set(CLogContext *ctx, int value);
+static void CLG_ctx_type_filter_exclude(CLogContext *ctx,
+                                        const char *type_match,
+                                        int type_match_len);
+static void CLG_ctx_type_filter_include(CLogContext *ctx,
+                                        const char *type_match,
+                                        int type_match_len);
+static void CLG_ctx_output_deferred_set(CLogContext *ctx, int value);
+static bool CLG_ctx_output_binary_set(CLogContext *ctx, const char *filepath);
 static void CLT_ctx_error_fn_set(CLogContext *ctx, void (*error_fn)(void *file_handle));
 static void CLG_ctx_fatal_fn_set(CLogContext *ctx, void (*fatal_fn)(void *file_handle));
 static void CLG_ctx_backtrace_fn_set(CLogContext *ctx, void (*backtrace_fn)(void *file_handle));
 
 static CLogContext *CLG_ctx_init();
 
+/** Argument type tag of a CLOG_* argument, after the default argument promotions. */
+template<typename T> constexpr CLG_ArgType clg_arg_type()
+{
+  using U = std::decay_t<T>;
+  if constexpr (std::is_same_v<U, char *> || std::is_same_v<U, const char *> ||
+                std::is_same_v<U, unsigned char *> || std::is_same_v<U, const unsigned char *>)
+  {
+    return CLG_ARG_STRING;
+  }
+  else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>) {
+    return CLG_ARG_POINTER;
+  }
+  else if constexpr (std::is_same_v<U, float> || std::is_same_v<U, double>) {
+    return CLG_ARG_DOUBLE;
+  }
+  else if constexpr (std::is_enum_v<U>) {
+    return clg_arg_type<std::underlying_type_t<U>>();
+  }
+  else if constexpr (std::is_integral_v<U>) {
+    if constexpr (sizeof(U) < sizeof(int) || (sizeof(U) == 4 && std::is_signed_v<U>)) {
+      return CLG_ARG_INT32;
+    }
+    else if constexpr (sizeof(U) == 4) {
+      return CLG_ARG_UINT32;
+    }
+    else {
+      return std::is_signed_v<U> ? CLG_ARG_INT64 : CLG_ARG_UINT64;
+    }
+  }
+  else {
+    static_assert(sizeof(U) == 0, "Type cannot be passed to a CLOG format");
+  }
+}
+
+/**
+ * Append `value` to a packed argument buffer. A string with a `precision` of 0 or more is read
+ * up to that many bytes, like printf does for `%.*s`, it does not need to be null terminated.
+ */
+template<typename T>
+inline bool clg_arg_pack(char *&r_ptr, const char *end, T value, int32_t precision = -1)
+{
+  constexpr CLG_ArgType type = clg_arg_type<T>();
+  auto write = [&](const void *data, size_t size) {
+    if (size > (size_t)(end - r_ptr)) {
+      return false;
+    }
+    memcpy(r_ptr, data, size);
+    r_ptr += size;
+    return true;
+  };
+
+  if constexpr (type == CLG_ARG_STRING) {
+    const char *str = (const char *)value;
+    if (str == nullptr) {
+      const uint32_t len = CLG_ARG_STRING_NULL;
+      return write(&len, sizeof(len));
+    }
+    const uint32_t len = (uint32_t)(precision >= 0 ? strnlen(str, (size_t)precision) :
+                                                     strlen(str));
+    return write(&len, sizeof(len)) && write(str, len);
+  }
+  else if constexpr (type == CLG_ARG_POINTER) {
+    const uint64_t stored = (uint64_t)(uintptr_t)value;
+    return write(&stored, sizeof(stored));
+  }
+  else if constexpr (type == CLG_ARG_DOUBLE) {
+    const double stored = value;
+    return write(&stored, sizeof(stored));
+  }
+  else if constexpr (type == CLG_ARG_INT32) {
+    const int32_t stored = (int32_t)value;
+    return write(&stored, sizeof(stored));
+  }
+  else if constexpr (type == CLG_ARG_UINT32) {
+    const uint32_t stored = (uint32_t)value;
+    return write(&stored, sizeof(stored));
+  }
+  else if constexpr (type == CLG_ARG_INT64) {
+    const int64_t stored = (int64_t)value;
+    return write(&stored, sizeof(stored));
+  }
+  else {
+    const uint64_t stored = (uint64_t)value;
+    return write(&stored, sizeof(stored));
+  }
+}
+
+/**
+ * Queue a record without formatting it. Errors, fatal errors and calls that need a backtrace
+ * keep their immediate side effects and are formatted right away.
+ */
+template<typename... Args>
+inline void CLG_log_deferred(const CLG_LogType *type,
+                             enum CLG_Level level,
+                             const char *file_line,
+                             const char *fn,
+                             const char *format,
+                             Args... args)
+{
+  if (level <= CLG_LEVEL_ERROR || type->clg_ctx->callbacks.backtrace_fn) {
+    CLG_logf(type, level, file_line, fn, format, args...);
+    return;
+  }
+
+  static constexpr uint8_t arg_types[] = {uint8_t(clg_arg_type<Args>())..., 0};
+  constexpr uint32_t arg_count = sizeof...(Args);
+  /* A `%.*s` needs an int right before a string, only then is the format worth a look. */
+  constexpr bool may_have_precision_strings = []() {
+    for (uint32_t i = 1; i < arg_count; i++) {
+      if (arg_types[i - 1] == CLG_ARG_INT32 && arg_types[i] == CLG_ARG_STRING) {
+        return true;
+      }
+    }
+    return false;
+  }();
+
+  alignas(CLG_DeferredRecord) char buf[CLOG_DEFERRED_BUF_LEN];
+  CLG_DeferredRecord *record = reinterpret_cast<CLG_DeferredRecord *>(buf);
+  record->format = format;
+  record->file_line = file_line;
+  record->fn = fn;
+  record->type = type;
+  record->level = (uint32_t)level;
+  record->arg_count = arg_count;
+
+  char *ptr = buf + sizeof(CLG_DeferredRecord);
+  /* Most calls pass no arguments, skip the packing so its state is not left unused. */
+  if constexpr (arg_count > 0) {
+    memcpy(ptr, arg_types, arg_count);
+    ptr += arg_count;
+    const uint64_t precision_strings = may_have_precision_strings ?
+                                           clg_format_precision_strings(format) :
+                                           0;
+    uint32_t arg = 0;
+    int32_t last_int = -1;
+    auto pack = [&](auto value) {
+      const bool bounded = arg < 64 && ((precision_strings >> arg) & 1);
+      arg++;
+      const bool fits = clg_arg_pack(ptr, buf + sizeof(buf), value, bounded ? last_int : -1);
+      if constexpr (clg_arg_type<decltype(value)>() == CLG_ARG_INT32) {
+        last_int = (int32_t)value;
+      }
+      return fits;
+    };
+    bool fits = true;
+    ((fits = fits && pack(args)), ...);
+    if (!fits) {
+      CLG_logf(type, level, file_line, fn, format, args...);
+      return;
+    }
+  }
+  CLG_log_deferred_push(type, buf, (uint)(ptr - buf));
+}
+
 inline CLG_LogRef::CLG_LogRef(const char *identifier)
     : identifier(identifier), type(nullptr), next(nullptr)
 {
   clog::CLG_logref_register(this);
 }
 
+/** The type of `clg_ref`, looked up or registered on first use. */
+inline CLG_LogType *CLG_logref_type(CLG_LogRef *clg_ref)
+{
+  CLG_LogType *type = clg_ref->type.load(std::memory_order_acquire);
+  return __builtin_expect(type != nullptr, 1) ? type : CLG_logref_init(clg_ref);
+}
+
 }  // namespace clog
 
 #define CLO_STRINGIFY_ARG(x) #x
@@ -228,25 +489,42 @@ inline CLG_LogRef::CLG_LogRef(const char *identifier)
 
 #define CLG_LOGREF_DECLARE_EXTERN(var) extern clog::CLG_LogRef(*(var))
 
-#define CLOG_ENSURE(clg_ref) \
-  (((clg_ref))->type ? ((clg_ref))->type : (clog::CLG_logref_init(clg_ref), ((clg_ref))->type))
+#define CLOG_ENSURE(clg_ref) clog::CLG_logref_type(clg_ref)
+
+/* Level check first, throttled types also count and suppress records. */
+#define CLOG_PASS(lg_ty, verbose_level) \
+  ((lg_ty)->level >= (verbose_level) && \
+   (__atomic_load_n(&(lg_ty)->throttle, __ATOMIC_ACQUIRE) == nullptr || \
+    clog::CLG_log_throttle_pass((lg_ty), (verbose_level))))
 
-#define CLOG_CHECK(clg_ref, verbose_level, ...) \
-  ((void)CLOG_ENSURE(clg_ref), (((clg_ref))->type->level >= (verbose_level)))
+#define CLOG_CHECK(clg_ref, verbose_level, ...) (CLOG_ENSURE(clg_ref)->level >= (verbose_level))
 
+/* The format must be a string literal, deferred records only keep its address. */
 #define CLOG_AT_LEVEL(clg_ref, verbose_level, ...) \
   do { \
     const clog::CLG_LogType *_lg_ty = CLOG_ENSURE(clg_ref); \
-    if (_lg_ty->level >= (verbose_level)) { \
-      clog::CLG_logf( \
-          _lg_ty, (verbose_level), __FILE__ ":" CLO_STRINGIFY(__LINE__), __func__, __VA_ARGS__); \
+    if (CLOG_PASS(_lg_ty, verbose_level)) { \
+      if (_lg_ty->clg_ctx->use_deferred) { \
+        clog::CLG_log_deferred(_lg_ty, \
+                               (verbose_level), \
+                               __FILE__ ":" CLO_STRINGIFY(__LINE__), \
+                               __func__, \
+                               "" __VA_ARGS__); \
+      } \
+      else { \
+        clog::CLG_logf(_lg_ty, \
+                       (verbose_level), \
+                       __FILE__ ":" CLO_STRINGIFY(__LINE__), \
+                       __func__, \
+                       __VA_ARGS__); \
+      } \
     } \
   } while (0)
 
 #define CLOG_STR_AT_LEVEL(clg_ref, verbose_level, str) \
   do { \
     const clog::CLG_LogType *_lg_ty = CLOG_ENSURE(clg_ref); \
-    if (_lg_ty->level >= (verbose_level)) { \
+    if (CLOG_PASS(_lg_ty, verbose_level)) { \
       clog::CLG_log_str( \
           _lg_ty, (verbose_level), __FILE__ ":" CLO_STRINGIFY(__LINE__), __func__, (str)); \
     } \
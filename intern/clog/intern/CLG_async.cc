@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../../gaurdalloc/MEM_gaurdalloc.h"
+#include "CLG_async.hh"
+
+/* Ring size in records, must be a power of two. */
+#define CLOG_ASYNC_SLOTS 2048
+/* Bytes per ring slot, longer records are copied to the heap. */
+#define CLOG_ASYNC_SLOT_SIZE 256
+/* Records gathered into one `writev`, well below IOV_MAX. */
+#define CLOG_ASYNC_BATCH 64
+/* The writer also wakes up on its own this often, in case a wake-up was missed. */
+#define CLOG_ASYNC_IDLE_MS 100
+
+namespace clog {
+
+/* Bounded MPMC sequence ring (Vyukov), used with a single consumer: a slot is free for the
+ * producer at position `pos` when its sequence equals `pos`, and ready for the writer when it
+ * equals `pos + 1`. */
+struct alignas(64) CLogAsyncSlot {
+  std::atomic<uint64_t> sequence;
+  uint32_t len;
+  /** The data is a #CLG_DeferredRecord. */
+  bool deferred;
+  char *heap_data;
+  char data[CLOG_ASYNC_SLOT_SIZE - 24];
+};
+static_assert(sizeof(CLogAsyncSlot) == CLOG_ASYNC_SLOT_SIZE, "unexpected slot padding");
+
+struct CLogAsync {
+  CLogContext *ctx;
+
+  alignas(64) std::atomic<uint64_t> enqueue_pos{0};
+  /* Everything before this position has been written, advanced by the writer only. */
+  alignas(64) std::atomic<uint64_t> written_pos{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<bool> sleeping{false};
+  std::atomic<bool> stop{false};
+
+  std::mutex mutex;
+  /* Wakes the writer. */
+  std::condition_variable wake_cv;
+  /* Wakes flushes and producers waiting for space. */
+  std::condition_variable progress_cv;
+  std::thread thread;
+
+  CLogAsyncSlot slots[CLOG_ASYNC_SLOTS];
+};
+
+static bool clg_async_ready(CLogAsync *async, uint64_t pos)
+{
+  const CLogAsyncSlot &slot = async->slots[pos & (CLOG_ASYNC_SLOTS - 1)];
+  return slot.sequence.load(std::memory_order_acquire) == pos + 1;
+}
+
+static void clg_async_wake_writer(CLogAsync *async)
+{
+  /* Pairs with the fence in the writer, one of both sides sees the other's store. Only the
+   * producer that clears the flag pays for the notification. */
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (async->sleeping.load(std::memory_order_relaxed) &&
+      async->sleeping.exchange(false, std::memory_order_relaxed))
+  {
+    std::lock_guard<std::mutex> lock(async->mutex);
+    async->wake_cv.notify_one();
+  }
+}
+
+/* Write all of `iov`, continuing after partial writes and interrupts. */
+static void clg_async_writev_all(int fd, const iovec *iov_src, int count)
+{
+  iovec iov[CLOG_ASYNC_BATCH + 1];
+  memcpy(iov, iov_src, sizeof(iovec) * count);
+  iovec *iter = iov;
+  while (count > 0) {
+    const ssize_t written = writev(fd, iter, count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    size_t remaining = (size_t)written;
+    while (count > 0 && remaining >= iter->iov_len) {
+      remaining -= iter->iov_len;
+      iter++;
+      count--;
+    }
+    if (count > 0) {
+      iter->iov_base = (char *)iter->iov_base + remaining;
+      iter->iov_len -= remaining;
+    }
+  }
+}
+
+static void clg_async_write(CLogAsync *async, const iovec *iov, int count)
+{
+  clg_async_writev_all(async->ctx->output, iov, count);
+  if (async->ctx->output_extra != -1) {
+    clg_async_writev_all(async->ctx->output_extra, iov, count);
+  }
+}
+
+static void clg_async_writer(CLogAsync *async)
+{
+  iovec iov[CLOG_ASYNC_BATCH + 1];
+  iovec iov_binary[CLOG_ASYNC_BATCH];
+  /* Deferred records of the batch, formatted here, capacity is kept between batches. */
+  std::string rendered[CLOG_ASYNC_BATCH];
+  uint64_t pos = 0;
+
+  for (;;) {
+    int count = 0, text_count = 0, binary_count = 0;
+    while (count < CLOG_ASYNC_BATCH && clg_async_ready(async, pos + count)) {
+      const CLogAsyncSlot &slot = async->slots[(pos + count) & (CLOG_ASYNC_SLOTS - 1)];
+      const char *data = slot.heap_data ? slot.heap_data : slot.data;
+      if (slot.deferred) {
+        std::string &text = rendered[count];
+        if (clg_deferred_render(async->ctx, data, slot.len, text)) {
+          iov_binary[binary_count++] = {text.data(), text.size()};
+        }
+        else {
+          iov[text_count++] = {text.data(), text.size()};
+        }
+      }
+      else {
+        iov[text_count++] = {(void *)data, slot.len};
+      }
+      count++;
+    }
+
+    const uint64_t dropped = async->dropped.exchange(0, std::memory_order_relaxed);
+    char dropped_str[96];
+    if (dropped) {
+      const int len = snprintf(dropped_str,
+                               sizeof(dropped_str),
+                               "clog: %llu records dropped, the queue was full\n",
+                               (unsigned long long)dropped);
+      iov[text_count++] = {dropped_str, (size_t)len};
+    }
+
+    if (count || dropped) {
+      if (text_count) {
+        clg_async_write(async, iov, text_count);
+      }
+      if (binary_count) {
+        clg_async_writev_all(async->ctx->binary_output, iov_binary, binary_count);
+      }
+      for (int i = 0; i < count; i++) {
+        CLogAsyncSlot &slot = async->slots[(pos + i) & (CLOG_ASYNC_SLOTS - 1)];
+        if (slot.heap_data) {
+          MEM_freeN(slot.heap_data);
+          slot.heap_data = nullptr;
+        }
+        slot.sequence.store(pos + i + CLOG_ASYNC_SLOTS, std::memory_order_release);
+      }
+      pos += count;
+      {
+        std::lock_guard<std::mutex> lock(async->mutex);
+        async->written_pos.store(pos, std::memory_order_release);
+      }
+      async->progress_cv.notify_all();
+      continue;
+    }
+
+    if (async->stop.load(std::memory_order_acquire) &&
+        async->enqueue_pos.load(std::memory_order_acquire) == pos)
+    {
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(async->mutex);
+    async->sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!clg_async_ready(async, pos) && !async->stop.load(std::memory_order_acquire)) {
+      async->wake_cv.wait_for(lock, std::chrono::milliseconds(CLOG_ASYNC_IDLE_MS));
+    }
+    async->sleeping.store(false, std::memory_order_relaxed);
+  }
+}
+
+CLogAsync *clg_async_start(CLogContext *ctx)
+{
+  CLogAsync *async = mem::MEM_new<CLogAsync>(__func__);
+  async->ctx = ctx;
+  for (uint64_t i = 0; i < CLOG_ASYNC_SLOTS; i++) {
+    async->slots[i].sequence.store(i, std::memory_order_relaxed);
+    async->slots[i].heap_data = nullptr;
+  }
+  async->thread = std::thread(clg_async_writer, async);
+  return async;
+}
+
+void clg_async_stop(CLogAsync *async)
+{
+  clg_async_flush(async);
+  {
+    std::lock_guard<std::mutex> lock(async->mutex);
+    async->stop.store(true, std::memory_order_release);
+  }
+  async->wake_cv.notify_one();
+  async->thread.join();
+  mem::MEM_delete(async);
+}
+
+static void clg_async_push_ex(
+    CLogAsync *async, const char *data, uint len, CLG_Level level, bool deferred)
+{
+  const bool may_drop = async->ctx->async_overflow == CLG_ASYNC_OVERFLOW_DROP &&
+                        level > CLG_LEVEL_ERROR;
+
+  uint64_t pos = async->enqueue_pos.load(std::memory_order_relaxed);
+  CLogAsyncSlot *slot;
+  for (;;) {
+    slot = &async->slots[pos & (CLOG_ASYNC_SLOTS - 1)];
+    const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const int64_t diff = (int64_t)(sequence - pos);
+    if (diff == 0) {
+      if (async->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (diff < 0) {
+      /* The ring is full: the writer has not released this slot yet. */
+      if (may_drop) {
+        async->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      clg_async_wake_writer(async);
+      std::unique_lock<std::mutex> lock(async->mutex);
+      async->progress_cv.wait_for(lock, std::chrono::milliseconds(1));
+      pos = async->enqueue_pos.load(std::memory_order_relaxed);
+    }
+    else {
+      pos = async->enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->len = len;
+  slot->deferred = deferred;
+  if (len <= sizeof(slot->data)) {
+    memcpy(slot->data, data, len);
+  }
+  else {
+    slot->heap_data = static_cast<char *>(
+        mem::MEM_new_array_uninitialized(len, sizeof(char), "clog_async_record"));
+    memcpy(slot->heap_data, data, len);
+  }
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  clg_async_wake_writer(async);
+}
+
+void clg_async_push(CLogAsync *async, const char *data, uint len, CLG_Level level)
+{
+  clg_async_push_ex(async, data, len, level, false);
+}
+
+void clg_async_push_deferred(CLogAsync *async, const char *data, uint len, CLG_Level level)
+{
+  clg_async_push_ex(async, data, len, level, true);
+}
+
+void clg_async_flush(CLogAsync *async)
+{
+  const uint64_t target = async->enqueue_pos.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(async->mutex);
+  while (async->written_pos.load(std::memory_order_acquire) < target) {
+    async->wake_cv.notify_one();
+    async->progress_cv.wait_for(lock, std::chrono::milliseconds(10));
+  }
+}
+
+}  // namespace clog
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+
+#include "../CLG_log.h"
+
+namespace clog {
+
+/*
+ * Asynchronous output: formatted records are copied into a bounded multi-producer ring and
+ * written by a dedicated thread, which gathers every record that is ready into one `writev`
+ * per output. The calling thread never touches the file descriptors.
+ */
+
+struct CLogAsync;
+
+/** Start the writer thread for `ctx`, which must outlive clg_async_stop(). */
+CLogAsync *clg_async_start(CLogContext *ctx);
+
+/** Write everything still queued, then stop and free the writer. */
+void clg_async_stop(CLogAsync *async);
+
+/**
+ * Queue a formatted record. When the ring is full the record is dropped or the caller waits,
+ * see #CLG_AsyncOverflow, errors and fatal errors always wait.
+ */
+void clg_async_push(CLogAsync *async, const char *data, uint len, CLG_Level level);
+
+/** Queue a #CLG_DeferredRecord, formatted by the writer with clg_deferred_render(). */
+void clg_async_push_deferred(CLogAsync *async, const char *data, uint len, CLG_Level level);
+
+/** Return once everything queued before the call has been written. */
+void clg_async_flush(CLogAsync *async);
+
+/**
+ * Called on the writer thread: turn a #CLG_DeferredRecord into text for the outputs, or into
+ * binary records for #CLogContext.binary_output. Returns true for binary.
+ */
+bool clg_deferred_render(CLogContext *ctx, const char *record, uint len, std::string &r_out);
+
+}  // namespace clog
@@ -1,14 +1,35 @@
+#include <cstdlib>
 #include <filesystem>
 
+#include "../../config/CONFIG_manager.h"
 #include "CLG_init.hh"
 #include "CLG_log.h"
 
 namespace clog {
+
+/* Rate limits and sampling of chatty log types, see clog.ini. */
+static void clog_init_throttling()
+{
+  auto &cfg = config::ConfigManager::instance();
+  const std::filesystem::path ini_path = std::filesystem::path(VEKTOR_SOURCE_DIR) / "intern" /
+                                         "config" / "ini" / "clog.ini";
+  if (!cfg.has("clog") && !cfg.load("clog", ini_path.string())) {
+    return;
+  }
+  for (const auto &[match, value] : cfg.get_section("clog", "RateLimit")) {
+    clog::CLG_type_rate_limit_set(match.c_str(), (int)match.size(), (uint)atoi(value.c_str()));
+  }
+  for (const auto &[match, value] : cfg.get_section("clog", "Sample")) {
+    clog::CLG_type_sample_set(match.c_str(), (int)match.size(), (uint)atoi(value.c_str()));
+  }
+}
+
 void clog_init(const char *id, const char *file_name, const char *var)
 {
   clog::CLG_init();
   clog::CLG_level_set(clog::CLG_LEVEL_INFO);
   clog::CLG_output_use_timestamp_set(1);
+  clog_init_throttling();
 
   std::filesystem::path log_dir = std::filesystem::path(VEKTOR_SOURCE_DIR) / "logs";
   std::filesystem::create_directories(log_dir);
@@ -18,6 +39,8 @@ void clog_init(const char *id, const char *file_name, const char *var)
   if (log_file) {
     clog::CLG_output_extra_set(log_file);
   }
+  /* Logging threads (render, loaders) never wait on the terminal or log file. */
+  clog::CLG_output_async_set(1);
 
   CLG_LOGREF_DECLARE_GLOBAL(V_LOG, id);
   CLOG_INFO(V_LOG, "%s", var);
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "../../source/runtime/lib/VLI_complier_attrs.h"
+
+namespace mem {
+
+/*
+ * Arena
+ *
+ * A stack-style linear allocator for the temporaries of a single operation (mesh
+ * triangulation, region selection, tree builds, ...).  Memory comes from a chain of blocks
+ * taken from the active MEM allocator, so it shows up under "MEM_Arena" in MEM_print_stats()
+ * and is checked by the guarded and debug modes.  Nothing is freed individually: the caller
+ * pushes a marker before the work and pops back to it afterwards, which keeps the blocks for
+ * the next operation.
+ *
+ * An arena belongs to one thread at a time.  Use MEM_arena_thread() for a per-thread scratch
+ * arena, so that any thread can do scoped work without setting one up.
+ */
+
+struct MEM_ArenaBlock;
+
+/** #MEM_Arena position returned by push_marker(). */
+struct MEM_ArenaMarker {
+  MEM_ArenaBlock *block;
+  size_t offset;
+};
+
+class MEM_Arena {
+ public:
+  /** `block_size` is the size of the first block, later blocks double up to 4 MB. */
+  explicit MEM_Arena(size_t block_size = 64 * 1024);
+  ~MEM_Arena();
+
+  MEM_Arena(const MEM_Arena &) = delete;
+  MEM_Arena &operator=(const MEM_Arena &) = delete;
+
+  /** Bump-allocate `size` bytes, `alignment` must be a power of two. */
+  void *alloc(size_t size, size_t alignment = alignof(std::max_align_t)) ATTR_WARN_UNUSED_RESULT;
+
+  template<typename T> T *alloc_array(size_t len)
+  {
+    return static_cast<T *>(alloc(len * sizeof(T), alignof(T)));
+  }
+
+  /**
+   * Give back the most recent allocation if `ptr` is it, e.g. a temporary container destroyed
+   * before anything else was allocated. Anything else is left to pop_to_marker(). This does not
+   * help a growing std::pmr::vector: it allocates the new buffer before it frees the old one.
+   */
+  void free_last(void *ptr, size_t size);
+
+  MEM_ArenaMarker push_marker() const;
+
+  /** Release everything allocated after `marker` was pushed, markers nest like a stack. */
+  void pop_to_marker(const MEM_ArenaMarker &marker);
+
+  /** Release everything, and give all but the first block back to the allocator. */
+  void clear();
+
+  /** Release everything and give all blocks back to the allocator, the arena stays usable. */
+  void release();
+
+  /** Bytes from the start of the arena to its cursor, including unused tails of blocks. */
+  size_t bytes_used() const;
+
+  /** Bytes held in blocks, allocated or not. */
+  size_t bytes_reserved() const;
+
+ private:
+  MEM_ArenaBlock *first_ = nullptr;
+  MEM_ArenaBlock *current_ = nullptr;
+  size_t offset_ = 0;
+  size_t block_size_;
+};
+
+/** The calling thread's scratch arena, created on first use and freed when the thread exits. */
+MEM_Arena &MEM_arena_thread();
+
+/**
+ * Give the blocks of the calling thread's scratch arena back to the allocator. Threads that
+ * outlive the leak and profiler reports (the main thread) call this before them, so that the
+ * arena does not show up as live memory there.
+ */
+void MEM_arena_thread_free();
+
+/** Pops the arena back to where it was when the scope was entered. */
+class MEM_ArenaScope {
+ public:
+  explicit MEM_ArenaScope(MEM_Arena &arena) : arena_(arena), marker_(arena.push_marker()) {}
+  MEM_ArenaScope() : MEM_ArenaScope(MEM_arena_thread()) {}
+  ~MEM_ArenaScope()
+  {
+    arena_.pop_to_marker(marker_);
+  }
+
+  MEM_ArenaScope(const MEM_ArenaScope &) = delete;
+  MEM_ArenaScope &operator=(const MEM_ArenaScope &) = delete;
+
+  MEM_Arena &arena()
+  {
+    return arena_;
+  }
+
+ private:
+  MEM_Arena &arena_;
+  MEM_ArenaMarker marker_;
+};
+
+/**
+ * std::pmr adapter, so existing containers can opt in with a type change:
+ *
+ *   mem::MEM_ArenaScope scope;
+ *   mem::MEM_ArenaResource resource(scope.arena());
+ *   std::pmr::vector<uint32_t> indices(&resource);
+ *
+ * The containers must be destroyed before the scope ends.
+ */
+class MEM_ArenaResource : public std::pmr::memory_resource {
+ public:
+  explicit MEM_ArenaResource(MEM_Arena &arena) : arena_(arena) {}
+
+ private:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *ptr, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+  MEM_Arena &arena_;
+};
+
+}  // namespace mem
@@ -27,51 +27,117 @@ ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
 /*
  * Frame Allocator
  *
- * A fixed-size linear/bump allocator backed by a 16 MB slab that is committed
- * at startup and rewound (cursor reset to 0) at the end of every frame via
- * MEM_frame_end().  Allocations are O(1) and produce NO heap traffic – ideal
- * for short-lived temporaries (string scratch buffers, per-frame math matrices,
- * transient work arrays, etc.) that must not out-live the current frame.
+ * A linear/bump allocator for short-lived temporaries (string scratch buffers,
+ * per-frame math matrices, transient work arrays, staging data for GPU uploads,
+ * etc.).  Allocations are O(1) and produce NO heap traffic in the steady state.
  *
- * Thread-safety: the internal cursor is advanced with std::atomic so concurrent
- * allocations from multiple threads within the same frame are safe.  end_frame()
- * must be called from a single "owner" context after all worker threads have
- * finished for the frame.
+ * Double buffering: there are two frame buffers used in alternation, and
+ * end_frame() only recycles the one that was filled two frames ago.  A pointer
+ * obtained during frame N therefore stays valid through frame N + 1, long
+ * enough for an asynchronous GPU upload to consume it.
+ *
+ * Thread-safety: each thread bump-allocates from its own sub-arena of
+ * MEM_FRAME_ARENA_SIZE bytes, so only claiming a new sub-arena touches the
+ * shared atomic cursor.  end_frame() must be called from a single "owner"
+ * context after all worker threads have finished for the frame.
+ *
+ * Growth: when a frame buffer is exhausted another slab is chained to it
+ * instead of failing.  When the buffer is recycled the chain is folded into a
+ * single slab large enough for it, so overflow only costs a malloc on the
+ * frames where the high-water mark rises.
  * */
-constexpr size_t MEM_FRAME_BUFFER_SIZE = 16u * 1024u * 1024u; /* 16 MB */
+constexpr size_t MEM_FRAME_BUFFER_SIZE = 8u * 1024u * 1024u; /* 8 MB per frame buffer */
+constexpr size_t MEM_FRAME_ARENA_SIZE = 64u * 1024u;         /* 64 KB per thread sub-arena */
+constexpr int MEM_FRAME_BUFFERS = 2;
+
+/** A slab of a frame buffer, the data follows the header. */
+struct FrameSlab {
+    FrameSlab *next;             /**< Older slab of the same frame buffer. */
+    size_t capacity;             /**< Usable bytes after the header. */
+    std::atomic<size_t> cursor;  /**< Bytes claimed, may overshoot `capacity`. */
+};
+
+struct FrameBuffer {
+    std::atomic<FrameSlab *> slabs; /**< Newest slab first. */
+    size_t overflow_count;          /**< Slabs chained since the buffer was last recycled. */
+};
 
 struct FrameAllocator {
-    uint8_t *buffer;                   /**< Base of the 16 MB slab (heap-allocated once). */
-    std::atomic<size_t> cursor;        /**< Byte offset of the next free byte. */
-    size_t capacity;                   /**< Total slab size in bytes (= MEM_FRAME_BUFFER_SIZE). */
-    
+    FrameBuffer frames[MEM_FRAME_BUFFERS];
+    std::atomic<uint64_t> frame_index; /**< Frames ended so far, selects the live buffer. */
+    size_t high_water;                 /**< Most bytes any single frame has used. */
+    size_t overflow_total;             /**< Overflow slabs chained since init(). */
+
     /** Initialise the allocator.  Called once at program / renderer start-up. */
     void init();
     
     /**
-     * Bump-allocate `size` bytes aligned to `alignment`.
-     * Returns nullptr when the slab is exhausted (caller must handle gracefully).
+     * Bump-allocate `size` bytes aligned to `alignment` (a power of two).
+     * Returns nullptr only when the system is out of memory.
      */
     void *alloc(size_t size, size_t alignment = alignof(std::max_align_t)) ATTR_WARN_UNUSED_RESULT;
     
     /**
-     * Reset the cursor to 0, making the entire slab available again.
-     * Call once per frame after all frame work is complete.
+     * Switch to the other frame buffer and recycle it, invalidating what was
+     * allocated before the previous end_frame().  Call once per frame after
+     * all frame work is complete.
      */
     void end_frame();
     
-    /** Return how many bytes are currently live in the slab. */
+    /** Return how many bytes the current frame has claimed (in whole sub-arenas). */
     size_t bytes_used() const;
-    
-    /** Free the underlying slab.  Call at application shutdown. */
+
+    /** Most bytes claimed by a single frame since init(), for tuning MEM_FRAME_BUFFER_SIZE. */
+    size_t bytes_high_water() const;
+
+    /** Free the underlying slabs.  Call at application shutdown. */
     void shutdown();
 };
 
 /** The singleton frame allocator instance. */
 extern FrameAllocator g_frame_allocator;
 
+/*
+ * Slab Allocator
+ *
+ * A size-class allocator for small blocks (up to MEM_SLAB_MAX_SIZE bytes).
+ * Requests are rounded up to one of 20 classes (16 byte steps up to 128, then
+ * four per power of two) carved out of 64 KB chunks that are never returned to
+ * the system.  It backs the lean allocator mode and the typed pools in
+ * MEM_gaurdalloc.h.
+ *
+ * Thread-safety: every thread keeps a small cache of free blocks per class and
+ * only takes the class lock to move a batch between its cache and the shared
+ * free list.  Blocks may be freed on any thread.  A thread's cache is handed
+ * back to the shared lists when the thread exits.
+ *
+ * Blocks carry no header, the caller passes the requested size again on free.
+ * */
+constexpr size_t MEM_SLAB_MAX_SIZE = 1024;
+constexpr size_t MEM_SLAB_CHUNK_SIZE = 64u * 1024u; /* 64 KB */
+
+struct SlabAllocator {
+    /**
+     * Allocate at least `size` bytes (<= MEM_SLAB_MAX_SIZE), 16 byte aligned.
+     * Returns nullptr when the system is out of memory.
+     */
+    void *alloc(size_t size) ATTR_WARN_UNUSED_RESULT;
+
+    /** Return a block from alloc(), `size` must be the size it was requested with. */
+    void free(void *ptr, size_t size);
+
+    /** Move the calling thread's cached blocks back to the shared free lists. */
+    void flush_thread_cache();
+
+    /** Bytes of chunk memory taken from the system so far (useful for profiling). */
+    size_t bytes_reserved() const;
+};
+
+/** The singleton slab allocator instance. */
+extern SlabAllocator g_slab_allocator;
+
 /**
- * Allocate `size` bytes from the frame slab with default alignment.
+ * Allocate `size` bytes from the frame allocator with default alignment.
  * Equivalent to g_frame_allocator.alloc(size).
  */
 extern void *(*mem_frame_alloc)(size_t size) ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1);
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 
 #include "../../source/runtime/lib/VLI_complier_attrs.h"
@@ -59,6 +62,70 @@ extern void *(*MEM_realloc_uninitialized_id)(
 
 extern size_t (*MEM_get_memory_in_use)();
 
+/** Allocator totals, aggregated over all threads at the time of the call. */
+struct MEM_Stats {
+  size_t bytes_in_use;
+  size_t blocks_in_use;
+  /** Highest `bytes_in_use` seen, sampled every 64 KiB allocated per thread. */
+  size_t peak_bytes;
+};
+
+/** Live totals of a single `allocation_name`. */
+struct MEM_TagStats {
+  const char *name;
+  size_t bytes_in_use;
+  size_t blocks_in_use;
+};
+
+void MEM_get_stats(MEM_Stats *r_stats);
+
+/**
+ * Call `fn` for every allocation name with live blocks. Names are tracked by pointer, equal
+ * strings passed from different places are reported separately.
+ */
+void MEM_foreach_tag_stats(void (*fn)(const MEM_TagStats *tag, void *user_data), void *user_data);
+
+/** Print the totals and the live blocks per allocation name, largest first, to stdout. */
+void MEM_print_stats();
+
+/**
+ * Start the allocation profiler: from now on the bytes and blocks allocated per name are
+ * counted as well, sampled once per MEM_profile_frame(). When `timeline_path` is given every
+ * frame is also written there, see MEM_profile_format.h, for the mem_profile_view tool.
+ * Calling it again while running only adds a timeline, if there is none yet. Returns false when
+ * the timeline cannot be created.
+ */
+bool MEM_profile_begin(const char *timeline_path);
+
+/** Sample the profiler, call once per frame. Does nothing unless it was started. */
+void MEM_profile_frame();
+
+/**
+ * Stop the profiler and print the blocks still allocated per name to stderr, ranked by how
+ * much each grew since MEM_profile_begin(). Also runs at exit if not called before.
+ */
+void MEM_profile_end();
+
+bool MEM_profile_is_active();
+
+enum class MEM_AllocatorMode {
+  /** Size-class pool with a 16 byte header and no guards, for production. */
+  Lean,
+  /** Magic head and tail words, checked on every free. */
+  Guarded,
+  /** Guarded, plus a list of live blocks with a backtrace each, leaks are reported at exit. */
+  Debug,
+};
+
+/**
+ * Switch the implementation behind the allocation function pointers. Blocks cannot move
+ * between implementations, so this fails while anything is allocated: call it first thing in
+ * main(). The default is #MEM_AllocatorMode::Guarded, or Lean with the
+ * VEKTOR_MEM_LEAN_ALLOCATOR build option.
+ */
+bool MEM_use_allocator(MEM_AllocatorMode mode);
+MEM_AllocatorMode MEM_get_allocator_mode();
+
 #define MEM_realloc_uninitialized(vmemh, len) MEM_realloc_uninitialized_id(vmemh, len, __func__)
 
 #define MEM_SAFE_DELETE(v) \
@@ -85,38 +152,129 @@ template<typename T> inline T *MEM_new_zeroed(const char *allocation_name)
 
 #define MEM_FRAME_INIT() mem_guarded::internal::g_frame_allocator.init()
 
-/** Release the slab at application shutdown. */
+/** Release the frame buffers at application shutdown. */
 #define MEM_FRAME_SHUTDOWN() mem_guarded::internal::g_frame_allocator.shutdown()
 
 /**
- * Allocate `size` bytes from the frame slab with default (max) alignment.
- * The pointer is valid until MEM_frame_end() is called at the end of the frame.
- * Do NOT call MEM_freeN on it – the whole slab is rewound as one unit.
+ * Allocate `size` bytes from the frame allocator with default (max) alignment.
+ * The pointer is valid until the second MEM_frame_end() after the call, i.e.
+ * through the next frame as well.
+ * Do NOT call MEM_freeN on it – the whole frame buffer is rewound as one unit.
  */
 #define MEM_frame_alloc(size) mem_guarded::internal::mem_frame_alloc(size)
 
 /**
- * Allocate `size` bytes from the frame slab with an explicit `alignment`.
+ * Allocate `size` bytes from the frame allocator with an explicit `alignment`.
  * alignment must be a power-of-two.
  */
 #define MEM_frame_alloc_aligned(size, alignment) \
   mem_guarded::internal::g_frame_allocator.alloc(size, alignment)
 
 /**
- * Rewind the frame slab.  Call exactly once per frame after all frame work
- * is complete (e.g. after present / swap-buffers).  All previous
- * MEM_frame_alloc pointers become invalid after this call.
+ * End the frame.  Call exactly once per frame after all frame work is
+ * complete (e.g. after present / swap-buffers).  MEM_frame_alloc pointers
+ * from the frame before the one just ended become invalid after this call.
  */
 #define MEM_frame_end() mem_guarded::internal::mem_frame_end()
 
-/** Query how many slab bytes are currently live (useful for profiling). */
+/** Query how many bytes the current frame has claimed (useful for profiling). */
 #define MEM_frame_bytes_used() mem_guarded::internal::g_frame_allocator.bytes_used()
 
+/** Most bytes a single frame has claimed so far, to size MEM_FRAME_BUFFER_SIZE from real runs. */
+#define MEM_frame_bytes_high_water() mem_guarded::internal::g_frame_allocator.bytes_high_water()
+
+/*
+ * Slab Pools
+ *
+ * Typed helpers on top of the thread-caching slab allocator, for small objects that are created
+ * and destroyed often (materials, meshes, lights, file block headers). Pool blocks carry no
+ * header, so they are not counted by MEM_get_stats() and must be released with the matching
+ * helper rather than MEM_delete/MEM_freeN.
+ */
+
+/** Return the calling thread's cached slab blocks to the shared pool (e.g. before parking). */
+#define MEM_slab_flush_thread_cache() mem_guarded::internal::g_slab_allocator.flush_thread_cache()
+
+/** Chunk memory reserved by the slab pools so far. */
+#define MEM_slab_bytes_reserved() mem_guarded::internal::g_slab_allocator.bytes_reserved()
+
+/** True when `T` fits a slab size class. */
+template<typename T>
+inline constexpr bool MEM_slab_fits_v = sizeof(T) <= mem_guarded::internal::MEM_SLAB_MAX_SIZE &&
+                                        alignof(T) <= 16;
+
+template<typename T, typename... Args> inline T *MEM_pool_new(Args &&...args)
+{
+  static_assert(MEM_slab_fits_v<T>, "Type is too large or over-aligned for the slab pool");
+  void *buffer = mem_guarded::internal::g_slab_allocator.alloc(sizeof(T));
+  if (!buffer) {
+    throw std::bad_alloc();
+  }
+  return new (buffer) T(std::forward<Args>(args)...);
+}
+
+/** Destroy an object created with MEM_pool_new<T>(), `T` must be its exact type. */
+template<typename T> inline void MEM_pool_delete(T *ptr)
+{
+  if (ptr == nullptr) {
+    return;
+  }
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    ptr->~T();
+  }
+  mem_guarded::internal::g_slab_allocator.free(ptr, sizeof(T));
+}
+
+/**
+ * Standard allocator on the slab pools. Requests that do not fit a size class (arrays, large
+ * or over-aligned types) fall back to the global operator new.
+ */
+template<typename T> struct MEM_SlabAllocator {
+  using value_type = T;
+
+  MEM_SlabAllocator() = default;
+  template<typename U> MEM_SlabAllocator(const MEM_SlabAllocator<U> & /*other*/) {}
+
+  T *allocate(size_t n)
+  {
+    const size_t size = n * sizeof(T);
+    if (alignof(T) <= 16 && size <= mem_guarded::internal::MEM_SLAB_MAX_SIZE) {
+      void *ptr = mem_guarded::internal::g_slab_allocator.alloc(size);
+      if (!ptr) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T *>(ptr);
+    }
+    return static_cast<T *>(::operator new(size, std::align_val_t(alignof(T))));
+  }
+
+  void deallocate(T *ptr, size_t n)
+  {
+    const size_t size = n * sizeof(T);
+    if (alignof(T) <= 16 && size <= mem_guarded::internal::MEM_SLAB_MAX_SIZE) {
+      mem_guarded::internal::g_slab_allocator.free(ptr, size);
+      return;
+    }
+    ::operator delete(ptr, size, std::align_val_t(alignof(T)));
+  }
+
+  template<typename U> bool operator==(const MEM_SlabAllocator<U> & /*other*/) const
+  {
+    return true;
+  }
+};
+
+/** std::make_shared with the object and its control block in one slab block. */
+template<typename T, typename... Args> inline std::shared_ptr<T> MEM_make_shared(Args &&...args)
+{
+  return std::allocate_shared<T>(MEM_SlabAllocator<T>(), std::forward<Args>(args)...);
+}
+
 }  // namespace mem
 
 /*
  * // --- Application / renderer startup ---
- * MEM_FRAME_INIT();   // allocates the 16 MB slab once
+ * MEM_FRAME_INIT();   // allocates both 8 MB frame buffers once
  *
  * // --- Inside the render / game loop (called ~60 times per second) ---
  * void render_frame()
@@ -133,13 +291,14 @@ template<typename T> inline T *MEM_new_zeroed(const char *allocation_name)
  *
  *     // ... rest of the frame ...
  *
- *     // Optional: profile how much slab we consumed this frame.
+ *     // Optional: profile how much we consumed this frame, or the worst frame so far.
  *     // size_t used = MEM_frame_bytes_used();
+ *     // size_t worst = MEM_frame_bytes_high_water();
  *
- *     // Must be called LAST – invalidates all pointers from this frame.
+ *     // Must be called LAST – invalidates all pointers from the previous frame.
  *     MEM_frame_end();
  * }
  *
  * // --- Application shutdown ---
- * MEM_FRAME_SHUTDOWN();  // frees the 16 MB slab
+ * MEM_FRAME_SHUTDOWN();  // frees the frame buffers
  */
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Allocation Profile Timeline
+ *
+ * Binary file written by MEM_profile_begin() with a timeline path, read by the
+ * mem_profile_view tool in source/tests. Native byte order, no compression.
+ *
+ *   MEM_ProfileFileHeader
+ *   { uint32_t record type, record }*
+ *
+ * A #MEM_PROFILE_RECORD_TAG names a tag slot the first time it is sampled, a
+ * #MEM_PROFILE_RECORD_FRAME is followed by `tag_count` #MEM_ProfileTagSample for the tags
+ * that allocated or freed anything during the frame.
+ */
+
+#define MEM_PROFILE_MAGIC "VKMEMPRF"
+#define MEM_PROFILE_VERSION 1
+
+enum MEM_ProfileRecordType : uint32_t {
+  MEM_PROFILE_RECORD_TAG = 1,
+  MEM_PROFILE_RECORD_FRAME = 2,
+};
+
+struct MEM_ProfileFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t tag_capacity;
+};
+
+/** Followed by `name_len` bytes of the allocation name, not null terminated. */
+struct MEM_ProfileTagRecord {
+  uint32_t tag;
+  uint32_t name_len;
+  /** Live bytes of the tag when profiling started. */
+  int64_t bytes_at_begin;
+};
+
+struct MEM_ProfileFrameRecord {
+  uint64_t frame;
+  /** Since MEM_profile_begin(). */
+  uint64_t time_ns;
+  int64_t bytes_in_use;
+  int64_t blocks_in_use;
+  /** Allocated during this frame, over all tags. */
+  int64_t allocated_bytes;
+  int64_t allocated_blocks;
+  uint32_t tag_count;
+  uint32_t _pad;
+};
+
+struct MEM_ProfileTagSample {
+  uint32_t tag;
+  uint32_t _pad;
+  int64_t bytes_in_use;
+  /** Allocated during this frame. */
+  int64_t allocated_bytes;
+  int64_t allocated_blocks;
+};
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <new>
+
+#include "../MEM_arena.h"
+#include "../MEM_gaurdalloc.h"
+
+/* Later blocks double in size up to this. */
+#define MEM_ARENA_MAX_BLOCK_SIZE (4 * 1024 * 1024)
+
+namespace mem {
+
+struct alignas(16) MEM_ArenaBlock {
+  MEM_ArenaBlock *next;
+  size_t capacity;
+};
+
+static uintptr_t arena_block_data(const MEM_ArenaBlock *block)
+{
+  return (uintptr_t)(block + 1);
+}
+
+static void arena_block_free_chain(MEM_ArenaBlock *block)
+{
+  while (block) {
+    MEM_ArenaBlock *next = block->next;
+    MEM_freeN(block);
+    block = next;
+  }
+}
+
+MEM_Arena::MEM_Arena(size_t block_size) : block_size_(block_size) {}
+
+MEM_Arena::~MEM_Arena()
+{
+  arena_block_free_chain(first_);
+}
+
+void *MEM_Arena::alloc(size_t size, size_t alignment)
+{
+  while (current_) {
+    const uintptr_t base = arena_block_data(current_);
+    const uintptr_t aligned = (base + offset_ + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (aligned + size <= base + current_->capacity) {
+      offset_ = aligned + size - base;
+      return (void *)aligned;
+    }
+    /* Blocks after the current one were kept by pop_to_marker(), reuse them if large enough. */
+    if (!current_->next || current_->next->capacity < size + alignment) {
+      break;
+    }
+    current_ = current_->next;
+    offset_ = 0;
+  }
+
+  const size_t capacity = std::max(block_size_, size + alignment);
+  auto *block = (MEM_ArenaBlock *)MEM_mallocN(sizeof(MEM_ArenaBlock) + capacity, "MEM_Arena");
+  if (!block) {
+    return nullptr;
+  }
+  block->capacity = capacity;
+  block->next = nullptr;
+  if (current_) {
+    /* The blocks following the current one are too small, replace them. */
+    arena_block_free_chain(current_->next);
+    current_->next = block;
+  }
+  else {
+    first_ = block;
+  }
+  current_ = block;
+  block_size_ = std::min<size_t>(block_size_ * 2, MEM_ARENA_MAX_BLOCK_SIZE);
+
+  const uintptr_t base = arena_block_data(block);
+  const uintptr_t aligned = (base + alignment - 1) & ~(uintptr_t)(alignment - 1);
+  offset_ = aligned + size - base;
+  return (void *)aligned;
+}
+
+void MEM_Arena::free_last(void *ptr, size_t size)
+{
+  if (current_ && (uintptr_t)ptr + size == arena_block_data(current_) + offset_) {
+    offset_ = (uintptr_t)ptr - arena_block_data(current_);
+  }
+}
+
+MEM_ArenaMarker MEM_Arena::push_marker() const
+{
+  return {current_, offset_};
+}
+
+void MEM_Arena::pop_to_marker(const MEM_ArenaMarker &marker)
+{
+  /* A marker pushed before the first allocation rewinds to the start of the first block. */
+  current_ = marker.block ? marker.block : first_;
+  offset_ = marker.block ? marker.offset : 0;
+}
+
+void MEM_Arena::clear()
+{
+  if (first_) {
+    arena_block_free_chain(first_->next);
+    first_->next = nullptr;
+  }
+  current_ = first_;
+  offset_ = 0;
+}
+
+void MEM_Arena::release()
+{
+  arena_block_free_chain(first_);
+  first_ = nullptr;
+  current_ = nullptr;
+  offset_ = 0;
+}
+
+size_t MEM_Arena::bytes_used() const
+{
+  size_t used = 0;
+  for (MEM_ArenaBlock *block = first_; block && block != current_; block = block->next) {
+    used += block->capacity;
+  }
+  return current_ ? used + offset_ : 0;
+}
+
+size_t MEM_Arena::bytes_reserved() const
+{
+  size_t reserved = 0;
+  for (MEM_ArenaBlock *block = first_; block; block = block->next) {
+    reserved += block->capacity;
+  }
+  return reserved;
+}
+
+MEM_Arena &MEM_arena_thread()
+{
+  thread_local MEM_Arena arena;
+  return arena;
+}
+
+void MEM_arena_thread_free()
+{
+  MEM_arena_thread().release();
+}
+
+void *MEM_ArenaResource::do_allocate(size_t bytes, size_t alignment)
+{
+  void *ptr = arena_.alloc(bytes, alignment);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void MEM_ArenaResource::do_deallocate(void *ptr, size_t bytes, size_t /*alignment*/)
+{
+  arena_.free_last(ptr, bytes);
+}
+
+bool MEM_ArenaResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+  return this == &other;
+}
+
+}  // namespace mem
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#if defined(__linux__) || defined(__APPLE__)
+#  include <execinfo.h>
+#  include <unistd.h>
+#  define MEM_DEBUG_HAS_BACKTRACE
+#endif
+
+#include "MEM_intern.hh"
+#include "MEM_stats.hh"
+
+#define MEM_DEBUG_BACKTRACE_DEPTH 16
+
+/* Written over freed memory to make use-after-free visible. */
+#define MEM_DEBUG_FREED_BYTE 0xDD
+
+namespace mem_guarded::internal {
+
+/* Debug bookkeeping, stored right before the MemHead of every block. */
+struct MemHeadDebug {
+  MemHeadDebug *prev;
+  MemHeadDebug *next;
+  int backtrace_len;
+  void *backtrace[MEM_DEBUG_BACKTRACE_DEPTH];
+};
+
+static std::mutex debug_mutex;
+static MemHeadDebug *debug_first = nullptr;
+
+static MemHeadDebug *debug_head_get(MemHead *head)
+{
+  return (MemHeadDebug *)((char *)head - sizeof(MemHeadDebug));
+}
+
+static MemHead *debug_alloc(size_t len, size_t alignment, const char *name)
+{
+  MemHead *head = guarded_block_alloc(len, alignment, name, sizeof(MemHeadDebug));
+  if (!head)
+    return nullptr;
+
+  MemHeadDebug *debug = debug_head_get(head);
+#ifdef MEM_DEBUG_HAS_BACKTRACE
+  debug->backtrace_len = backtrace(debug->backtrace, MEM_DEBUG_BACKTRACE_DEPTH);
+#else
+  debug->backtrace_len = 0;
+#endif
+
+  {
+    std::lock_guard<std::mutex> lock(debug_mutex);
+    debug->prev = nullptr;
+    debug->next = debug_first;
+    if (debug_first) {
+      debug_first->prev = debug;
+    }
+    debug_first = debug;
+  }
+
+  mem_stats_add(head->tag, (int64_t)len, 1);
+  return head;
+}
+
+void debug_freeN(void *vmemh, DestructorType /*destructor_type*/)
+{
+  if (!vmemh)
+    return;
+
+  MemHead *head = guarded_block_check(vmemh, "free");
+  MemHeadDebug *debug = debug_head_get(head);
+  {
+    std::lock_guard<std::mutex> lock(debug_mutex);
+    if (debug->prev) {
+      debug->prev->next = debug->next;
+    }
+    else {
+      debug_first = debug->next;
+    }
+    if (debug->next) {
+      debug->next->prev = debug->prev;
+    }
+  }
+
+  mem_stats_add(head->tag, -(int64_t)head->size, -1);
+
+  /* A second free of the same block now fails the magic check, unless malloc reused it. */
+  head->magic = 0;
+  std::memset(vmemh, MEM_DEBUG_FREED_BYTE, head->size);
+  free((char *)head - head->raw_offset);
+}
+
+void *debug_mallocN_aligned(size_t len,
+                            size_t alignment,
+                            const char *name,
+                            DestructorType /*destructor_type*/)
+{
+  MemHead *head = debug_alloc(len, alignment, name);
+  return head ? (char *)head + sizeof(MemHead) : nullptr;
+}
+
+void *debug_reallocN(void *vmemh, size_t len, const char * /*str*/)
+{
+  if (!vmemh) {
+    return mem_mallocN(len, "MEM_realloc");
+  }
+
+  MemHead *old_head = guarded_block_check(vmemh, "realloc");
+  MemHead *head = debug_alloc(len, alignof(std::max_align_t), old_head->name);
+  if (!head)
+    return nullptr;
+
+  char *user_ptr = (char *)head + sizeof(MemHead);
+  std::memcpy(user_ptr, vmemh, std::min(len, old_head->size));
+  debug_freeN(vmemh, DestructorType::Trivial);
+  return user_ptr;
+}
+
+void debug_print_leaks()
+{
+  std::lock_guard<std::mutex> lock(debug_mutex);
+  if (!debug_first) {
+    return;
+  }
+
+  size_t leaked_blocks = 0, leaked_bytes = 0;
+  for (MemHeadDebug *debug = debug_first; debug; debug = debug->next) {
+    const MemHead *head = (const MemHead *)(debug + 1);
+    leaked_blocks++;
+    leaked_bytes += head->size;
+
+    fprintf(stderr, "Leaked %zu bytes: %s\n", head->size, head->name ? head->name : "(unnamed)");
+#ifdef MEM_DEBUG_HAS_BACKTRACE
+    fflush(stderr);
+    /* Skip our own allocation frames. */
+    const int skip = std::min(debug->backtrace_len, 2);
+    backtrace_symbols_fd(debug->backtrace + skip, debug->backtrace_len - skip, STDERR_FILENO);
+#endif
+  }
+  fprintf(stderr, "Memory leaks: %zu blocks, %zu bytes in total\n", leaked_blocks, leaked_bytes);
+}
+
+}  // namespace mem_guarded::internal
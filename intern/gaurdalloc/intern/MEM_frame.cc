@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include "../clog/CLG_log.h"
+#include "../MEM_function_pointers.h"
+
+CLG_LOGREF_DECLARE_EXTERN(LOG_MEM);
+
+/* Slab data starts one cache line after the header, sub-arenas never share a line. */
+#define MEM_FRAME_SLAB_HEADER 64
+/* Folded frame buffers are rounded up to this, so a slowly rising high-water mark does not
+ * reallocate every other frame. */
+#define MEM_FRAME_GROW_GRANULE (1024 * 1024)
+
+namespace mem_guarded::internal {
+
+static_assert(sizeof(FrameSlab) <= MEM_FRAME_SLAB_HEADER, "slab header does not fit");
+
+/* The calling thread's sub-arena, only valid for `owner` during frame `frame_index`. */
+struct FrameThreadArena {
+  const FrameAllocator *owner;
+  uint64_t frame_index;
+  uintptr_t cursor;
+  uintptr_t end;
+};
+
+FrameAllocator g_frame_allocator{};
+
+static thread_local FrameThreadArena frame_thread_arena;
+/* Only taken to chain a slab, claims are lock free. */
+static std::mutex frame_grow_mutex;
+
+static uintptr_t frame_slab_data(FrameSlab *slab)
+{
+  return (uintptr_t)slab + MEM_FRAME_SLAB_HEADER;
+}
+
+static size_t frame_slab_used(const FrameSlab *slab)
+{
+  return std::min(slab->cursor.load(std::memory_order_relaxed), slab->capacity);
+}
+
+static FrameSlab *frame_slab_new(size_t capacity, FrameSlab *next)
+{
+  auto *slab = (FrameSlab *)malloc(MEM_FRAME_SLAB_HEADER + capacity);
+  if (!slab) {
+    CLOG_ERROR(LOG_MEM, "FrameAllocator: failed to allocate a %zu KB slab!", capacity / 1024);
+    return nullptr;
+  }
+  slab->next = next;
+  slab->capacity = capacity;
+  slab->cursor.store(0, std::memory_order_relaxed);
+  return slab;
+}
+
+static void frame_buffer_free(FrameBuffer &frame)
+{
+  FrameSlab *slab = frame.slabs.exchange(nullptr, std::memory_order_relaxed);
+  while (slab) {
+    FrameSlab *next = slab->next;
+    free(slab);
+    slab = next;
+  }
+  frame.overflow_count = 0;
+}
+
+static size_t frame_buffer_used(const FrameBuffer &frame)
+{
+  size_t used = 0;
+  for (FrameSlab *slab = frame.slabs.load(std::memory_order_acquire); slab; slab = slab->next) {
+    used += frame_slab_used(slab);
+  }
+  return used;
+}
+
+/* Chain a slab of at least `size` bytes in front of `full`, unless another thread already did. */
+static bool frame_buffer_grow(FrameAllocator &allocator,
+                              FrameBuffer &frame,
+                              FrameSlab *full,
+                              size_t size)
+{
+  std::lock_guard<std::mutex> lock(frame_grow_mutex);
+  if (frame.slabs.load(std::memory_order_acquire) != full) {
+    return true;
+  }
+
+  const size_t capacity = std::max(full ? full->capacity : MEM_FRAME_BUFFER_SIZE, size);
+  FrameSlab *slab = frame_slab_new(capacity, full);
+  if (!slab) {
+    return false;
+  }
+  if (full) {
+    CLOG_WARN(LOG_MEM,
+              "FrameAllocator: frame buffer exhausted, chaining a %zu KB slab.",
+              capacity / 1024);
+    frame.overflow_count++;
+    allocator.overflow_total++;
+  }
+  frame.slabs.store(slab, std::memory_order_release);
+  return true;
+}
+
+/* Claim `size` bytes from the newest slab of `frame` with one atomic add, growing on failure. */
+static void *frame_buffer_claim(FrameAllocator &allocator,
+                                FrameBuffer &frame,
+                                size_t size,
+                                size_t alignment)
+{
+  const size_t padded = size + alignment - 1;
+  for (;;) {
+    FrameSlab *slab = frame.slabs.load(std::memory_order_acquire);
+    if (slab) {
+      const size_t offset = slab->cursor.fetch_add(padded, std::memory_order_relaxed);
+      if (offset + padded <= slab->capacity) {
+        const uintptr_t addr = frame_slab_data(slab) + offset;
+        return (void *)((addr + alignment - 1) & ~(uintptr_t)(alignment - 1));
+      }
+    }
+    if (!frame_buffer_grow(allocator, frame, slab, padded)) {
+      return nullptr;
+    }
+  }
+}
+
+/* Make `frame` empty again. A chained buffer is folded into one slab that fits all of it. */
+static void frame_buffer_recycle(FrameBuffer &frame)
+{
+  FrameSlab *slab = frame.slabs.load(std::memory_order_relaxed);
+  if (!slab) {
+    return;
+  }
+
+  if (slab->next) {
+    size_t capacity = 0;
+    for (FrameSlab *iter = slab; iter; iter = iter->next) {
+      capacity += iter->capacity;
+    }
+    capacity = (capacity + MEM_FRAME_GROW_GRANULE - 1) & ~size_t(MEM_FRAME_GROW_GRANULE - 1);
+    frame_buffer_free(frame);
+    /* On failure the buffer starts empty and grows again on first use. */
+    frame.slabs.store(frame_slab_new(capacity, nullptr), std::memory_order_relaxed);
+    return;
+  }
+
+  /* Stamp the slab with a recognisable pattern in debug to catch use-after-end_frame bugs.
+   * Only the recycled buffer is touched, the frame that just ended stays intact. */
+#ifndef NDEBUG
+  std::memset((void *)frame_slab_data(slab), 0xCD, frame_slab_used(slab));
+#endif
+  slab->cursor.store(0, std::memory_order_relaxed);
+}
+
+void FrameAllocator::init()
+{
+  assert(frames[0].slabs.load() == nullptr && "FrameAllocator::init() called more than once");
+  for (FrameBuffer &frame : frames) {
+    frame.slabs.store(frame_slab_new(MEM_FRAME_BUFFER_SIZE, nullptr), std::memory_order_relaxed);
+    if (!frame.slabs.load(std::memory_order_relaxed)) {
+      std::abort();
+    }
+    frame.overflow_count = 0;
+  }
+  frame_index.store(0, std::memory_order_relaxed);
+  high_water = 0;
+  overflow_total = 0;
+  CLOG_INFO(LOG_MEM,
+            "FrameAllocator: %d x %zu MB frame buffers initialised",
+            MEM_FRAME_BUFFERS,
+            MEM_FRAME_BUFFER_SIZE / (1024 * 1024));
+}
+
+void *FrameAllocator::alloc(size_t size, size_t alignment)
+{
+  if (!size)
+    return nullptr;
+
+  const uint64_t index = frame_index.load(std::memory_order_acquire);
+  FrameThreadArena &arena = frame_thread_arena;
+
+  /* Fast path: bump the thread's own sub-arena, no atomics. */
+  if (arena.owner == this && arena.frame_index == index) {
+    const uintptr_t aligned = (arena.cursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (aligned + size <= arena.end) {
+      arena.cursor = aligned + size;
+      return (void *)aligned;
+    }
+  }
+
+  FrameBuffer &frame = frames[index % MEM_FRAME_BUFFERS];
+
+  /* Large requests would waste most of a sub-arena, claim them from the frame directly. */
+  if (size + alignment > MEM_FRAME_ARENA_SIZE / 4) {
+    return frame_buffer_claim(*this, frame, size, alignment);
+  }
+
+  void *chunk = frame_buffer_claim(*this, frame, MEM_FRAME_ARENA_SIZE, MEM_FRAME_SLAB_HEADER);
+  if (!chunk) {
+    return nullptr;
+  }
+  const uintptr_t aligned = ((uintptr_t)chunk + alignment - 1) & ~(uintptr_t)(alignment - 1);
+  arena.owner = this;
+  arena.frame_index = index;
+  arena.cursor = aligned + size;
+  arena.end = (uintptr_t)chunk + MEM_FRAME_ARENA_SIZE;
+  return (void *)aligned;
+}
+
+void FrameAllocator::end_frame()
+{
+  const uint64_t index = frame_index.load(std::memory_order_relaxed);
+  high_water = std::max(high_water, frame_buffer_used(frames[index % MEM_FRAME_BUFFERS]));
+
+  /* The other buffer was filled during the previous frame, which nothing may reference once
+   * this one has ended. Sub-arenas of threads are dropped lazily through the frame index. */
+  frame_buffer_recycle(frames[(index + 1) % MEM_FRAME_BUFFERS]);
+  frame_index.store(index + 1, std::memory_order_release);
+}
+
+size_t FrameAllocator::bytes_used() const
+{
+  const uint64_t index = frame_index.load(std::memory_order_relaxed);
+  return frame_buffer_used(frames[index % MEM_FRAME_BUFFERS]);
+}
+
+size_t FrameAllocator::bytes_high_water() const
+{
+  return std::max(high_water, bytes_used());
+}
+
+void FrameAllocator::shutdown()
+{
+  if (overflow_total) {
+    CLOG_INFO(LOG_MEM,
+              "FrameAllocator: high-water mark %zu KB, %zu overflow slabs, consider raising "
+              "MEM_FRAME_BUFFER_SIZE.",
+              bytes_high_water() / 1024,
+              overflow_total);
+  }
+  for (FrameBuffer &frame : frames) {
+    frame_buffer_free(frame);
+  }
+  frame_index.store(0, std::memory_order_relaxed);
+  high_water = 0;
+  overflow_total = 0;
+}
+
+/* Public function-pointer hooks (match the extern declarations in MEM_function_pointers.h). */
+void *(*mem_frame_alloc)(size_t size) = [](size_t size) -> void * {
+  return g_frame_allocator.alloc(size);
+};
+
+void (*mem_frame_end)() = []() { g_frame_allocator.end_frame(); };
+
+}  // namespace mem_guarded::internal
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../MEM_function_pointers.h"
+
+#define MEM_MAGIC 0xDEADBEEF
+
+namespace mem_guarded::internal {
+
+/* Guarded and debug layout: [prefix][pad][MemHead][user data][magic tail]. */
+struct MemHead {
+  uint32_t magic;
+  uint32_t tag; /* Slot in the statistics tag table, see MEM_stats.hh. */
+  size_t size;
+  size_t raw_offset; /* bytes from raw malloc ptr to this MemHead */
+  const char *name;
+};
+
+/**
+ * Allocate a guarded block with `prefix_size` bytes reserved right before its MemHead, for
+ * the debug allocator's bookkeeping. Does not touch the statistics.
+ */
+MemHead *guarded_block_alloc(size_t len, size_t alignment, const char *name, size_t prefix_size);
+
+/** Validate both magic words of a guarded block, aborting on corruption. */
+MemHead *guarded_block_check(void *vmemh, const char *caller);
+
+/* One implementation per allocator mode, installed by MEM_use_*_allocator(). */
+
+void guarded_freeN(void *vmemh, DestructorType destructor_type);
+void *guarded_mallocN_aligned(size_t len,
+                              size_t alignment,
+                              const char *name,
+                              DestructorType destructor_type);
+void *guarded_reallocN(void *vmemh, size_t len, const char *name);
+
+void lean_freeN(void *vmemh, DestructorType destructor_type);
+void *lean_mallocN_aligned(size_t len,
+                           size_t alignment,
+                           const char *name,
+                           DestructorType destructor_type);
+void *lean_reallocN(void *vmemh, size_t len, const char *name);
+
+void debug_freeN(void *vmemh, DestructorType destructor_type);
+void *debug_mallocN_aligned(size_t len,
+                            size_t alignment,
+                            const char *name,
+                            DestructorType destructor_type);
+void *debug_reallocN(void *vmemh, size_t len, const char *name);
+void debug_print_leaks();
+
+}  // namespace mem_guarded::internal
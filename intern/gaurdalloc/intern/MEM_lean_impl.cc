@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "MEM_intern.hh"
+#include "MEM_stats.hh"
+
+/* Marks a lean block that came from the slab pool instead of malloc. */
+#define MEM_LEAN_SLAB UINT32_MAX
+
+namespace mem_guarded::internal {
+
+/* Lean layout: [pad][MemHeadLean][user data]. No magic words, nothing is checked on free. */
+struct MemHeadLean {
+  uint32_t tag;
+  uint32_t raw_offset; /* bytes from raw malloc ptr to this head, or MEM_LEAN_SLAB */
+  size_t size;
+};
+static_assert(sizeof(MemHeadLean) == 16, "keeps slab blocks 16 byte aligned");
+
+static void *lean_alloc_tagged(size_t len, size_t alignment, uint32_t tag)
+{
+  MemHeadLean *head;
+  if (alignment <= alignof(std::max_align_t) && len <= MEM_SLAB_MAX_SIZE - sizeof(MemHeadLean)) {
+    head = (MemHeadLean *)g_slab_allocator.alloc(sizeof(MemHeadLean) + len);
+    if (!head)
+      return nullptr;
+    head->raw_offset = MEM_LEAN_SLAB;
+  }
+  else {
+    size_t align_pad = (alignment > alignof(std::max_align_t)) ? (alignment - 1) : 0;
+    void *raw = malloc(sizeof(MemHeadLean) + align_pad + len);
+    if (!raw)
+      return nullptr;
+
+    char *user_ptr = (char *)raw + sizeof(MemHeadLean);
+    if (align_pad) {
+      auto addr = (uintptr_t)user_ptr;
+      user_ptr = (char *)((addr + alignment - 1) & ~(alignment - 1));
+    }
+    head = (MemHeadLean *)(user_ptr - sizeof(MemHeadLean));
+    head->raw_offset = (uint32_t)((char *)head - (char *)raw);
+  }
+  head->tag = tag;
+  head->size = len;
+
+  mem_stats_add(tag, (int64_t)len, 1);
+  return head + 1;
+}
+
+void lean_freeN(void *vmemh, DestructorType /*destructor_type*/)
+{
+  if (!vmemh)
+    return;
+
+  auto *head = (MemHeadLean *)vmemh - 1;
+  mem_stats_add(head->tag, -(int64_t)head->size, -1);
+
+  if (head->raw_offset == MEM_LEAN_SLAB) {
+    g_slab_allocator.free(head, sizeof(MemHeadLean) + head->size);
+  }
+  else {
+    free((char *)head - head->raw_offset);
+  }
+}
+
+void *lean_mallocN_aligned(size_t len,
+                           size_t alignment,
+                           const char *name,
+                           DestructorType /*destructor_type*/)
+{
+  return lean_alloc_tagged(len, alignment, mem_stats_tag(name));
+}
+
+void *lean_reallocN(void *vmemh, size_t len, const char * /*str*/)
+{
+  if (!vmemh) {
+    return mem_mallocN(len, "MEM_realloc");
+  }
+
+  auto *old_head = (MemHeadLean *)vmemh - 1;
+  void *ptr = lean_alloc_tagged(len, alignof(std::max_align_t), old_head->tag);
+  if (!ptr)
+    return nullptr;
+
+  std::memcpy(ptr, vmemh, std::min(len, old_head->size));
+  lean_freeN(vmemh, DestructorType::Trivial);
+  return ptr;
+}
+
+}  // namespace mem_guarded::internal
@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../MEM_gaurdalloc.h"
+#include "../MEM_profile_format.h"
+#include "MEM_stats.hh"
+
+/* The report lists this many frames with the most bytes allocated. */
+#define MEM_PROFILE_HOT_FRAMES 5
+
+namespace mem_guarded::internal {
+
+/* What the profiler last saw of a tag slot. */
+struct MemProfileTag {
+  int64_t bytes_at_begin;
+  int64_t bytes_peak;
+  int64_t bytes_last;
+  int64_t allocated_bytes_last;
+  int64_t allocated_blocks_last;
+  bool named;
+};
+
+struct MemProfileFrame {
+  uint64_t frame;
+  int64_t allocated_bytes;
+  int64_t allocated_blocks;
+};
+
+/* Main thread only: begin, frame and end are called from the UI loop and at exit. */
+static struct {
+  bool active;
+  FILE *timeline;
+  MemProfileTag *tags;
+  uint64_t frame;
+  std::chrono::steady_clock::time_point begin_time;
+  /* Frames with the most allocated bytes, largest first. */
+  std::vector<MemProfileFrame> hot_frames;
+} profile;
+
+static void profile_write(const void *data, size_t size)
+{
+  if (size && profile.timeline && fwrite(data, size, 1, profile.timeline) != 1) {
+    fprintf(stderr, "Memory profile: writing the timeline failed, disabling it.\n");
+    fclose(profile.timeline);
+    profile.timeline = nullptr;
+  }
+}
+
+static void profile_write_tag_name(uint32_t slot, const char *name)
+{
+  const uint32_t type = MEM_PROFILE_RECORD_TAG;
+  MEM_ProfileTagRecord record;
+  record.tag = slot;
+  record.name_len = (uint32_t)strlen(name);
+  record.bytes_at_begin = profile.tags[slot].bytes_at_begin;
+  profile_write(&type, sizeof(type));
+  profile_write(&record, sizeof(record));
+  profile_write(name, record.name_len);
+}
+
+static void profile_note_hot_frame(const MemProfileFrame &frame)
+{
+  auto &hot = profile.hot_frames;
+  if (hot.size() == MEM_PROFILE_HOT_FRAMES && hot.back().allocated_bytes >= frame.allocated_bytes)
+  {
+    return;
+  }
+  auto it = std::upper_bound(
+      hot.begin(), hot.end(), frame, [](const MemProfileFrame &a, const MemProfileFrame &b) {
+        return a.allocated_bytes > b.allocated_bytes;
+      });
+  hot.insert(it, frame);
+  if (hot.size() > MEM_PROFILE_HOT_FRAMES) {
+    hot.pop_back();
+  }
+}
+
+/* Fold the counters into the per-tag state and write a frame record. */
+static void profile_sample()
+{
+  static std::vector<MEM_ProfileTagSample> samples;
+  samples.clear();
+
+  MemProfileFrame frame = {profile.frame, 0, 0};
+  for (uint32_t slot = 0; slot < MEM_STATS_TAG_CAPACITY; slot++) {
+    if (!mem_stats_tag_used(slot)) {
+      continue;
+    }
+    const MemStatsTotals totals = mem_stats_tag_totals(slot);
+    MemProfileTag &tag = profile.tags[slot];
+    const int64_t bytes = totals.bytes;
+    const int64_t allocated_bytes = totals.allocated_bytes;
+    const int64_t allocated_blocks = totals.allocated_blocks;
+    if (bytes == tag.bytes_last && allocated_bytes == tag.allocated_bytes_last) {
+      continue;
+    }
+
+    if (!tag.named) {
+      const char *name = g_stats_tags[slot].name.load(std::memory_order_acquire);
+      profile_write_tag_name(slot, name ? name : "(unnamed)");
+      tag.named = true;
+    }
+
+    MEM_ProfileTagSample sample = {};
+    sample.tag = slot;
+    sample.bytes_in_use = bytes;
+    sample.allocated_bytes = allocated_bytes - tag.allocated_bytes_last;
+    sample.allocated_blocks = allocated_blocks - tag.allocated_blocks_last;
+    samples.push_back(sample);
+
+    frame.allocated_bytes += sample.allocated_bytes;
+    frame.allocated_blocks += sample.allocated_blocks;
+    tag.bytes_last = bytes;
+    tag.bytes_peak = std::max(tag.bytes_peak, bytes);
+    tag.allocated_bytes_last = allocated_bytes;
+    tag.allocated_blocks_last = allocated_blocks;
+  }
+  profile_note_hot_frame(frame);
+
+  if (!profile.timeline) {
+    return;
+  }
+  mem::MEM_Stats stats;
+  mem::MEM_get_stats(&stats);
+
+  const uint32_t type = MEM_PROFILE_RECORD_FRAME;
+  MEM_ProfileFrameRecord record = {};
+  record.frame = profile.frame;
+  record.time_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - profile.begin_time)
+                       .count();
+  record.bytes_in_use = (int64_t)stats.bytes_in_use;
+  record.blocks_in_use = (int64_t)stats.blocks_in_use;
+  record.allocated_bytes = frame.allocated_bytes;
+  record.allocated_blocks = frame.allocated_blocks;
+  record.tag_count = (uint32_t)samples.size();
+  profile_write(&type, sizeof(type));
+  profile_write(&record, sizeof(record));
+  profile_write(samples.data(), samples.size() * sizeof(MEM_ProfileTagSample));
+}
+
+struct MemProfileReportRow {
+  std::string name;
+  int64_t bytes = 0;
+  int64_t blocks = 0;
+  int64_t growth = 0;
+  int64_t peak = 0;
+  int64_t allocated_bytes = 0;
+  int64_t allocated_blocks = 0;
+};
+
+static void profile_print_report()
+{
+  /* The same name can be passed from several translation units, merge by content. */
+  std::vector<MemProfileReportRow> rows;
+  for (uint32_t slot = 0; slot < MEM_STATS_TAG_CAPACITY; slot++) {
+    if (!mem_stats_tag_used(slot)) {
+      continue;
+    }
+    const MemProfileTag &tag = profile.tags[slot];
+    const int64_t blocks = mem_stats_tag_totals(slot).blocks;
+    if (blocks <= 0) {
+      continue;
+    }
+    const char *name = g_stats_tags[slot].name.load(std::memory_order_acquire);
+    const std::string key = name ? name : "(unnamed)";
+    auto it = std::find_if(rows.begin(), rows.end(), [&](const MemProfileReportRow &row) {
+      return row.name == key;
+    });
+    if (it == rows.end()) {
+      rows.emplace_back();
+      it = rows.end() - 1;
+      it->name = key;
+    }
+    it->bytes += tag.bytes_last;
+    it->blocks += blocks;
+    it->growth += tag.bytes_last - tag.bytes_at_begin;
+    it->peak += tag.bytes_peak;
+    it->allocated_bytes += tag.allocated_bytes_last;
+    it->allocated_blocks += tag.allocated_blocks_last;
+  }
+  /* Rank by what each name added over the session, that is what grows memory over time. */
+  std::sort(rows.begin(),
+            rows.end(),
+            [](const MemProfileReportRow &a, const MemProfileReportRow &b) {
+              return a.growth > b.growth;
+            });
+
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                       profile.begin_time)
+                             .count();
+  fprintf(stderr,
+          "\nMemory profile: %llu frames in %.1f s, blocks still allocated at exit, largest "
+          "growth first\n",
+          (unsigned long long)profile.frame,
+          seconds);
+  fprintf(stderr,
+          " %12s %8s %12s %12s %12s %10s  %s\n",
+          "growth KiB",
+          "blocks",
+          "live KiB",
+          "peak KiB",
+          "alloc MiB",
+          "allocs",
+          "name");
+  for (const MemProfileReportRow &row : rows) {
+    fprintf(stderr,
+            " %12.2f %8lld %12.2f %12.2f %12.2f %10lld  %s\n",
+            (double)row.growth / 1024.0,
+            (long long)row.blocks,
+            (double)row.bytes / 1024.0,
+            (double)row.peak / 1024.0,
+            (double)row.allocated_bytes / (1024.0 * 1024.0),
+            (long long)row.allocated_blocks,
+            row.name.c_str());
+  }
+  if (!profile.hot_frames.empty()) {
+    fprintf(stderr, " Frames allocating the most:");
+    for (const MemProfileFrame &frame : profile.hot_frames) {
+      fprintf(stderr,
+              " #%llu (%.2f MiB, %lld blocks)",
+              (unsigned long long)frame.frame,
+              (double)frame.allocated_bytes / (1024.0 * 1024.0),
+              (long long)frame.allocated_blocks);
+    }
+    fprintf(stderr, "\n");
+  }
+  fflush(stderr);
+}
+
+}  // namespace mem_guarded::internal
+
+namespace mem {
+
+using namespace mem_guarded::internal;
+
+static bool profile_timeline_open(const char *timeline_path)
+{
+  profile.timeline = fopen(timeline_path, "wb");
+  if (!profile.timeline) {
+    fprintf(stderr, "Memory profile: cannot open \"%s\" for writing.\n", timeline_path);
+    return false;
+  }
+  MEM_ProfileFileHeader header = {};
+  memcpy(header.magic, MEM_PROFILE_MAGIC, sizeof(header.magic));
+  header.version = MEM_PROFILE_VERSION;
+  header.tag_capacity = MEM_STATS_TAG_CAPACITY;
+  profile_write(&header, sizeof(header));
+  return true;
+}
+
+bool MEM_profile_begin(const char *timeline_path)
+{
+  if (profile.active) {
+    /* Started without a timeline first, e.g. both command line flags were given. The timeline
+     * then starts at the next frame, the report still covers the whole run. */
+    if (timeline_path && !profile.timeline) {
+      if (!profile_timeline_open(timeline_path)) {
+        return false;
+      }
+      /* Names seen so far were not written anywhere. */
+      for (uint32_t slot = 0; slot < MEM_STATS_TAG_CAPACITY; slot++) {
+        profile.tags[slot].named = false;
+      }
+      return true;
+    }
+    if (timeline_path) {
+      fprintf(stderr, "Memory profile: a timeline is already being written.\n");
+      return false;
+    }
+    return true;
+  }
+
+  /* Plain calloc, the profiler's own memory should not show up in what it profiles. */
+  profile.tags = (MemProfileTag *)calloc(MEM_STATS_TAG_CAPACITY, sizeof(MemProfileTag));
+  if (!profile.tags) {
+    return false;
+  }
+  if (timeline_path && !profile_timeline_open(timeline_path)) {
+    free(profile.tags);
+    profile.tags = nullptr;
+    return false;
+  }
+
+  for (uint32_t slot = 0; slot < MEM_STATS_TAG_CAPACITY; slot++) {
+    MemProfileTag &tag = profile.tags[slot];
+    const MemStatsTotals totals = mem_stats_tag_totals(slot);
+    tag.bytes_at_begin = totals.bytes;
+    tag.bytes_last = tag.bytes_at_begin;
+    tag.bytes_peak = tag.bytes_at_begin;
+    tag.allocated_bytes_last = totals.allocated_bytes;
+    tag.allocated_blocks_last = totals.allocated_blocks;
+  }
+  profile.frame = 0;
+  profile.hot_frames.clear();
+  profile.begin_time = std::chrono::steady_clock::now();
+  profile.active = true;
+  g_stats_profiling.store(true, std::memory_order_relaxed);
+
+  static bool end_registered = false;
+  if (!end_registered) {
+    std::atexit(MEM_profile_end);
+    end_registered = true;
+  }
+  return true;
+}
+
+void MEM_profile_frame()
+{
+  if (!profile.active) {
+    return;
+  }
+  profile_sample();
+  profile.frame++;
+}
+
+bool MEM_profile_is_active()
+{
+  return profile.active;
+}
+
+void MEM_profile_end()
+{
+  if (!profile.active) {
+    return;
+  }
+  profile_sample();
+  g_stats_profiling.store(false, std::memory_order_relaxed);
+  profile.active = false;
+
+  profile_print_report();
+  if (profile.timeline) {
+    fclose(profile.timeline);
+    profile.timeline = nullptr;
+  }
+  free(profile.tags);
+  profile.tags = nullptr;
+}
+
+}  // namespace mem
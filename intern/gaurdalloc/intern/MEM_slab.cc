@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <mutex>
+
+#include "../clog/CLG_log.h"
+#include "../MEM_function_pointers.h"
+
+CLG_LOGREF_DECLARE_EXTERN(LOG_MEM);
+
+#define MEM_SLAB_CLASSES 20
+/* Bytes of free blocks a thread may cache per class, at least MEM_SLAB_CACHE_MIN blocks. */
+#define MEM_SLAB_CACHE_BYTES (16 * 1024)
+#define MEM_SLAB_CACHE_MIN 8
+
+namespace mem_guarded::internal {
+
+static constexpr std::array<size_t, MEM_SLAB_CLASSES> slab_class_sizes = {
+    16,  32,  48,  64,  80,  96,  112, 128, 160, 192,
+    224, 256, 320, 384, 448, 512, 640, 768, 896, 1024,
+};
+
+/* Free blocks are chained through their first word. */
+struct SlabBlock {
+  SlabBlock *next;
+};
+
+struct alignas(64) SlabClass {
+  std::mutex mutex;
+  SlabBlock *free_list = nullptr;
+  char *bump = nullptr;
+  char *bump_end = nullptr;
+};
+
+/* Trivially destructible on purpose, blocks freed by other thread-local destructors at thread
+ * exit must still find it. SlabThreadFlush hands the blocks back and disables the cache. */
+struct SlabThreadCache {
+  SlabBlock *blocks[MEM_SLAB_CLASSES];
+  uint32_t count[MEM_SLAB_CLASSES];
+  bool registered;
+  bool disabled;
+};
+
+struct SlabThreadFlush {
+  ~SlabThreadFlush();
+};
+
+static SlabClass slab_classes[MEM_SLAB_CLASSES];
+static std::atomic<size_t> slab_bytes_reserved{0};
+static thread_local SlabThreadCache slab_thread_cache;
+
+SlabAllocator g_slab_allocator{};
+
+static int slab_class_index(size_t size)
+{
+  if (size <= 16) {
+    return 0;
+  }
+  if (size <= 128) {
+    return (int)((size + 15) / 16) - 1;
+  }
+  /* Four classes per power of two above 128. */
+  const int log2 = (int)std::bit_width(size - 1) - 1;
+  const int step = (int)((size - 1) >> (log2 - 2)) & 3;
+  return 8 + (log2 - 7) * 4 + step;
+}
+
+static uint32_t slab_cache_limit(int index)
+{
+  return std::max<uint32_t>(MEM_SLAB_CACHE_BYTES / slab_class_sizes[index], MEM_SLAB_CACHE_MIN);
+}
+
+/* Take up to `max_count` blocks from the shared class, returns them chained. */
+static SlabBlock *slab_class_take(int index, uint32_t max_count, uint32_t *r_count)
+{
+  const size_t block_size = slab_class_sizes[index];
+  SlabClass &slab = slab_classes[index];
+  SlabBlock *first = nullptr;
+  uint32_t count = 0;
+
+  std::lock_guard<std::mutex> lock(slab.mutex);
+  while (count < max_count && slab.free_list) {
+    SlabBlock *block = slab.free_list;
+    slab.free_list = block->next;
+    block->next = first;
+    first = block;
+    count++;
+  }
+  while (count < max_count) {
+    if (slab.bump + block_size > slab.bump_end) {
+      if (count) {
+        /* Do not grow for a prefetch, only when nothing could be taken. */
+        break;
+      }
+      slab.bump = (char *)malloc(MEM_SLAB_CHUNK_SIZE);
+      if (!slab.bump) {
+        CLOG_ERROR(LOG_MEM, "SlabAllocator: failed to allocate a chunk for %zu byte blocks!",
+                   block_size);
+        slab.bump_end = nullptr;
+        break;
+      }
+      slab.bump_end = slab.bump + MEM_SLAB_CHUNK_SIZE;
+      slab_bytes_reserved.fetch_add(MEM_SLAB_CHUNK_SIZE, std::memory_order_relaxed);
+    }
+    auto *block = (SlabBlock *)slab.bump;
+    slab.bump += block_size;
+    block->next = first;
+    first = block;
+    count++;
+  }
+  *r_count = count;
+  return first;
+}
+
+/* Return `count` chained blocks to the shared class. */
+static void slab_class_give(int index, SlabBlock *first, uint32_t count)
+{
+  if (!count) {
+    return;
+  }
+  SlabBlock *last = first;
+  for (uint32_t i = 1; i < count; i++) {
+    last = last->next;
+  }
+
+  SlabClass &slab = slab_classes[index];
+  std::lock_guard<std::mutex> lock(slab.mutex);
+  last->next = slab.free_list;
+  slab.free_list = first;
+}
+
+SlabThreadFlush::~SlabThreadFlush()
+{
+  g_slab_allocator.flush_thread_cache();
+  slab_thread_cache.disabled = true;
+}
+
+static SlabThreadCache *slab_thread_cache_get()
+{
+  SlabThreadCache &cache = slab_thread_cache;
+  if (cache.disabled) {
+    return nullptr;
+  }
+  if (!cache.registered) {
+    cache.registered = true;
+    thread_local SlabThreadFlush flush;
+    (void)flush;
+  }
+  return &cache;
+}
+
+void *SlabAllocator::alloc(size_t size)
+{
+  const int index = slab_class_index(size);
+  SlabThreadCache *cache = slab_thread_cache_get();
+  if (!cache) {
+    uint32_t count;
+    return slab_class_take(index, 1, &count);
+  }
+
+  if (!cache->blocks[index]) {
+    /* Refill half of the cache so that alternating alloc/free stays lock free. */
+    cache->blocks[index] = slab_class_take(
+        index, slab_cache_limit(index) / 2, &cache->count[index]);
+    if (!cache->blocks[index]) {
+      return nullptr;
+    }
+  }
+  SlabBlock *block = cache->blocks[index];
+  cache->blocks[index] = block->next;
+  cache->count[index]--;
+  return block;
+}
+
+void SlabAllocator::free(void *ptr, size_t size)
+{
+  const int index = slab_class_index(size);
+  auto *block = (SlabBlock *)ptr;
+  SlabThreadCache *cache = slab_thread_cache_get();
+  if (!cache) {
+    block->next = nullptr;
+    slab_class_give(index, block, 1);
+    return;
+  }
+
+  block->next = cache->blocks[index];
+  cache->blocks[index] = block;
+  const uint32_t limit = slab_cache_limit(index);
+  if (++cache->count[index] > limit) {
+    /* Keep the most recently freed half, those are the likeliest to be warm. */
+    SlabBlock *keep_last = cache->blocks[index];
+    for (uint32_t i = 1; i < limit / 2; i++) {
+      keep_last = keep_last->next;
+    }
+    slab_class_give(index, keep_last->next, cache->count[index] - limit / 2);
+    keep_last->next = nullptr;
+    cache->count[index] = limit / 2;
+  }
+}
+
+void SlabAllocator::flush_thread_cache()
+{
+  SlabThreadCache &cache = slab_thread_cache;
+  for (int index = 0; index < MEM_SLAB_CLASSES; index++) {
+    slab_class_give(index, cache.blocks[index], cache.count[index]);
+    cache.blocks[index] = nullptr;
+    cache.count[index] = 0;
+  }
+}
+
+size_t SlabAllocator::bytes_reserved() const
+{
+  return slab_bytes_reserved.load(std::memory_order_relaxed);
+}
+
+}  // namespace mem_guarded::internal
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../MEM_gaurdalloc.h"
+#include "MEM_stats.hh"
+
+namespace mem_guarded::internal {
+
+MemStatsShard g_stats_shards[MEM_STATS_SHARDS];
+MemStatsTag g_stats_tags[MEM_STATS_TAG_CAPACITY];
+std::atomic<bool> g_stats_profiling{false};
+
+static std::atomic<uint32_t> g_stats_next_shard{0};
+static std::atomic<int64_t> g_stats_peak{0};
+
+MemStatsThread::MemStatsThread()
+    : shard(&g_stats_shards[g_stats_next_shard.fetch_add(1, std::memory_order_relaxed) %
+                            MEM_STATS_SHARDS])
+{
+}
+
+uint32_t mem_stats_tag_insert(const char *name)
+{
+  if (!name) {
+    return 0;
+  }
+  /* Slot 0 collects unnamed allocations and overflow. */
+  const uintptr_t hash = ((uintptr_t)name >> 3) * 0x9E3779B97F4A7C15ull;
+  for (uint32_t probe = 0; probe < MEM_STATS_TAG_CAPACITY; probe++) {
+    const uint32_t slot = (uint32_t)(hash + probe) & (MEM_STATS_TAG_CAPACITY - 1);
+    if (slot == 0) {
+      continue;
+    }
+    const char *current = g_stats_tags[slot].name.load(std::memory_order_acquire);
+    if (current == nullptr &&
+        g_stats_tags[slot].name.compare_exchange_strong(current, name, std::memory_order_acq_rel))
+    {
+      return slot;
+    }
+    if (current == name) {
+      return slot;
+    }
+  }
+  return 0;
+}
+
+int64_t mem_stats_bytes_in_use()
+{
+  int64_t bytes = 0;
+  for (const MemStatsShard &shard : g_stats_shards) {
+    bytes += shard.bytes.load(std::memory_order_relaxed);
+  }
+  return bytes;
+}
+
+MemStatsTotals mem_stats_tag_totals(uint32_t tag)
+{
+  MemStatsTotals totals = {0, 0, 0, 0};
+  for (const MemStatsShard &shard : g_stats_shards) {
+    const MemStatsCounters &counters = shard.tags[tag];
+    totals.bytes += counters.bytes.load(std::memory_order_relaxed);
+    totals.blocks += counters.blocks.load(std::memory_order_relaxed);
+    totals.allocated_bytes += counters.allocated_bytes.load(std::memory_order_relaxed);
+    totals.allocated_blocks += counters.allocated_blocks.load(std::memory_order_relaxed);
+  }
+  return totals;
+}
+
+static int64_t mem_stats_blocks_in_use()
+{
+  int64_t blocks = 0;
+  for (const MemStatsShard &shard : g_stats_shards) {
+    blocks += shard.blocks.load(std::memory_order_relaxed);
+  }
+  return blocks;
+}
+
+static int64_t mem_stats_raise_peak(int64_t bytes)
+{
+  int64_t peak = g_stats_peak.load(std::memory_order_relaxed);
+  while (bytes > peak &&
+         !g_stats_peak.compare_exchange_weak(peak, bytes, std::memory_order_relaxed))
+  {
+  }
+  return std::max(peak, bytes);
+}
+
+void mem_stats_sample_peak()
+{
+  mem_stats_raise_peak(mem_stats_bytes_in_use());
+}
+
+}  // namespace mem_guarded::internal
+
+namespace mem {
+
+using namespace mem_guarded::internal;
+
+void MEM_get_stats(MEM_Stats *r_stats)
+{
+  /* Shards are read one after another, a concurrent free may be seen before its malloc. */
+  const int64_t bytes = std::max<int64_t>(mem_stats_bytes_in_use(), 0);
+  r_stats->bytes_in_use = (size_t)bytes;
+  r_stats->blocks_in_use = (size_t)std::max<int64_t>(mem_stats_blocks_in_use(), 0);
+  r_stats->peak_bytes = (size_t)mem_stats_raise_peak(bytes);
+}
+
+void MEM_foreach_tag_stats(void (*fn)(const MEM_TagStats *tag, void *user_data),
+                           void *user_data)
+{
+  for (uint32_t slot = 0; slot < MEM_STATS_TAG_CAPACITY; slot++) {
+    if (!mem_stats_tag_used(slot)) {
+      continue;
+    }
+    const MemStatsTotals totals = mem_stats_tag_totals(slot);
+    if (totals.blocks <= 0) {
+      continue;
+    }
+    const char *name = g_stats_tags[slot].name.load(std::memory_order_acquire);
+    MEM_TagStats tag;
+    tag.name = name ? name : "(unnamed)";
+    tag.bytes_in_use = (size_t)std::max<int64_t>(totals.bytes, 0);
+    tag.blocks_in_use = (size_t)totals.blocks;
+    fn(&tag, user_data);
+  }
+}
+
+void MEM_print_stats()
+{
+  MEM_Stats stats;
+  MEM_get_stats(&stats);
+
+  /* The same name can be passed from several translation units, merge by content. */
+  std::vector<MEM_TagStats> tags;
+  MEM_foreach_tag_stats(
+      [](const MEM_TagStats *tag, void *user_data) {
+        auto &tags = *static_cast<std::vector<MEM_TagStats> *>(user_data);
+        for (MEM_TagStats &existing : tags) {
+          if (std::strcmp(existing.name, tag->name) == 0) {
+            existing.bytes_in_use += tag->bytes_in_use;
+            existing.blocks_in_use += tag->blocks_in_use;
+            return;
+          }
+        }
+        tags.push_back(*tag);
+      },
+      &tags);
+  std::sort(tags.begin(), tags.end(), [](const MEM_TagStats &a, const MEM_TagStats &b) {
+    return a.bytes_in_use > b.bytes_in_use;
+  });
+
+  printf("\nMemory statistics: %.3f MiB in %zu blocks, peak %.3f MiB\n",
+         (double)stats.bytes_in_use / (1024.0 * 1024.0),
+         stats.blocks_in_use,
+         (double)stats.peak_bytes / (1024.0 * 1024.0));
+  printf(" %12s %8s  %s\n", "KiB", "blocks", "name");
+  for (const MEM_TagStats &tag : tags) {
+    printf(" %12.2f %8zu  %s\n",
+           (double)tag.bytes_in_use / 1024.0,
+           tag.blocks_in_use,
+           tag.name);
+  }
+  fflush(stdout);
+}
+
+}  // namespace mem
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Allocator Statistics
+ *
+ * Live bytes and blocks are kept in shards, each thread updating the shard it was assigned on
+ * first use, and summed when read. Tags are slots of a fixed open addressing table of names
+ * keyed by the `allocation_name` pointer; the slot is stored in the MemHead so that free and
+ * realloc never look it up again. Every shard has its own counters for every tag, so threads
+ * of different shards never write to the same cache line.
+ *
+ * The peak is sampled from the exact total each time a thread has allocated another
+ * #MEM_STATS_PEAK_GRANULE bytes, so it may under-report by up to one granule per thread.
+ * Reading the statistics folds the current total into the peak as well.
+ *
+ * The hot path is four relaxed atomic adds to the shard of the thread, uncontended unless more
+ * than #MEM_STATS_SHARDS threads allocate, plus a thread-local cache probe on allocation. The
+ * allocation profiler adds two more per allocation while it runs. Reads sum every shard.
+ */
+
+/**
+ * Number of counter shards, threads beyond this share shards. A shard takes 128 KiB of zero
+ * pages, which are only touched for the tags its threads use.
+ */
+#define MEM_STATS_SHARDS 16
+/** Tag table size, must be a power of two. Tags beyond it are counted in slot 0. */
+#define MEM_STATS_TAG_CAPACITY 4096
+/** Bytes a thread allocates between two samples of the peak. */
+#define MEM_STATS_PEAK_GRANULE (64 * 1024)
+/** Thread-local tag lookup cache size, must be a power of two. */
+#define MEM_STATS_TAG_CACHE 64
+
+namespace mem_guarded::internal {
+
+/** Counters of one tag in one shard. */
+struct MemStatsCounters {
+  std::atomic<int64_t> bytes{0};
+  std::atomic<int64_t> blocks{0};
+  /* Totals ever allocated, only counted while the profiler runs, see MEM_profile.cc. */
+  std::atomic<int64_t> allocated_bytes{0};
+  std::atomic<int64_t> allocated_blocks{0};
+};
+
+struct alignas(64) MemStatsShard {
+  std::atomic<int64_t> bytes{0};
+  std::atomic<int64_t> blocks{0};
+  alignas(64) MemStatsCounters tags[MEM_STATS_TAG_CAPACITY];
+};
+
+/** Written once when a tag is first used, read-mostly after that. */
+struct MemStatsTag {
+  std::atomic<const char *> name{nullptr};
+};
+
+/** A tag summed over the shards, see #mem_stats_tag_totals. */
+struct MemStatsTotals {
+  int64_t bytes;
+  int64_t blocks;
+  int64_t allocated_bytes;
+  int64_t allocated_blocks;
+};
+
+extern MemStatsShard g_stats_shards[MEM_STATS_SHARDS];
+extern MemStatsTag g_stats_tags[MEM_STATS_TAG_CAPACITY];
+extern std::atomic<bool> g_stats_profiling;
+
+/* Trivially destructible on purpose, allocations made by other thread-local destructors at
+ * thread exit must still find it. */
+struct MemStatsThread {
+  MemStatsShard *shard;
+  int64_t allocated_since_peak = 0;
+  struct {
+    const char *name = nullptr;
+    uint32_t tag = 0;
+  } tag_cache[MEM_STATS_TAG_CACHE];
+
+  MemStatsThread();
+};
+
+/** Slot of `name` in #g_stats_tags, inserting it when new. */
+uint32_t mem_stats_tag_insert(const char *name);
+
+/** Raise the peak to the current total. */
+void mem_stats_sample_peak();
+
+inline MemStatsThread &mem_stats_thread()
+{
+  thread_local MemStatsThread thread;
+  return thread;
+}
+
+inline uint32_t mem_stats_tag(const char *name)
+{
+  MemStatsThread &thread = mem_stats_thread();
+  auto &entry = thread.tag_cache[((uintptr_t)name >> 3) & (MEM_STATS_TAG_CACHE - 1)];
+  if (entry.name != name) {
+    entry.tag = mem_stats_tag_insert(name);
+    entry.name = name;
+  }
+  return entry.tag;
+}
+
+inline void mem_stats_add(uint32_t tag, int64_t bytes, int64_t blocks)
+{
+  MemStatsThread &thread = mem_stats_thread();
+  MemStatsCounters &counters = thread.shard->tags[tag];
+  thread.shard->bytes.fetch_add(bytes, std::memory_order_relaxed);
+  thread.shard->blocks.fetch_add(blocks, std::memory_order_relaxed);
+  counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  counters.blocks.fetch_add(blocks, std::memory_order_relaxed);
+
+  if (bytes > 0 && g_stats_profiling.load(std::memory_order_relaxed)) {
+    counters.allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    counters.allocated_blocks.fetch_add(std::max<int64_t>(blocks, 0), std::memory_order_relaxed);
+  }
+
+  if (bytes > 0 && (thread.allocated_since_peak += bytes) >= MEM_STATS_PEAK_GRANULE) {
+    thread.allocated_since_peak = 0;
+    mem_stats_sample_peak();
+  }
+}
+
+/** Live bytes summed over the shards, exact when no other thread is allocating. */
+int64_t mem_stats_bytes_in_use();
+
+/** True for slots that were handed out, the others are always zero. Slot 0 always is. */
+inline bool mem_stats_tag_used(uint32_t tag)
+{
+  return tag == 0 || g_stats_tags[tag].name.load(std::memory_order_acquire) != nullptr;
+}
+
+/** Counters of `tag` summed over the shards, with the same caveat as #mem_stats_bytes_in_use. */
+MemStatsTotals mem_stats_tag_totals(uint32_t tag);
+
+}  // namespace mem_guarded::internal
@@ -3,25 +3,54 @@
 #include <QItemSelection>
 #include <QMenu>
 #include <QMouseEvent>
+#include <QSortFilterProxyModel>
 #include <QStandardItem>
+#include <QThreadPool>
 #include <QTimer>
 #include <QWidget>
 #include <entt/entt.hpp>
 
+#include <atomic>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "../../../../source/runtime/dna/DNA_object_type.h"
+#include "../../../../source/runtime/kernel/ecs/ECS_selection.h"
 
 class QTreeView;
 class QStandardItemModel;
-class QSortFilterProxyModel;
 class QLineEdit;
 
 namespace qt::dock {
+
+/**
+ * Filters object rows by a set of entities produced by the name index, instead of matching
+ * every row's text on the GUI thread. Parent rows stay visible through recursive filtering.
+ */
+class OutlinerFilterProxy : public QSortFilterProxyModel {
+ public:
+  explicit OutlinerFilterProxy(QObject *parent = nullptr);
+
+  /**
+   * Show only rows of `entities`, or every row when `entities` is null. Refiltering walks every
+   * row, so a result equal to the current one is dropped.
+   */
+  void set_visible_entities(std::unique_ptr<std::unordered_set<uint32_t>> entities);
+
+ protected:
+  bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override;
+
+ private:
+  std::unique_ptr<std::unordered_set<uint32_t>> visible_entities_;
+};
+
 class OutlinerPanel : public QWidget {
   Q_OBJECT
  public:
   explicit OutlinerPanel(QWidget *parent = nullptr);
+  ~OutlinerPanel() override;
 
  private slots:
   void refresh_entities();
@@ -29,6 +58,7 @@ class OutlinerPanel : public QWidget {
   void apply_filter();
 
   void show_context_menu(const QPoint &pos);
+  void on_item_changed(QStandardItem *item);
   void on_selection_changed(const QItemSelection &selected, const QItemSelection &deselected);
 
  private:
@@ -37,6 +67,7 @@ class OutlinerPanel : public QWidget {
   void rebuild_tree();
   void sync_selection_from_scene();
   void sync_selection_to_scene(const QItemSelection &selected, const QItemSelection &deselected);
+  void on_scene_selection_changed(const vektor::kernel::SelectionDelta &delta);
 
   QList<QStandardItem *> create_object_item(entt::entity entity,
                                            const vektor::dna::Object &obj);
@@ -44,18 +75,34 @@ class OutlinerPanel : public QWidget {
   void build_object_context_menu(QMenu &menu, entt::entity entity);
   static void build_add_menu(QMenu &menu);
 
+  void cancel_search();
+  void on_search_finished(uint64_t generation, std::vector<entt::entity> hits);
+  /** Expand the parent rows of `entities`, up to a fixed number of them. */
+  void expand_to_entities(const std::vector<entt::entity> &entities);
+
  protected:
   bool eventFilter(QObject *watched, QEvent *event) override;
 
  private:
   QTreeView *tree_view_ = nullptr;
   QStandardItemModel *model_ = nullptr;
-  QSortFilterProxyModel *proxy_model_ = nullptr;
+  OutlinerFilterProxy *proxy_model_ = nullptr;
   QLineEdit *search_bar_ = nullptr;
   QTimer *filter_timer_ = nullptr;
   QTimer *refresh_timer_ = nullptr;
   bool is_refreshing_ = false;
 
+  /* Guards against echoing a selection change back to where it came from. */
+  uint32_t selection_listener_ = 0;
+  bool is_pushing_selection_ = false;
+  bool is_applying_selection_ = false;
+
+  /* Name queries run here so typing never waits on a search. Single thread: a new query always
+   * cancels the previous one first. */
+  QThreadPool search_pool_;
+  std::shared_ptr<std::atomic<bool>> search_cancel_;
+  uint64_t search_generation_ = 0;
+
   std::unordered_map<entt::entity, QStandardItem *> entity_to_item_;
 };
 }  // namespace qt::dock
@@ -1,9 +1,12 @@
+#include <algorithm>
+#include <chrono>
+
 #include <QAbstractItemView>
 #include <QAction>
 #include <QHeaderView>
 #include <QLineEdit>
 #include <QMenu>
-#include <QSortFilterProxyModel>
+#include <QMetaObject>
 #include <QStandardItemModel>
 #include <QTimer>
 #include <QTreeView>
@@ -14,6 +17,7 @@
 
 #include "../../../../../intern/clog/CLG_log.h"
 #include "../../../../../source/runtime/dna/DNA_object_type.h"
+#include "../../../../../source/runtime/lib/VLI_profile.h"
 #include "../../../../source/runtime/kernel/ecs/ECS_registry.h"
 #include "../../../../source/runtime/rna/RNA_ecs_registry.h"
 
@@ -21,10 +25,43 @@ namespace qt::dock {
 
 CLG_LOGREF_DECLARE_GLOBAL(LOG_OUTLINER, "outliner");
 
+/* Hits whose parent rows get expanded, a broad query leaves the rest as they are. */
+#define OUTLINER_EXPAND_LIMIT 1024
+/* Applying a search result runs on the GUI thread and should fit in one frame. */
+#define OUTLINER_APPLY_BUDGET_MS 16.0
+
 using namespace vektor::dna;
 
+OutlinerFilterProxy::OutlinerFilterProxy(QObject *parent) : QSortFilterProxyModel(parent)
+{
+  setRecursiveFilteringEnabled(true);
+}
+
+void OutlinerFilterProxy::set_visible_entities(
+    std::unique_ptr<std::unordered_set<uint32_t>> entities)
+{
+  const bool unchanged = entities && visible_entities_ ? *entities == *visible_entities_ :
+                                                         entities == visible_entities_;
+  if (unchanged) {
+    return;
+  }
+  visible_entities_ = std::move(entities);
+  invalidateRowsFilter();
+}
+
+bool OutlinerFilterProxy::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
+{
+  if (!visible_entities_) {
+    return true;
+  }
+  const QVariant data = sourceModel()->index(source_row, 0, source_parent).data(Qt::UserRole);
+  return data.isValid() && visible_entities_->count(data.toUInt());
+}
+
 OutlinerPanel::OutlinerPanel(QWidget *parent) : QWidget(parent)
 {
+  search_pool_.setMaxThreadCount(1);
+
   build_ui();
   build_model();
 
@@ -35,6 +72,9 @@ OutlinerPanel::OutlinerPanel(QWidget *parent) : QWidget(parent)
 
   connect(search_bar_, &QLineEdit::textChanged, this, &OutlinerPanel::on_search_text_changed);
 
+  /* Renaming edits the name item in place, see on_item_changed(). */
+  connect(model_, &QStandardItemModel::itemChanged, this, &OutlinerPanel::on_item_changed);
+
   filter_timer_ = new QTimer(this);
   filter_timer_->setSingleShot(true);
   connect(filter_timer_, &QTimer::timeout, this, &OutlinerPanel::apply_filter);
@@ -53,9 +93,19 @@ OutlinerPanel::OutlinerPanel(QWidget *parent) : QWidget(parent)
           this,
           [this]() { refresh_timer_->start(10); });
 
+  selection_listener_ = vektor::kernel::ECSRegistry::instance().selection().add_listener(
+      [this](const vektor::kernel::SelectionDelta &delta) { on_scene_selection_changed(delta); });
+
   refresh_entities();
 }
 
+OutlinerPanel::~OutlinerPanel()
+{
+  vektor::kernel::ECSRegistry::instance().selection().remove_listener(selection_listener_);
+  cancel_search();
+  search_pool_.waitForDone();
+}
+
 void OutlinerPanel::build_ui()
 {
   auto *layout = new QVBoxLayout(this);
@@ -71,7 +121,8 @@ void OutlinerPanel::build_ui()
   tree_view_->setUniformRowHeights(true);
   tree_view_->setIndentation(12);
   tree_view_->setSelectionMode(QAbstractItemView::ExtendedSelection);
-  tree_view_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  tree_view_->setEditTriggers(QAbstractItemView::DoubleClicked |
+                              QAbstractItemView::EditKeyPressed);
   tree_view_->setAlternatingRowColors(true);
   tree_view_->setAnimated(true);
 
@@ -96,10 +147,8 @@ void OutlinerPanel::build_model()
   model_ = new QStandardItemModel(this);
   model_->setHorizontalHeaderLabels({"Scene Hierarchy", ""});
 
-  proxy_model_ = new QSortFilterProxyModel(this);
+  proxy_model_ = new OutlinerFilterProxy(this);
   proxy_model_->setSourceModel(model_);
-  proxy_model_->setFilterCaseSensitivity(Qt::CaseInsensitive);
-  proxy_model_->setFilterKeyColumn(0);
 
   tree_view_->setModel(proxy_model_);
   tree_view_->setColumnWidth(0, 200);
@@ -116,10 +165,12 @@ void OutlinerPanel::refresh_entities()
 
   // Level 1: Scene Collection
   auto *root_item = new QStandardItem("Scene Collection");
+  root_item->setEditable(false);
   model_->appendRow({root_item, new QStandardItem("")});
 
   // Level 2: Collection
   auto *collection_item = new QStandardItem("Collection");
+  collection_item->setEditable(false);
   collection_item->setData(QString("📦"), Qt::DecorationRole);
   root_item->appendRow({collection_item, new QStandardItem("")});
 
@@ -132,10 +183,17 @@ void OutlinerPanel::refresh_entities()
     collection_item->appendRow(create_object_item(entity, obj));
   }
 
-  tree_view_->expandAll();
+  /* Only the collections, expandAll() would walk every object row. */
+  tree_view_->expand(proxy_model_->mapFromSource(root_item->index()));
+  tree_view_->expand(proxy_model_->mapFromSource(collection_item->index()));
   sync_selection_from_scene();
 
   is_refreshing_ = false;
+
+  /* New or renamed objects may change the matches of an active search. */
+  if (!search_bar_->text().isEmpty()) {
+    apply_filter();
+  }
   CLOG_INFO(LOG_OUTLINER, "Refresh complete.");
 }
 
@@ -169,6 +227,7 @@ QList<QStandardItem *> OutlinerPanel::create_object_item(entt::entity entity,
   name_item->setData((uint32_t)entity, Qt::UserRole);
 
   auto *visibility_item = new QStandardItem("👁️");
+  visibility_item->setEditable(false);
   visibility_item->setTextAlignment(Qt::AlignCenter);
   visibility_item->setData((uint32_t)entity, Qt::UserRole);
 
@@ -181,66 +240,120 @@ void OutlinerPanel::rebuild_tree()
   refresh_entities();
 }
 
+void OutlinerPanel::on_item_changed(QStandardItem *item)
+{
+  if (is_refreshing_ || item->column() != 0 || !item->data(Qt::UserRole).isValid()) {
+    return;
+  }
+  const auto entity = (entt::entity)item->data(Qt::UserRole).toUInt();
+  auto &registry = vektor::kernel::ECSRegistry::instance();
+  if (!registry.has_component<vektor::dna::Object>(entity)) {
+    return;
+  }
+
+  const QByteArray name = item->text().trimmed().toUtf8();
+  const char *old_name = registry.get_component<vektor::dna::Object>(entity).id.name;
+  if (name.isEmpty() || name == old_name) {
+    /* Put the current name back, e.g. after clearing the field. The scene refresh that follows
+     * a rename rebuilds the row anyway. */
+    if (item->text() != QString::fromUtf8(old_name)) {
+      is_refreshing_ = true;
+      item->setText(QString::fromUtf8(old_name));
+      is_refreshing_ = false;
+    }
+    return;
+  }
+  vektor::kernel::rename_entity(entity, name.constData());
+}
+
 void OutlinerPanel::on_selection_changed(const QItemSelection &selected,
                                           const QItemSelection &deselected)
 {
-  if (is_refreshing_) {
+  if (is_refreshing_ || is_applying_selection_) {
     return;
   }
   sync_selection_to_scene(selected, deselected);
-  outliner_notify_scene_changed();
 }
 
-void OutlinerPanel::sync_selection_to_scene(const QItemSelection &selected,
-                                             const QItemSelection &deselected)
+static entt::entity index_entity(const QModelIndex &src)
 {
-  auto &registry = vektor::kernel::ECSRegistry::instance();
+  const QVariant data = src.data(Qt::UserRole);
+  return data.isValid() ? (entt::entity)data.toUInt() : entt::null;
+}
 
-  for (const auto &idx : deselected.indexes()) {
-    if (idx.column() != 0)
-      continue;
-    QModelIndex src = proxy_model_->mapToSource(idx);
-    auto *item = model_->itemFromIndex(src);
-    if (item && item->data(Qt::UserRole).isValid()) {
-      auto entity = (entt::entity)item->data(Qt::UserRole).toUInt();
-      vektor::rna::RNA_ecs_set_selected(&registry, entity, false);
+void OutlinerPanel::sync_selection_to_scene(const QItemSelection &selected,
+                                             const QItemSelection &)
+{
+  auto &selection = vektor::kernel::ECSRegistry::instance().selection();
+
+  /* The selection model already holds the full result, push it as one delta. */
+  std::vector<entt::entity> entities;
+  for (const auto &idx : tree_view_->selectionModel()->selectedRows(0)) {
+    const entt::entity entity = index_entity(proxy_model_->mapToSource(idx));
+    if (entity != entt::null) {
+      entities.push_back(entity);
     }
   }
 
+  entt::entity active = selection.active();
   for (const auto &idx : selected.indexes()) {
-    if (idx.column() != 0)
-      continue;
-    QModelIndex src = proxy_model_->mapToSource(idx);
-    auto *item = model_->itemFromIndex(src);
-    if (item && item->data(Qt::UserRole).isValid()) {
-      auto entity = (entt::entity)item->data(Qt::UserRole).toUInt();
-      vektor::rna::RNA_ecs_set_selected(&registry, entity, true);
-      vektor::rna::RNA_ecs_set_active(&registry, entity, true);
+    const entt::entity entity = index_entity(proxy_model_->mapToSource(idx));
+    if (idx.column() == 0 && entity != entt::null) {
+      active = entity;
     }
   }
+  if (std::find(entities.begin(), entities.end(), active) == entities.end()) {
+    active = entt::null;
+  }
+
+  is_pushing_selection_ = true;
+  selection.assign(entities, active);
+  is_pushing_selection_ = false;
 }
 
-void OutlinerPanel::sync_selection_from_scene()
+void OutlinerPanel::on_scene_selection_changed(const vektor::kernel::SelectionDelta &delta)
 {
-  auto &registry = vektor::kernel::ECSRegistry::instance();
-  auto &reg = registry.registry();
-  auto view = reg.view<vektor::dna::Object>();
+  if (is_pushing_selection_) {
+    return;
+  }
 
-  QItemSelection selection;
-  for (auto entity : view) {
-    if (vektor::rna::RNA_ecs_is_selected(&registry, entity)) {
+  QItemSelection selected, deselected;
+  auto add_rows = [this](QItemSelection &rows, const std::vector<entt::entity> &entities) {
+    for (const entt::entity entity : entities) {
       auto it = entity_to_item_.find(entity);
       if (it != entity_to_item_.end()) {
-        QModelIndex src = model_->indexFromItem(it->second);
-        QModelIndex proxy = proxy_model_->mapFromSource(src);
-        selection.select(proxy, proxy);
+        QModelIndex proxy = proxy_model_->mapFromSource(model_->indexFromItem(it->second));
+        rows.select(proxy, proxy);
       }
     }
+  };
+  add_rows(selected, delta.selected);
+  add_rows(deselected, delta.deselected);
+
+  is_applying_selection_ = true;
+  auto *selection_model = tree_view_->selectionModel();
+  selection_model->select(deselected, QItemSelectionModel::Deselect | QItemSelectionModel::Rows);
+  selection_model->select(selected, QItemSelectionModel::Select | QItemSelectionModel::Rows);
+  is_applying_selection_ = false;
+}
+
+void OutlinerPanel::sync_selection_from_scene()
+{
+  auto &selection = vektor::kernel::ECSRegistry::instance().selection();
+
+  QItemSelection rows;
+  for (const entt::entity entity : selection.selected()) {
+    auto it = entity_to_item_.find(entity);
+    if (it != entity_to_item_.end()) {
+      QModelIndex src = model_->indexFromItem(it->second);
+      QModelIndex proxy = proxy_model_->mapFromSource(src);
+      rows.select(proxy, proxy);
+    }
   }
 
-  if (!selection.isEmpty()) {
+  if (!rows.isEmpty()) {
     tree_view_->selectionModel()->select(
-        selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+        rows, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
   }
   else {
     tree_view_->selectionModel()->clearSelection();
@@ -268,15 +381,42 @@ void OutlinerPanel::show_context_menu(const QPoint &pos)
 
 void OutlinerPanel::build_object_context_menu(QMenu &menu, entt::entity entity)
 {
+  QAction *rename = menu.addAction("Rename");
+  connect(rename, &QAction::triggered, [this, entity]() {
+    auto it = entity_to_item_.find(entity);
+    if (it != entity_to_item_.end()) {
+      tree_view_->edit(proxy_model_->mapFromSource(model_->indexFromItem(it->second)));
+    }
+  });
+
   QAction *select = menu.addAction("Select");
-  connect(select, &QAction::triggered, [this, entity]() {
+  connect(select, &QAction::triggered, [entity]() {
     auto &registry = vektor::kernel::ECSRegistry::instance();
     vektor::rna::RNA_ecs_set_selected(&registry, entity, true);
-    // Selection will be synced via scene notifier if it triggers, 
-    // but for immediate feedback we can call sync_selection_from_scene.
-    sync_selection_from_scene();
   });
 
+  auto &registry = vektor::kernel::ECSRegistry::instance();
+  const entt::entity active = vektor::rna::RNA_ecs_get_active(&registry);
+  if (active != entt::null && active != entity) {
+    QAction *parent = menu.addAction("Parent to Active");
+    connect(parent, &QAction::triggered, [entity, active]() {
+      auto &registry = vektor::kernel::ECSRegistry::instance();
+      if (!vektor::rna::RNA_ecs_set_parent(&registry, entity, active)) {
+        CLOG_WARN(LOG_OUTLINER, "Cannot parent an object to one of its children");
+        return;
+      }
+      outliner_notify_scene_changed();
+    });
+  }
+  if (vektor::rna::RNA_ecs_get_parent(&registry, entity) != entt::null) {
+    QAction *clear_parent = menu.addAction("Clear Parent");
+    connect(clear_parent, &QAction::triggered, [entity]() {
+      auto &registry = vektor::kernel::ECSRegistry::instance();
+      vektor::rna::RNA_ecs_set_parent(&registry, entity, entt::null);
+      outliner_notify_scene_changed();
+    });
+  }
+
   QAction *delete_obj = menu.addAction("Delete");
   connect(delete_obj, &QAction::triggered, [entity]() {
     auto &registry = vektor::kernel::ECSRegistry::instance();
@@ -352,9 +492,90 @@ void OutlinerPanel::on_search_text_changed(const QString &)
   filter_timer_->start(200);  // 200ms debounce
 }
 
+void OutlinerPanel::cancel_search()
+{
+  if (search_cancel_) {
+    search_cancel_->store(true, std::memory_order_relaxed);
+    search_cancel_.reset();
+  }
+}
+
 void OutlinerPanel::apply_filter()
 {
-  proxy_model_->setFilterFixedString(search_bar_->text());
+  cancel_search();
+  const uint64_t generation = ++search_generation_;
+
+  const std::string text = search_bar_->text().toStdString();
+  if (text.empty()) {
+    proxy_model_->set_visible_entities(nullptr);
+    return;
+  }
+
+  /* The query runs against the name index on the search thread; a newer keystroke raises the
+   * cancel flag and its stale result is dropped by the generation check. */
+  auto cancel = std::make_shared<std::atomic<bool>>(false);
+  search_cancel_ = cancel;
+
+  search_pool_.start([this, text, cancel, generation]() {
+    std::vector<entt::entity> hits;
+    if (!vektor::kernel::ECSRegistry::instance().name_index().query(text, hits, cancel.get())) {
+      return;
+    }
+    QMetaObject::invokeMethod(
+        this,
+        [this, generation, hits = std::move(hits)]() mutable {
+          on_search_finished(generation, std::move(hits));
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void OutlinerPanel::on_search_finished(uint64_t generation, std::vector<entt::entity> hits)
+{
+  if (generation != search_generation_) {
+    return;
+  }
+  search_cancel_.reset();
+
+  VK_PROFILE_SCOPE("outliner_apply_search");
+  const auto start = std::chrono::steady_clock::now();
+
+  auto visible = std::make_unique<std::unordered_set<uint32_t>>();
+  visible->reserve(hits.size());
+  for (const entt::entity entity : hits) {
+    visible->insert((uint32_t)entity);
+  }
+  proxy_model_->set_visible_entities(std::move(visible));
+  expand_to_entities(hits);
+
+  const double ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  if (ms > OUTLINER_APPLY_BUDGET_MS) {
+    CLOG_WARN(LOG_OUTLINER,
+              "Applying %zu search hits took %.1f ms, over the %.1f ms frame budget",
+              hits.size(),
+              ms,
+              OUTLINER_APPLY_BUDGET_MS);
+  }
+}
+
+void OutlinerPanel::expand_to_entities(const std::vector<entt::entity> &entities)
+{
+  /* Walk up from each hit until a row that is already open, so rows shared by many hits, like
+   * the collections, are expanded once. */
+  std::unordered_set<QStandardItem *> opened;
+  const size_t count = std::min<size_t>(entities.size(), OUTLINER_EXPAND_LIMIT);
+  for (size_t i = 0; i < count; i++) {
+    auto it = entity_to_item_.find(entities[i]);
+    if (it == entity_to_item_.end()) {
+      continue;
+    }
+    for (QStandardItem *parent = it->second->parent(); parent && opened.insert(parent).second;
+         parent = parent->parent())
+    {
+      tree_view_->expand(proxy_model_->mapFromSource(parent->index()));
+    }
+  }
 }
 
 }  // namespace qt::dock
@@ -1,22 +1,24 @@
 #include "PRP_transform.hh"
 #include "../../scene/SCN_notifier.h"
+#include "../../../../../source/runtime/kernel/ecs/ECS_registry.h"
 #include <QtMath>
 
 namespace qt::dock {
-TransformPanel::TransformPanel(vektor::dna::Object *ob, QWidget *parent)
-    : PropertySubPanel("Transform", ob, parent)
+TransformPanel::TransformPanel(entt::entity entity, vektor::dna::Object *ob, QWidget *parent)
+    : PropertySubPanel("Transform", ob, parent), entity_(entity)
 {
   create_spin_box_row(0, "Position", loc_x_, loc_y_, loc_z_, 0.1);
   create_spin_box_row(1, "Rotation", rot_x_, rot_y_, rot_z_, 1.0);
   create_spin_box_row(2, "Scale", scale_x_, scale_y_, scale_z_, 0.01);
 
   auto update_object = [this]() {
-    object_->transform.location = {loc_x_->value(), loc_y_->value(), loc_z_->value()};
-    object_->transform.rotation = {
-        (float)qDegreesToRadians(rot_x_->value()),
-        (float)qDegreesToRadians(rot_y_->value()),
-        (float)qDegreesToRadians(rot_z_->value())};
-    object_->transform.scale = {scale_x_->value(), scale_y_->value(), scale_z_->value()};
+    vektor::dna::Transform transform;
+    transform.location = {loc_x_->value(), loc_y_->value(), loc_z_->value()};
+    transform.rotation = {(float)qDegreesToRadians(rot_x_->value()),
+                          (float)qDegreesToRadians(rot_y_->value()),
+                          (float)qDegreesToRadians(rot_z_->value())};
+    transform.scale = {scale_x_->value(), scale_y_->value(), scale_z_->value()};
+    vektor::kernel::set_entity_transform(entity_, transform);
 
     // Notify scene changed
     qt::scene::SCN_notifier::instance()->notifySceneChanged();
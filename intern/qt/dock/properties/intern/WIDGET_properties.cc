@@ -41,20 +41,28 @@ PropertiesPanel::PropertiesPanel(QWidget *parent) : QWidget(parent)
           &qt::scene::SCN_notifier::sceneChanged,
           this,
           &PropertiesPanel::on_selection_changed);
+
+  selection_listener_ = vektor::kernel::ECSRegistry::instance().selection().add_listener(
+      [this](const vektor::kernel::SelectionDelta &delta) {
+        if (delta.active_changed()) {
+          on_selection_changed();
+        }
+      });
+}
+
+PropertiesPanel::~PropertiesPanel()
+{
+  vektor::kernel::ECSRegistry::instance().selection().remove_listener(selection_listener_);
 }
 
 void PropertiesPanel::on_selection_changed()
 {
-  auto &registry = vektor::kernel::ECSRegistry::instance().registry();
-  auto view = registry.view<vektor::dna::Object, vektor::dna::Active>();
+  auto &registry = vektor::kernel::ECSRegistry::instance();
+  const entt::entity active = registry.selection().active();
 
   selected_object_ = nullptr;
-  for (auto entity : view) {
-    const auto &active = view.get<vektor::dna::Active>(entity);
-    if (active.active) {
-      selected_object_ = &view.get<vektor::dna::Object>(entity);
-      break;
-    }
+  if (active != entt::null) {
+    selected_object_ = registry.registry().try_get<vektor::dna::Object>(active);
   }
 
   QLayoutItem *item;
@@ -73,7 +81,7 @@ void PropertiesPanel::on_selection_changed()
     return;
   }
 
-  sub_panel_layout_->addWidget(new TransformPanel(selected_object_, container_widget_));
+  sub_panel_layout_->addWidget(new TransformPanel(active, selected_object_, container_widget_));
 
   if (selected_object_->type == vektor::dna::ObjectType::Light) {
     sub_panel_layout_->addWidget(new LightPanel(selected_object_, container_widget_));
@@ -10,12 +10,14 @@ class PropertiesPanel : public QWidget {
   Q_OBJECT
  public:
   explicit PropertiesPanel(QWidget *parent = nullptr);
+  ~PropertiesPanel() override;
 
  private slots:
   void on_selection_changed();
 
  private:
   vektor::dna::Object *selected_object_ = nullptr;
+  uint32_t selection_listener_ = 0;
 
   QWidget *container_widget_ = nullptr;
   QVBoxLayout *sub_panel_layout_ = nullptr;
@@ -6,12 +6,14 @@
 #include <QPinchGesture>
 #include <QTimer>
 #include <map>
+#include <vector>
 
 #include <QOpenGLFunctions_4_1_Core>
 
 #include "../../../../intern/vpi/intern/VPI_GLWidget.hh"
 #include "../../../../source/runtime/gpu/shaders/SHDR_grid.h"
 #include "../../../../source/runtime/rna/RNA_camera.h"
+#include <entt/entt.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace qt::dock {
@@ -37,12 +39,24 @@ class ViewportWidget : public vpi::VPI_GLWidget, protected QOpenGLFunctions_4_1_
 
  private:
   void update_camera();
+  void pick_ray_cast(const QPointF &pos);
+  void select_picked(entt::entity entity);
+  void select_region();
+  void draw_select_region();
   vektor::gpu::GridShader *grid_shader_ = nullptr;
 
   bool right_mouse_down_ = false;
   bool right_shift_down_ = false;
   QPoint last_mouse_pos;
 
+  /* Left button selection: a click picks, a drag selects a box (Ctrl: lasso) on release. */
+  bool select_pending_ = false;
+  bool select_dragging_ = false;
+  bool select_lasso_ = false;
+  QPointF select_start_;
+  QPointF select_current_;
+  std::vector<glm::vec2> lasso_points_;
+
   vektor::rna::Camera *camera_ = nullptr;
   std::map<int, bool> keys_;
   QTimer timer_;
@@ -1,4 +1,6 @@
+#include <QPainter>
 #include <QSizePolicy>
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 
@@ -6,12 +8,15 @@
 #include "../../../../../source/runtime/dna/DNA_camera.h"
 #include "../../../../../source/runtime/dna/DNA_object_type.h"
 #include "../../../../../source/runtime/draw/DRW_manager.hh"
+#include "../../../../../source/runtime/gpu/GPU_profile.h"
 #include "../../../../../source/runtime/gpu/shaders/SHDR_grid.h"
 #include "../../../../../source/runtime/lib/intern/appdir.h"
+#include "../../../../gaurdalloc/MEM_gaurdalloc.h"
 #include "../../../../source/runtime/gpu/GPU_shader.h"
 #include "../../../../source/runtime/kernel/ecs/ECS_mesh_primitives.h"
 #include "../../../../source/runtime/kernel/ecs/ECS_registry.h"
 #include "../../../../source/runtime/lib/VLI_math_geom.h"
+#include "../../../../source/runtime/lib/VLI_select_region.h"
 #include "../../../../source/runtime/rna/RNA_ecs_registry.h"
 #include "../../../../vpi/intern/VPI_ContextMTL.hh"
 #include "../../../../vpi/intern/VPI_QtWindow.hh"
@@ -27,6 +32,13 @@
 
 #define float_to_int(x) ((int)((x) + 0.5f))
 
+/* Half size of the GPU pick region in logical pixels, forgiving for thin geometry. */
+#define VIEWPORT_PICK_RADIUS 3
+/* Cursor travel in logical pixels before a left click turns into a box or lasso drag. */
+#define VIEWPORT_DRAG_THRESHOLD 4
+/* Minimum spacing of recorded lasso points in logical pixels. */
+#define VIEWPORT_LASSO_SPACING 2.0f
+
 // TODO: Thinking to create a separate file for openGL for this, let's see in blender later, how
 // they are doing this. ?
 
@@ -58,10 +70,15 @@ void ViewportWidget::init()
 
 void ViewportWidget::paintGL()
 {
+  mem::MEM_profile_frame();
+  VK_PROFILE_FRAME();
+  VK_PROFILE_SCOPE("paintGL");
+
   // Initialize OpenGL functions FIRST before any GL calls or shader/buffer creation
   if (vektor::creator::G.gpu_backend == vektor::creator::GPU_BACKEND_OPENGL) {
     initializeOpenGLFunctions();
   }
+  GPU_PROFILE_FRAME();
 
   qt::scene::SCN_init_default_scene();
 
@@ -122,6 +139,8 @@ void ViewportWidget::paintGL()
   }
 
   if (grid_shader_) {
+    VK_PROFILE_SCOPE("grid");
+    GPU_PROFILE_SCOPE("grid");
     glDepthMask(GL_FALSE);
     grid_shader_->draw(projection, view);
     glDepthMask(GL_TRUE);
@@ -133,6 +152,16 @@ void ViewportWidget::paintGL()
   vektor::draw::DRW_draw_view(
       nullptr, nullptr, view, projection, (width() * (int)dpr), (height() * (int)dpr), time);
   glDisable(GL_DEPTH_TEST);
+
+  entt::entity picked;
+  if (vektor::draw::DRW_select_buffer_poll(&picked)) {
+    select_picked(picked);
+  }
+
+  if (select_dragging_) {
+    VK_PROFILE_SCOPE("select_region");
+    draw_select_region();
+  }
 }
 
 void ViewportWidget::mouseReleaseEvent(QMouseEvent *event)
@@ -142,6 +171,27 @@ void ViewportWidget::mouseReleaseEvent(QMouseEvent *event)
   switch (event->button()) {
     case Qt::LeftButton:
       wm_event = vektor::wmEventType::LEFTMOUSE;
+      if (select_pending_) {
+        if (select_dragging_) {
+          select_region();
+        }
+        else {
+          /* GPU picking resolves in a later paintGL(), see select_picked(). */
+          const float dpr = (float)devicePixelRatio();
+          if (!(vektor::creator::G.use_gpu_select &&
+                vektor::draw::DRW_select_buffer_request(
+                    (int)(select_start_.x() * dpr),
+                    (int)((height() - select_start_.y()) * dpr),
+                    (int)(VIEWPORT_PICK_RADIUS * dpr))))
+          {
+            pick_ray_cast(select_start_);
+          }
+        }
+        select_pending_ = false;
+        select_dragging_ = false;
+        lasso_points_.clear();
+        update();
+      }
       break;
     case Qt::RightButton:
       wm_event = vektor::wmEventType::RIGHTMOUSE;
@@ -183,6 +233,25 @@ void ViewportWidget::mouseMoveEvent(QMouseEvent *event)
   float dx = (float)event->position().x() - (float)last_mouse_pos.x();
   float dy = (float)event->position().y() - (float)last_mouse_pos.y();
 
+  if (select_pending_ && (event->buttons() & Qt::LeftButton)) {
+    const QPointF pos = event->position();
+    if (!select_dragging_ &&
+        (pos - select_start_).manhattanLength() >= VIEWPORT_DRAG_THRESHOLD)
+    {
+      select_dragging_ = true;
+    }
+    if (select_dragging_) {
+      select_current_ = pos;
+      if (select_lasso_) {
+        const glm::vec2 point((float)pos.x(), (float)pos.y());
+        if (glm::distance(point, lasso_points_.back()) >= VIEWPORT_LASSO_SPACING) {
+          lasso_points_.push_back(point);
+        }
+      }
+      update();
+    }
+  }
+
   // fix here
   if (event->modifiers() & Qt::ShiftModifier) {
     if (event->buttons() & (Qt::MiddleButton | Qt::LeftButton | Qt::RightButton)) {
@@ -250,71 +319,148 @@ void ViewportWidget::wheelEvent(QWheelEvent *event)
   update();
 }
 
-void ViewportWidget::mousePressEvent(QMouseEvent *event)
+void ViewportWidget::pick_ray_cast(const QPointF &pos)
 {
-  if (event->button() == Qt::LeftButton) {
-    glm::vec3 ray_origin, ray_dir;
-    camera_->screen_to_ray(
-        (float)event->pos().x(), (float)event->pos().y(), width(), height(), ray_origin, ray_dir);
-
-    vektor::dna::Object *closest_obj = nullptr;
-    entt::entity closest_entity = entt::null;
-    float closest_dist = FLT_MAX;
-
-    auto &registry_instance = vektor::kernel::ECSRegistry::instance();
-    auto &registry = registry_instance.registry();
-    auto objects_view = registry.view<vektor::dna::Object>();
-
-    // Clear selection
-    for (auto entity : objects_view) {
-      vektor::rna::RNA_ecs_set_selected(&registry_instance, entity, false);
-      vektor::rna::RNA_ecs_set_active(&registry_instance, entity, false);
-      auto &obj = objects_view.get<vektor::dna::Object>(entity);
-      obj.select_flag &= ~(vektor::dna::BASE_SELECTED | vektor::dna::BASE_ACTIVE);
-    }
+  glm::vec3 ray_origin, ray_dir;
+  camera_->screen_to_ray((float)pos.x(), (float)pos.y(), width(), height(), ray_origin, ray_dir);
 
-    for (auto entity : objects_view) {
-      auto &obj = objects_view.get<vektor::dna::Object>(entity);
+  vektor::dna::Object *closest_obj = nullptr;
+  entt::entity closest_entity = entt::null;
+  float closest_dist = FLT_MAX;
 
-      if (obj.mesh) {
-        // Calculate model matrix
-        auto model = glm::mat4(1.0f);
-        model = glm::translate(model, obj.transform.location);
-        model = glm::rotate(model, obj.transform.rotation.x, glm::vec3(1, 0, 0));
-        model = glm::rotate(model, obj.transform.rotation.y, glm::vec3(0, 1, 0));
-        model = glm::rotate(model, obj.transform.rotation.z, glm::vec3(0, 0, 1));
-        model = glm::scale(model, obj.transform.scale);
+  auto &registry_instance = vektor::kernel::ECSRegistry::instance();
+  auto &registry = registry_instance.registry();
+  auto objects_view = registry.view<vektor::dna::Object>();
+  /* Transforms may have changed since the last redraw. */
+  registry_instance.hierarchy().update_world_matrices();
 
-        // Inverse model matrix to bring ray into object space
-        glm::mat4 inv_model = glm::inverse(model);
+  for (auto entity : objects_view) {
+    auto &obj = objects_view.get<vektor::dna::Object>(entity);
 
-        // Transform ray origin and direction to object space
-        glm::vec3 obj_ray_origin = glm::vec3(inv_model * glm::vec4(ray_origin, 1.0f));
-        glm::vec3 obj_ray_dir = glm::normalize(glm::vec3(inv_model * glm::vec4(ray_dir, 0.0f)));
+    if (obj.mesh) {
+      const glm::mat4 &model = obj.object_to_world;
 
-        float t = vektor::lib::ray_mesh_intersect(obj_ray_origin, obj_ray_dir, obj.mesh.get());
+      // Inverse model matrix to bring ray into object space
+      glm::mat4 inv_model = glm::inverse(model);
 
-        if (t != FLT_MAX) {
-          // Transform hit distance back to world space for depth comparison
-          glm::vec3 world_hit_pt = glm::vec3(model * glm::vec4(obj_ray_origin + obj_ray_dir * t, 1.0f));
-          float world_t = glm::length(world_hit_pt - ray_origin);
+      // Transform ray origin and direction to object space
+      glm::vec3 obj_ray_origin = glm::vec3(inv_model * glm::vec4(ray_origin, 1.0f));
+      glm::vec3 obj_ray_dir = glm::normalize(glm::vec3(inv_model * glm::vec4(ray_dir, 0.0f)));
 
-          if (world_t < closest_dist) {
-            closest_dist = world_t;
-            closest_obj = &obj;
-            closest_entity = entity;
-          }
+      float t = vektor::lib::ray_mesh_intersect(obj_ray_origin, obj_ray_dir, obj.mesh.get());
+
+      if (t != FLT_MAX) {
+        // Transform hit distance back to world space for depth comparison
+        glm::vec3 world_hit_pt = glm::vec3(model * glm::vec4(obj_ray_origin + obj_ray_dir * t, 1.0f));
+        float world_t = glm::length(world_hit_pt - ray_origin);
+
+        if (world_t < closest_dist) {
+          closest_dist = world_t;
+          closest_obj = &obj;
+          closest_entity = entity;
         }
       }
     }
+  }
+
+  select_picked(closest_obj ? closest_entity : entt::null);
+}
 
-    if (closest_obj) {
-      vektor::rna::RNA_ecs_set_selected(&registry_instance, closest_entity, true);
-      vektor::rna::RNA_ecs_set_active(&registry_instance, closest_entity, true);
-      closest_obj->select_flag |= (vektor::dna::BASE_SELECTED | vektor::dna::BASE_ACTIVE);
+void ViewportWidget::select_picked(entt::entity entity)
+{
+  /* Click picking replaces the selection, listeners get the delta. */
+  auto &selection = vektor::kernel::ECSRegistry::instance().selection();
+  if (entity != entt::null) {
+    selection.assign({&entity, 1}, entity);
+  }
+  else {
+    selection.clear();
+  }
+}
+
+void ViewportWidget::select_region()
+{
+  auto &registry_instance = vektor::kernel::ECSRegistry::instance();
+  auto &registry = registry_instance.registry();
+  auto objects_view = registry.view<vektor::dna::Object>();
+  registry_instance.hierarchy().update_world_matrices();
+
+  std::vector<entt::entity> entities;
+  std::vector<vektor::lib::SelectRegionObject> objects;
+  for (auto entity : objects_view) {
+    auto &obj = objects_view.get<vektor::dna::Object>(entity);
+    if (obj.mesh) {
+      entities.push_back(entity);
+      objects.push_back({obj.mesh.get(), obj.object_to_world});
+    }
+  }
+
+  const glm::mat4 view_projection = camera_->projection_matrix((float)width() / (float)height()) *
+                                    camera_->view_matrix();
+  const glm::vec2 viewport((float)width(), (float)height());
+
+  std::vector<uint8_t> hits;
+  if (select_lasso_) {
+    vektor::lib::select_region_lasso(objects, view_projection, viewport, lasso_points_, hits);
+  }
+  else {
+    const QRectF rect = QRectF(select_start_, select_current_).normalized();
+    vektor::lib::select_region_box(
+        objects,
+        view_projection,
+        viewport,
+        glm::vec4(rect.left(), rect.top(), rect.right(), rect.bottom()),
+        hits);
+  }
+
+  std::vector<entt::entity> selected;
+  for (size_t i = 0; i < hits.size(); i++) {
+    if (hits[i]) {
+      selected.push_back(entities[i]);
     }
+  }
+
+  /* The region replaces the selection, the active object survives when it is still inside. */
+  auto &selection = registry_instance.selection();
+  entt::entity active = selection.active();
+  if (std::find(selected.begin(), selected.end(), active) == selected.end()) {
+    active = entt::null;
+  }
+  selection.assign(selected, active);
+}
 
-    outliner_notify_scene_changed();
+void ViewportWidget::draw_select_region()
+{
+  QPainter painter(this);
+  painter.setRenderHint(QPainter::Antialiasing);
+  QPen pen(QColor(255, 255, 255, 200));
+  pen.setStyle(Qt::DashLine);
+  pen.setCosmetic(true);
+  painter.setPen(pen);
+  painter.setBrush(QColor(255, 255, 255, 24));
+
+  if (select_lasso_) {
+    QPolygonF polygon;
+    for (const glm::vec2 &point : lasso_points_) {
+      polygon << QPointF(point.x, point.y);
+    }
+    painter.drawPolygon(polygon);
+  }
+  else {
+    painter.drawRect(QRectF(select_start_, select_current_).normalized());
+  }
+}
+
+void ViewportWidget::mousePressEvent(QMouseEvent *event)
+{
+  if (event->button() == Qt::LeftButton && !(event->modifiers() & Qt::ShiftModifier)) {
+    /* Decided on release: a click picks, a drag selects a region. */
+    select_pending_ = true;
+    select_dragging_ = false;
+    select_lasso_ = (event->modifiers() & Qt::ControlModifier) != 0;
+    select_start_ = event->position();
+    select_current_ = select_start_;
+    lasso_points_.assign(1, glm::vec2((float)select_start_.x(), (float)select_start_.y()));
   }
   else if (event->button() == Qt::RightButton) {
     right_mouse_down_ = true;
@@ -1,8 +1,12 @@
 #include <cstdlib>
+#include <cstring>
 
+#include "MEM_arena.h"
+#include "MEM_gaurdalloc.h"
 #include "creator.h"
 #include "intern/CLG_init.hh"
 #include "intern/appdir.h"
+#include "lib/VLI_profile.h"
 #include "lib/intern/context.hh"
 #include "windowmanager/intern/wm_init_exit.hh"
 
@@ -10,6 +14,17 @@ vektor::lib::vkContext vkC = {};
 
 int main(int argc, const char **argv)
 {
+  /* The allocator can only be switched before the first allocation, so these flags are
+   * handled here and only documented by the argument parser. */
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--debug-memory") == 0) {
+      mem::MEM_use_allocator(mem::MEM_AllocatorMode::Debug);
+    }
+    else if (std::strcmp(argv[i], "--guarded-memory") == 0) {
+      mem::MEM_use_allocator(mem::MEM_AllocatorMode::Guarded);
+    }
+  }
+
   vektor::lib::init(argv[0]);
   clog::clog_init("main", "editor.log", "Editor");
 
@@ -18,7 +33,13 @@ int main(int argc, const char **argv)
   vektor::editor::WM_init(&vkC, argc, argv);
 
   vektor::editor::WM_exit();
-  
+
+  /* Report while logging still works, the atexit fallback would run after clg_exit(). The
+   * scratch arena of the main thread would only be freed after the report. */
+  mem::MEM_arena_thread_free();
+  mem::MEM_profile_end();
+  vektor::lib::profile_end();
+
   clog::clg_exit();
   
   return EXIT_SUCCESS;
@@ -1,15 +1,22 @@
+#include <cstdlib>
 #include <iostream>
 #include <utility>
 
 #include "../../intern/clog/CLG_log.h"
+#include "../../intern/gaurdalloc/MEM_gaurdalloc.h"
 #include "creator_args.hh"
 #include "creator_global.h"
 #include "kernel/vektor.h"
+#include "lib/VLI_compute.h"
+#include "lib/VLI_profile.h"
 
 namespace vektor::creator {
 
 CLG_LOGREF_DECLARE_GLOBAL(V_LOG, "runtime.args");
 
+/* Applied once the arguments are parsed, before any compute kernel runs. */
+static lib::ComputeSettings compute_settings;
+
 void Args::add(
     const char *short_arg, const char *long_arg, const char *doc, ArgCallback callback, void *data)
 {
@@ -127,6 +134,100 @@ static int arg_handle_metal(int, const char **, void *)
   return 0;
 }
 
+static int arg_handle_gpu_select(int, const char **, void *)
+{
+  G.use_gpu_select = true;
+  return 0;
+}
+
+/* Applied in main() before anything is allocated, see MEM_use_allocator(). */
+static int arg_handle_memory_mode(int, const char **, void *)
+{
+  return 0;
+}
+
+static int arg_handle_profile_memory(int, const char **, void *)
+{
+  mem::MEM_profile_begin(nullptr);
+  return 0;
+}
+
+static int arg_handle_profile_memory_timeline(int argc, const char **argv, void *)
+{
+  if (argc < 2) {
+    CLOG_ERROR(V_LOG, "--profile-memory-timeline requires a file path");
+    exit(1);
+  }
+  if (!mem::MEM_profile_begin(argv[1])) {
+    CLOG_ERROR(V_LOG, "Cannot write the memory timeline to %s", argv[1]);
+  }
+  return 1;
+}
+
+static int arg_handle_profile_trace(int argc, const char **argv, void *)
+{
+  if (argc < 2) {
+    CLOG_ERROR(V_LOG, "--profile-trace requires a file path");
+    exit(1);
+  }
+  if (!lib::profile_begin(argv[1])) {
+    CLOG_ERROR(V_LOG, "Cannot start the profiler, it is running already or not part of this build");
+  }
+  return 1;
+}
+
+static int arg_handle_log_deferred(int, const char **, void *)
+{
+  clog::CLG_output_deferred_set(1);
+  return 0;
+}
+
+static int arg_handle_log_binary(int argc, const char **argv, void *)
+{
+  if (argc < 2) {
+    CLOG_ERROR(V_LOG, "--log-binary requires a file path");
+    exit(1);
+  }
+  if (!clog::CLG_output_binary_set(argv[1])) {
+    CLOG_ERROR(V_LOG, "Cannot write the binary log to %s", argv[1]);
+  }
+  return 1;
+}
+
+static int arg_handle_compute_threads(int argc, const char **argv, void *)
+{
+  if (argc < 2 || atoi(argv[1]) <= 0) {
+    CLOG_ERROR(V_LOG, "--compute-threads requires a positive number");
+    exit(1);
+  }
+  compute_settings.threads = atoi(argv[1]);
+  return 1;
+}
+
+static int arg_handle_compute_cores(int argc, const char **argv, void *)
+{
+  if (argc < 2) {
+    CLOG_ERROR(V_LOG, "--compute-cores requires a list of cores");
+    exit(1);
+  }
+  compute_settings.cores.clear();
+  const char *list = argv[1];
+  while (true) {
+    char *end;
+    const long core = strtol(list, &end, 10);
+    if (end == list || core < 0 || (*end != ',' && *end != '\0')) {
+      CLOG_ERROR(V_LOG, "--compute-cores expects numbers separated by commas, not %s", argv[1]);
+      exit(1);
+    }
+    compute_settings.cores.push_back((int)core);
+    if (*end == '\0') {
+      break;
+    }
+    list = end + 1;
+  }
+  return 1;
+}
+
 void main_args_setup(Args &args)
 {
   args.add("-h", "--help", "Print this help text and exit", arg_handle_print_help, &args);
@@ -136,6 +237,49 @@ void main_args_setup(Args &args)
 
   args.add("", "--opengl", "Force OpenGL graphics backend", arg_handle_opengl);
   args.add("", "--metal", "Force Metal graphics backend", arg_handle_metal);
+  args.add("",
+           "--gpu-select",
+           "Pick objects with the GPU ID buffer instead of CPU ray casting",
+           arg_handle_gpu_select);
+
+  args.add("",
+           "--debug-memory",
+           "Track every allocation with a backtrace and report leaks at exit",
+           arg_handle_memory_mode);
+  args.add("",
+           "--guarded-memory",
+           "Check allocations for corruption, also in builds defaulting to the lean allocator",
+           arg_handle_memory_mode);
+  args.add("",
+           "--profile-memory",
+           "Sample allocations per frame and report what grew, ranked by name, at exit",
+           arg_handle_profile_memory);
+  args.add("",
+           "--profile-memory-timeline",
+           "<file> As --profile-memory, also writing every frame to <file> for mem_profile_view",
+           arg_handle_profile_memory_timeline);
+  args.add("",
+           "--profile-trace",
+           "<file> Time CPU and GPU zones of every frame, written to <file> as a Chrome trace",
+           arg_handle_profile_trace);
+
+  args.add("",
+           "--log-deferred",
+           "Format log messages on the log writer thread instead of the calling thread",
+           arg_handle_log_deferred);
+  args.add("",
+           "--log-binary",
+           "<file> Write debug, info and warning messages unformatted to <file>, see clog_decode",
+           arg_handle_log_binary);
+
+  args.add("",
+           "--compute-threads",
+           "<n> Threads of the compute kernels, one per core but one by default",
+           arg_handle_compute_threads);
+  args.add("",
+           "--compute-cores",
+           "<list> Pin the compute threads to these comma separated cores (Linux)",
+           arg_handle_compute_cores);
 
   // using opengl in default for now ...
 // #ifdef __APPLE__
@@ -149,7 +293,13 @@ int main_args_handle(int argc, const char **argv)
 {
   Args args;
   main_args_setup(args);
-  return args.parse(argc, argv);
+  const int result = args.parse(argc, argv);
+
+  std::string error;
+  if (!lib::compute_init(compute_settings, &error)) {
+    CLOG_WARN(V_LOG, "Compute threads keep their defaults: %s", error.c_str());
+  }
+  return result;
 }
 
 }  // namespace vektor::creator
@@ -14,6 +14,9 @@ struct Global {
   const char *project_file;
 
   GPUBackend gpu_backend;
+
+  /** Pick objects with the GPU ID buffer instead of CPU ray casting. */
+  bool use_gpu_select;
 };
 
 extern Global G;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -31,6 +33,30 @@ typedef struct MLoop {
   glm::vec2 uv;
 } MLoop;
 
+/** Axis aligned box. */
+typedef struct BoundBox {
+  glm::vec3 min = glm::vec3(0.0f);
+  glm::vec3 max = glm::vec3(0.0f);
+} BoundBox;
+
+/**
+ * A new value for #Mesh::geometry_version. One counter serves all meshes, so a version is never
+ * seen twice, not even on a new mesh allocated at the address of a freed one.
+ */
+inline uint64_t mesh_geometry_version_next()
+{
+  static std::atomic<uint64_t> counter = 0;
+  return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+struct Mesh;
+
+/**
+ * Called by the destructor of every #Mesh, so that caches keyed by its address drop their
+ * entries before the address is reused. Set by the draw manager for its GPU meshes.
+ */
+extern void (*mesh_free_callback)(const Mesh *mesh);
+
 typedef struct Mesh {
   ID id;
 
@@ -43,12 +69,30 @@ typedef struct Mesh {
   /** The number of face corners in the mesh, and the size of #corner_data. */
   int corners_num = 0;
 
+  MEdge *medge = nullptr;  // pointer to edges, may be null when #edges_num is 0
   MPoly *mpoly = nullptr;  // pointer to  mesh polygons
   MLoop *mloop = nullptr;  // pointer to face corners
   MVert *mvert = nullptr;  // pointer to vertices
 
+  /**
+   * Renewed whenever vertex positions change, see `lib::mesh_tag_positions_changed`. Unique
+   * across all meshes, see #mesh_geometry_version_next.
+   */
+  uint64_t geometry_version = mesh_geometry_version_next();
+  /**
+   * Local bounds cached by `lib::mesh_bounds`: the box, and the radius of the sphere around its
+   * center. Valid while #bounds_version equals #geometry_version.
+   */
+  mutable BoundBox bounds;
+  mutable float bounds_radius = 0.0f;
+  mutable uint64_t bounds_version = UINT64_MAX;
+
   std::vector<std::shared_ptr<Material>> materials;
 
+  Mesh() = default;
+  Mesh(const Mesh &other) = default;
+  Mesh &operator=(const Mesh &other) = default;
+  ~Mesh();
 } Mesh;
 }  // namespace vektor::dna
 
@@ -11,14 +11,6 @@
 
 namespace vektor::dna {
 
-struct Selected {
-  bool selected;
-};
-
-struct Active {
-  bool active;
-};
-
 enum class ObjectType : uint8_t { Mesh, Camera, Light, Empty };
 
 typedef struct Transform {
@@ -32,6 +24,9 @@ enum OBSelectionFlags {
   BASE_ACTIVE = (1 << 1),
 };
 
+/** #Object.parent of an object without parent, the value of `entt::null`. */
+inline constexpr uint32_t OB_NO_PARENT = UINT32_MAX;
+
 typedef struct Object {
   ID id;
   char description[256] = "";
@@ -40,6 +35,11 @@ typedef struct Object {
 
   uint32_t select_flag = 0;
 
+  /** Entity of the parent object, see kernel::Hierarchy. */
+  uint32_t parent = OB_NO_PARENT;
+  /** `transform` combined with the parents, evaluated by kernel::Hierarchy. */
+  glm::mat4 object_to_world = glm::mat4(1.0f);
+
   std::shared_ptr<dna::Mesh> mesh;
   std::shared_ptr<dna::DNA_Light> light;
   std::shared_ptr<dna::DNA_Camera> camera;
@@ -0,0 +1,14 @@
+#include "../DNA_mesh_types.h"
+
+namespace vektor::dna {
+
+void (*mesh_free_callback)(const Mesh *mesh) = nullptr;
+
+Mesh::~Mesh()
+{
+  if (mesh_free_callback) {
+    mesh_free_callback(this);
+  }
+}
+
+}  // namespace vektor::dna
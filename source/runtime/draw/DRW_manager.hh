@@ -2,6 +2,7 @@
 #include "../dna/DNA_scene_types.h"
 #include "../gpu/GPU_mesh.h"
 
+#include <entt/entt.hpp>
 #include <glm/glm.hpp>
 
 namespace vektor::draw {
@@ -21,4 +22,19 @@ void DRW_draw_view(vektor::dna::Scene *scene,
                    int height,
                    float time);
 
+/**
+ * Request an ID buffer pick around framebuffer pixel (x, y), origin bottom-left.
+ * Object IDs are rendered by the next #DRW_draw_view, scissored to the pick region, and read
+ * back asynchronously. Returns false when the backend has no ID buffer support, callers should
+ * then fall back to ray casting.
+ */
+bool DRW_select_buffer_request(int x, int y, int radius);
+
+/**
+ * Fetch the result of the last pick without stalling. Returns false while it is still in
+ * flight, otherwise sets `r_entity` to the object closest to the pick center or `entt::null`.
+ * Needs the draw context to be current.
+ */
+bool DRW_select_buffer_poll(entt::entity *r_entity);
+
 } // namespace vektor::draw
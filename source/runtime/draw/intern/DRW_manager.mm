@@ -1,16 +1,22 @@
 #include <QDir>
 #include <QOpenGLFunctions_4_1_Core>
 #include <QString>
+#include <algorithm>
+#include <climits>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 #include <map>
+#include <vector>
 
 #include "../../../intern/clog/CLG_log.h"
 #include "../../creator_global.h"
 #include "../../kernel/ecs/ECS_registry.h"
+#include "../../lib/VLI_bounds.h"
+#include "../../lib/VLI_cull.h"
 #include "../../lib/intern/appdir.h"
 #include "../DRW_manager.hh"
 #include "../gpu/GPU_framebuffer.h"
+#include "../gpu/GPU_profile.h"
 #include "../gpu/GPU_shader.h"
 #include "../gpu/GPU_vertex_buffer.hh"
 
@@ -77,11 +83,126 @@ static gpu::GPUFrameBuffer *get_shadow_fb_array()
 static LightingUniforms g_lighting = {};
 static glm::mat4 g_lightSpaceMatrices[MAX_SHADOW_LIGHTS];
 
+/* GPU mesh, shared by the shadow, main and outline passes. */
+struct DRWMeshCache {
+  gpu::GPUMesh *gpu_mesh = nullptr;
+  /* #dna::Mesh::geometry_version the GPU mesh was built from. */
+  uint64_t geometry_version = 0;
+};
+
+/* Keyed by address, entries are dropped by #mesh_cache_free_cb when their mesh is freed.
+ * Meshes are freed and drawn on the main thread. */
+static std::map<const dna::Mesh *, DRWMeshCache> g_mesh_cache;
+/* GPU meshes of freed meshes, released by #mesh_cache_free_garbage while the context is
+ * current. */
+static std::vector<gpu::GPUMesh *> g_mesh_garbage;
+
+static void mesh_cache_free_cb(const dna::Mesh *mesh)
+{
+  auto it = g_mesh_cache.find(mesh);
+  if (it == g_mesh_cache.end()) {
+    return;
+  }
+  g_mesh_garbage.push_back(it->second.gpu_mesh);
+  g_mesh_cache.erase(it);
+}
+
+static void mesh_cache_free_garbage()
+{
+  for (gpu::GPUMesh *gpu_mesh : g_mesh_garbage) {
+    gpu::GPU_mesh_free(gpu_mesh);
+  }
+  g_mesh_garbage.clear();
+}
+
+static DRWMeshCache &get_mesh_cache(dna::Mesh *mesh)
+{
+  dna::mesh_free_callback = mesh_cache_free_cb;
+  auto it = g_mesh_cache.find(mesh);
+  if (it != g_mesh_cache.end()) {
+    DRWMeshCache &cache = it->second;
+    if (cache.geometry_version != mesh->geometry_version) {
+      gpu::GPU_mesh_free(cache.gpu_mesh);
+      cache.gpu_mesh = gpu::GPU_mesh_create_from_dna_mesh(mesh);
+      cache.geometry_version = mesh->geometry_version;
+    }
+    return cache;
+  }
+
+  DRWMeshCache &cache = g_mesh_cache[mesh];
+  cache.gpu_mesh = gpu::GPU_mesh_create_from_dna_mesh(mesh);
+  cache.geometry_version = mesh->geometry_version;
+  return cache;
+}
+
+/* Includes the parents, evaluated by DRW_prepare_view() for the redraw. */
+static const glm::mat4 &object_model_matrix(const dna::Object &obj)
+{
+  return obj.object_to_world;
+}
+
+/* Drawn with their mesh by every pass. */
+static bool object_is_drawable(const dna::Object &obj)
+{
+  return (obj.type == dna::ObjectType::Mesh || obj.type == dna::ObjectType::Light) && obj.mesh;
+}
+
+/**
+ * The drawable objects of `entities` whose world box is not fully outside `frustum`, in the
+ * order of `entities`. The local boxes cached on the meshes are moved to world space and culled
+ * in one batch each.
+ */
+template<typename Entities>
+static void cull_objects(const Entities &entities,
+                         const lib::CullFrustum &frustum,
+                         std::vector<entt::entity> &r_visible)
+{
+  /* Scratch kept between passes and frames, drawing happens on one thread. */
+  static std::vector<entt::entity> candidates;
+  static std::vector<dna::BoundBox> locals, worlds;
+  static std::vector<glm::mat4> matrices;
+  static lib::CullBoxes boxes;
+  static std::vector<uint32_t> visible;
+
+  auto &registry = kernel::ECSRegistry::instance().registry();
+  candidates.clear();
+  locals.clear();
+  matrices.clear();
+  for (const entt::entity entity : entities) {
+    const auto *obj = registry.try_get<dna::Object>(entity);
+    if (!obj || !object_is_drawable(*obj)) {
+      continue;
+    }
+    candidates.push_back(entity);
+    locals.push_back(lib::mesh_bounds(*obj->mesh));
+    matrices.push_back(object_model_matrix(*obj));
+  }
+
+  worlds.resize(locals.size());
+  lib::bounds_transform(locals, matrices, worlds);
+  boxes.clear();
+  boxes.reserve(worlds.size());
+  for (const dna::BoundBox &world : worlds) {
+    boxes.append(world);
+  }
+  lib::cull_boxes(boxes, frustum, visible);
+  r_visible.clear();
+  for (const uint32_t index : visible) {
+    r_visible.push_back(candidates[index]);
+  }
+}
+
 void DRW_prepare_view(vektor::dna::Scene *scene)
 {
+  VK_PROFILE_SCOPE("DRW_prepare_view");
   auto &registry = kernel::ECSRegistry::instance().registry();
   auto objects_view = registry.view<dna::Object>();
 
+  {
+    VK_PROFILE_SCOPE("update_world_matrices");
+    kernel::ECSRegistry::instance().hierarchy().update_world_matrices();
+  }
+
   // 1. Gather active lights in the scene
   g_lighting.num_lights = 0;
   for (auto entity : objects_view) {
@@ -91,7 +212,7 @@ void DRW_prepare_view(vektor::dna::Scene *scene)
       auto &la = *l_obj.light;
       GPULight &gl = g_lighting.lights[g_lighting.num_lights++];
       gl.type = (int)la.type;
-      gl.position = l_obj.transform.location;
+      gl.position = glm::vec3(object_model_matrix(l_obj)[3]);
       gl.color = la.color;
       gl.energy = la.energy;
       gl.range = la.distance;
@@ -110,12 +231,14 @@ void DRW_prepare_view(vektor::dna::Scene *scene)
 
     if (shadow_shdr && shadow_fb) {
       for (int i = 0; i < std::min(g_lighting.num_lights, MAX_SHADOW_LIGHTS); i++) {
+        VK_PROFILE_SCOPE("shadow_pass");
         glm::vec3 lightPos = g_lighting.lights[i].position;
         glm::mat4 lightProjection = glm::ortho(-15.0f, 15.0f, -15.0f, 15.0f, 1.0f, 50.0f);
         glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         g_lightSpaceMatrices[i] = lightProjection * lightView;
 
         if (is_opengl) {
+          GPU_PROFILE_SCOPE("shadow_pass");
           gpu::GPU_framebuffer_attach_depth_layer(shadow_fb, i);
           QOpenGLFunctions_4_1_Core gl_func;
           gl_func.initializeOpenGLFunctions();
@@ -129,22 +252,11 @@ void DRW_prepare_view(vektor::dna::Scene *scene)
           for (auto entity : objects_view) {
             auto &obj = registry.get<dna::Object>(entity);
             if (obj.type == dna::ObjectType::Mesh && obj.mesh) {
-              auto model = glm::mat4(1.0f);
-              model = glm::translate(model, obj.transform.location);
-              model = glm::rotate(model, obj.transform.rotation.x, glm::vec3(1, 0, 0));
-              model = glm::rotate(model, obj.transform.rotation.y, glm::vec3(0, 1, 0));
-              model = glm::rotate(model, obj.transform.rotation.z, glm::vec3(0, 0, 1));
-              model = glm::scale(model, obj.transform.scale);
+              const glm::mat4 &model = object_model_matrix(obj);
 
               gpu::GPU_shader_uniform_matrix4(shadow_shdr, "model", &model[0][0]);
 
-              static std::map<void *, gpu::GPUMesh *> shadow_mesh_cache;
-              if (shadow_mesh_cache.find(obj.mesh.get()) == shadow_mesh_cache.end()) {
-                shadow_mesh_cache[obj.mesh.get()] = gpu::GPU_mesh_create_from_dna_mesh(
-                    obj.mesh.get());
-              }
-              gpu::GPUMesh *gpu_mesh = shadow_mesh_cache[obj.mesh.get()];
-              gpu::GPU_mesh_draw(gpu_mesh, nullptr);
+              gpu::GPU_mesh_draw(get_mesh_cache(obj.mesh.get()).gpu_mesh, nullptr);
             }
           }
           gpu::GPU_framebuffer_unbind();
@@ -180,12 +292,7 @@ void DRW_prepare_view(vektor::dna::Scene *scene)
                 for (auto entity : objects_view) {
                   auto &obj = registry.get<dna::Object>(entity);
                   if (obj.type == dna::ObjectType::Mesh && obj.mesh) {
-                    auto model = glm::mat4(1.0f);
-                    model = glm::translate(model, obj.transform.location);
-                    model = glm::rotate(model, obj.transform.rotation.x, glm::vec3(1, 0, 0));
-                    model = glm::rotate(model, obj.transform.rotation.y, glm::vec3(0, 1, 0));
-                    model = glm::rotate(model, obj.transform.rotation.z, glm::vec3(0, 0, 1));
-                    model = glm::scale(model, obj.transform.scale);
+                    const glm::mat4 &model = object_model_matrix(obj);
 
                     struct {
                       glm::mat4 model;
@@ -196,13 +303,7 @@ void DRW_prepare_view(vektor::dna::Scene *scene)
 
                     [shadowEncoder setVertexBytes:&uniforms length:sizeof(uniforms) atIndex:1];
 
-                    static std::map<void *, gpu::GPUMesh *> shadow_mesh_cache;
-                    if (shadow_mesh_cache.find(obj.mesh.get()) == shadow_mesh_cache.end()) {
-                      shadow_mesh_cache[obj.mesh.get()] = gpu::GPU_mesh_create_from_dna_mesh(
-                          obj.mesh.get());
-                    }
-                    gpu::GPUMesh *gpu_mesh = shadow_mesh_cache[obj.mesh.get()];
-                    gpu::GPU_mesh_draw(gpu_mesh, shadowEncoder);
+                    gpu::GPU_mesh_draw(get_mesh_cache(obj.mesh.get()).gpu_mesh, shadowEncoder);
                   }
                 }
                 [shadowEncoder endEncoding];
@@ -219,6 +320,333 @@ void DRW_prepare_view(vektor::dna::Scene *scene)
   }
 }
 
+/* Selection outline: selected objects are rendered flat into a single channel mask, an edge
+ * detect over the mask then draws the outline on top of the scene. The mask is depth tested
+ * against the objects of the main pass, drawn depth only first, so occluded parts of the
+ * selection get no outline. */
+
+#define OUTLINE_MASK_SELECTED 0.5f
+#define OUTLINE_MASK_ACTIVE 1.0f
+#define OUTLINE_THICKNESS 2
+
+static gpu::GPUShader *get_outline_shader(const char *name)
+{
+  QString shader_path = QString(vektor::lib::get_application_dir_path()) +
+                        "/../../source/runtime/gpu/shaders/core/outline/" + name;
+  return gpu::GPU_shader_create_from_source((shader_path + ".vert").toUtf8().constData(),
+                                            (shader_path + ".frag").toUtf8().constData());
+}
+
+static gpu::GPUFrameBuffer *get_outline_mask_fb(int width, int height)
+{
+  static gpu::GPUFrameBuffer *fb = nullptr;
+  if (fb && (fb->width != width || fb->height != height)) {
+    gpu::GPU_framebuffer_free(fb);
+    fb = nullptr;
+  }
+  if (!fb) {
+    fb = gpu::GPU_framebuffer_create_color(width, height, gpu::GPU_R8, true);
+  }
+  return fb;
+}
+
+static void draw_selection_outline(QOpenGLFunctions_4_1_Core &gl_func,
+                                   const lib::CullFrustum &frustum,
+                                   const std::vector<entt::entity> &occluders,
+                                   const glm::mat4 &view,
+                                   const glm::mat4 &projection,
+                                   int width,
+                                   int height)
+{
+  auto &ecs = kernel::ECSRegistry::instance();
+  const kernel::Selection &selection = ecs.selection();
+  if (selection.size() == 0) {
+    return;
+  }
+  VK_PROFILE_SCOPE("selection_outline");
+  GPU_PROFILE_SCOPE("selection_outline");
+
+  static gpu::GPUShader *mask_shader = nullptr;
+  static gpu::GPUShader *detect_shader = nullptr;
+  static unsigned int fullscreen_vao = 0;
+  static bool shader_failed = false;
+  if (shader_failed) {
+    return;
+  }
+  if (!mask_shader) {
+    mask_shader = get_outline_shader("outline_mask");
+    detect_shader = get_outline_shader("outline_detect");
+    if (!mask_shader || !detect_shader) {
+      shader_failed = true;
+      CLOG_ERROR(LOG_DRAW, "Failed to create selection outline shaders.");
+      return;
+    }
+    /* Core profile needs a bound VAO even when the vertex shader ignores attributes. */
+    gl_func.glGenVertexArrays(1, &fullscreen_vao);
+  }
+
+  /* The pass runs inside the main pass, leave its blend and depth state as it was. */
+  const GLboolean blend_enabled = gl_func.glIsEnabled(GL_BLEND);
+  const GLboolean depth_enabled = gl_func.glIsEnabled(GL_DEPTH_TEST);
+  GLint depth_func = GL_LESS;
+  gl_func.glGetIntegerv(GL_DEPTH_FUNC, &depth_func);
+
+  gpu::GPUFrameBuffer *mask_fb = get_outline_mask_fb(width, height);
+
+  /* 1. Mask pass: selected objects only, culled like the main pass. */
+  gpu::GPU_framebuffer_bind(mask_fb);
+  const float clear_mask[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  const float clear_depth = 1.0f;
+  gl_func.glClearBufferfv(GL_COLOR, 0, clear_mask);
+  gl_func.glClearBufferfv(GL_DEPTH, 0, &clear_depth);
+  gl_func.glEnable(GL_DEPTH_TEST);
+  gl_func.glDisable(GL_BLEND);
+
+  gpu::GPU_shader_bind(mask_shader);
+  gpu::GPU_shader_uniform_matrix4(mask_shader, "view", &view[0][0]);
+  gpu::GPU_shader_uniform_matrix4(mask_shader, "projection", &projection[0][0]);
+
+  /* Depth of the main pass objects. Drawn with the mask shader rather than copied from the main
+   * target, so the selected objects below land on exactly the same depth and pass GL_LEQUAL. */
+  gl_func.glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  gl_func.glDepthFunc(GL_LESS);
+  for (const entt::entity entity : occluders) {
+    const dna::Object &obj = ecs.registry().get<dna::Object>(entity);
+    const glm::mat4 &model = object_model_matrix(obj);
+    DRWMeshCache &cache = get_mesh_cache(obj.mesh.get());
+    gpu::GPU_shader_uniform_matrix4(mask_shader, "model", &model[0][0]);
+    gpu::GPU_mesh_draw(cache.gpu_mesh, nullptr);
+  }
+  gl_func.glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  gl_func.glDepthFunc(GL_LEQUAL);
+
+  static std::vector<entt::entity> visible;
+  cull_objects(selection.selected(), frustum, visible);
+
+  const entt::entity active = selection.active();
+  int drawn = 0;
+  for (const entt::entity entity : visible) {
+    const dna::Object &obj = ecs.registry().get<dna::Object>(entity);
+    const glm::mat4 &model = object_model_matrix(obj);
+    DRWMeshCache &cache = get_mesh_cache(obj.mesh.get());
+    gpu::GPU_shader_uniform_matrix4(mask_shader, "model", &model[0][0]);
+    gpu::GPU_shader_uniform_float(mask_shader,
+                                  "maskValue",
+                                  entity == active ? OUTLINE_MASK_ACTIVE :
+                                                     OUTLINE_MASK_SELECTED);
+    gpu::GPU_mesh_draw(cache.gpu_mesh, nullptr);
+    drawn++;
+  }
+
+  gpu::GPU_framebuffer_unbind();
+  gl_func.glViewport(0, 0, width, height);
+  gl_func.glDepthFunc(depth_func);
+
+  /* 2. Screen-space edge detect over the mask, blended onto the scene. */
+  if (drawn > 0) {
+    const float select_color[4] = {0.93f, 0.45f, 0.1f, 1.0f};
+    const float active_color[4] = {1.0f, 0.67f, 0.25f, 1.0f};
+
+    gl_func.glDisable(GL_DEPTH_TEST);
+    gl_func.glEnable(GL_BLEND);
+    gl_func.glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    gpu::GPU_shader_bind(detect_shader);
+    gl_func.glActiveTexture(GL_TEXTURE2);
+    gl_func.glBindTexture(GL_TEXTURE_2D, mask_fb->color_tex->opengl_id);
+    gpu::GPU_shader_uniform_texture(detect_shader, "selectionMask", 2);
+    gpu::GPU_shader_uniform_int(detect_shader, "thickness", OUTLINE_THICKNESS);
+    gpu::GPU_shader_uniform_vector4(detect_shader, "selectColor", select_color);
+    gpu::GPU_shader_uniform_vector4(detect_shader, "activeColor", active_color);
+
+    gl_func.glBindVertexArray(fullscreen_vao);
+    gl_func.glDrawArrays(GL_TRIANGLES, 0, 3);
+    gl_func.glBindVertexArray(0);
+  }
+
+  if (depth_enabled) {
+    gl_func.glEnable(GL_DEPTH_TEST);
+  }
+  else {
+    gl_func.glDisable(GL_DEPTH_TEST);
+  }
+  if (blend_enabled) {
+    gl_func.glEnable(GL_BLEND);
+  }
+  else {
+    gl_func.glDisable(GL_BLEND);
+  }
+}
+
+/* ID buffer picking: on request, object IDs (entity + 1) are rendered into an R32UI target,
+ * scissored to the pick region, then copied out through a PBO and resolved on a later frame.
+ * The cost depends on the objects overlapping the pick region, not on triangle counts. */
+
+struct DRWSelectBuffer {
+  bool requested = false;
+  int x = 0, y = 0, radius = 0;
+
+  bool in_flight = false;
+  int center_x = 0, center_y = 0;
+
+  gpu::GPUFrameBuffer *fb = nullptr;
+  gpu::GPUReadback *readback = nullptr;
+};
+
+static DRWSelectBuffer g_select_buffer;
+
+bool DRW_select_buffer_request(int x, int y, int radius)
+{
+  if (creator::G.gpu_backend != creator::GPU_BACKEND_OPENGL) {
+    return false;
+  }
+  g_select_buffer.requested = true;
+  g_select_buffer.x = x;
+  g_select_buffer.y = y;
+  g_select_buffer.radius = std::max(radius, 0);
+  return true;
+}
+
+static void draw_select_buffer(QOpenGLFunctions_4_1_Core &gl_func,
+                               const glm::mat4 &view,
+                               const glm::mat4 &projection,
+                               int width,
+                               int height)
+{
+  DRWSelectBuffer &sb = g_select_buffer;
+  if (!sb.requested) {
+    return;
+  }
+  sb.requested = false;
+  VK_PROFILE_SCOPE("select_buffer");
+  GPU_PROFILE_SCOPE("select_buffer");
+
+  const int x0 = std::max(sb.x - sb.radius, 0);
+  const int y0 = std::max(sb.y - sb.radius, 0);
+  const int x1 = std::min(sb.x + sb.radius + 1, width);
+  const int y1 = std::min(sb.y + sb.radius + 1, height);
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+  const int rect_w = x1 - x0, rect_h = y1 - y0;
+
+  static gpu::GPUShader *id_shader = nullptr;
+  static bool shader_failed = false;
+  if (shader_failed) {
+    return;
+  }
+  if (!id_shader) {
+    QString shader_path = QString(vektor::lib::get_application_dir_path()) +
+                          "/../../source/runtime/gpu/shaders/core/select_id/select_id";
+    id_shader = gpu::GPU_shader_create_from_source((shader_path + ".vert").toUtf8().constData(),
+                                                   (shader_path + ".frag").toUtf8().constData());
+    if (!id_shader) {
+      shader_failed = true;
+      CLOG_ERROR(LOG_DRAW, "Failed to create select ID shader.");
+      return;
+    }
+  }
+
+  if (sb.fb && (sb.fb->width != width || sb.fb->height != height)) {
+    gpu::GPU_framebuffer_free(sb.fb);
+    sb.fb = nullptr;
+  }
+  if (!sb.fb) {
+    sb.fb = gpu::GPU_framebuffer_create_color(width, height, gpu::GPU_R32UI, true);
+  }
+  if (!sb.readback) {
+    sb.readback = gpu::GPU_readback_create();
+  }
+
+  /* Narrow the frustum to the pick region so objects outside of it are skipped entirely. */
+  const float rx = (float)x0 + rect_w * 0.5f, ry = (float)y0 + rect_h * 0.5f;
+  glm::mat4 pick = glm::mat4(1.0f);
+  pick = glm::translate(
+      pick, glm::vec3((width - 2.0f * rx) / rect_w, (height - 2.0f * ry) / rect_h, 0.0f));
+  pick = glm::scale(pick, glm::vec3((float)width / rect_w, (float)height / rect_h, 1.0f));
+  const lib::CullFrustum pick_frustum = lib::cull_frustum_from_matrix(pick * projection * view);
+
+  /* The pass runs inside the main pass, leave its blend and scissor state as it was. */
+  const GLboolean blend_enabled = gl_func.glIsEnabled(GL_BLEND);
+  const GLboolean scissor_enabled = gl_func.glIsEnabled(GL_SCISSOR_TEST);
+
+  gpu::GPU_framebuffer_bind(sb.fb);
+  gl_func.glEnable(GL_SCISSOR_TEST);
+  gl_func.glScissor(x0, y0, rect_w, rect_h);
+  const GLuint clear_id[4] = {0, 0, 0, 0};
+  const float clear_depth = 1.0f;
+  gl_func.glClearBufferuiv(GL_COLOR, 0, clear_id);
+  gl_func.glClearBufferfv(GL_DEPTH, 0, &clear_depth);
+  gl_func.glEnable(GL_DEPTH_TEST);
+  gl_func.glDisable(GL_BLEND);
+
+  gpu::GPU_shader_bind(id_shader);
+  gpu::GPU_shader_uniform_matrix4(id_shader, "view", &view[0][0]);
+  gpu::GPU_shader_uniform_matrix4(id_shader, "projection", &projection[0][0]);
+
+  auto &registry = kernel::ECSRegistry::instance().registry();
+  static std::vector<entt::entity> visible;
+  cull_objects(registry.view<dna::Object>(), pick_frustum, visible);
+  for (const entt::entity entity : visible) {
+    const dna::Object &obj = registry.get<dna::Object>(entity);
+    const glm::mat4 &model = object_model_matrix(obj);
+    DRWMeshCache &cache = get_mesh_cache(obj.mesh.get());
+    gpu::GPU_shader_uniform_matrix4(id_shader, "model", &model[0][0]);
+    gpu::GPU_shader_uniform_uint(id_shader, "objectId", (uint32_t)entity + 1);
+    gpu::GPU_mesh_draw(cache.gpu_mesh, nullptr);
+  }
+
+  if (!scissor_enabled) {
+    gl_func.glDisable(GL_SCISSOR_TEST);
+  }
+  if (blend_enabled) {
+    gl_func.glEnable(GL_BLEND);
+  }
+
+  gpu::GPU_framebuffer_read_color_async(sb.fb, sb.readback, x0, y0, rect_w, rect_h);
+  gl_func.glViewport(0, 0, width, height);
+
+  sb.in_flight = true;
+  sb.center_x = sb.x - x0;
+  sb.center_y = sb.y - y0;
+}
+
+bool DRW_select_buffer_poll(entt::entity *r_entity)
+{
+  DRWSelectBuffer &sb = g_select_buffer;
+  if (!sb.in_flight || !gpu::GPU_readback_is_ready(sb.readback)) {
+    return false;
+  }
+  sb.in_flight = false;
+
+  const auto *ids = (const uint32_t *)gpu::GPU_readback_map(sb.readback);
+  uint32_t best_id = 0;
+  int best_dist = INT_MAX;
+  if (ids) {
+    for (int y = 0; y < sb.readback->height; y++) {
+      for (int x = 0; x < sb.readback->width; x++) {
+        const uint32_t id = ids[y * sb.readback->width + x];
+        const int dist = (x - sb.center_x) * (x - sb.center_x) +
+                         (y - sb.center_y) * (y - sb.center_y);
+        if (id != 0 && dist < best_dist) {
+          best_id = id;
+          best_dist = dist;
+        }
+      }
+    }
+    gpu::GPU_readback_unmap(sb.readback);
+  }
+
+  *r_entity = entt::null;
+  if (best_id != 0) {
+    const auto entity = (entt::entity)(best_id - 1);
+    if (kernel::ECSRegistry::instance().registry().valid(entity)) {
+      *r_entity = entity;
+    }
+  }
+  return true;
+}
+
 void DRW_draw_view(vektor::dna::Scene *scene,
                    void *encoder_or_context,
                    const glm::mat4 &view,
@@ -227,8 +655,10 @@ void DRW_draw_view(vektor::dna::Scene *scene,
                    int height,
                    float time)
 {
+  VK_PROFILE_SCOPE("DRW_draw_view");
+  mesh_cache_free_garbage();
   auto &registry = kernel::ECSRegistry::instance().registry();
-  auto objects_view = registry.view<dna::Object>();
+  const lib::CullFrustum frustum = lib::cull_frustum_from_matrix(projection * view);
 
   static gpu::GPUShader *gpu_shader = nullptr;
   static bool shader_failed = false;
@@ -256,7 +686,17 @@ void DRW_draw_view(vektor::dna::Scene *scene,
     }
   }
 
+  /* Objects of the main pass, culled in one batch for both backends. */
+  static std::vector<entt::entity> visible;
+  {
+    VK_PROFILE_SCOPE("cull_objects");
+    cull_objects(registry.view<dna::Object>(), frustum, visible);
+  }
+
   if (creator::G.gpu_backend == creator::GPU_BACKEND_OPENGL) {
+    /* The select buffer and the outline are zones of their own, inside this one. */
+    VK_PROFILE_SCOPE("main_pass");
+    GPU_PROFILE_SCOPE("main_pass");
     QOpenGLFunctions_4_1_Core gl_func;
     gl_func.initializeOpenGLFunctions();
     // CRITICAL: Restore viewport for the main scene draw
@@ -294,36 +734,29 @@ void DRW_draw_view(vektor::dna::Scene *scene,
     }
 
     // Draw objects (Both meshes and light icons)
-    for (auto entity : objects_view) {
-      auto &obj = registry.get<dna::Object>(entity);
-      if ((obj.type == dna::ObjectType::Mesh || obj.type == dna::ObjectType::Light) && obj.mesh) {
-        auto model = glm::mat4(1.0f);
-        model = glm::translate(model, obj.transform.location);
-        model = glm::rotate(model, obj.transform.rotation.x, glm::vec3(1, 0, 0));
-        model = glm::rotate(model, obj.transform.rotation.y, glm::vec3(0, 1, 0));
-        model = glm::rotate(model, obj.transform.rotation.z, glm::vec3(0, 0, 1));
-        model = glm::scale(model, obj.transform.scale);
-        gpu::GPU_shader_uniform_matrix4(gpu_shader, "model", &model[0][0]);
-        gpu::GPU_shader_uniform_int(gpu_shader, "isLight", obj.type == dna::ObjectType::Light);
-
-        dna::Color objectColor = {0.8f, 0.8f, 0.8f, 1.0f};
-        if (obj.mesh && !obj.mesh->materials.empty()) {
-          objectColor = obj.mesh->materials[0]->color;
-        }
-        float color_val[4] = {objectColor.r, objectColor.g, objectColor.b, objectColor.a};
-        gpu::GPU_shader_uniform_vector4(gpu_shader, "objectColor", color_val);
-
-        static std::map<void *, gpu::GPUMesh *> mesh_cache;
-        if (mesh_cache.find(obj.mesh.get()) == mesh_cache.end()) {
-          mesh_cache[obj.mesh.get()] = gpu::GPU_mesh_create_from_dna_mesh(obj.mesh.get());
-        }
-        gpu::GPUMesh *gpu_mesh = mesh_cache[obj.mesh.get()];
-        gpu::GPU_mesh_draw(gpu_mesh, nullptr);
+    for (const entt::entity entity : visible) {
+      const dna::Object &obj = registry.get<dna::Object>(entity);
+      const glm::mat4 &model = object_model_matrix(obj);
+      DRWMeshCache &cache = get_mesh_cache(obj.mesh.get());
+      gpu::GPU_shader_uniform_matrix4(gpu_shader, "model", &model[0][0]);
+      gpu::GPU_shader_uniform_int(gpu_shader, "isLight", obj.type == dna::ObjectType::Light);
+
+      dna::Color objectColor = {0.8f, 0.8f, 0.8f, 1.0f};
+      if (obj.mesh && !obj.mesh->materials.empty()) {
+        objectColor = obj.mesh->materials[0]->color;
       }
+      float color_val[4] = {objectColor.r, objectColor.g, objectColor.b, objectColor.a};
+      gpu::GPU_shader_uniform_vector4(gpu_shader, "objectColor", color_val);
+
+      gpu::GPU_mesh_draw(cache.gpu_mesh, nullptr);
     }
+
+    draw_select_buffer(gl_func, view, projection, width, height);
+    draw_selection_outline(gl_func, frustum, visible, view, projection, width, height);
   }
   else {
 #ifdef __APPLE__
+    VK_PROFILE_SCOPE("main_pass");
     id<MTLRenderCommandEncoder> mtl_encoder = (id<MTLRenderCommandEncoder>)encoder_or_context;
     if (!mtl_encoder)
       return;
@@ -368,43 +801,32 @@ void DRW_draw_view(vektor::dna::Scene *scene,
                               atIndex:0];
     }
 
-    for (auto entity : objects_view) {
-      auto &obj = registry.get<dna::Object>(entity);
-      if ((obj.type == dna::ObjectType::Mesh || obj.type == dna::ObjectType::Light) && obj.mesh) {
-        auto model = glm::mat4(1.0f);
-        model = glm::translate(model, obj.transform.location);
-        model = glm::rotate(model, obj.transform.rotation.x, glm::vec3(1, 0, 0));
-        model = glm::rotate(model, obj.transform.rotation.y, glm::vec3(0, 1, 0));
-        model = glm::rotate(model, obj.transform.rotation.z, glm::vec3(0, 0, 1));
-        model = glm::scale(model, obj.transform.scale);
-
-        struct {
-          glm::mat4 model;
-          int isLight;
-          float padding[3];
-        } obj_uniforms = {model, (obj.type == dna::ObjectType::Light), {0, 0, 0}};
-
-        [mtl_encoder setVertexBytes:&obj_uniforms length:sizeof(obj_uniforms) atIndex:2];
-
-        // Restore missing fragment buffers for color and emissive
-        dna::Color color = {0.8f, 0.8f, 0.8f, 1.0f};
-        glm::vec3 emissive = {0.0f, 0.0f, 0.0f};
-        if (!obj.mesh->materials.empty()) {
-          color = obj.mesh->materials[0]->color;
-          emissive = glm::vec3(obj.mesh->materials[0]->emissive_color.r,
-                               obj.mesh->materials[0]->emissive_color.g,
-                               obj.mesh->materials[0]->emissive_color.b);
-        }
-        [mtl_encoder setFragmentBytes:&color length:sizeof(color) atIndex:0];
-        [mtl_encoder setFragmentBytes:&emissive length:sizeof(emissive) atIndex:3];
-
-        static std::map<void *, gpu::GPUMesh *> mesh_cache;
-        if (mesh_cache.find(obj.mesh.get()) == mesh_cache.end()) {
-          mesh_cache[obj.mesh.get()] = gpu::GPU_mesh_create_from_dna_mesh(obj.mesh.get());
-        }
-        gpu::GPUMesh *gpu_mesh = mesh_cache[obj.mesh.get()];
-        gpu::GPU_mesh_draw(gpu_mesh, mtl_encoder);
+    for (const entt::entity entity : visible) {
+      const dna::Object &obj = registry.get<dna::Object>(entity);
+      const glm::mat4 &model = object_model_matrix(obj);
+      DRWMeshCache &cache = get_mesh_cache(obj.mesh.get());
+
+      struct {
+        glm::mat4 model;
+        int isLight;
+        float padding[3];
+      } obj_uniforms = {model, (obj.type == dna::ObjectType::Light), {0, 0, 0}};
+
+      [mtl_encoder setVertexBytes:&obj_uniforms length:sizeof(obj_uniforms) atIndex:2];
+
+      // Restore missing fragment buffers for color and emissive
+      dna::Color color = {0.8f, 0.8f, 0.8f, 1.0f};
+      glm::vec3 emissive = {0.0f, 0.0f, 0.0f};
+      if (!obj.mesh->materials.empty()) {
+        color = obj.mesh->materials[0]->color;
+        emissive = glm::vec3(obj.mesh->materials[0]->emissive_color.r,
+                             obj.mesh->materials[0]->emissive_color.g,
+                             obj.mesh->materials[0]->emissive_color.b);
       }
+      [mtl_encoder setFragmentBytes:&color length:sizeof(color) atIndex:0];
+      [mtl_encoder setFragmentBytes:&emissive length:sizeof(emissive) atIndex:3];
+
+      gpu::GPU_mesh_draw(cache.gpu_mesh, mtl_encoder);
     }
 #endif
   }
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+
 #include "GPU_texture.h"
 
 namespace vektor::gpu {
@@ -6,12 +8,21 @@ namespace vektor::gpu {
 typedef struct GPUFrameBuffer {
   unsigned int opengl_id;
   GPUTexture *depth_tex;
+  GPUTexture *color_tex;
   int width, height;
 } GPUFrameBuffer;
 
 /** Create a framebuffer with only a depth attachment (for shadow mapping). */
 GPUFrameBuffer *GPU_framebuffer_create_depth_only(int width, int height);
 GPUFrameBuffer *GPU_framebuffer_create_depth_array(int width, int height, int layers);
+/**
+ * Create a framebuffer with a single color attachment, for screen-space masks and ID buffers.
+ * A depth attachment is only added when `with_depth` is set.
+ */
+GPUFrameBuffer *GPU_framebuffer_create_color(int width,
+                                             int height,
+                                             eGPUTextureFormat format,
+                                             bool with_depth = false);
 
 /** Bind a specific layer of a depth array texture to the framebuffer. */
 void GPU_framebuffer_attach_depth_layer(GPUFrameBuffer *fb, int layer);
@@ -25,4 +36,30 @@ void GPU_framebuffer_unbind();
 /** Free the framebuffer and its attachments. */
 void GPU_framebuffer_free(GPUFrameBuffer *fb);
 
+/**
+ * Asynchronous read back of a color attachment region through a pixel pack buffer.
+ * The copy is queued with #GPU_framebuffer_read_color_async and fenced, so the CPU only waits
+ * for the GPU when it maps a readback that is not #GPU_readback_is_ready yet.
+ */
+typedef struct GPUReadback {
+  unsigned int pbo;
+  void *fence; /* GLsync */
+  int width, height;
+  eGPUTextureFormat format;
+  size_t size;
+} GPUReadback;
+
+GPUReadback *GPU_readback_create();
+void GPU_framebuffer_read_color_async(
+    GPUFrameBuffer *fb, GPUReadback *readback, int x, int y, int width, int height);
+/** True once the queued copy finished. Never blocks. */
+bool GPU_readback_is_ready(GPUReadback *readback);
+/**
+ * Map the pixels of a finished readback, tightly packed rows starting at the bottom. Returns null
+ * when mapping fails, only a successful map is followed by #GPU_readback_unmap.
+ */
+const void *GPU_readback_map(GPUReadback *readback);
+void GPU_readback_unmap(GPUReadback *readback);
+void GPU_readback_free(GPUReadback *readback);
+
 } // namespace vektor::gpu
@@ -1,6 +1,11 @@
 #pragma once
 
-#include "../../dna/DNA_mesh_types.h"
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "../dna/DNA_mesh_types.h"
+#include "../dna/DNA_vertex_.h"
 
 namespace vektor::gpu {
 
@@ -23,6 +28,13 @@ struct GPUMesh {
   void *metal_ebo = nullptr;
 };
 
+/**
+ * The CPU side of #GPU_mesh_create_from_dna_mesh: one vertex per mesh vertex and three indices
+ * per triangle, quads split along their first diagonal. Other faces are skipped.
+ */
+void GPU_mesh_pack(const dna::Mesh &mesh,
+                   std::pmr::vector<dna::GPUVertex> &r_vertices,
+                   std::pmr::vector<uint32_t> &r_indices);
 GPUMesh *GPU_mesh_create_from_dna_mesh(dna::Mesh *mesh);
 void GPU_mesh_free(GPUMesh *gpu_mesh);
 void GPU_mesh_draw(GPUMesh *gpu_mesh, void *command_encoder = nullptr);
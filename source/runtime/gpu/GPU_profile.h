@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../lib/VLI_profile.h"
+
+namespace vektor::gpu {
+
+/**
+ * GPU zones for the frame profiler of `VLI_profile.h`, measured with GL timestamp queries.
+ * Queries of a frame are read #GPU_PROFILE_FRAMES frames later and only when the GPU already
+ * finished them, so profiling never waits for the GPU. Zones that are not done by then are
+ * dropped. Metal has no GPU zones, only the CPU ones.
+ */
+
+/** Frames of queries in flight. */
+#define GPU_PROFILE_FRAMES 2
+/** GPU zones per frame, the rest of a frame is not measured. */
+#define GPU_PROFILE_ZONES 64
+
+/**
+ * Start a new frame of queries and hand the finished ones of an older frame to the profiler.
+ * Call once per frame with the GL context current, before any #GPU_PROFILE_SCOPE.
+ */
+void GPU_profile_frame();
+
+/** Queue the start of a zone, returns the zone for #GPU_profile_zone_end or -1. */
+int GPU_profile_zone_begin(const char *name);
+void GPU_profile_zone_end(int zone);
+
+/** Measures the GPU commands between construction and destruction, see #GPU_PROFILE_SCOPE. */
+class GPUProfileScope {
+ public:
+  explicit GPUProfileScope(const char *name)
+      : zone_(lib::profile_is_active() ? GPU_profile_zone_begin(name) : -1)
+  {
+  }
+  ~GPUProfileScope()
+  {
+    if (zone_ >= 0) {
+      GPU_profile_zone_end(zone_);
+    }
+  }
+
+  GPUProfileScope(const GPUProfileScope &) = delete;
+  GPUProfileScope &operator=(const GPUProfileScope &) = delete;
+
+ private:
+  int zone_;
+};
+
+}  // namespace vektor::gpu
+
+#ifdef WITH_PROFILER
+/** Start a frame of GPU zones, see #vektor::gpu::GPU_profile_frame. */
+#  define GPU_PROFILE_FRAME() ::vektor::gpu::GPU_profile_frame()
+/** Time the GPU work of the rest of the enclosing block as a zone named `name`. */
+#  define GPU_PROFILE_SCOPE(name) \
+    const ::vektor::gpu::GPUProfileScope VK_PROFILE_CONCAT(gpu_profile_scope_, __LINE__)(name)
+#else
+#  define GPU_PROFILE_FRAME() ((void)0)
+#  define GPU_PROFILE_SCOPE(name) ((void)0)
+#endif
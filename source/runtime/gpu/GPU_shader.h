@@ -46,6 +46,7 @@ void GPU_shader_free(GPUShader *shader);
 
 void GPU_shader_uniform_float(GPUShader *shader, const char *name, float val);
 void GPU_shader_uniform_int(GPUShader *shader, const char *name, int val);
+void GPU_shader_uniform_uint(GPUShader *shader, const char *name, unsigned int val);
 void GPU_shader_uniform_vector3(GPUShader *shader, const char *name, const float val[3]);
 void GPU_shader_uniform_vector4(GPUShader *shader, const char *name, const float val[4]);
 void GPU_shader_uniform_matrix4(GPUShader *shader, const char *name, const float val[16]);
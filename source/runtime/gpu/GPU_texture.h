@@ -5,8 +5,19 @@ namespace vektor::gpu {
 typedef enum eGPUTextureFormat {
   GPU_DEPTH_COMPONENT24,
   GPU_RGBA8,
+  /** Single channel, used for masks such as the selection outline. */
+  GPU_R8,
+  /** Unsigned integer formats, not filterable. Used for ID buffers. */
+  GPU_R32UI,
+  GPU_RG32UI,
 } eGPUTextureFormat;
 
+/** True for formats that must be sampled with `usampler` and read as integers. */
+inline bool GPU_texture_format_is_integer(eGPUTextureFormat format)
+{
+  return format == GPU_R32UI || format == GPU_RG32UI;
+}
+
 typedef struct GPUTexture {
   int width, height;
   eGPUTextureFormat format;
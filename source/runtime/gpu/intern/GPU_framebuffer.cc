@@ -72,6 +72,39 @@ GPUFrameBuffer *GPU_framebuffer_create_depth_only(int width, int height)
   return fb;
 }
 
+GPUFrameBuffer *GPU_framebuffer_create_color(int width,
+                                             int height,
+                                             eGPUTextureFormat format,
+                                             bool with_depth)
+{
+  auto *fb = new GPUFrameBuffer();
+  fb->width = width;
+  fb->height = height;
+  fb->opengl_id = 0;
+  fb->color_tex = GPU_texture_create_2d(width, height, format);
+  if (with_depth) {
+    fb->depth_tex = GPU_texture_create_2d(width, height, GPU_DEPTH_COMPONENT24);
+  }
+
+  if (creator::G.gpu_backend == creator::GPU_BACKEND_OPENGL) {
+    QOpenGLFunctions_4_1_Core gl;
+    gl.initializeOpenGLFunctions();
+
+    gl.glGenFramebuffers(1, &fb->opengl_id);
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, fb->opengl_id);
+    gl.glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fb->color_tex->opengl_id, 0);
+    if (fb->depth_tex) {
+      gl.glFramebufferTexture2D(
+          GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, fb->depth_tex->opengl_id, 0);
+    }
+    gl.glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+  return fb;
+}
+
 void GPU_framebuffer_bind(GPUFrameBuffer *fb)
 {
   if (creator::G.gpu_backend == creator::GPU_BACKEND_OPENGL) {
@@ -108,7 +141,149 @@ void GPU_framebuffer_free(GPUFrameBuffer *fb)
   if (fb->depth_tex) {
     GPU_texture_free(fb->depth_tex);
   }
+  if (fb->color_tex) {
+    GPU_texture_free(fb->color_tex);
+  }
   delete fb;
 }
 
+static void readback_format(eGPUTextureFormat format,
+                            GLenum &r_format,
+                            GLenum &r_type,
+                            size_t &r_pixel_size)
+{
+  switch (format) {
+    case GPU_R8:
+      r_format = GL_RED;
+      r_type = GL_UNSIGNED_BYTE;
+      r_pixel_size = 1;
+      break;
+    case GPU_R32UI:
+      r_format = GL_RED_INTEGER;
+      r_type = GL_UNSIGNED_INT;
+      r_pixel_size = 4;
+      break;
+    case GPU_RG32UI:
+      r_format = GL_RG_INTEGER;
+      r_type = GL_UNSIGNED_INT;
+      r_pixel_size = 8;
+      break;
+    default:
+      r_format = GL_RGBA;
+      r_type = GL_UNSIGNED_BYTE;
+      r_pixel_size = 4;
+      break;
+  }
+}
+
+GPUReadback *GPU_readback_create()
+{
+  return new GPUReadback();
+}
+
+void GPU_framebuffer_read_color_async(
+    GPUFrameBuffer *fb, GPUReadback *readback, int x, int y, int width, int height)
+{
+  if (creator::G.gpu_backend != creator::GPU_BACKEND_OPENGL || !fb || !fb->color_tex) {
+    return;
+  }
+  QOpenGLFunctions_4_1_Core gl;
+  gl.initializeOpenGLFunctions();
+
+  GLenum format, type;
+  size_t pixel_size;
+  readback_format(fb->color_tex->format, format, type, pixel_size);
+  const size_t size = (size_t)width * (size_t)height * pixel_size;
+
+  if (!readback->pbo) {
+    gl.glGenBuffers(1, &readback->pbo);
+  }
+  gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+  if (size > readback->size) {
+    gl.glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_READ);
+    readback->size = size;
+  }
+
+  gl.glBindFramebuffer(GL_READ_FRAMEBUFFER, fb->opengl_id);
+  gl.glReadBuffer(GL_COLOR_ATTACHMENT0);
+  gl.glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  /* With a pack buffer bound the pointer is an offset, the call returns immediately. */
+  gl.glReadPixels(x, y, width, height, format, type, nullptr);
+  gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if (readback->fence) {
+    gl.glDeleteSync((GLsync)readback->fence);
+  }
+  readback->fence = (void *)gl.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback->width = width;
+  readback->height = height;
+  readback->format = fb->color_tex->format;
+
+  GPU_framebuffer_unbind();
+}
+
+bool GPU_readback_is_ready(GPUReadback *readback)
+{
+  if (!readback || !readback->fence) {
+    return false;
+  }
+  QOpenGLFunctions_4_1_Core gl;
+  gl.initializeOpenGLFunctions();
+  const GLenum status = gl.glClientWaitSync((GLsync)readback->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+  return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+const void *GPU_readback_map(GPUReadback *readback)
+{
+  if (!readback || !readback->pbo) {
+    return nullptr;
+  }
+  QOpenGLFunctions_4_1_Core gl;
+  gl.initializeOpenGLFunctions();
+
+  GLenum format, type;
+  size_t pixel_size;
+  readback_format(readback->format, format, type, pixel_size);
+
+  gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+  const void *pixels = gl.glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+                                           0,
+                                           (GLsizeiptr)readback->width * readback->height *
+                                               pixel_size,
+                                           GL_MAP_READ_BIT);
+  if (!pixels) {
+    gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+  return pixels;
+}
+
+void GPU_readback_unmap(GPUReadback *readback)
+{
+  QOpenGLFunctions_4_1_Core gl;
+  gl.initializeOpenGLFunctions();
+  gl.glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if (readback->fence) {
+    gl.glDeleteSync((GLsync)readback->fence);
+    readback->fence = nullptr;
+  }
+}
+
+void GPU_readback_free(GPUReadback *readback)
+{
+  if (!readback) {
+    return;
+  }
+  QOpenGLFunctions_4_1_Core gl;
+  gl.initializeOpenGLFunctions();
+  if (readback->fence) {
+    gl.glDeleteSync((GLsync)readback->fence);
+  }
+  if (readback->pbo) {
+    gl.glDeleteBuffers(1, &readback->pbo);
+  }
+  delete readback;
+}
+
 } // namespace vektor::gpu
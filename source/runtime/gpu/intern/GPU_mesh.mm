@@ -7,8 +7,11 @@
 #endif
 
 #include <QOpenGLFunctions_4_1_Core>
+#include <memory_resource>
 #include <vector>
 
+#include "MEM_arena.h"
+
 #include "../../creator_global.h"
 #include "../../dna/DNA_vertex_.h"
 #include "../GPU_mesh.h"
@@ -17,49 +20,64 @@ namespace vektor::gpu {
 
 using namespace dna;
 
-GPUMesh *GPU_mesh_create_from_dna_mesh(dna::Mesh *mesh)
+void GPU_mesh_pack(const dna::Mesh &mesh,
+                   std::pmr::vector<dna::GPUVertex> &r_vertices,
+                   std::pmr::vector<uint32_t> &r_indices)
 {
-  if (!mesh || mesh->faces_num == 0)
-    return nullptr;
-
-  auto *gpu_mesh = new GPUMesh();
-  gpu_mesh->backend = (creator::G.gpu_backend == creator::GPU_BACKEND_METAL) ?
-                          GPUMesh::GPU_BACKEND_METAL :
-                          GPUMesh::GPU_BACKEND_OPENGL;
-  gpu_mesh->vertex_count = mesh->verts_num;
-
-  // We need to unpack the mesh into a format suitable for the GPU (triangles)
-  // For simplicity, assuming the primitive generation outputs triangulated faces,
-  // or simple quads that we can easily split.
-
-  std::vector<dna::GPUVertex> vertices;
-  std::vector<uint32_t> indices;
-  vertices.reserve(mesh->verts_num);
+  int triangles_num = 0;
+  for (int i = 0; i < mesh.faces_num; i++) {
+    const int count = mesh.mpoly[i].num_corners;
+    triangles_num += (count == 3) ? 1 : (count == 4) ? 2 : 0;
+  }
+  r_vertices.clear();
+  r_indices.clear();
+  r_vertices.reserve(mesh.verts_num);
+  r_indices.reserve(size_t(triangles_num) * 3);
 
-  for (int i = 0; i < mesh->verts_num; i++) {
-    vertices.push_back({mesh->mvert[i].co, mesh->mvert[i].no});
+  for (int i = 0; i < mesh.verts_num; i++) {
+    r_vertices.push_back({mesh.mvert[i].co, mesh.mvert[i].no});
   }
 
-  for (int i = 0; i < mesh->faces_num; i++) {
-    int first = mesh->mpoly[i].first_corner;
-    int count = mesh->mpoly[i].num_corners;
+  for (int i = 0; i < mesh.faces_num; i++) {
+    int first = mesh.mpoly[i].first_corner;
+    int count = mesh.mpoly[i].num_corners;
 
     if (count == 3) {
-      indices.push_back(mesh->mloop[first].v);
-      indices.push_back(mesh->mloop[first + 1].v);
-      indices.push_back(mesh->mloop[first + 2].v);
+      r_indices.push_back(mesh.mloop[first].v);
+      r_indices.push_back(mesh.mloop[first + 1].v);
+      r_indices.push_back(mesh.mloop[first + 2].v);
     }
     else if (count == 4) {
       // Triangulate quad (0-1-2-3) -> (0-1-2) + (0-2-3)
-      indices.push_back(mesh->mloop[first].v);
-      indices.push_back(mesh->mloop[first + 1].v);
-      indices.push_back(mesh->mloop[first + 2].v);
+      r_indices.push_back(mesh.mloop[first].v);
+      r_indices.push_back(mesh.mloop[first + 1].v);
+      r_indices.push_back(mesh.mloop[first + 2].v);
 
-      indices.push_back(mesh->mloop[first].v);
-      indices.push_back(mesh->mloop[first + 2].v);
-      indices.push_back(mesh->mloop[first + 3].v);
+      r_indices.push_back(mesh.mloop[first].v);
+      r_indices.push_back(mesh.mloop[first + 2].v);
+      r_indices.push_back(mesh.mloop[first + 3].v);
     }
   }
+}
+
+GPUMesh *GPU_mesh_create_from_dna_mesh(dna::Mesh *mesh)
+{
+  if (!mesh || mesh->faces_num == 0)
+    return nullptr;
+
+  auto *gpu_mesh = new GPUMesh();
+  gpu_mesh->backend = (creator::G.gpu_backend == creator::GPU_BACKEND_METAL) ?
+                          GPUMesh::GPU_BACKEND_METAL :
+                          GPUMesh::GPU_BACKEND_OPENGL;
+  gpu_mesh->vertex_count = mesh->verts_num;
+
+  /* Both arrays only live until the upload, keep them off the general heap. */
+  mem::MEM_ArenaScope scope;
+  mem::MEM_ArenaResource resource(scope.arena());
+
+  std::pmr::vector<dna::GPUVertex> vertices(&resource);
+  std::pmr::vector<uint32_t> indices(&resource);
+  GPU_mesh_pack(*mesh, vertices, indices);
 
   gpu_mesh->index_count = (int)indices.size();
 
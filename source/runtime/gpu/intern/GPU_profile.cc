@@ -0,0 +1,126 @@
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_1_Core>
+
+#include "../creator_global.h"
+#include "GPU_profile.h"
+
+namespace vektor::gpu {
+
+struct GPUProfileZone {
+  const char *name;
+  /* Begin and end timestamp queries. */
+  GLuint queries[2];
+};
+
+struct GPUProfileFrame {
+  GPUProfileZone zones[GPU_PROFILE_ZONES];
+  int zones_num;
+  /* The end query issued last, zones nest so it is not always the one of the last zone. */
+  GLuint last_query;
+  /* GPU and profiler time at the start of the frame, to move timestamps to the CPU clock. */
+  GLint64 gpu_sync_ns;
+  uint64_t cpu_sync_ns;
+};
+
+/* Render thread only. */
+static struct {
+  GPUProfileFrame frames[GPU_PROFILE_FRAMES];
+  int frame;
+  bool queries_created;
+  /* A frame was started with #GPU_profile_frame while the profiler ran. */
+  bool recording;
+} gpu_profile;
+
+static void gpu_profile_frame_resolve(QOpenGLFunctions_4_1_Core &gl, GPUProfileFrame &frame)
+{
+  if (frame.zones_num == 0) {
+    return;
+  }
+  /* Queries finish in order, when the last one is available all of them are. */
+  GLuint available = 0;
+  gl.glGetQueryObjectuiv(frame.last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    frame.zones_num = 0;
+    return;
+  }
+  for (int i = 0; i < frame.zones_num; i++) {
+    const GPUProfileZone &zone = frame.zones[i];
+    GLuint64 begin_ns = 0, end_ns = 0;
+    gl.glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &begin_ns);
+    gl.glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end_ns);
+    const int64_t begin_offset = int64_t(begin_ns) - frame.gpu_sync_ns;
+    const int64_t end_offset = int64_t(end_ns) - frame.gpu_sync_ns;
+    /* The GPU may start on the commands of a zone before the synced CPU time. */
+    if (int64_t(frame.cpu_sync_ns) + begin_offset < 0) {
+      continue;
+    }
+    lib::profile_gpu_zone(zone.name,
+                          uint64_t(int64_t(frame.cpu_sync_ns) + begin_offset),
+                          uint64_t(int64_t(frame.cpu_sync_ns) + end_offset));
+  }
+  frame.zones_num = 0;
+}
+
+void GPU_profile_frame()
+{
+  if (creator::G.gpu_backend != creator::GPU_BACKEND_OPENGL) {
+    return;
+  }
+  if (!lib::profile_is_active()) {
+    if (gpu_profile.recording) {
+      for (GPUProfileFrame &frame : gpu_profile.frames) {
+        frame.zones_num = 0;
+      }
+      gpu_profile.recording = false;
+    }
+    return;
+  }
+
+  QOpenGLFunctions_4_1_Core gl;
+  gl.initializeOpenGLFunctions();
+  if (!gpu_profile.queries_created) {
+    for (GPUProfileFrame &frame : gpu_profile.frames) {
+      for (GPUProfileZone &zone : frame.zones) {
+        gl.glGenQueries(2, zone.queries);
+      }
+    }
+    gpu_profile.queries_created = true;
+  }
+
+  /* The oldest frame in flight is reused, resolve it first. */
+  gpu_profile.frame = (gpu_profile.frame + 1) % GPU_PROFILE_FRAMES;
+  GPUProfileFrame &frame = gpu_profile.frames[gpu_profile.frame];
+  gpu_profile_frame_resolve(gl, frame);
+
+  gl.glGetInteger64v(GL_TIMESTAMP, &frame.gpu_sync_ns);
+  frame.cpu_sync_ns = lib::profile_time_ns();
+  gpu_profile.recording = true;
+}
+
+int GPU_profile_zone_begin(const char *name)
+{
+  if (!gpu_profile.recording) {
+    return -1;
+  }
+  GPUProfileFrame &frame = gpu_profile.frames[gpu_profile.frame];
+  if (frame.zones_num == GPU_PROFILE_ZONES) {
+    return -1;
+  }
+  QOpenGLFunctions_4_1_Core gl;
+  gl.initializeOpenGLFunctions();
+  GPUProfileZone &zone = frame.zones[frame.zones_num];
+  zone.name = name;
+  gl.glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+  return frame.zones_num++;
+}
+
+void GPU_profile_zone_end(int zone)
+{
+  QOpenGLFunctions_4_1_Core gl;
+  gl.initializeOpenGLFunctions();
+  GPUProfileFrame &frame = gpu_profile.frames[gpu_profile.frame];
+  frame.last_query = frame.zones[zone].queries[1];
+  gl.glQueryCounter(frame.last_query, GL_TIMESTAMP);
+}
+
+}  // namespace vektor::gpu
@@ -394,6 +394,13 @@ void GPU_shader_uniform_int(GPUShader *shader, const char *name, int val)
   }
 }
 
+void GPU_shader_uniform_uint(GPUShader *shader, const char *name, unsigned int val)
+{
+  if (shader && shader->program) {
+    shader->program->setUniformValue(name, (GLuint)val);
+  }
+}
+
 void GPU_shader_uniform_vector3(GPUShader *shader, const char *name, const float val[3])
 {
   if (shader && shader->program) {
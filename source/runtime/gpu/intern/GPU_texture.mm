@@ -107,6 +107,30 @@ GPUTexture *GPU_texture_create_2d(int width, int height, eGPUTextureFormat forma
       gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
       gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     }
+    else if (format == GPU_R32UI || format == GPU_RG32UI) {
+      const bool is_rg = (format == GPU_RG32UI);
+      gl.glTexImage2D(GL_TEXTURE_2D,
+                      0,
+                      is_rg ? GL_RG32UI : GL_R32UI,
+                      width,
+                      height,
+                      0,
+                      is_rg ? GL_RG_INTEGER : GL_RED_INTEGER,
+                      GL_UNSIGNED_INT,
+                      nullptr);
+      gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    else if (format == GPU_R8) {
+      gl.glTexImage2D(
+          GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+      gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
     else {
       gl.glTexImage2D(
           GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
@@ -120,7 +144,10 @@ GPUTexture *GPU_texture_create_2d(int width, int height, eGPUTextureFormat forma
     MTLTextureDescriptor *texDesc = [MTLTextureDescriptor
         texture2DDescriptorWithPixelFormat:(format == GPU_DEPTH_COMPONENT24 ?
                                                 MTLPixelFormatDepth32Float_Stencil8 :
-                                                MTLPixelFormatRGBA8Unorm)
+                                            format == GPU_R8    ? MTLPixelFormatR8Unorm :
+                                            format == GPU_R32UI ? MTLPixelFormatR32Uint :
+                                            format == GPU_RG32UI ? MTLPixelFormatRG32Uint :
+                                                                   MTLPixelFormatRGBA8Unorm)
                                       width:width
                                      height:height
                                    mipmapped:NO];
@@ -0,0 +1,28 @@
+#version 410 core
+
+out vec4 FragColor;
+
+uniform sampler2D selectionMask;
+uniform int thickness;
+uniform vec4 selectColor;
+uniform vec4 activeColor;
+
+void main() {
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(selectionMask, 0);
+    float center = texelFetch(selectionMask, coord, 0).r;
+
+    // Only pixels outside a silhouette are drawn, the strongest neighbour picks the color.
+    float edge = 0.0;
+    for (int y = -thickness; y <= thickness; y++) {
+        for (int x = -thickness; x <= thickness; x++) {
+            ivec2 tap = clamp(coord + ivec2(x, y), ivec2(0), size - 1);
+            edge = max(edge, texelFetch(selectionMask, tap, 0).r);
+        }
+    }
+
+    if (edge <= center) {
+        discard;
+    }
+    FragColor = (edge > 0.75) ? activeColor : selectColor;
+}
@@ -0,0 +1,10 @@
+#version 410 core
+
+out float FragMask;
+
+// 0.5 for selected objects, 1.0 for the active one.
+uniform float maskValue;
+
+void main() {
+    FragMask = maskValue;
+}
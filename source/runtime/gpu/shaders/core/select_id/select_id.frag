@@ -0,0 +1,10 @@
+#version 410 core
+
+out uint FragId;
+
+// Entity index + 1, zero is reserved for "nothing".
+uniform uint objectId;
+
+void main() {
+    FragId = objectId;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+#include <entt/entt.hpp>
+
+#include "ECS_transform_buffers.h"
+
+namespace vektor::kernel {
+
+/**
+ * Object parenting, owned by #ECSRegistry.
+ *
+ * The parent of an object is stored in `dna::Object::parent`, a child keeps its local transform
+ * and follows its parent. #update_world_matrices evaluates `dna::Object::object_to_world` for
+ * every object with the Rust transform solver, straight from the #TransformBuffers columns,
+ * which are kept sorted breadth first so that the solver can process one depth level at a time
+ * in parallel. Main thread only.
+ */
+class Hierarchy {
+ public:
+  Hierarchy(entt::registry &registry, TransformBuffers &transforms);
+
+  /**
+   * Parent `child` to `parent`, `entt::null` clears the parent. Returns false and changes
+   * nothing when `parent` is `child` or one of its descendants.
+   */
+  bool set_parent(entt::entity child, entt::entity parent);
+
+  /** The parent of `child`, or `entt::null`. */
+  [[nodiscard]] entt::entity parent(entt::entity child) const;
+
+  /** Called before `entity` is destroyed, its children become roots. */
+  void remove(entt::entity entity);
+
+  /** Evaluate the world matrix of every object, once per redraw. */
+  void update_world_matrices();
+
+ private:
+  void rebuild_order();
+
+  entt::registry &registry_;
+  TransformBuffers &transforms_;
+
+  /* The transform rows are sorted breadth first and their parent rows are valid. Sorting again
+   * when the parenting changes or rows are added, moved or removed. */
+  bool order_dirty_ = true;
+  uint64_t layout_version_ = 0;
+};
+
+}  // namespace vektor::kernel
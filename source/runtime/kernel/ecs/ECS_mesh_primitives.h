@@ -12,6 +12,13 @@ namespace vektor::kernel {
 void add_primitive_cube_exec(dna::Object *obj, float size);
 void add_primitive_cylinder_exec(dna::Object *obj, float radius, float depth, int segments);
 void add_primitive_plane_exec(dna::Object *obj, float size);
+void add_primitive_uv_sphere_exec(dna::Object *obj, float radius, int segments, int rings);
+void add_primitive_grid_exec(dna::Object *obj, float size, int x_subdivisions, int y_subdivisions);
+void add_primitive_torus_exec(dna::Object *obj,
+                              float major_radius,
+                              float minor_radius,
+                              int major_segments,
+                              int minor_segments);
 
 void add_primitive_light_exec(dna::Object *obj, float size);
 
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+namespace vektor::kernel {
+
+/**
+ * Case-insensitive trigram index over `dna::ID::name`.
+ *
+ * Kept up to date incrementally by #ECSRegistry as entities are created, renamed and destroyed,
+ * so the outliner search never has to walk the registry. Writers (GUI thread) take an exclusive
+ * lock, queries take a shared lock and may run on a worker thread.
+ *
+ * Posting lists are append-only: a removed or renamed entity leaves stale postings behind which
+ * are rejected by their stamp during queries and compacted once they outnumber the live ones.
+ */
+class NameIndex {
+ public:
+  /** Insert or replace the indexed name of `entity`. */
+  void insert(entt::entity entity, const char *name);
+  void rename(entt::entity entity, const char *name);
+  void remove(entt::entity entity);
+  void clear();
+
+  /**
+   * Collect every entity whose name contains `text` (case-insensitive) into `r_hits`.
+   *
+   * Queries of three or more characters only visit the shortest posting list among the query
+   * trigrams; shorter queries fall back to a linear scan of the names.
+   * Returns false when `cancel` was raised before the query finished, `r_hits` is then partial.
+   */
+  bool query(std::string_view text,
+             std::vector<entt::entity> &r_hits,
+             const std::atomic<bool> *cancel = nullptr) const;
+
+  [[nodiscard]] size_t size() const;
+
+ private:
+  struct Entry {
+    std::string name; /* Lower-case. */
+    uint32_t stamp;
+    uint32_t num_postings;
+  };
+
+  struct Posting {
+    entt::entity entity;
+    uint32_t stamp;
+  };
+
+  void insert_locked(entt::entity entity, const char *name);
+  void remove_locked(entt::entity entity);
+  void compact_locked();
+
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<entt::entity, Entry> entries_;
+  std::unordered_map<uint32_t, std::vector<Posting>> trigrams_;
+  uint32_t next_stamp_ = 0;
+  size_t live_postings_ = 0;
+  size_t stale_postings_ = 0;
+};
+
+}  // namespace vektor::kernel
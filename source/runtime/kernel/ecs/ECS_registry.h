@@ -3,6 +3,14 @@
 #include <entt/entt.hpp>
 
 #include "../../rna/RNA_internal.h"
+#include "ECS_hierarchy.h"
+#include "ECS_name_index.h"
+#include "ECS_selection.h"
+#include "ECS_transform_buffers.h"
+
+namespace vektor::dna {
+struct Transform;
+}  // namespace vektor::dna
 
 namespace vektor::kernel {
 class ECSRegistry {
@@ -55,17 +63,49 @@ class ECSRegistry {
 
   void destroy_entity(entt::entity entity)
   {
+    selection_.deselect(entity);
+    name_index_.remove(entity);
+    hierarchy_.remove(entity);
     registry_.destroy(entity);
   }
 
+  /** Name lookup for the outliner search, see #NameIndex. */
+  NameIndex &name_index()
+  {
+    return name_index_;
+  }
+
+  Selection &selection()
+  {
+    return selection_;
+  }
+
+  /** Object transforms in SoA columns for the Rust solver, see #TransformBuffers. */
+  TransformBuffers &transforms()
+  {
+    return transforms_;
+  }
+
+  /** Object parenting and world matrices, see #Hierarchy. */
+  Hierarchy &hierarchy()
+  {
+    return hierarchy_;
+  }
+
   explicit operator entt::registry &()
   {
     return registry_;
   }
 
  private:
-  ECSRegistry() = default;
+  ECSRegistry() : selection_(registry_), transforms_(registry_), hierarchy_(registry_, transforms_)
+  {
+  }
   entt::registry registry_;
+  NameIndex name_index_;
+  Selection selection_;
+  TransformBuffers transforms_;
+  Hierarchy hierarchy_;
 };
 
 void create_entity(rna::VektorRNA *v_rna,
@@ -79,4 +119,13 @@ void create_entity(rna::VektorRNA *v_rna,
                    float r,
                    float g,
                    float b);
+
+void destroy_entity(entt::entity entity);
+/** Change the display name of an object, keeping the name index in sync. */
+void rename_entity(entt::entity entity, const char *name);
+/**
+ * Set the local transform of an object and refresh its row in #TransformBuffers, so that the
+ * next #Hierarchy::update_world_matrices picks it up.
+ */
+void set_entity_transform(entt::entity entity, const dna::Transform &transform);
 }  // namespace vektor::kernel
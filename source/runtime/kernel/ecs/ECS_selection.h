@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+namespace vektor::kernel {
+
+/** What a single selection operation changed. Listeners only ever see non-empty deltas. */
+struct SelectionDelta {
+  std::vector<entt::entity> selected;
+  std::vector<entt::entity> deselected;
+  entt::entity active_old = entt::null;
+  entt::entity active_new = entt::null;
+
+  [[nodiscard]] bool active_changed() const
+  {
+    return active_old != active_new;
+  }
+
+  [[nodiscard]] bool empty() const
+  {
+    return selected.empty() && deselected.empty() && !active_changed();
+  }
+};
+
+/**
+ * Object selection, owned by #ECSRegistry.
+ *
+ * Selected entities live in a dense set so that clearing or drawing the selection costs
+ * O(selected) instead of a walk over every object. `dna::Object::select_flag` is kept in sync
+ * for the entities that change. Every public operation notifies listeners at most once, with
+ * the combined delta. Main thread only.
+ */
+class Selection {
+ public:
+  using Listener = std::function<void(const SelectionDelta &delta)>;
+
+  explicit Selection(entt::registry &registry);
+
+  [[nodiscard]] bool is_selected(entt::entity entity) const;
+  [[nodiscard]] size_t size() const;
+
+  /** Selected entities in no particular order, invalidated by the next change. */
+  [[nodiscard]] std::span<const entt::entity> selected() const;
+
+  /** The active object, or `entt::null`. The active object is always selected. */
+  [[nodiscard]] entt::entity active() const;
+
+  void select(entt::entity entity);
+  void deselect(entt::entity entity);
+  void select(std::span<const entt::entity> entities);
+  void deselect(std::span<const entt::entity> entities);
+
+  /** Select `entity` and make it active, `entt::null` only clears the active handle. */
+  void set_active(entt::entity entity);
+
+  /** Replace the whole selection, e.g. for click picking, as a single delta. */
+  void assign(std::span<const entt::entity> entities, entt::entity active = entt::null);
+
+  void clear();
+
+  /** Returns a handle for #remove_listener. */
+  uint32_t add_listener(Listener listener);
+  void remove_listener(uint32_t handle);
+
+ private:
+  void select_impl(entt::entity entity, SelectionDelta &delta);
+  void deselect_impl(entt::entity entity, SelectionDelta &delta);
+  void set_flag(entt::entity entity, uint32_t flag, bool value);
+  void notify(SelectionDelta &delta);
+
+  entt::registry &registry_;
+  entt::sparse_set selected_;
+  entt::entity active_ = entt::null;
+
+  std::vector<std::pair<uint32_t, Listener>> listeners_;
+  uint32_t next_listener_ = 1;
+};
+
+}  // namespace vektor::kernel
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <entt/entt.hpp>
+
+namespace vektor::kernel {
+
+/**
+ * Object transforms in SoA form, owned by #ECSRegistry and handed to the Rust transform solver
+ * by pointer and length, without copies.
+ *
+ * Every `dna::Object` has one row. Location, rotation and scale are one float column per
+ * component, the local and world matrices are 16 floats per row. Each column starts on a
+ * 64 byte boundary, so every matrix fills exactly one cache line.
+ *
+ * Rows follow `dna::Object` through the storage signals of the registry: created on
+ * construction, refreshed on update and removed (swap and pop) on destruction. Code that edits
+ * `dna::Object::transform` in place must call `registry.patch<dna::Object>(entity)` afterwards.
+ * Main thread only.
+ */
+class TransformBuffers {
+ public:
+  enum Column {
+    LOCATION_X,
+    LOCATION_Y,
+    LOCATION_Z,
+    ROTATION_X,
+    ROTATION_Y,
+    ROTATION_Z,
+    SCALE_X,
+    SCALE_Y,
+    SCALE_Z,
+    COLUMNS_NUM,
+  };
+
+  explicit TransformBuffers(entt::registry &registry);
+  ~TransformBuffers();
+
+  TransformBuffers(const TransformBuffers &) = delete;
+  TransformBuffers &operator=(const TransformBuffers &) = delete;
+
+  [[nodiscard]] size_t size() const
+  {
+    return rows_.size();
+  }
+
+  /** Floats between the starts of two columns, a multiple of 16. */
+  [[nodiscard]] size_t stride() const
+  {
+    return capacity_;
+  }
+
+  [[nodiscard]] bool contains(entt::entity entity) const
+  {
+    return rows_.contains(entity);
+  }
+
+  [[nodiscard]] uint32_t row(entt::entity entity) const
+  {
+    return (uint32_t)rows_.index(entity);
+  }
+
+  /** Entity of every row, in row order. */
+  [[nodiscard]] std::span<const entt::entity> entities() const
+  {
+    return {rows_.data(), rows_.size()};
+  }
+
+  /** All #COLUMNS_NUM columns, column `c` starts at `c * stride()`. */
+  [[nodiscard]] std::span<const float> columns() const
+  {
+    return {data_, COLUMNS_NUM * capacity_};
+  }
+
+  [[nodiscard]] const float *column(Column column) const
+  {
+    return data_ + column * capacity_;
+  }
+
+  /** Parent row of every row, UINT32_MAX for roots. Written by #Hierarchy. */
+  [[nodiscard]] std::span<uint32_t> parents()
+  {
+    return {parents_, rows_.size()};
+  }
+
+  [[nodiscard]] std::span<float> local_matrices()
+  {
+    return {data_ + COLUMNS_NUM * capacity_, rows_.size() * 16};
+  }
+
+  [[nodiscard]] std::span<float> world_matrices()
+  {
+    return {data_ + (COLUMNS_NUM + 16) * capacity_, rows_.size() * 16};
+  }
+
+  /** Incremented whenever rows move or disappear, #Hierarchy re-sorts on a change. */
+  [[nodiscard]] uint64_t layout_version() const
+  {
+    return layout_version_;
+  }
+
+  /** Move the rows so that row `order[i]` becomes row `i`. `order` is a permutation. */
+  void reorder(std::span<const uint32_t> order);
+
+ private:
+  void on_construct(entt::registry &registry, entt::entity entity);
+  void on_update(entt::registry &registry, entt::entity entity);
+  void on_destroy(entt::registry &registry, entt::entity entity);
+
+  void write_row(uint32_t row, entt::entity entity);
+  void copy_row(uint32_t dst, uint32_t src);
+  void reserve(size_t rows);
+
+  entt::registry &registry_;
+  entt::sparse_set rows_;
+  uint64_t layout_version_ = 0;
+
+  /* #COLUMNS_NUM float columns, then the local and world matrices, all from one allocation. */
+  float *data_ = nullptr;
+  uint32_t *parents_ = nullptr;
+  size_t capacity_ = 0;
+};
+
+}  // namespace vektor::kernel
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "../../../dna/DNA_object_type.h"
+#include "rust/intern/src/lib.rs.h"
+
+#include "../ECS_hierarchy.h"
+
+namespace vektor::kernel {
+
+Hierarchy::Hierarchy(entt::registry &registry, TransformBuffers &transforms)
+    : registry_(registry), transforms_(transforms)
+{
+}
+
+bool Hierarchy::set_parent(entt::entity child, entt::entity parent)
+{
+  auto *object = registry_.try_get<dna::Object>(child);
+  if (object == nullptr) {
+    return false;
+  }
+  if (parent != entt::null) {
+    if (!registry_.all_of<dna::Object>(parent)) {
+      return false;
+    }
+    for (entt::entity ancestor = parent; ancestor != entt::null; ancestor = this->parent(ancestor))
+    {
+      if (ancestor == child) {
+        return false;
+      }
+    }
+  }
+  object->parent = (uint32_t)parent;
+  order_dirty_ = true;
+  return true;
+}
+
+entt::entity Hierarchy::parent(entt::entity child) const
+{
+  const auto *object = registry_.try_get<dna::Object>(child);
+  if (object == nullptr || object->parent == dna::OB_NO_PARENT) {
+    return entt::null;
+  }
+  const auto parent = (entt::entity)object->parent;
+  return registry_.valid(parent) ? parent : entt::null;
+}
+
+void Hierarchy::remove(entt::entity entity)
+{
+  for (auto [child, object] : registry_.view<dna::Object>().each()) {
+    if (object.parent == (uint32_t)entity) {
+      object.parent = dna::OB_NO_PARENT;
+    }
+  }
+  order_dirty_ = true;
+}
+
+void Hierarchy::rebuild_order()
+{
+  const std::span<const entt::entity> entities = transforms_.entities();
+  const size_t count = entities.size();
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> parent_rows;
+  std::vector<bool> placed(count, false);
+  order.reserve(count);
+  parent_rows.reserve(count);
+
+  std::unordered_map<entt::entity, std::vector<uint32_t>> children;
+  for (uint32_t row = 0; row < count; row++) {
+    const entt::entity parent = this->parent(entities[row]);
+    if (parent == entt::null || !transforms_.contains(parent)) {
+      order.push_back(row);
+      parent_rows.push_back(UINT32_MAX);
+      placed[row] = true;
+    }
+    else {
+      children[parent].push_back(row);
+    }
+  }
+
+  /* `order` doubles as the queue. */
+  for (size_t i = 0; i < order.size(); i++) {
+    auto it = children.find(entities[order[i]]);
+    if (it == children.end()) {
+      continue;
+    }
+    for (uint32_t child : it->second) {
+      order.push_back(child);
+      parent_rows.push_back((uint32_t)i);
+      placed[child] = true;
+    }
+  }
+  /* Objects in a parenting loop, which set_parent() refuses, are never reached. They are
+   * evaluated as roots. */
+  for (uint32_t row = 0; row < count; row++) {
+    if (!placed[row]) {
+      order.push_back(row);
+      parent_rows.push_back(UINT32_MAX);
+    }
+  }
+
+  transforms_.reorder(order);
+  std::span<uint32_t> parents = transforms_.parents();
+  std::copy(parent_rows.begin(), parent_rows.end(), parents.begin());
+  layout_version_ = transforms_.layout_version();
+  order_dirty_ = false;
+}
+
+void Hierarchy::update_world_matrices()
+{
+  if (order_dirty_ || layout_version_ != transforms_.layout_version()) {
+    rebuild_order();
+  }
+  const size_t count = transforms_.size();
+  if (count == 0) {
+    return;
+  }
+
+  const std::span<const float> columns = transforms_.columns();
+  const std::span<uint32_t> parents = transforms_.parents();
+  const std::span<float> locals = transforms_.local_matrices();
+  const std::span<float> worlds = transforms_.world_matrices();
+  compute_transforms_rs({columns.data(), columns.size()},
+                        transforms_.stride(),
+                        {parents.data(), parents.size()},
+                        {locals.data(), locals.size()},
+                        {worlds.data(), worlds.size()});
+
+  /* The draw manager reads the matrices from the objects. */
+  const std::span<const entt::entity> entities = transforms_.entities();
+  for (size_t row = 0; row < count; row++) {
+    dna::Object &object = registry_.get<dna::Object>(entities[row]);
+    memcpy(&object.object_to_world[0][0], &worlds[row * 16], sizeof(float) * 16);
+  }
+}
+
+}  // namespace vektor::kernel
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+
+#include "../ECS_name_index.h"
+
+namespace vektor::kernel {
+
+/* How often long scans poll the cancel flag. */
+#define NAME_INDEX_CANCEL_STRIDE 4096
+
+static std::string name_to_lower(std::string_view name)
+{
+  std::string lower(name);
+  for (char &c : lower) {
+    c = (char)std::tolower((unsigned char)c);
+  }
+  return lower;
+}
+
+static uint32_t trigram_key(const char *str)
+{
+  return ((uint32_t)(uint8_t)str[0] << 16) | ((uint32_t)(uint8_t)str[1] << 8) |
+         (uint32_t)(uint8_t)str[2];
+}
+
+static bool is_cancelled(const std::atomic<bool> *cancel)
+{
+  return cancel && cancel->load(std::memory_order_relaxed);
+}
+
+void NameIndex::insert_locked(entt::entity entity, const char *name)
+{
+  remove_locked(entity);
+
+  Entry &entry = entries_[entity];
+  entry.name = name_to_lower(name ? name : "");
+  entry.stamp = next_stamp_++;
+
+  /* Repeated trigrams ("aaaa") are posted once so queries never report duplicates. */
+  const std::string &lower = entry.name;
+  std::vector<uint32_t> keys;
+  for (size_t i = 0; i + 3 <= lower.size(); i++) {
+    keys.push_back(trigram_key(lower.data() + i));
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  for (const uint32_t key : keys) {
+    trigrams_[key].push_back({entity, entry.stamp});
+  }
+  entry.num_postings = (uint32_t)keys.size();
+  live_postings_ += keys.size();
+}
+
+void NameIndex::remove_locked(entt::entity entity)
+{
+  auto it = entries_.find(entity);
+  if (it == entries_.end()) {
+    return;
+  }
+  live_postings_ -= it->second.num_postings;
+  stale_postings_ += it->second.num_postings;
+  entries_.erase(it);
+
+  if (stale_postings_ > live_postings_ && stale_postings_ > 1024) {
+    compact_locked();
+  }
+}
+
+void NameIndex::compact_locked()
+{
+  for (auto it = trigrams_.begin(); it != trigrams_.end();) {
+    std::vector<Posting> &postings = it->second;
+    std::erase_if(postings, [this](const Posting &posting) {
+      auto entry = entries_.find(posting.entity);
+      return entry == entries_.end() || entry->second.stamp != posting.stamp;
+    });
+    if (postings.empty()) {
+      it = trigrams_.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+  stale_postings_ = 0;
+}
+
+void NameIndex::insert(entt::entity entity, const char *name)
+{
+  std::unique_lock lock(mutex_);
+  insert_locked(entity, name);
+}
+
+void NameIndex::rename(entt::entity entity, const char *name)
+{
+  insert(entity, name);
+}
+
+void NameIndex::remove(entt::entity entity)
+{
+  std::unique_lock lock(mutex_);
+  remove_locked(entity);
+}
+
+void NameIndex::clear()
+{
+  std::unique_lock lock(mutex_);
+  entries_.clear();
+  trigrams_.clear();
+  live_postings_ = 0;
+  stale_postings_ = 0;
+}
+
+size_t NameIndex::size() const
+{
+  std::shared_lock lock(mutex_);
+  return entries_.size();
+}
+
+bool NameIndex::query(std::string_view text,
+                      std::vector<entt::entity> &r_hits,
+                      const std::atomic<bool> *cancel) const
+{
+  const std::string needle = name_to_lower(text);
+  std::shared_lock lock(mutex_);
+
+  if (needle.size() < 3) {
+    size_t i = 0;
+    for (const auto &[entity, entry] : entries_) {
+      if ((++i % NAME_INDEX_CANCEL_STRIDE) == 0 && is_cancelled(cancel)) {
+        return false;
+      }
+      if (entry.name.find(needle) != std::string::npos) {
+        r_hits.push_back(entity);
+      }
+    }
+    return true;
+  }
+
+  /* Every match contains all of the needle's trigrams, so the shortest posting list is a
+   * complete candidate set. Candidates are verified against the full name afterwards. */
+  const std::vector<Posting> *candidates = nullptr;
+  for (size_t i = 0; i + 3 <= needle.size(); i++) {
+    auto it = trigrams_.find(trigram_key(needle.data() + i));
+    if (it == trigrams_.end()) {
+      return true;
+    }
+    if (!candidates || it->second.size() < candidates->size()) {
+      candidates = &it->second;
+    }
+  }
+
+  size_t i = 0;
+  for (const Posting &posting : *candidates) {
+    if ((++i % NAME_INDEX_CANCEL_STRIDE) == 0 && is_cancelled(cancel)) {
+      return false;
+    }
+    auto entry = entries_.find(posting.entity);
+    if (entry == entries_.end() || entry->second.stamp != posting.stamp) {
+      continue;
+    }
+    if (needle.size() == 3 || entry->second.name.find(needle) != std::string::npos) {
+      r_hits.push_back(posting.entity);
+    }
+  }
+  return true;
+}
+
+}  // namespace vektor::kernel
@@ -34,6 +34,7 @@ void create_entity(rna::VektorRNA *v_rna,
   object->type = (dna::ObjectType)type;
   strncpy(object->id.name, name, sizeof(object->id.name) - 1);
   object->id.name[sizeof(object->id.name) - 1] = '\0';
+  registry.name_index().insert(entity, object->id.name);
 
   strncpy(object->description, description, sizeof(object->description) - 1);
   object->description[sizeof(object->description) - 1] = '\0';
@@ -51,6 +52,15 @@ void create_entity(rna::VektorRNA *v_rna,
     else if (std::string(name).find("Plane") != std::string::npos) {
       add_primitive_plane_exec(object, 10.0f);
     }
+    else if (std::string(name).find("Sphere") != std::string::npos) {
+      add_primitive_uv_sphere_exec(object, 1.0f, 32, 16);
+    }
+    else if (std::string(name).find("Torus") != std::string::npos) {
+      add_primitive_torus_exec(object, 1.0f, 0.25f, 48, 12);
+    }
+    else if (std::string(name).find("Grid") != std::string::npos) {
+      add_primitive_grid_exec(object, 10.0f, 10, 10);
+    }
     else {
       add_primitive_cylinder_exec(object, 1.0f, 2.0f, 32);
     }
@@ -65,6 +75,9 @@ void create_entity(rna::VektorRNA *v_rna,
     object->transform.location.y = 5.0f;
   }
 
+  /* Refresh the transform row, which was filled in when the object was constructed. */
+  registry.registry().patch<dna::Object>(entity);
+
   // Apply material color from creation parameters
   if (object->mesh && !object->mesh->materials.empty()) {
     object->mesh->materials[0]->color.r = r;
@@ -88,4 +101,29 @@ void destroy_entity(entt::entity entity)
   ECSRegistry::instance().destroy_entity(entity);
   outliner_notify_scene_changed();
 }
+
+void rename_entity(entt::entity entity, const char *name)
+{
+  auto &registry = ECSRegistry::instance();
+  if (!registry.has_component<dna::Object>(entity)) {
+    return;
+  }
+  auto &object = registry.get_component<dna::Object>(entity);
+  strncpy(object.id.name, name, sizeof(object.id.name) - 1);
+  object.id.name[sizeof(object.id.name) - 1] = '\0';
+  registry.name_index().rename(entity, object.id.name);
+
+  outliner_notify_scene_changed();
+}
+
+void set_entity_transform(entt::entity entity, const dna::Transform &transform)
+{
+  auto &registry = ECSRegistry::instance();
+  if (!registry.has_component<dna::Object>(entity)) {
+    return;
+  }
+  /* The update signal refreshes the transform row that the world matrices are solved from. */
+  registry.registry().patch<dna::Object>(
+      entity, [&transform](dna::Object &object) { object.transform = transform; });
+}
 }  // namespace vektor::kernel
@@ -0,0 +1,191 @@
+#include "../../../dna/DNA_object_type.h"
+#include "../ECS_selection.h"
+
+namespace vektor::kernel {
+
+Selection::Selection(entt::registry &registry) : registry_(registry) {}
+
+bool Selection::is_selected(entt::entity entity) const
+{
+  return selected_.contains(entity);
+}
+
+size_t Selection::size() const
+{
+  return selected_.size();
+}
+
+std::span<const entt::entity> Selection::selected() const
+{
+  return {selected_.data(), selected_.size()};
+}
+
+entt::entity Selection::active() const
+{
+  return active_;
+}
+
+void Selection::set_flag(entt::entity entity, uint32_t flag, bool value)
+{
+  if (auto *object = registry_.try_get<dna::Object>(entity)) {
+    if (value) {
+      object->select_flag |= flag;
+    }
+    else {
+      object->select_flag &= ~flag;
+    }
+  }
+}
+
+void Selection::select_impl(entt::entity entity, SelectionDelta &delta)
+{
+  if (entity == entt::null || selected_.contains(entity)) {
+    return;
+  }
+  selected_.push(entity);
+  set_flag(entity, dna::BASE_SELECTED, true);
+  delta.selected.push_back(entity);
+}
+
+void Selection::deselect_impl(entt::entity entity, SelectionDelta &delta)
+{
+  if (!selected_.remove(entity)) {
+    return;
+  }
+  if (entity == active_) {
+    active_ = entt::null;
+  }
+  set_flag(entity, dna::BASE_SELECTED | dna::BASE_ACTIVE, false);
+  delta.deselected.push_back(entity);
+}
+
+void Selection::notify(SelectionDelta &delta)
+{
+  delta.active_new = active_;
+  if (delta.empty()) {
+    return;
+  }
+  /* Copied so that listeners may unregister themselves. */
+  const auto listeners = listeners_;
+  for (const auto &[handle, listener] : listeners) {
+    listener(delta);
+  }
+}
+
+void Selection::select(entt::entity entity)
+{
+  SelectionDelta delta;
+  delta.active_old = active_;
+  select_impl(entity, delta);
+  notify(delta);
+}
+
+void Selection::deselect(entt::entity entity)
+{
+  SelectionDelta delta;
+  delta.active_old = active_;
+  deselect_impl(entity, delta);
+  notify(delta);
+}
+
+void Selection::select(std::span<const entt::entity> entities)
+{
+  SelectionDelta delta;
+  delta.active_old = active_;
+  for (const entt::entity entity : entities) {
+    select_impl(entity, delta);
+  }
+  notify(delta);
+}
+
+void Selection::deselect(std::span<const entt::entity> entities)
+{
+  SelectionDelta delta;
+  delta.active_old = active_;
+  for (const entt::entity entity : entities) {
+    deselect_impl(entity, delta);
+  }
+  notify(delta);
+}
+
+void Selection::set_active(entt::entity entity)
+{
+  SelectionDelta delta;
+  delta.active_old = active_;
+
+  if (active_ != entt::null) {
+    set_flag(active_, dna::BASE_ACTIVE, false);
+  }
+  select_impl(entity, delta);
+  active_ = entity;
+  if (active_ != entt::null) {
+    set_flag(active_, dna::BASE_ACTIVE, true);
+  }
+  notify(delta);
+}
+
+void Selection::assign(std::span<const entt::entity> entities, entt::entity active)
+{
+  SelectionDelta delta;
+  delta.active_old = active_;
+
+  entt::sparse_set incoming;
+  for (const entt::entity entity : entities) {
+    if (entity != entt::null && !incoming.contains(entity)) {
+      incoming.push(entity);
+    }
+  }
+
+  std::vector<entt::entity> outgoing;
+  for (const entt::entity entity : selected()) {
+    if (!incoming.contains(entity)) {
+      outgoing.push_back(entity);
+    }
+  }
+  for (const entt::entity entity : outgoing) {
+    deselect_impl(entity, delta);
+  }
+  for (const entt::entity entity : incoming) {
+    select_impl(entity, delta);
+  }
+
+  if (active_ != active) {
+    if (active_ != entt::null) {
+      set_flag(active_, dna::BASE_ACTIVE, false);
+    }
+    select_impl(active, delta);
+    active_ = active;
+    if (active_ != entt::null) {
+      set_flag(active_, dna::BASE_ACTIVE, true);
+    }
+  }
+  notify(delta);
+}
+
+void Selection::clear()
+{
+  SelectionDelta delta;
+  delta.active_old = active_;
+
+  delta.deselected.assign(selected_.data(), selected_.data() + selected_.size());
+  for (const entt::entity entity : delta.deselected) {
+    set_flag(entity, dna::BASE_SELECTED | dna::BASE_ACTIVE, false);
+  }
+  selected_.clear();
+  active_ = entt::null;
+  notify(delta);
+}
+
+uint32_t Selection::add_listener(Listener listener)
+{
+  const uint32_t handle = next_listener_++;
+  listeners_.emplace_back(handle, std::move(listener));
+  return handle;
+}
+
+void Selection::remove_listener(uint32_t handle)
+{
+  std::erase_if(listeners_, [handle](const auto &entry) { return entry.first == handle; });
+}
+
+}  // namespace vektor::kernel
@@ -0,0 +1,171 @@
+#include <cstring>
+#include <vector>
+
+#include "../../../dna/DNA_object_type.h"
+#include "MEM_gaurdalloc.h"
+
+#include "../ECS_transform_buffers.h"
+
+namespace vektor::kernel {
+
+/* Columns start on a cache line, and a cache line holds 16 floats. */
+#define TRANSFORM_ALIGN 64
+#define TRANSFORM_ROWS_STEP 16
+
+/* Float columns of one allocation: the transform components, then the local and world
+ * matrices of 16 floats each. */
+#define TRANSFORM_FLOAT_COLUMNS (TransformBuffers::COLUMNS_NUM + 32)
+
+TransformBuffers::TransformBuffers(entt::registry &registry) : registry_(registry)
+{
+  registry_.on_construct<dna::Object>().connect<&TransformBuffers::on_construct>(*this);
+  registry_.on_update<dna::Object>().connect<&TransformBuffers::on_update>(*this);
+  registry_.on_destroy<dna::Object>().connect<&TransformBuffers::on_destroy>(*this);
+}
+
+TransformBuffers::~TransformBuffers()
+{
+  registry_.on_construct<dna::Object>().disconnect<&TransformBuffers::on_construct>(*this);
+  registry_.on_update<dna::Object>().disconnect<&TransformBuffers::on_update>(*this);
+  registry_.on_destroy<dna::Object>().disconnect<&TransformBuffers::on_destroy>(*this);
+  if (data_ != nullptr) {
+    MEM_freeN(data_);
+    MEM_freeN(parents_);
+  }
+}
+
+static float *transform_data_alloc(size_t capacity)
+{
+  return static_cast<float *>(mem::MEM_new_array_zeroed_aligned(
+      TRANSFORM_FLOAT_COLUMNS * capacity, sizeof(float), TRANSFORM_ALIGN, "TransformBuffers"));
+}
+
+static uint32_t *transform_parents_alloc(size_t capacity)
+{
+  return static_cast<uint32_t *>(mem::MEM_new_array_zeroed_aligned(
+      capacity, sizeof(uint32_t), TRANSFORM_ALIGN, "TransformBuffers.parents"));
+}
+
+void TransformBuffers::reserve(size_t rows)
+{
+  if (rows <= capacity_) {
+    return;
+  }
+  size_t capacity = capacity_ ? capacity_ * 2 : TRANSFORM_ROWS_STEP;
+  while (capacity < rows) {
+    capacity *= 2;
+  }
+
+  float *data = transform_data_alloc(capacity);
+  uint32_t *parents = transform_parents_alloc(capacity);
+  if (data_ != nullptr) {
+    const size_t size = rows_.size();
+    for (int c = 0; c < COLUMNS_NUM; c++) {
+      memcpy(data + c * capacity, data_ + c * capacity_, sizeof(float) * size);
+    }
+    /* The local and world matrices are AoS, each block is copied in one go. */
+    for (int m = 0; m < 2; m++) {
+      memcpy(data + (COLUMNS_NUM + m * 16) * capacity,
+             data_ + (COLUMNS_NUM + m * 16) * capacity_,
+             sizeof(float) * 16 * size);
+    }
+    memcpy(parents, parents_, sizeof(uint32_t) * size);
+    MEM_freeN(data_);
+    MEM_freeN(parents_);
+  }
+  data_ = data;
+  parents_ = parents;
+  capacity_ = capacity;
+}
+
+void TransformBuffers::write_row(uint32_t row, entt::entity entity)
+{
+  const dna::Transform &transform = registry_.get<dna::Object>(entity).transform;
+  const float values[COLUMNS_NUM] = {transform.location.x,
+                                     transform.location.y,
+                                     transform.location.z,
+                                     transform.rotation.x,
+                                     transform.rotation.y,
+                                     transform.rotation.z,
+                                     transform.scale.x,
+                                     transform.scale.y,
+                                     transform.scale.z};
+  for (int c = 0; c < COLUMNS_NUM; c++) {
+    data_[c * capacity_ + row] = values[c];
+  }
+}
+
+void TransformBuffers::copy_row(uint32_t dst, uint32_t src)
+{
+  for (int c = 0; c < COLUMNS_NUM; c++) {
+    data_[c * capacity_ + dst] = data_[c * capacity_ + src];
+  }
+  for (int m = 0; m < 2; m++) {
+    float *matrices = data_ + (COLUMNS_NUM + m * 16) * capacity_;
+    memcpy(matrices + dst * 16, matrices + src * 16, sizeof(float) * 16);
+  }
+  parents_[dst] = parents_[src];
+}
+
+void TransformBuffers::on_construct(entt::registry & /*registry*/, entt::entity entity)
+{
+  reserve(rows_.size() + 1);
+  rows_.push(entity);
+  const uint32_t row = (uint32_t)rows_.size() - 1;
+  write_row(row, entity);
+  parents_[row] = UINT32_MAX;
+  layout_version_++;
+}
+
+void TransformBuffers::on_update(entt::registry & /*registry*/, entt::entity entity)
+{
+  write_row(row(entity), entity);
+}
+
+void TransformBuffers::on_destroy(entt::registry & /*registry*/, entt::entity entity)
+{
+  /* Same swap and pop as the sparse set: the last row fills the hole. */
+  const uint32_t removed = row(entity);
+  const uint32_t last = (uint32_t)rows_.size() - 1;
+  if (removed != last) {
+    copy_row(removed, last);
+  }
+  rows_.erase(entity);
+  layout_version_++;
+}
+
+void TransformBuffers::reorder(std::span<const uint32_t> order)
+{
+  const size_t size = rows_.size();
+  if (size == 0) {
+    return;
+  }
+  float *data = transform_data_alloc(capacity_);
+  uint32_t *parents = transform_parents_alloc(capacity_);
+  std::vector<entt::entity> entities(size);
+
+  for (size_t i = 0; i < size; i++) {
+    const uint32_t src = order[i];
+    for (int c = 0; c < COLUMNS_NUM; c++) {
+      data[c * capacity_ + i] = data_[c * capacity_ + src];
+    }
+    for (int m = 0; m < 2; m++) {
+      const size_t offset = (COLUMNS_NUM + m * 16) * capacity_;
+      memcpy(data + offset + i * 16, data_ + offset + src * 16, sizeof(float) * 16);
+    }
+    parents[i] = parents_[src];
+    entities[i] = rows_.data()[src];
+  }
+
+  rows_.clear();
+  for (entt::entity entity : entities) {
+    rows_.push(entity);
+  }
+  MEM_freeN(data_);
+  MEM_freeN(parents_);
+  data_ = data;
+  parents_ = parents;
+  layout_version_++;
+}
+
+}  // namespace vektor::kernel
@@ -0,0 +1,60 @@
+#include <cassert>
+
+#include "rust/intern/src/lib.rs.h"
+
+#include "VLI_bounds.h"
+
+namespace vektor::lib {
+
+/* Passed to the kernels as plain floats. */
+static_assert(sizeof(dna::MVert) == 8 * sizeof(float));
+static_assert(sizeof(dna::BoundBox) == 6 * sizeof(float));
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float));
+
+static void mesh_bounds_ensure(const dna::Mesh &mesh)
+{
+  if (mesh.bounds_version == mesh.geometry_version) {
+    return;
+  }
+  float result[7] = {0.0f};
+  if (mesh.verts_num > 0 && mesh.mvert) {
+    mesh_bounds_rs({reinterpret_cast<const float *>(mesh.mvert), (size_t)mesh.verts_num * 8},
+                   {result, 7});
+  }
+  mesh.bounds.min = glm::vec3(result[0], result[1], result[2]);
+  mesh.bounds.max = glm::vec3(result[3], result[4], result[5]);
+  mesh.bounds_radius = result[6];
+  mesh.bounds_version = mesh.geometry_version;
+}
+
+const dna::BoundBox &mesh_bounds(const dna::Mesh &mesh)
+{
+  mesh_bounds_ensure(mesh);
+  return mesh.bounds;
+}
+
+float mesh_bounds_radius(const dna::Mesh &mesh)
+{
+  mesh_bounds_ensure(mesh);
+  return mesh.bounds_radius;
+}
+
+void mesh_tag_positions_changed(dna::Mesh &mesh)
+{
+  mesh.geometry_version = dna::mesh_geometry_version_next();
+}
+
+void bounds_transform(std::span<const dna::BoundBox> locals,
+                      std::span<const glm::mat4> matrices,
+                      std::span<dna::BoundBox> r_worlds)
+{
+  assert(locals.size() == matrices.size() && locals.size() == r_worlds.size());
+  if (locals.empty()) {
+    return;
+  }
+  transform_bounds_rs({reinterpret_cast<const float *>(locals.data()), locals.size() * 6},
+                      {reinterpret_cast<const float *>(matrices.data()), matrices.size() * 16},
+                      {reinterpret_cast<float *>(r_worlds.data()), r_worlds.size() * 6});
+}
+
+}  // namespace vektor::lib
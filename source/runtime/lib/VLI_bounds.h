@@ -0,0 +1,33 @@
+#pragma once
+
+#include <span>
+
+#include <glm/glm.hpp>
+#include "../dna/DNA_mesh_types.h"
+
+namespace vektor::lib {
+
+/**
+ * Local box of `mesh`, recomputed by the SIMD reduction of `math_accel` only when
+ * `dna::Mesh::geometry_version` changed since the last call. Main thread only.
+ */
+const dna::BoundBox &mesh_bounds(const dna::Mesh &mesh);
+
+/** Radius of the sphere around the center of #mesh_bounds that holds every vertex. */
+float mesh_bounds_radius(const dna::Mesh &mesh);
+
+/**
+ * Call after writing vertex positions of `mesh`, so the cached bounds are recomputed and the
+ * GPU mesh of the draw manager is rebuilt on next use.
+ */
+void mesh_tag_positions_changed(dna::Mesh &mesh);
+
+/**
+ * World boxes of many objects in one batch: `r_worlds[i]` bounds `locals[i]` under
+ * `matrices[i]`. Arvo's method, as tight as transforming the eight corners.
+ */
+void bounds_transform(std::span<const dna::BoundBox> locals,
+                      std::span<const glm::mat4> matrices,
+                      std::span<dna::BoundBox> r_worlds);
+
+}  // namespace vektor::lib
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <thread>
+
+#include "rust/intern/src/lib.rs.h"
+
+#include "VLI_compute.h"
+
+namespace vektor::lib {
+
+bool compute_init(const ComputeSettings &settings, std::string *r_error)
+{
+  ComputeRuntimeConfig config;
+  config.threads = settings.threads > 0 ?
+                       (size_t)settings.threads :
+                       (size_t)std::max(1, (int)std::thread::hardware_concurrency() - 1);
+  for (int core : settings.cores) {
+    config.cores.push_back((size_t)core);
+  }
+  config.thread_name = rust::String(settings.thread_name);
+  config.cooperative = settings.cooperative;
+
+  const rust::String error = compute_runtime_init_rs(config);
+  if (!error.empty()) {
+    if (r_error) {
+      *r_error = std::string(error);
+    }
+    return false;
+  }
+  return true;
+}
+
+int compute_threads_num()
+{
+  return (int)compute_runtime_threads_rs();
+}
+
+bool compute_lend_thread()
+{
+  return compute_runtime_lend_thread_rs();
+}
+
+void compute_reclaim_threads()
+{
+  compute_runtime_reclaim_threads_rs();
+}
+
+std::vector<ComputeCounter> compute_counters()
+{
+  std::vector<ComputeCounter> counters;
+  for (const ::ComputeCounter &counter : compute_counters_rs()) {
+    counters.push_back(
+        {std::string(counter.name), counter.calls, counter.nanoseconds, counter.max_nanoseconds});
+  }
+  return counters;
+}
+
+void compute_counters_reset()
+{
+  compute_counters_reset_rs();
+}
+
+}  // namespace vektor::lib
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vektor::lib {
+
+/** Thread pool of the Rust compute kernels, see #compute_init. */
+struct ComputeSettings {
+  /** Worker threads, 0 for one per core minus one, which is left to the main thread. */
+  int threads = 0;
+  /** Pin worker `i` to core `cores[i % cores.size()]`, no pinning when empty. Linux only. */
+  std::vector<int> cores;
+  /** Workers are named `<thread_name>:<index>`. */
+  std::string thread_name = "vektor-compute";
+  /**
+   * Create no threads of its own, the job system of the host runs the workers on its threads
+   * with #compute_lend_thread until #compute_reclaim_threads. While no thread is lent, kernels
+   * run single threaded on their caller. #cores must be empty, the threads stay the host's.
+   */
+  bool cooperative = false;
+};
+
+/**
+ * Build the thread pool of the Rust compute kernels. Only possible once and before the first
+ * kernel runs, which would otherwise create one thread per core. Returns false with the reason
+ * in `r_error`.
+ */
+bool compute_init(const ComputeSettings &settings, std::string *r_error = nullptr);
+
+/** Worker threads of the pool, also in cooperative mode before they are lent. */
+int compute_threads_num();
+
+/**
+ * Cooperative mode: run one compute worker on the calling thread until
+ * #compute_reclaim_threads, then return true. Returns false right away when every worker
+ * already has a thread.
+ */
+bool compute_lend_thread();
+
+/**
+ * Cooperative mode: hand the lent threads back. Each returns from #compute_lend_thread once
+ * the kernel it works on finished, the next lend starts the workers again.
+ */
+void compute_reclaim_threads();
+
+/** Time spent in one Rust kernel since the last #compute_counters_reset. */
+struct ComputeCounter {
+  std::string name;
+  uint64_t calls;
+  /** Wall clock time, summed over the calls. */
+  uint64_t nanoseconds;
+  uint64_t max_nanoseconds;
+};
+
+std::vector<ComputeCounter> compute_counters();
+void compute_counters_reset();
+
+}  // namespace vektor::lib
@@ -0,0 +1,109 @@
+#include "rust/intern/src/lib.rs.h"
+
+#include "VLI_cull.h"
+
+namespace vektor::lib {
+
+static_assert(sizeof(CullFrustum) == 24 * sizeof(float));
+
+CullFrustum cull_frustum_from_matrix(const glm::mat4 &matrix)
+{
+  /* Rows of the matrix, added to and subtracted from the w row. */
+  const glm::mat4 m = glm::transpose(matrix);
+  CullFrustum frustum;
+  frustum.planes[0] = m[3] + m[0];
+  frustum.planes[1] = m[3] - m[0];
+  frustum.planes[2] = m[3] + m[1];
+  frustum.planes[3] = m[3] - m[1];
+  frustum.planes[4] = m[3] + m[2];
+  frustum.planes[5] = m[3] - m[2];
+  for (glm::vec4 &plane : frustum.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return frustum;
+}
+
+void CullSpheres::clear()
+{
+  xs.clear();
+  ys.clear();
+  zs.clear();
+  radii.clear();
+}
+
+void CullSpheres::reserve(size_t size)
+{
+  xs.reserve(size);
+  ys.reserve(size);
+  zs.reserve(size);
+  radii.reserve(size);
+}
+
+void CullSpheres::append(const glm::vec3 &center, float radius)
+{
+  xs.push_back(center.x);
+  ys.push_back(center.y);
+  zs.push_back(center.z);
+  radii.push_back(radius);
+}
+
+void CullBoxes::clear()
+{
+  for (std::vector<float> *column : {&min_xs, &min_ys, &min_zs, &max_xs, &max_ys, &max_zs}) {
+    column->clear();
+  }
+}
+
+void CullBoxes::reserve(size_t size)
+{
+  for (std::vector<float> *column : {&min_xs, &min_ys, &min_zs, &max_xs, &max_ys, &max_zs}) {
+    column->reserve(size);
+  }
+}
+
+void CullBoxes::append(const dna::BoundBox &box)
+{
+  min_xs.push_back(box.min.x);
+  min_ys.push_back(box.min.y);
+  min_zs.push_back(box.min.z);
+  max_xs.push_back(box.max.x);
+  max_ys.push_back(box.max.y);
+  max_zs.push_back(box.max.z);
+}
+
+static rust::Slice<const float> cull_planes(const CullFrustum &frustum)
+{
+  return {&frustum.planes[0].x, 24};
+}
+
+void cull_spheres(const CullSpheres &spheres,
+                  const CullFrustum &frustum,
+                  std::vector<uint32_t> &r_visible)
+{
+  r_visible.resize(spheres.size());
+  const size_t visible_num = cull_spheres_rs({spheres.xs.data(), spheres.xs.size()},
+                                             {spheres.ys.data(), spheres.ys.size()},
+                                             {spheres.zs.data(), spheres.zs.size()},
+                                             {spheres.radii.data(), spheres.radii.size()},
+                                             cull_planes(frustum),
+                                             {r_visible.data(), r_visible.size()});
+  r_visible.resize(visible_num);
+}
+
+void cull_boxes(const CullBoxes &boxes,
+                const CullFrustum &frustum,
+                std::vector<uint32_t> &r_visible)
+{
+  r_visible.resize(boxes.size());
+  const size_t visible_num = cull_boxes_rs({boxes.min_xs.data(), boxes.min_xs.size()},
+                                           {boxes.min_ys.data(), boxes.min_ys.size()},
+                                           {boxes.min_zs.data(), boxes.min_zs.size()},
+                                           {boxes.max_xs.data(), boxes.max_xs.size()},
+                                           {boxes.max_ys.data(), boxes.max_ys.size()},
+                                           {boxes.max_zs.data(), boxes.max_zs.size()},
+                                           cull_planes(frustum),
+                                           {r_visible.data(), r_visible.size()});
+  r_visible.resize(visible_num);
+}
+
+}  // namespace vektor::lib
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "../dna/DNA_mesh_types.h"
+
+namespace vektor::lib {
+
+/** Six planes `(a, b, c, d)` with unit normals, the inside at `dot(abc, p) + d >= 0`. */
+struct CullFrustum {
+  glm::vec4 planes[6];
+};
+
+/**
+ * Gribb/Hartmann planes of the frustum of `matrix`, in the space `matrix` maps from: world
+ * space for a view-projection matrix.
+ */
+CullFrustum cull_frustum_from_matrix(const glm::mat4 &matrix);
+
+/** Bounding spheres, one array per component, as the culling kernel reads them. */
+struct CullSpheres {
+  std::vector<float> xs, ys, zs, radii;
+
+  size_t size() const
+  {
+    return xs.size();
+  }
+  void clear();
+  void reserve(size_t size);
+  void append(const glm::vec3 &center, float radius);
+};
+
+/** Axis aligned boxes, one array per component of the min and max corners. */
+struct CullBoxes {
+  std::vector<float> min_xs, min_ys, min_zs;
+  std::vector<float> max_xs, max_ys, max_zs;
+
+  size_t size() const
+  {
+    return min_xs.size();
+  }
+  void clear();
+  void reserve(size_t size);
+  void append(const dna::BoundBox &box);
+};
+
+/**
+ * Indices of the spheres that are not fully outside `frustum`, in increasing order. Eight
+ * spheres per SIMD step in `math_accel`, split over the compute threads for large counts.
+ */
+void cull_spheres(const CullSpheres &spheres,
+                  const CullFrustum &frustum,
+                  std::vector<uint32_t> &r_visible);
+
+/** Like #cull_spheres for boxes, which fit long or flat objects more tightly. */
+void cull_boxes(const CullBoxes &boxes,
+                const CullFrustum &frustum,
+                std::vector<uint32_t> &r_visible);
+
+}  // namespace vektor::lib
@@ -0,0 +1,73 @@
+#include <cstddef>
+
+#include "rust/intern/src/lib.rs.h"
+
+#include "VLI_mesh_normals.h"
+
+namespace vektor::lib {
+
+/* The kernels read the DNA arrays as they are: 8 floats per vertex, 5 words per corner and 2
+ * per face, see `math_accel::normals`. */
+static_assert(sizeof(dna::MVert) == 8 * sizeof(float));
+static_assert(offsetof(dna::MVert, no) == 3 * sizeof(float));
+static_assert(offsetof(dna::MVert, uv) == 6 * sizeof(float));
+static_assert(sizeof(dna::MLoop) == 5 * sizeof(int) && offsetof(dna::MLoop, v) == 0);
+static_assert(sizeof(dna::MPoly) == 2 * sizeof(int));
+
+struct MeshSlices {
+  rust::Slice<const float> verts;
+  rust::Slice<const int32_t> loops;
+  rust::Slice<const int32_t> polys;
+};
+
+static bool mesh_has_faces(const dna::Mesh &mesh)
+{
+  return mesh.mvert && mesh.mloop && mesh.mpoly && mesh.verts_num > 0 && mesh.faces_num > 0;
+}
+
+static MeshSlices mesh_arrays(const dna::Mesh &mesh)
+{
+  return {{reinterpret_cast<const float *>(mesh.mvert), (size_t)mesh.verts_num * 8},
+          {reinterpret_cast<const int32_t *>(mesh.mloop), (size_t)mesh.corners_num * 5},
+          {reinterpret_cast<const int32_t *>(mesh.mpoly), (size_t)mesh.faces_num * 2}};
+}
+
+void mesh_face_normals(const dna::Mesh &mesh, std::vector<glm::vec3> &r_normals)
+{
+  r_normals.assign(mesh.faces_num, glm::vec3(0.0f));
+  if (!mesh_has_faces(mesh)) {
+    return;
+  }
+  const MeshSlices arrays = mesh_arrays(mesh);
+  mesh_face_normals_rs(arrays.verts,
+                       arrays.loops,
+                       arrays.polys,
+                       {reinterpret_cast<float *>(r_normals.data()), r_normals.size() * 3});
+}
+
+void mesh_vertex_normals_update(dna::Mesh &mesh, MeshNormalWeight weight)
+{
+  if (!mesh_has_faces(mesh)) {
+    return;
+  }
+  const MeshSlices arrays = mesh_arrays(mesh);
+  mesh_vertex_normals_rs({reinterpret_cast<float *>(mesh.mvert), arrays.verts.size()},
+                         arrays.loops,
+                         arrays.polys,
+                         weight == MeshNormalWeight::Angle);
+}
+
+void mesh_tangents(const dna::Mesh &mesh, std::vector<glm::vec4> &r_tangents)
+{
+  r_tangents.assign(mesh.corners_num, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+  if (!mesh_has_faces(mesh)) {
+    return;
+  }
+  const MeshSlices arrays = mesh_arrays(mesh);
+  mesh_tangents_rs(arrays.verts,
+                   arrays.loops,
+                   arrays.polys,
+                   {reinterpret_cast<float *>(r_tangents.data()), r_tangents.size() * 4});
+}
+
+}  // namespace vektor::lib
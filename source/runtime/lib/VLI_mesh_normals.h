@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "../dna/DNA_mesh_types.h"
+
+namespace vektor::lib {
+
+/** How the faces around a vertex add up to its normal. */
+enum class MeshNormalWeight {
+  /** Each face counts with its area. */
+  Area,
+  /** Each face counts with its angle at the vertex, independent of the triangulation. */
+  Angle,
+};
+
+/**
+ * Unit normal of every face of `mesh`, degenerate faces get a zero vector. Computed in parallel
+ * by `math_accel`, also for concave n-gons.
+ */
+void mesh_face_normals(const dna::Mesh &mesh, std::vector<glm::vec3> &r_normals);
+
+/**
+ * Recompute `MVert::no` of every vertex from the faces around it. Call after the positions or
+ * the faces changed, and after import. Vertices without faces keep their normal.
+ */
+void mesh_vertex_normals_update(dna::Mesh &mesh,
+                                MeshNormalWeight weight = MeshNormalWeight::Angle);
+
+/**
+ * MikkTSpace tangent of every face corner, as normal maps are baked: `xyz` is the tangent and
+ * `w` the bitangent sign, `bitangent = w * cross(no, xyz)`. Reads `MVert::no` and `MVert::uv`,
+ * so update the normals first. A port of the reference implementation, see
+ * `math_accel::mikktspace`.
+ */
+void mesh_tangents(const dna::Mesh &mesh, std::vector<glm::vec4> &r_tangents);
+
+}  // namespace vektor::lib
@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#include "rust/intern/src/lib.rs.h"
+
+#include "VLI_bounds.h"
+#include "VLI_mesh_primitives.h"
+
+namespace vektor::lib {
+
+/* Written as 32 bit words like the normal kernels read them, see `VLI_mesh_normals.cc`. */
+static_assert(sizeof(dna::MEdge) == 2 * sizeof(int));
+static_assert(sizeof(dna::MLoop) == 5 * sizeof(int));
+static_assert(offsetof(dna::MLoop, e) == 1 * sizeof(int));
+static_assert(offsetof(dna::MLoop, f) == 2 * sizeof(int));
+static_assert(offsetof(dna::MLoop, uv) == 3 * sizeof(int));
+
+void mesh_primitive_create(dna::Mesh &mesh, const MeshPrimitive &primitive)
+{
+  const uint32_t kind = (uint32_t)primitive.type;
+  const uint32_t segments = (uint32_t)std::max(primitive.segments, 0);
+  const uint32_t rings = (uint32_t)std::max(primitive.rings, 0);
+
+  size_t counts[4];
+  mesh_primitive_counts_rs(
+      kind, segments, rings, primitive.size, primitive.depth, {counts, std::size(counts)});
+  mesh.verts_num = (int)counts[0];
+  mesh.edges_num = (int)counts[1];
+  mesh.faces_num = (int)counts[2];
+  mesh.corners_num = (int)counts[3];
+
+  mesh.mvert = new dna::MVert[mesh.verts_num];
+  mesh.medge = new dna::MEdge[mesh.edges_num];
+  mesh.mloop = new dna::MLoop[mesh.corners_num];
+  mesh.mpoly = new dna::MPoly[mesh.faces_num];
+
+  mesh_primitive_rs(kind,
+                    segments,
+                    rings,
+                    primitive.size,
+                    primitive.depth,
+                    {reinterpret_cast<float *>(mesh.mvert), counts[0] * 8},
+                    {reinterpret_cast<int32_t *>(mesh.medge), counts[1] * 2},
+                    {reinterpret_cast<int32_t *>(mesh.mloop), counts[3] * 5},
+                    {reinterpret_cast<int32_t *>(mesh.mpoly), counts[2] * 2});
+  mesh_tag_positions_changed(mesh);
+}
+
+}  // namespace vektor::lib
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../dna/DNA_mesh_types.h"
+
+namespace vektor::lib {
+
+enum class MeshPrimitiveType {
+  /** Square in the xz plane facing +y, `segments` x `rings` quads, `size` wide. */
+  Grid,
+  /** `segments` around the y axis, `rings` from pole to pole, `size` is the radius. */
+  UVSphere,
+  /**
+   * `segments` around the y axis and `rings` around the tube, `size` is the distance of the
+   * tube from the axis and `depth` its radius.
+   */
+  Torus,
+  /** Capped, `segments` around the y axis and `rings` along it, radius `size`. */
+  Cylinder,
+};
+
+/** Parameters of a procedural primitive, centered on the origin with +y up. */
+struct MeshPrimitive {
+  MeshPrimitiveType type = MeshPrimitiveType::Grid;
+  int segments = 32;
+  int rings = 16;
+  float size = 1.0f;
+  float depth = 2.0f;
+};
+
+/**
+ * Allocate the vertex, edge, corner and face arrays of `mesh` for `primitive` and fill them in
+ * parallel in `math_accel`: positions, normals and uvs, edges, and corners with their edge,
+ * face and uv. Quads come first, then the triangles of sphere poles and cylinder caps.
+ * Spheres, cylinders and tori repeat the vertices of their uv seam, so that the vertex uvs are
+ * continuous up to it. Resolutions below the minimum of a shape are raised to it. The previous
+ * arrays of `mesh` are not freed.
+ */
+void mesh_primitive_create(dna::Mesh &mesh, const MeshPrimitive &primitive);
+
+}  // namespace vektor::lib
@@ -0,0 +1,209 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "VLI_profile.h"
+
+namespace vektor::lib {
+
+namespace internal {
+std::atomic<bool> profile_active{false};
+}  // namespace internal
+
+struct ProfileZone {
+  const char *name;
+  uint64_t start_ns;
+  uint64_t end_ns;
+};
+
+/* Zones of one thread. Only the owning thread writes, the trace is read after recording stops. */
+struct ProfileRing {
+  std::string thread_name;
+  int tid;
+  /* Zones ever written, the ring holds the last #PROFILE_RING_ZONES of them. */
+  std::atomic<uint64_t> head{0};
+  uint64_t frame_start_ns = 0;
+  ProfileZone zones[PROFILE_RING_ZONES];
+};
+
+static struct {
+  /* Guards the ring list and the trace path, not the zones. */
+  std::mutex mutex;
+  /* Rings are never freed, threads that outlive #profile_end may still hold theirs. */
+  std::vector<ProfileRing *> rings;
+  ProfileRing *gpu_ring = nullptr;
+  /* Track 0 is the GPU. */
+  int next_tid = 1;
+  std::string trace_path;
+  std::chrono::steady_clock::time_point begin_time;
+} profile;
+
+static thread_local ProfileRing *profile_thread_ring = nullptr;
+
+static ProfileRing *profile_ring_create(const char *thread_name, int tid)
+{
+  ProfileRing *ring = new ProfileRing();
+  ring->thread_name = thread_name;
+  ring->tid = tid;
+  profile.rings.push_back(ring);
+  return ring;
+}
+
+static ProfileRing *profile_thread_ring_ensure()
+{
+  if (!profile_thread_ring) {
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    const int tid = profile.next_tid++;
+    profile_thread_ring = profile_ring_create(("thread " + std::to_string(tid)).c_str(), tid);
+  }
+  return profile_thread_ring;
+}
+
+static void profile_ring_push(ProfileRing *ring,
+                              const char *name,
+                              uint64_t start_ns,
+                              uint64_t end_ns)
+{
+  const uint64_t head = ring->head.load(std::memory_order_relaxed);
+  ring->zones[head % PROFILE_RING_ZONES] = {name, start_ns, end_ns};
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t profile_time_ns()
+{
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - profile.begin_time)
+                      .count());
+}
+
+bool profile_begin(const char *trace_path)
+{
+#ifdef WITH_PROFILER
+  if (profile_is_active()) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    profile.trace_path = trace_path;
+    for (ProfileRing *ring : profile.rings) {
+      ring->head.store(0, std::memory_order_relaxed);
+      ring->frame_start_ns = 0;
+    }
+    if (!profile.gpu_ring) {
+      profile.gpu_ring = profile_ring_create("GPU", 0);
+    }
+  }
+  profile_thread_name_set("main");
+  profile.begin_time = std::chrono::steady_clock::now();
+  internal::profile_active.store(true, std::memory_order_release);
+
+  static bool end_registered = false;
+  if (!end_registered) {
+    std::atexit(profile_end);
+    end_registered = true;
+  }
+  return true;
+#else
+  (void)trace_path;
+  return false;
+#endif
+}
+
+static void profile_write_string(FILE *file, const char *text)
+{
+  fputc('"', file);
+  for (const char *c = text; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      fputc('\\', file);
+    }
+    fputc((unsigned char)*c < 0x20 ? ' ' : *c, file);
+  }
+  fputc('"', file);
+}
+
+void profile_end()
+{
+  if (!internal::profile_active.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  FILE *file = fopen(profile.trace_path.c_str(), "w");
+  if (!file) {
+    fprintf(stderr, "Profiler: cannot open \"%s\" for writing.\n", profile.trace_path.c_str());
+    return;
+  }
+
+  /* Chrome trace format, timestamps in microseconds. */
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  bool first = true;
+  for (const ProfileRing *ring : profile.rings) {
+    fprintf(file,
+            "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+            first ? "" : ",",
+            ring->tid);
+    profile_write_string(file, ring->thread_name.c_str());
+    fprintf(file, "}}");
+    first = false;
+
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    const uint64_t begin = head > PROFILE_RING_ZONES ? head - PROFILE_RING_ZONES : 0;
+    for (uint64_t i = begin; i < head; i++) {
+      const ProfileZone &zone = ring->zones[i % PROFILE_RING_ZONES];
+      fprintf(file, ",\n{\"ph\":\"X\",\"name\":");
+      profile_write_string(file, zone.name);
+      fprintf(file,
+              ",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+              ring->tid,
+              double(zone.start_ns) / 1e3,
+              double(zone.end_ns - zone.start_ns) / 1e3);
+    }
+    if (begin > 0) {
+      fprintf(stderr,
+              "Profiler: %llu older zones of \"%s\" were overwritten.\n",
+              (unsigned long long)begin,
+              ring->thread_name.c_str());
+    }
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+}
+
+void profile_frame()
+{
+  if (!profile_is_active()) {
+    return;
+  }
+  ProfileRing *ring = profile_thread_ring_ensure();
+  const uint64_t now = profile_time_ns();
+  if (ring->frame_start_ns) {
+    profile_ring_push(ring, "frame", ring->frame_start_ns, now);
+  }
+  ring->frame_start_ns = now;
+}
+
+void profile_zone(const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+  /* The scope may have started before #profile_end. */
+  if (profile_is_active()) {
+    profile_ring_push(profile_thread_ring_ensure(), name, start_ns, end_ns);
+  }
+}
+
+void profile_gpu_zone(const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+  if (profile_is_active()) {
+    profile_ring_push(profile.gpu_ring, name, start_ns, end_ns);
+  }
+}
+
+void profile_thread_name_set(const char *name)
+{
+  ProfileRing *ring = profile_thread_ring_ensure();
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  ring->thread_name = name;
+}
+
+}  // namespace vektor::lib
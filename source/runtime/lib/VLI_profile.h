@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Frame Profiler
+ *
+ * Scoped CPU zones with nanosecond timestamps, written by each thread into its own ring buffer
+ * of the most recent #PROFILE_RING_ZONES zones, plus GPU zones from `GPU_profile.h` on their own
+ * track. #profile_end writes everything as Chrome trace JSON, which chrome://tracing, Perfetto
+ * and Speedscope open:
+ *
+ *   void draw_scene()
+ *   {
+ *     VK_PROFILE_SCOPE("draw_scene");
+ *     ...
+ *   }
+ *
+ * Zones cost one relaxed load while the profiler is not running. Configuring with
+ * `-DVEKTOR_PROFILER=OFF` removes the macros entirely, #profile_begin then fails.
+ */
+
+namespace vektor::lib {
+
+/** Zones kept per thread, older ones are overwritten. */
+#define PROFILE_RING_ZONES (1 << 16)
+
+/**
+ * Start recording zones, written to `trace_path` by #profile_end. Returns false when the
+ * profiler is already running or was compiled out.
+ */
+bool profile_begin(const char *trace_path);
+
+/** Write the trace and stop recording. Also runs at exit when not called before. */
+void profile_end();
+
+namespace internal {
+extern std::atomic<bool> profile_active;
+}  // namespace internal
+
+inline bool profile_is_active()
+{
+  return internal::profile_active.load(std::memory_order_relaxed);
+}
+
+/** Nanoseconds since #profile_begin, on the clock of the zones. */
+uint64_t profile_time_ns();
+
+/**
+ * Mark the end of a frame on the calling thread, shown as one `frame` zone from the previous
+ * mark. Call at the start of the paint function.
+ */
+void profile_frame();
+
+/** Record a zone of the calling thread, `name` must outlive the profiler, e.g. a literal. */
+void profile_zone(const char *name, uint64_t start_ns, uint64_t end_ns);
+
+/** Record a zone on the GPU track, in #profile_time_ns time. Render thread only. */
+void profile_gpu_zone(const char *name, uint64_t start_ns, uint64_t end_ns);
+
+/** Name of the calling thread in the trace, `main` for the one that began profiling. */
+void profile_thread_name_set(const char *name);
+
+/** Records the time from construction to destruction as a zone, see #VK_PROFILE_SCOPE. */
+class ProfileScope {
+ public:
+  explicit ProfileScope(const char *name)
+      : name_(profile_is_active() ? name : nullptr), start_ns_(name_ ? profile_time_ns() : 0)
+  {
+  }
+  ~ProfileScope()
+  {
+    if (name_) {
+      profile_zone(name_, start_ns_, profile_time_ns());
+    }
+  }
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+ private:
+  const char *name_;
+  uint64_t start_ns_;
+};
+
+}  // namespace vektor::lib
+
+#define VK_PROFILE_CONCAT_(a, b) a##b
+#define VK_PROFILE_CONCAT(a, b) VK_PROFILE_CONCAT_(a, b)
+
+#ifdef WITH_PROFILER
+/** Time the rest of the enclosing block as a zone named `name`, a string literal. */
+#  define VK_PROFILE_SCOPE(name) \
+    const ::vektor::lib::ProfileScope VK_PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+/** Mark the start of a frame, see #vektor::lib::profile_frame. */
+#  define VK_PROFILE_FRAME() ::vektor::lib::profile_frame()
+#else
+#  define VK_PROFILE_SCOPE(name) ((void)0)
+#  define VK_PROFILE_FRAME() ((void)0)
+#endif
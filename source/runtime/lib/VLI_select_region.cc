@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+
+#include "MEM_arena.h"
+
+#include "rust/intern/src/lib.rs.h"
+
+#include "VLI_bounds.h"
+#include "VLI_cull.h"
+#include "VLI_select_region.h"
+
+namespace vektor::lib {
+
+static_assert(sizeof(dna::MVert) == 8 * sizeof(float));
+
+/* Narrows a projection to a pixel rectangle of `viewport` (origin top-left), the frustum of
+ * `region_matrix * view_projection` passes through the rectangle. */
+static glm::mat4 region_matrix(const glm::vec2 &viewport, const glm::vec4 &rect)
+{
+  const float x0 = rect.x / viewport.x * 2.0f - 1.0f;
+  const float x1 = std::max(rect.z, rect.x + 1.0f) / viewport.x * 2.0f - 1.0f;
+  const float y0 = 1.0f - std::max(rect.w, rect.y + 1.0f) / viewport.y * 2.0f;
+  const float y1 = 1.0f - rect.y / viewport.y * 2.0f;
+
+  glm::mat4 region = glm::mat4(1.0f);
+  region[0][0] = 2.0f / (x1 - x0);
+  region[1][1] = 2.0f / (y1 - y0);
+  region[3][0] = -(x0 + x1) / (x1 - x0);
+  region[3][1] = -(y0 + y1) / (y1 - y0);
+  return region;
+}
+
+/* Objects left over by the broad phase. The narrow phase reads each object's `MVert` array in
+ * place, only its address and length are gathered. The arrays live in the thread's scratch
+ * arena for the duration of one selection. */
+struct SelectCandidates {
+  std::pmr::vector<uint32_t> indices;
+  std::pmr::vector<size_t> verts;
+  std::pmr::vector<size_t> verts_nums;
+
+  SelectCandidates(size_t count, std::pmr::memory_resource *resource)
+      : indices(resource), verts(resource), verts_nums(resource)
+  {
+    indices.reserve(count);
+    verts.reserve(count);
+    verts_nums.reserve(count);
+  }
+
+  void add(uint32_t index, const dna::Mesh *mesh)
+  {
+    indices.push_back(index);
+    verts.push_back((size_t)(uintptr_t)mesh->mvert);
+    verts_nums.push_back((size_t)mesh->verts_num);
+  }
+};
+
+static bool object_has_vertices(const SelectRegionObject &object)
+{
+  return object.mesh && object.mesh->verts_num > 0 && object.mesh->mvert;
+}
+
+/* Broad phase: the objects with vertices whose world box is not fully outside `frustum`, in
+ * increasing order. The boxes are transformed and culled in one batch each by the kernels the
+ * draw manager culls with. */
+static void select_broad_phase(std::span<const SelectRegionObject> objects,
+                               const CullFrustum &frustum,
+                               std::pmr::memory_resource *resource,
+                               std::pmr::vector<uint32_t> &r_indices)
+{
+  std::pmr::vector<uint32_t> indices(resource);
+  std::pmr::vector<dna::BoundBox> locals(resource);
+  std::pmr::vector<glm::mat4> matrices(resource);
+  for (uint32_t i = 0; i < (uint32_t)objects.size(); i++) {
+    if (object_has_vertices(objects[i])) {
+      indices.push_back(i);
+      locals.push_back(mesh_bounds(*objects[i].mesh));
+      matrices.push_back(objects[i].model);
+    }
+  }
+
+  std::pmr::vector<dna::BoundBox> worlds(locals.size(), resource);
+  bounds_transform(locals, matrices, worlds);
+  CullBoxes boxes;
+  boxes.reserve(worlds.size());
+  for (const dna::BoundBox &world : worlds) {
+    boxes.append(world);
+  }
+  std::vector<uint32_t> visible;
+  cull_boxes(boxes, frustum, visible);
+  for (const uint32_t index : visible) {
+    r_indices.push_back(indices[index]);
+  }
+}
+
+void select_region_box(std::span<const SelectRegionObject> objects,
+                       const glm::mat4 &view_projection,
+                       const glm::vec2 &viewport,
+                       const glm::vec4 &rect,
+                       std::vector<uint8_t> &r_hits)
+{
+  r_hits.assign(objects.size(), 0);
+  const CullFrustum frustum = cull_frustum_from_matrix(region_matrix(viewport, rect) *
+                                                       view_projection);
+
+  mem::MEM_ArenaScope scope;
+  mem::MEM_ArenaResource resource(scope.arena());
+  std::pmr::vector<uint32_t> indices(&resource);
+  select_broad_phase(objects, frustum, &resource, indices);
+
+  SelectCandidates candidates(indices.size(), &resource);
+  std::pmr::vector<float> planes(&resource);
+  planes.reserve(indices.size() * 24);
+  for (const uint32_t i : indices) {
+    /* Move the planes into object space instead of transforming every vertex. */
+    const glm::mat4 model_t = glm::transpose(objects[i].model);
+    for (const glm::vec4 &plane : frustum.planes) {
+      const glm::vec4 local = model_t * plane;
+      planes.insert(planes.end(), {local.x, local.y, local.z, local.w});
+    }
+    candidates.add(i, objects[i].mesh);
+  }
+
+  if (candidates.indices.empty()) {
+    return;
+  }
+
+  std::pmr::vector<uint8_t> hits(candidates.indices.size(), 0, &resource);
+  select_points_in_frustum_rs({candidates.verts.data(), candidates.verts.size()},
+                              {candidates.verts_nums.data(), candidates.verts_nums.size()},
+                              {planes.data(), planes.size()},
+                              {hits.data(), hits.size()});
+  for (size_t i = 0; i < hits.size(); i++) {
+    r_hits[candidates.indices[i]] = hits[i];
+  }
+}
+
+void select_region_lasso(std::span<const SelectRegionObject> objects,
+                         const glm::mat4 &view_projection,
+                         const glm::vec2 &viewport,
+                         std::span<const glm::vec2> polygon,
+                         std::vector<uint8_t> &r_hits)
+{
+  r_hits.assign(objects.size(), 0);
+  if (polygon.size() < 3) {
+    return;
+  }
+
+  glm::vec2 min = polygon[0], max = polygon[0];
+  for (const glm::vec2 &point : polygon) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+  const CullFrustum frustum = cull_frustum_from_matrix(
+      region_matrix(viewport, glm::vec4(min.x, min.y, max.x, max.y)) * view_projection);
+
+  mem::MEM_ArenaScope scope;
+  mem::MEM_ArenaResource resource(scope.arena());
+  std::pmr::vector<uint32_t> indices(&resource);
+  select_broad_phase(objects, frustum, &resource, indices);
+
+  SelectCandidates candidates(indices.size(), &resource);
+  std::pmr::vector<float> matrices(&resource);
+  matrices.reserve(indices.size() * 16);
+  for (const uint32_t i : indices) {
+    const glm::mat4 mvp = view_projection * objects[i].model;
+    matrices.insert(matrices.end(), &mvp[0][0], &mvp[0][0] + 16);
+    candidates.add(i, objects[i].mesh);
+  }
+
+  if (candidates.indices.empty()) {
+    return;
+  }
+
+  const float viewport_size[2] = {viewport.x, viewport.y};
+  std::pmr::vector<uint8_t> hits(candidates.indices.size(), 0, &resource);
+  select_points_in_polygon_rs({candidates.verts.data(), candidates.verts.size()},
+                              {candidates.verts_nums.data(), candidates.verts_nums.size()},
+                              {matrices.data(), matrices.size()},
+                              {viewport_size, 2},
+                              {&polygon[0].x, polygon.size() * 2},
+                              {hits.data(), hits.size()});
+  for (size_t i = 0; i < hits.size(); i++) {
+    r_hits[candidates.indices[i]] = hits[i];
+  }
+}
+
+}  // namespace vektor::lib
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "../dna/DNA_mesh_types.h"
+
+namespace vektor::lib {
+
+/** An object taking part in region selection. */
+struct SelectRegionObject {
+  const dna::Mesh *mesh;
+  glm::mat4 model;
+};
+
+/**
+ * Box selection. Sets `r_hits[i]` to 1 when any vertex of `objects[i]` lies inside the frustum
+ * through `rect` (min x, min y, max x, max y in pixels of `viewport`, origin top-left).
+ *
+ * Objects whose world box is fully outside the frustum are rejected in one batch by the culling
+ * kernel of #cull_boxes. The vertices of the remaining objects are tested in parallel by the
+ * SIMD kernels of `math_accel`, which read each mesh's `MVert` array in place.
+ */
+void select_region_box(std::span<const SelectRegionObject> objects,
+                       const glm::mat4 &view_projection,
+                       const glm::vec2 &viewport,
+                       const glm::vec4 &rect,
+                       std::vector<uint8_t> &r_hits);
+
+/**
+ * Lasso selection. Sets `r_hits[i]` to 1 when any vertex of `objects[i]` projects inside
+ * `polygon` (pixels, origin top-left). The frustum through the polygon bounds rejects objects
+ * in the broad phase, the crossing test runs in `math_accel`.
+ */
+void select_region_lasso(std::span<const SelectRegionObject> objects,
+                         const glm::mat4 &view_projection,
+                         const glm::vec2 &viewport,
+                         std::span<const glm::vec2> polygon,
+                         std::vector<uint8_t> &r_hits);
+
+}  // namespace vektor::lib
@@ -8,6 +8,7 @@
  */
 
 #include "../../intern/clog/CLG_log.h"
+#include "../../intern/gaurdalloc/MEM_gaurdalloc.h"
 #include "../dna/DNA_genfile.h"
 #include "VLO_readfile.hh"
 
@@ -59,9 +60,10 @@ static bool read_header(FileData *fd)
 
 static BHead *read_bhead(FileData *fd)
 {
-  BHead *bh = (BHead *)malloc(sizeof(BHead));
+  /* One header per file block, pooled to keep large files off the general heap. */
+  BHead *bh = mem::MEM_pool_new<BHead>();
   if (fread(bh, sizeof(BHead), 1, fd->file) != 1) {
-    free(bh);
+    mem::MEM_pool_delete(bh);
     return nullptr;
   }
   return bh;
@@ -125,14 +127,14 @@ VktFileData *VLO_read_from_file(const char *filepath)
       CLOG_INFO(V_LOG, "Loaded DNA with %d structs", (int)fd->filesdna->structs.size());
     }
     else if (bh->code == VLO_CODE_ENDB) {
-      free(bh);
+      mem::MEM_pool_delete(bh);
       break;
     }
     else {
       // Skip data for now
       fseek(fd->file, bh->len, SEEK_CUR);
     }
-    free(bh);
+    mem::MEM_pool_delete(bh);
   }
 
   auto *vfd = new VktFileData();
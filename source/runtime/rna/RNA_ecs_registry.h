@@ -17,7 +17,12 @@ dna::Object *RNA_ecs_get_object(kernel::ECSRegistry *registry, entt::entity enti
 bool RNA_ecs_is_selected(kernel::ECSRegistry *registry, entt::entity entity);
 void RNA_ecs_set_selected(kernel::ECSRegistry *registry, entt::entity entity, bool selected);
 void RNA_ecs_set_active(kernel::ECSRegistry *registry, entt::entity entity, bool active);
+entt::entity RNA_ecs_get_active(kernel::ECSRegistry *registry);
+void RNA_ecs_clear_selection(kernel::ECSRegistry *registry);
 void RNA_ecs_destroy_entity(kernel::ECSRegistry *registry, entt::entity entity);
+/** Parent `child` to `parent` (`entt::null` clears it), false when it would make a loop. */
+bool RNA_ecs_set_parent(kernel::ECSRegistry *registry, entt::entity child, entt::entity parent);
+entt::entity RNA_ecs_get_parent(kernel::ECSRegistry *registry, entt::entity child);
 #ifdef __cplusplus
 }
 #endif
@@ -28,31 +28,53 @@ dna::Object *RNA_ecs_get_object(ECSRegistry *registry, entt::entity entity)
 
 bool RNA_ecs_is_selected(ECSRegistry *registry, entt::entity entity)
 {
-  if (registry->registry().any_of<dna::Selected>(entity)) {
-    return registry->registry().get<dna::Selected>(entity).selected;
-  }
-  return false;
+  return registry->selection().is_selected(entity);
 }
 
 void RNA_ecs_set_selected(ECSRegistry *registry, entt::entity entity, bool selected)
 {
-  registry->emplace_or_replace<dna::Selected>(entity, selected);
+  if (selected) {
+    registry->selection().select(entity);
+  }
+  else {
+    registry->selection().deselect(entity);
+  }
 }
 
 void RNA_ecs_set_active(ECSRegistry *registry, entt::entity entity, bool active)
 {
+  Selection &selection = registry->selection();
   if (active) {
-    auto view = registry->registry().view<dna::Active>();
-    for (auto ent : view) {
-      registry->emplace_or_replace<dna::Active>(ent, false);
-    }
+    selection.set_active(entity);
+  }
+  else if (selection.active() == entity) {
+    selection.set_active(entt::null);
   }
-  registry->emplace_or_replace<dna::Active>(entity, active);
+}
+
+entt::entity RNA_ecs_get_active(ECSRegistry *registry)
+{
+  return registry->selection().active();
+}
+
+void RNA_ecs_clear_selection(ECSRegistry *registry)
+{
+  registry->selection().clear();
 }
 
 void RNA_ecs_destroy_entity(ECSRegistry *registry, entt::entity entity)
 {
   registry->destroy_entity(entity);
 }
+
+bool RNA_ecs_set_parent(ECSRegistry *registry, entt::entity child, entt::entity parent)
+{
+  return registry->hierarchy().set_parent(child, parent);
+}
+
+entt::entity RNA_ecs_get_parent(ECSRegistry *registry, entt::entity child)
+{
+  return registry->hierarchy().parent(child);
+}
 }
 }  // namespace vektor::rna
@@ -6,7 +6,18 @@ namespace vektor::vmo {
 
 void vmo_create_cube_exec(dna::Mesh *mesh, float size);
 void vmo_create_plane_exec(dna::Mesh *mesh, float size);
-void vmo_create_cylinder_exec(dna::Mesh *mesh, float radius, float depth, int segments);
+
+/* Generated in parallel by `math_accel` with complete topology, see `lib::MeshPrimitive`. The
+ * grid lies in the xz plane, `y_subdivisions` runs along z. */
+void vmo_create_cylinder_exec(
+    dna::Mesh *mesh, float radius, float depth, int segments, int rings = 1);
+void vmo_create_uv_sphere_exec(dna::Mesh *mesh, float radius, int segments, int rings);
+void vmo_create_grid_exec(dna::Mesh *mesh, float size, int x_subdivisions, int y_subdivisions);
+void vmo_create_torus_exec(dna::Mesh *mesh,
+                           float major_radius,
+                           float minor_radius,
+                           int major_segments,
+                           int minor_segments);
 
 void vmo_create_light_exec(dna::Mesh *mesh, float size);
 
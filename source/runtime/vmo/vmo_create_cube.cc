@@ -1,5 +1,8 @@
 #include "VMO_execute.h"
 
+#include "../lib/VLI_bounds.h"
+#include "../lib/VLI_mesh_normals.h"
+
 namespace vektor::vmo {
 
 void vmo_create_cube_exec(dna::Mesh *mesh, float size)
@@ -16,15 +19,6 @@ void vmo_create_cube_exec(dna::Mesh *mesh, float size)
 
   // Faces and Vertices configuration
   // Front, Back, Top, Bottom, Right, Left
-  glm::vec3 normals[6] = {
-      glm::vec3( 0.0f,  0.0f,  1.0f), // Front
-      glm::vec3( 0.0f,  0.0f, -1.0f), // Back
-      glm::vec3( 0.0f,  1.0f,  0.0f), // Top
-      glm::vec3( 0.0f, -1.0f,  0.0f), // Bottom
-      glm::vec3( 1.0f,  0.0f,  0.0f), // Right
-      glm::vec3(-1.0f,  0.0f,  0.0f)  // Left
-  };
-
   glm::vec3 positions[6][4] = {
       // Front (z = off)
       { {-off, -off,  off}, { off, -off,  off}, { off,  off,  off}, {-off,  off,  off} },
@@ -47,7 +41,6 @@ void vmo_create_cube_exec(dna::Mesh *mesh, float size)
     
     for (int j = 0; j < 4; j++) {
       mesh->mvert[v_idx].co = positions[i][j];
-      mesh->mvert[v_idx].no = normals[i];
       // Basic UV layout
       mesh->mvert[v_idx].uv = glm::vec2((j == 1 || j == 2) ? 1.0f : 0.0f, (j == 2 || j == 3) ? 1.0f : 0.0f);
       
@@ -55,6 +48,10 @@ void vmo_create_cube_exec(dna::Mesh *mesh, float size)
       v_idx++;
     }
   }
+
+  /* Every vertex belongs to one face, so the vertex normals are the face normals. */
+  lib::mesh_vertex_normals_update(*mesh);
+  lib::mesh_tag_positions_changed(*mesh);
 }
 
 }  // namespace vektor::vmo
@@ -0,0 +1,17 @@
+#include "VMO_execute.h"
+
+#include "../lib/VLI_mesh_primitives.h"
+
+namespace vektor::vmo {
+
+void vmo_create_grid_exec(dna::Mesh *mesh, float size, int x_subdivisions, int y_subdivisions)
+{
+  lib::MeshPrimitive primitive;
+  primitive.type = lib::MeshPrimitiveType::Grid;
+  primitive.segments = x_subdivisions;
+  primitive.rings = y_subdivisions;
+  primitive.size = size;
+  lib::mesh_primitive_create(*mesh, primitive);
+}
+
+}  // namespace vektor::vmo
@@ -2,6 +2,8 @@
 #include <cmath>
 #include <glm/glm.hpp>
 
+#include "../lib/VLI_bounds.h"
+
 namespace vektor::vmo {
 
 #ifndef M_PI
@@ -57,6 +59,8 @@ void vmo_create_light_exec(dna::Mesh *mesh, float size)
       p_idx++;
     }
   }
+
+  lib::mesh_tag_positions_changed(*mesh);
 }
 
 }  // namespace vektor::vmo
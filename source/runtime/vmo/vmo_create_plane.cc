@@ -1,5 +1,7 @@
 #include "VMO_execute.h"
 
+#include "../lib/VLI_bounds.h"
+
 namespace vektor::vmo {
 
 void vmo_create_plane_exec(dna::Mesh *mesh, float size)
@@ -44,6 +46,8 @@ void vmo_create_plane_exec(dna::Mesh *mesh, float size)
   mesh->mloop[5].v = 2;
   mesh->mloop[6].v = 1;
   mesh->mloop[7].v = 0;
+
+  lib::mesh_tag_positions_changed(*mesh);
 }
 
 }  // namespace vektor::vmo
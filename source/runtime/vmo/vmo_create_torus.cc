@@ -0,0 +1,22 @@
+#include "VMO_execute.h"
+
+#include "../lib/VLI_mesh_primitives.h"
+
+namespace vektor::vmo {
+
+void vmo_create_torus_exec(dna::Mesh *mesh,
+                           float major_radius,
+                           float minor_radius,
+                           int major_segments,
+                           int minor_segments)
+{
+  lib::MeshPrimitive primitive;
+  primitive.type = lib::MeshPrimitiveType::Torus;
+  primitive.segments = major_segments;
+  primitive.rings = minor_segments;
+  primitive.size = major_radius;
+  primitive.depth = minor_radius;
+  lib::mesh_primitive_create(*mesh, primitive);
+}
+
+}  // namespace vektor::vmo
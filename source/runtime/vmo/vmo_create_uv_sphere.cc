@@ -0,0 +1,17 @@
+#include "VMO_execute.h"
+
+#include "../lib/VLI_mesh_primitives.h"
+
+namespace vektor::vmo {
+
+void vmo_create_uv_sphere_exec(dna::Mesh *mesh, float radius, int segments, int rings)
+{
+  lib::MeshPrimitive primitive;
+  primitive.type = lib::MeshPrimitiveType::UVSphere;
+  primitive.segments = segments;
+  primitive.rings = rings;
+  primitive.size = radius;
+  lib::mesh_primitive_create(*mesh, primitive);
+}
+
+}  // namespace vektor::vmo
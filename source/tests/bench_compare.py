@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Compare two `vektor_bench --json` runs:
+
+    python3 source/tests/bench_compare.py base.json new.json [--threshold 5]
+
+Prints the change of the median time of every benchmark in both runs. A benchmark counts as
+slower or faster when both its median and its fastest repetition moved by more than the
+threshold in percent, which keeps single noisy repetitions from flagging it. Exits with 1 when
+a benchmark got slower, so the script can gate a change.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path, encoding='utf-8') as file:
+        run = json.load(file)
+    return run.get('context', {}), {b['name']: b for b in run['benchmarks']}
+
+
+def format_time(ns):
+    for unit, scale in (('s', 1e9), ('ms', 1e6), ('us', 1e3)):
+        if ns >= scale:
+            return f'{ns / scale:.2f} {unit}'
+    return f'{ns:.1f} ns'
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare two vektor_bench JSON runs.')
+    parser.add_argument('base')
+    parser.add_argument('new')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='change in percent that counts, 5 by default')
+    args = parser.parse_args()
+
+    base_context, base = load(args.base)
+    new_context, new = load(args.new)
+    for key in ('num_cpus', 'compute_threads', 'build_type'):
+        if base_context.get(key) != new_context.get(key):
+            print(f'Note: {key} differs, {base_context.get(key)} -> {new_context.get(key)}')
+
+    limit = args.threshold / 100.0
+    slower = faster = 0
+    print(f'{"benchmark":44} {"base":>12} {"new":>12} {"change":>9}')
+    for name, b in base.items():
+        n = new.get(name)
+        if n is None:
+            continue
+        change = n['median_ns'] / b['median_ns'] - 1.0
+        min_change = n['min_ns'] / b['min_ns'] - 1.0
+        verdict = ''
+        if change > limit and min_change > limit:
+            verdict = 'SLOWER'
+            slower += 1
+        elif change < -limit and min_change < -limit:
+            verdict = 'faster'
+            faster += 1
+        print(f'{name:44} {format_time(b["median_ns"]):>12} {format_time(n["median_ns"]):>12} '
+              f'{change * 100.0:+8.1f}% {verdict}')
+    only_base = len(base.keys() - new.keys())
+    only_new = len(new.keys() - base.keys())
+
+    print(f'\n{slower} slower, {faster} faster, threshold {args.threshold:g}%')
+    if only_base or only_new:
+        print(f'{only_base} only in {args.base}, {only_new} only in {args.new}')
+    return 1 if slower else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,288 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "rust/intern/src/lib.rs.h"
+
+#include "../runtime/lib/VLI_bounds.h"
+#include "../runtime/lib/VLI_cull.h"
+#include "../runtime/lib/VLI_mesh_normals.h"
+#include "../runtime/lib/VLI_mesh_primitives.h"
+#include "bench_harness.h"
+
+/* The Rust compute entry points, through the cxx bridge like the engine calls them. The batch
+ * sizes span the single threaded cutoffs of the kernels, the thread count is set with
+ * `--compute-threads`. */
+
+using namespace vektor;
+
+/* Deterministic values in -1..1, so runs compare. */
+static std::vector<float> bench_floats(size_t count, float seed)
+{
+  std::vector<float> values(count);
+  for (size_t i = 0; i < count; i++) {
+    values[i] = std::sin(float(i) * 0.618f + seed);
+  }
+  return values;
+}
+
+/* Chains of four: every fourth node is a root, the others are the child of the previous one. */
+static std::vector<uint32_t> bench_parents(size_t count)
+{
+  std::vector<uint32_t> parents(count);
+  for (size_t i = 0; i < count; i++) {
+    parents[i] = (i % 4) ? uint32_t(i - 1) : UINT32_MAX;
+  }
+  return parents;
+}
+
+static void bench_compute_transforms(bench::State &state)
+{
+  const size_t count = size_t(state.arg());
+  const std::vector<float> columns = bench_floats(9 * count, 0.0f);
+  const std::vector<uint32_t> parents = bench_parents(count);
+  std::vector<float> locals(count * 16), worlds(count * 16);
+
+  while (state.keep_running()) {
+    compute_transforms_rs({columns.data(), columns.size()},
+                          count,
+                          {parents.data(), parents.size()},
+                          {locals.data(), locals.size()},
+                          {worlds.data(), worlds.size()});
+    bench::clobber_memory();
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_compute_transforms, 1000, 100000);
+
+static void bench_compute_world_matrices(bench::State &state)
+{
+  const size_t count = size_t(state.arg());
+  const std::vector<float> locals = bench_floats(count * 16, 1.0f);
+  const std::vector<uint32_t> parents = bench_parents(count);
+  std::vector<float> worlds(count * 16);
+
+  while (state.keep_running()) {
+    compute_world_matrices_rs({locals.data(), locals.size()},
+                              {parents.data(), parents.size()},
+                              {worlds.data(), worlds.size()});
+    bench::clobber_memory();
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_compute_world_matrices, 1000, 100000);
+
+static void bench_multiply_matrices(bench::State &state)
+{
+  const size_t count = size_t(state.arg());
+  const std::vector<float> a = bench_floats(count * 16, 2.0f);
+  const std::vector<float> b = bench_floats(count * 16, 3.0f);
+  std::vector<float> outs(count * 16);
+
+  while (state.keep_running()) {
+    multiply_matrices_rs({a.data(), a.size()}, {b.data(), b.size()}, {outs.data(), outs.size()});
+    bench::clobber_memory();
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_multiply_matrices, 1000, 100000);
+
+static void bench_matrix_vector_muls(bench::State &state)
+{
+  const size_t count = size_t(state.arg());
+  const std::vector<float> matrices = bench_floats(count * 16, 4.0f);
+  const std::vector<float> vectors = bench_floats(count * 4, 5.0f);
+  std::vector<float> outs(count * 4);
+
+  while (state.keep_running()) {
+    compute_matrix_vector_muls_rs({matrices.data(), matrices.size()},
+                                  {vectors.data(), vectors.size()},
+                                  {outs.data(), outs.size()},
+                                  count);
+    bench::clobber_memory();
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_matrix_vector_muls, 1000, 1000000);
+
+static void bench_add_vectors(bench::State &state)
+{
+  const size_t count = size_t(state.arg());
+  const std::vector<float> a = bench_floats(count * 4, 6.0f);
+  const std::vector<float> b = bench_floats(count * 4, 7.0f);
+  std::vector<float> outs(count * 4);
+
+  while (state.keep_running()) {
+    add_vectors_rs(
+        {a.data(), a.size()}, {b.data(), b.size()}, {outs.data(), outs.size()}, count);
+    bench::clobber_memory();
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_add_vectors, 1000, 1000000);
+
+static void bench_dot_products(bench::State &state)
+{
+  const size_t count = size_t(state.arg());
+  const std::vector<float> a = bench_floats(count * 4, 8.0f);
+  const std::vector<float> b = bench_floats(count * 4, 9.0f);
+  std::vector<float> outs(count);
+
+  while (state.keep_running()) {
+    dot_products_rs(
+        {a.data(), a.size()}, {b.data(), b.size()}, {outs.data(), outs.size()}, count);
+    bench::clobber_memory();
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_dot_products, 1000, 1000000);
+
+/* A grid of `arg` x `arg` quads, for the mesh kernels. */
+static void bench_grid_create(dna::Mesh &mesh, int64_t resolution)
+{
+  lib::MeshPrimitive primitive;
+  primitive.type = lib::MeshPrimitiveType::Grid;
+  primitive.segments = int(resolution);
+  primitive.rings = int(resolution);
+  primitive.size = 10.0f;
+  lib::mesh_primitive_create(mesh, primitive);
+}
+
+static void bench_mesh_free(dna::Mesh &mesh)
+{
+  delete[] mesh.mvert;
+  delete[] mesh.medge;
+  delete[] mesh.mloop;
+  delete[] mesh.mpoly;
+  mesh = dna::Mesh();
+}
+
+static void bench_mesh_face_normals(bench::State &state)
+{
+  dna::Mesh mesh;
+  bench_grid_create(mesh, state.arg());
+  std::vector<glm::vec3> normals;
+
+  while (state.keep_running()) {
+    lib::mesh_face_normals(mesh, normals);
+    bench::do_not_optimize(normals.data());
+  }
+  state.set_items_per_iteration(mesh.faces_num);
+  bench_mesh_free(mesh);
+}
+BENCH_REGISTER(bench_mesh_face_normals, 64, 1024);
+
+static void bench_mesh_vertex_normals(bench::State &state)
+{
+  dna::Mesh mesh;
+  bench_grid_create(mesh, state.arg());
+
+  while (state.keep_running()) {
+    lib::mesh_vertex_normals_update(mesh);
+    bench::clobber_memory();
+  }
+  state.set_items_per_iteration(mesh.verts_num);
+  bench_mesh_free(mesh);
+}
+BENCH_REGISTER(bench_mesh_vertex_normals, 64, 1024);
+
+static void bench_mesh_tangents(bench::State &state)
+{
+  dna::Mesh mesh;
+  bench_grid_create(mesh, state.arg());
+  std::vector<glm::vec4> tangents;
+
+  while (state.keep_running()) {
+    lib::mesh_tangents(mesh, tangents);
+    bench::do_not_optimize(tangents.data());
+  }
+  state.set_items_per_iteration(mesh.corners_num);
+  bench_mesh_free(mesh);
+}
+BENCH_REGISTER(bench_mesh_tangents, 64, 1024);
+
+/* The positions are tagged as changed every iteration, so the cache never hits. */
+static void bench_mesh_bounds(bench::State &state)
+{
+  dna::Mesh mesh;
+  bench_grid_create(mesh, state.arg());
+
+  while (state.keep_running()) {
+    lib::mesh_tag_positions_changed(mesh);
+    bench::do_not_optimize(lib::mesh_bounds(mesh).max.x);
+  }
+  state.set_items_per_iteration(mesh.verts_num);
+  bench_mesh_free(mesh);
+}
+BENCH_REGISTER(bench_mesh_bounds, 64, 1024);
+
+static void bench_bounds_transform(bench::State &state)
+{
+  const size_t count = size_t(state.arg());
+  const std::vector<float> values = bench_floats(count * 4, 10.0f);
+  std::vector<dna::BoundBox> locals(count), worlds(count);
+  std::vector<glm::mat4> matrices(count);
+  for (size_t i = 0; i < count; i++) {
+    const glm::vec3 center(values[i * 4], values[i * 4 + 1], values[i * 4 + 2]);
+    locals[i].min = center - glm::vec3(1.0f);
+    locals[i].max = center + glm::vec3(1.0f);
+    matrices[i] = glm::mat4(1.0f);
+    matrices[i][3] = glm::vec4(center * 50.0f, 1.0f);
+  }
+
+  while (state.keep_running()) {
+    lib::bounds_transform(locals, matrices, worlds);
+    bench::clobber_memory();
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_bounds_transform, 1000, 100000);
+
+/* Spheres scattered around the camera of a 90 degree frustum, which sees a part of them. */
+static void bench_cull_spheres(bench::State &state)
+{
+  const size_t count = size_t(state.arg());
+  const std::vector<float> values = bench_floats(count * 4, 11.0f);
+  lib::CullSpheres spheres;
+  spheres.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    const glm::vec3 center(values[i * 4], values[i * 4 + 1], values[i * 4 + 2]);
+    spheres.append(center * 20.0f, std::abs(values[i * 4 + 3]));
+  }
+  glm::mat4 projection(0.0f);
+  projection[0][0] = 1.0f;
+  projection[1][1] = 1.0f;
+  projection[2][2] = -1.002f;
+  projection[2][3] = -1.0f;
+  projection[3][2] = -0.2002f;
+  const lib::CullFrustum frustum = lib::cull_frustum_from_matrix(projection);
+  std::vector<uint32_t> visible;
+
+  while (state.keep_running()) {
+    lib::cull_spheres(spheres, frustum, visible);
+    bench::do_not_optimize(visible.data());
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_cull_spheres, 1000, 100000);
+
+/* Allocation and generation of a sphere with `arg` x `arg / 2` faces. */
+static void bench_mesh_primitive(bench::State &state)
+{
+  lib::MeshPrimitive primitive;
+  primitive.type = lib::MeshPrimitiveType::UVSphere;
+  primitive.segments = int(state.arg());
+  primitive.rings = int(state.arg() / 2);
+  int faces_num = 0;
+
+  while (state.keep_running()) {
+    dna::Mesh mesh;
+    lib::mesh_primitive_create(mesh, primitive);
+    faces_num = mesh.faces_num;
+    bench_mesh_free(mesh);
+  }
+  state.set_items_per_iteration(faces_num);
+}
+BENCH_REGISTER(bench_mesh_primitive, 64, 1024);
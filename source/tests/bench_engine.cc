@@ -0,0 +1,368 @@
+#include <barrier>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include "CLG_log.h"
+#include "MEM_arena.h"
+#include "MEM_gaurdalloc.h"
+
+#include "../runtime/dna/DNA_object_type.h"
+#include "../runtime/gpu/GPU_mesh.h"
+#include "../runtime/lib/VLI_math_geom.h"
+#include "../runtime/lib/VLI_mesh_primitives.h"
+#include "bench_harness.h"
+
+/* Engine hot paths on the C++ side: picking, mesh packing, allocators, logging and ECS
+ * iteration. */
+
+#define BENCH_RAYS 64
+#define BENCH_FRAME_ALLOCS_PER_THREAD 4096
+#define BENCH_MALLOC_WINDOW 256
+#define BENCH_MIXED_OPS_PER_THREAD 4096
+#define BENCH_LOG_RECORDS 1024
+
+CLG_LOGREF_DECLARE_GLOBAL(LOG_BENCH, "bench");
+
+using namespace vektor;
+
+static void bench_mesh_free(dna::Mesh &mesh)
+{
+  delete[] mesh.mvert;
+  delete[] mesh.medge;
+  delete[] mesh.mloop;
+  delete[] mesh.mpoly;
+  mesh = dna::Mesh();
+}
+
+static void bench_mesh_create(dna::Mesh &mesh, lib::MeshPrimitiveType type, int segments)
+{
+  lib::MeshPrimitive primitive;
+  primitive.type = type;
+  primitive.segments = segments;
+  primitive.rings = type == lib::MeshPrimitiveType::UVSphere ? segments / 2 : segments;
+  primitive.size = type == lib::MeshPrimitiveType::Grid ? 10.0f : 1.0f;
+  lib::mesh_primitive_create(mesh, primitive);
+}
+
+/* Picking: rays from a ring around a sphere of `segments` x `segments / 2` faces, half of them
+ * aimed past it. */
+static void bench_ray_mesh_intersect(bench::State &state)
+{
+  dna::Mesh mesh;
+  bench_mesh_create(mesh, lib::MeshPrimitiveType::UVSphere, int(state.arg()));
+
+  glm::vec3 origins[BENCH_RAYS], directions[BENCH_RAYS];
+  for (int i = 0; i < BENCH_RAYS; i++) {
+    const float angle = float(i) * 6.2831853f / BENCH_RAYS;
+    origins[i] = glm::vec3(std::cos(angle), 0.3f, std::sin(angle)) * 5.0f;
+    const glm::vec3 target = glm::vec3(0.0f, (i % 2) ? 0.2f : 3.0f, 0.0f);
+    directions[i] = glm::normalize(target - origins[i]);
+  }
+
+  while (state.keep_running()) {
+    for (int i = 0; i < BENCH_RAYS; i++) {
+      bench::do_not_optimize(lib::ray_mesh_intersect(origins[i], directions[i], &mesh));
+    }
+  }
+  state.set_items_per_iteration(BENCH_RAYS);
+  bench_mesh_free(mesh);
+}
+BENCH_REGISTER(bench_ray_mesh_intersect, 16, 64, 256);
+
+/* The CPU half of GPU_mesh_create_from_dna_mesh, into the same arena it uses. */
+static void bench_gpu_mesh_pack(bench::State &state)
+{
+  dna::Mesh mesh;
+  bench_mesh_create(mesh, lib::MeshPrimitiveType::Grid, int(state.arg()));
+
+  while (state.keep_running()) {
+    mem::MEM_ArenaScope scope;
+    mem::MEM_ArenaResource resource(scope.arena());
+    std::pmr::vector<dna::GPUVertex> vertices(&resource);
+    std::pmr::vector<uint32_t> indices(&resource);
+    gpu::GPU_mesh_pack(mesh, vertices, indices);
+    bench::do_not_optimize(indices.data());
+  }
+  state.set_items_per_iteration(mesh.faces_num);
+  bench_mesh_free(mesh);
+}
+BENCH_REGISTER(bench_gpu_mesh_pack, 64, 256, 1024);
+
+/* Every thread allocates small blocks from one frame allocator at once, then the frame ends.
+ * The threads are started once and meet at barriers, so only the allocations are timed. */
+static void bench_frame_alloc_threads(bench::State &state)
+{
+  const int threads_num = int(state.arg());
+  mem_guarded::internal::FrameAllocator allocator{};
+  allocator.init();
+
+  std::barrier start(threads_num + 1), finish(threads_num + 1);
+  bool running = true;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threads_num; t++) {
+    threads.emplace_back([&, t]() {
+      for (;;) {
+        start.arrive_and_wait();
+        if (!running) {
+          return;
+        }
+        for (int i = 0; i < BENCH_FRAME_ALLOCS_PER_THREAD; i++) {
+          void *ptr = allocator.alloc(16 + ((i + t) & 7) * 16);
+          bench::do_not_optimize(ptr);
+        }
+        finish.arrive_and_wait();
+      }
+    });
+  }
+
+  while (state.keep_running()) {
+    start.arrive_and_wait();
+    finish.arrive_and_wait();
+    allocator.end_frame();
+  }
+  running = false;
+  start.arrive_and_wait();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  allocator.shutdown();
+  state.set_items_per_iteration(int64_t(threads_num) * BENCH_FRAME_ALLOCS_PER_THREAD);
+}
+BENCH_REGISTER(bench_frame_alloc_threads, 1, 2, 4, 8);
+
+/* A window of live blocks of `arg` bytes, the oldest freed for every new one. */
+template<typename AllocFn, typename FreeFn>
+static void bench_alloc_window(bench::State &state, AllocFn alloc_fn, FreeFn free_fn)
+{
+  const size_t size = size_t(state.arg());
+  void *window[BENCH_MALLOC_WINDOW] = {};
+  int64_t next = 0;
+  while (state.keep_running()) {
+    void *&slot = window[next++ % BENCH_MALLOC_WINDOW];
+    if (slot) {
+      free_fn(slot);
+    }
+    slot = alloc_fn(size);
+    bench::do_not_optimize(slot);
+  }
+  for (void *ptr : window) {
+    if (ptr) {
+      free_fn(ptr);
+    }
+  }
+  state.set_items_per_iteration(1);
+}
+
+static void bench_mem_mallocN(bench::State &state)
+{
+  bench_alloc_window(
+      state, [](size_t size) { return MEM_mallocN(size, "bench_mem_mallocN"); }, [](void *ptr) {
+        MEM_freeN(ptr);
+      });
+}
+BENCH_REGISTER(bench_mem_mallocN, 32, 256, 4096);
+
+static void bench_malloc(bench::State &state)
+{
+  bench_alloc_window(state, [](size_t size) { return malloc(size); }, [](void *ptr) {
+    free(ptr);
+  });
+}
+BENCH_REGISTER(bench_malloc, 32, 256, 4096);
+
+struct BenchBlock {
+  void *ptr;
+  size_t size;
+};
+
+/* Sizes 8..1016 bytes weighted towards the small end, like transient engine objects. */
+static size_t bench_block_size(uint32_t &state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  const size_t size = 8 + (state & 1023);
+  return (state & 0x30000) ? (size & 127) + 8 : size & ~size_t(7);
+}
+
+/* Every thread keeps a window of live blocks of mixed sizes and replaces the oldest one per op.
+ * Threads are started once and meet at barriers, as in bench_frame_alloc_threads. */
+template<typename AllocFn, typename FreeFn>
+static void bench_alloc_mixed_threads(bench::State &state, AllocFn alloc_fn, FreeFn free_fn)
+{
+  const int threads_num = int(state.arg());
+  std::barrier start(threads_num + 1), finish(threads_num + 1);
+  bool running = true;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threads_num; t++) {
+    threads.emplace_back([&, t]() {
+      BenchBlock window[BENCH_MALLOC_WINDOW] = {};
+      uint32_t seed = 0x9E3779B9u ^ uint32_t(t + 1);
+      int64_t next = 0;
+      for (;;) {
+        start.arrive_and_wait();
+        if (!running) {
+          break;
+        }
+        for (int i = 0; i < BENCH_MIXED_OPS_PER_THREAD; i++) {
+          BenchBlock &block = window[next++ % BENCH_MALLOC_WINDOW];
+          if (block.ptr) {
+            free_fn(block.ptr, block.size);
+          }
+          block.size = bench_block_size(seed);
+          block.ptr = alloc_fn(block.size);
+          /* Touch the block so neither allocator gets away with lazily committed pages. */
+          *(volatile char *)block.ptr = char(i);
+        }
+        finish.arrive_and_wait();
+      }
+      for (BenchBlock &block : window) {
+        if (block.ptr) {
+          free_fn(block.ptr, block.size);
+        }
+      }
+    });
+  }
+
+  while (state.keep_running()) {
+    start.arrive_and_wait();
+    finish.arrive_and_wait();
+  }
+  running = false;
+  start.arrive_and_wait();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  state.set_items_per_iteration(int64_t(threads_num) * BENCH_MIXED_OPS_PER_THREAD);
+}
+
+static void bench_slab_threads(bench::State &state)
+{
+  bench_alloc_mixed_threads(
+      state,
+      [](size_t size) { return mem_guarded::internal::g_slab_allocator.alloc(size); },
+      [](void *ptr, size_t size) { mem_guarded::internal::g_slab_allocator.free(ptr, size); });
+}
+BENCH_REGISTER(bench_slab_threads, 1, 2, 4, 8);
+
+static void bench_malloc_threads(bench::State &state)
+{
+  bench_alloc_mixed_threads(
+      state, [](size_t size) { return malloc(size); }, [](void *ptr, size_t /*size*/) {
+        free(ptr);
+      });
+}
+BENCH_REGISTER(bench_malloc_threads, 1, 2, 4, 8);
+
+/* Time at the call site for formatted records written to /dev/null, for each output mode:
+ * 0 writes on the calling thread, 1 on the writer thread, 2 also formats there. The writer
+ * catches up outside of the timing. */
+static void bench_clog_records(bench::State &state)
+{
+  FILE *null_file = fopen("/dev/null", "w");
+  if (!null_file) {
+    state.skip("no /dev/null");
+    return;
+  }
+  const int mode = int(state.arg());
+  const clog::CLG_Level level = clog::CLG_level_get();
+  clog::CLG_output_set(null_file);
+  clog::CLG_level_set(clog::CLG_LEVEL_INFO);
+  clog::CLG_output_async_set(mode >= 1);
+  clog::CLG_output_deferred_set(mode == 2);
+
+  while (state.keep_running()) {
+    for (int i = 0; i < BENCH_LOG_RECORDS; i++) {
+      CLOG_INFO(LOG_BENCH, "record %d of %d, %.3f ms", i, BENCH_LOG_RECORDS, i * 0.25);
+    }
+    state.pause_timing();
+    clog::CLG_flush();
+    state.resume_timing();
+  }
+
+  clog::CLG_output_deferred_set(0);
+  clog::CLG_output_async_set(0);
+  clog::CLG_level_set(level);
+  clog::CLG_output_set(stderr);
+  fclose(null_file);
+  state.set_items_per_iteration(BENCH_LOG_RECORDS);
+}
+BENCH_REGISTER(bench_clog_records, 0, 1, 2);
+
+static void bench_registry_fill(entt::registry &registry, int64_t count)
+{
+  for (int64_t i = 0; i < count; i++) {
+    const entt::entity entity = registry.create();
+    dna::Object &object = registry.emplace<dna::Object>(entity);
+    object.type = (i % 4) ? dna::ObjectType::Mesh : dna::ObjectType::Empty;
+    object.object_to_world[3] = glm::vec4(float(i), 0.0f, float(-i), 1.0f);
+    /* Every eighth object also gets a second component, for the two component view. */
+    if (i % 8 == 0) {
+      registry.emplace<dna::Transform>(entity);
+    }
+  }
+}
+
+/* The loops of the draw manager: a view over every object, with `registry.get` per entity. */
+static void bench_ecs_view_get(bench::State &state)
+{
+  entt::registry registry;
+  bench_registry_fill(registry, state.arg());
+
+  while (state.keep_running()) {
+    glm::vec3 sum(0.0f);
+    for (const entt::entity entity : registry.view<dna::Object>()) {
+      const dna::Object &object = registry.get<dna::Object>(entity);
+      if (object.type == dna::ObjectType::Mesh) {
+        sum += glm::vec3(object.object_to_world[3]);
+      }
+    }
+    bench::do_not_optimize(sum);
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_ecs_view_get, 1000, 100000);
+
+/* The same loop through `each`, which skips the lookup. */
+static void bench_ecs_view_each(bench::State &state)
+{
+  entt::registry registry;
+  bench_registry_fill(registry, state.arg());
+
+  while (state.keep_running()) {
+    glm::vec3 sum(0.0f);
+    registry.view<dna::Object>().each([&](const dna::Object &object) {
+      if (object.type == dna::ObjectType::Mesh) {
+        sum += glm::vec3(object.object_to_world[3]);
+      }
+    });
+    bench::do_not_optimize(sum);
+  }
+  state.set_items_per_iteration(state.arg());
+}
+BENCH_REGISTER(bench_ecs_view_each, 1000, 100000);
+
+/* Two component views, as for objects with an extra component. */
+static void bench_ecs_view_two(bench::State &state)
+{
+  entt::registry registry;
+  bench_registry_fill(registry, state.arg());
+
+  while (state.keep_running()) {
+    float sum = 0.0f;
+    registry.view<dna::Object, dna::Transform>().each(
+        [&](const dna::Object &object, const dna::Transform &transform) {
+          sum += object.object_to_world[3].x + transform.scale.x;
+        });
+    bench::do_not_optimize(sum);
+  }
+  state.set_items_per_iteration(state.arg() / 8);
+}
+BENCH_REGISTER(bench_ecs_view_two, 1000, 100000);
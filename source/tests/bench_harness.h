@@ -0,0 +1,145 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* A small benchmark harness for `vektor_bench`, in the spirit of Google Benchmark:
+ *
+ *   static void bench_thing(bench::State &state)
+ *   {
+ *     Input input = make_input(state.arg());  // Not timed.
+ *     while (state.keep_running()) {
+ *       bench::do_not_optimize(run_thing(input));
+ *     }
+ *     state.set_items_per_iteration(state.arg());
+ *   }
+ *   BENCH_REGISTER(bench_thing, 1000, 100000);
+ *
+ * The runner grows the iteration count until one run takes long enough to time, then repeats
+ * the run and reports the spread. */
+
+namespace bench {
+
+class State {
+ public:
+  State(int64_t arg, int64_t iterations) : arg_(arg), iterations_(iterations) {}
+
+  /** The argument the benchmark was registered with, 0 when it has none. */
+  int64_t arg() const
+  {
+    return arg_;
+  }
+  int64_t iterations() const
+  {
+    return iterations_;
+  }
+
+  /**
+   * True once per iteration. The first call starts the clock, the last one stops it unless the
+   * body left timing paused.
+   */
+  bool keep_running()
+  {
+    if (done_ == 0) {
+      start_ = Clock::now();
+    }
+    if (done_ == iterations_) {
+      if (!paused_) {
+        elapsed_ += Clock::now() - start_;
+      }
+      return false;
+    }
+    done_++;
+    return true;
+  }
+
+  /** Leave setup work inside the loop out of the measurement. */
+  void pause_timing()
+  {
+    if (!paused_) {
+      elapsed_ += Clock::now() - start_;
+      paused_ = true;
+    }
+  }
+  void resume_timing()
+  {
+    start_ = Clock::now();
+    paused_ = false;
+  }
+
+  /** Work items per iteration (vertices, rays, records...), for the items per second column. */
+  void set_items_per_iteration(int64_t items)
+  {
+    items_per_iteration_ = items;
+  }
+  int64_t items_per_iteration() const
+  {
+    return items_per_iteration_;
+  }
+
+  /** Skip the benchmark, e.g. when the engine part it measures is unavailable. */
+  void skip(std::string reason)
+  {
+    skip_reason_ = std::move(reason);
+  }
+  const std::string &skip_reason() const
+  {
+    return skip_reason_;
+  }
+
+  double elapsed_ns() const
+  {
+    return std::chrono::duration<double, std::nano>(elapsed_).count();
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  int64_t arg_;
+  int64_t iterations_;
+  int64_t done_ = 0;
+  int64_t items_per_iteration_ = 0;
+  std::string skip_reason_;
+  Clock::time_point start_;
+  Clock::duration elapsed_{};
+  bool paused_ = false;
+};
+
+using BenchFn = void (*)(State &state);
+
+struct Benchmark {
+  /** `function/arg`, or just the function without arguments. */
+  std::string name;
+  BenchFn fn;
+  int64_t arg;
+};
+
+/** Every registered benchmark, in registration order per translation unit. */
+std::vector<Benchmark> &benchmarks();
+
+/** Registers `fn` once per argument, or once with 0 without arguments. */
+int register_benchmark(const char *name, BenchFn fn, std::vector<int64_t> args);
+
+/** Keep the compiler from dropping a result that is never read. */
+template<typename T> inline void do_not_optimize(const T &value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** Keep the compiler from dropping writes to memory that is never read. */
+inline void clobber_memory()
+{
+  asm volatile("" : : : "memory");
+}
+
+}  // namespace bench
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+/** Register `fn` with the given arguments, `fn` runs once per argument. */
+#define BENCH_REGISTER(fn, ...) \
+  static const int BENCH_CONCAT(bench_registered_, __LINE__) = bench::register_benchmark( \
+      #fn, fn, {__VA_ARGS__})
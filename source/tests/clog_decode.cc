@@ -0,0 +1,157 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CLG_binary_format.h"
+
+/* Prints a binary log written with `--log-binary <file>` as text:
+ *
+ *   ./bin/clog_decode editor.clog [--source]
+ *
+ * Lines look like the regular log output with timestamps, `--source` adds the file, line and
+ * function of each call. */
+
+struct DecodeSite {
+  std::string identifier;
+  std::string fn;
+  std::string format;
+  std::string file_line;
+};
+
+static const char *level_as_text(uint32_t level)
+{
+  /* Matches clog::CLG_Level. */
+  static const char *names[] = {"FATAL", "ERROR", "WARNING", "INFO", "DEBUG", "TRACE"};
+  return level < sizeof(names) / sizeof(*names) ? names[level] : "INVALID_LEVEL";
+}
+
+template<typename T> static bool read_value(FILE *file, T *r_value)
+{
+  return fread(r_value, sizeof(T), 1, file) == 1;
+}
+
+static bool read_string(FILE *file, size_t len, std::string *r_str)
+{
+  r_str->resize(len);
+  return len == 0 || fread(r_str->data(), len, 1, file) == 1;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <binary log> [--source]\n", argv[0]);
+    return 1;
+  }
+  const bool use_source = argc > 2 && strcmp(argv[2], "--source") == 0;
+
+  FILE *file = fopen(argv[1], "rb");
+  if (!file) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  CLG_BinaryFileHeader header;
+  if (!read_value(file, &header) || memcmp(header.magic, CLG_BINARY_MAGIC, sizeof(header.magic)))
+  {
+    fprintf(stderr, "%s is not a binary log\n", argv[1]);
+    fclose(file);
+    return 1;
+  }
+  if (header.version != CLG_BINARY_VERSION) {
+    fprintf(stderr, "Unsupported binary log version %u\n", header.version);
+    fclose(file);
+    return 1;
+  }
+
+  std::vector<DecodeSite> sites;
+  std::vector<uint8_t> arg_types;
+  std::string args, message;
+  size_t events = 0;
+  bool truncated = false;
+
+  uint32_t type;
+  while (read_value(file, &type)) {
+    if (type == CLG_BINARY_RECORD_SITE) {
+      CLG_BinarySiteRecord record;
+      DecodeSite site;
+      if (!read_value(file, &record) ||
+          !read_string(file, record.identifier_len, &site.identifier) ||
+          !read_string(file, record.fn_len, &site.fn) ||
+          !read_string(file, record.format_len, &site.format) ||
+          !read_string(file, record.file_line_len, &site.file_line))
+      {
+        truncated = true;
+        break;
+      }
+      if (record.site >= sites.size()) {
+        sites.resize(record.site + 1);
+      }
+      sites[record.site] = site;
+    }
+    else if (type == CLG_BINARY_RECORD_EVENT) {
+      CLG_BinaryEventRecord record;
+      if (!read_value(file, &record) || record.site >= sites.size()) {
+        truncated = true;
+        break;
+      }
+      arg_types.resize(record.arg_count);
+      if ((record.arg_count && fread(arg_types.data(), record.arg_count, 1, file) != 1) ||
+          !read_string(file, record.args_len, &args))
+      {
+        truncated = true;
+        break;
+      }
+      const DecodeSite &site = sites[record.site];
+
+      message.clear();
+      clg_binary_format_message(message,
+                                site.format.c_str(),
+                                arg_types.data(),
+                                record.arg_count,
+                                args.data(),
+                                record.args_len);
+
+      const uint64_t timestamp = record.tick > header.tick_start ?
+                                     record.tick - header.tick_start :
+                                     0;
+      const int h = int(timestamp / (1000 * 60 * 60));
+      const int m = int((timestamp / (1000 * 60)) % 60);
+      const int s = int((timestamp / 1000) % 60);
+      const int r = int(timestamp % 1000);
+      int indent = (h > 0) ? printf("%.2d:%.2d:%.2d.%.3d  ", h, m, s, r) :
+                             printf("%.2d:%.2d.%.3d  ", m, s, r);
+      indent += printf("%-16s | ", site.identifier.c_str());
+
+      /* Continuation lines line up after the type, as in the regular log. */
+      if (use_source) {
+        message += '\n';
+        message += site.file_line + " " + site.fn;
+      }
+      const std::string continuation = "\n" + std::string(size_t(indent - 2), ' ') + "| ";
+      for (size_t pos = 0; (pos = message.find('\n', pos)) != std::string::npos;) {
+        message.replace(pos, 1, continuation);
+        pos += continuation.size();
+      }
+
+      if (record.level < 3) {
+        printf("%s ", level_as_text(record.level));
+      }
+      printf("%s\n", message.c_str());
+      events++;
+    }
+    else {
+      fprintf(stderr, "Unknown record type %u, stopping\n", type);
+      truncated = true;
+      break;
+    }
+  }
+  fclose(file);
+
+  fprintf(stderr,
+          "%zu records from %zu call sites%s\n",
+          events,
+          sites.size(),
+          truncated ? " (truncated)" : "");
+  return truncated ? 1 : 0;
+}
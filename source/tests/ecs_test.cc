@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../runtime/dna/DNA_object_type.h"
+#include "../runtime/kernel/ecs/ECS_registry.h"
+
+/* Object bookkeeping of the ECS registry. Uses the registry singleton, so it runs on the main
+ * thread after the other tests that create objects, and destroys what it created. */
+
+using namespace vektor;
+
+static entt::entity test_object_create(const char *name,
+                                       const glm::vec3 &location = glm::vec3(0.0f))
+{
+  kernel::create_entity(nullptr,
+                        nullptr,
+                        name,
+                        "ECS test object",
+                        (int)dna::ObjectType::Empty,
+                        location.x,
+                        location.y,
+                        location.z,
+                        1.0f,
+                        1.0f,
+                        1.0f);
+  kernel::ECSRegistry &ecs = kernel::ECSRegistry::instance();
+  std::vector<entt::entity> hits;
+  ecs.name_index().query(name, hits);
+  for (const entt::entity entity : hits) {
+    if (std::string(ecs.get_component<dna::Object>(entity).id.name) == name) {
+      return entity;
+    }
+  }
+  return entt::null;
+}
+
+static bool test_name_query(const char *text, entt::entity entity)
+{
+  std::vector<entt::entity> hits;
+  kernel::ECSRegistry::instance().name_index().query(text, hits);
+  return std::find(hits.begin(), hits.end(), entity) != hits.end();
+}
+
+static int test_rename()
+{
+  const entt::entity entity = test_object_create("Camera Rig");
+  if (entity == entt::null) {
+    std::cerr << "ECS Test: a new object is not in the name index." << std::endl;
+    return 1;
+  }
+
+  kernel::rename_entity(entity, "Spotlight Target");
+  int failed = 0;
+  if (!test_name_query("spotlight", entity) || !test_name_query("Tar", entity)) {
+    std::cerr << "ECS Test: a renamed object is not found by its new name." << std::endl;
+    failed++;
+  }
+  if (test_name_query("camera rig", entity) || test_name_query("Ri", entity)) {
+    std::cerr << "ECS Test: a renamed object is still found by its old name." << std::endl;
+    failed++;
+  }
+  const dna::Object &object = kernel::ECSRegistry::instance().get_component<dna::Object>(entity);
+  if (std::string(object.id.name) != "Spotlight Target") {
+    std::cerr << "ECS Test: rename did not change the object name." << std::endl;
+    failed++;
+  }
+
+  kernel::destroy_entity(entity);
+  if (test_name_query("spotlight", entity)) {
+    std::cerr << "ECS Test: a destroyed object is still in the name index." << std::endl;
+    failed++;
+  }
+  return failed;
+}
+
+static bool test_world_location(entt::entity entity, const glm::vec3 &expected)
+{
+  kernel::ECSRegistry &ecs = kernel::ECSRegistry::instance();
+  ecs.hierarchy().update_world_matrices();
+  const glm::vec3 location(ecs.get_component<dna::Object>(entity).object_to_world[3]);
+  return glm::all(glm::lessThan(glm::abs(location - expected), glm::vec3(1e-5f)));
+}
+
+static int test_reparent()
+{
+  const entt::entity parent = test_object_create("Parent Empty", glm::vec3(1.0f, 2.0f, 3.0f));
+  const entt::entity child = test_object_create("Child Empty", glm::vec3(0.0f, 0.0f, 1.0f));
+  if (parent == entt::null || child == entt::null) {
+    std::cerr << "ECS Test: a new object is not in the name index." << std::endl;
+    return 1;
+  }
+
+  kernel::Hierarchy &hierarchy = kernel::ECSRegistry::instance().hierarchy();
+  int failed = 0;
+  if (!hierarchy.set_parent(child, parent) || hierarchy.parent(child) != parent) {
+    std::cerr << "ECS Test: set_parent() did not parent the object." << std::endl;
+    failed++;
+  }
+  else if (!test_world_location(child, glm::vec3(1.0f, 2.0f, 4.0f))) {
+    std::cerr << "ECS Test: a child does not follow its parent." << std::endl;
+    failed++;
+  }
+  if (hierarchy.set_parent(parent, child)) {
+    std::cerr << "ECS Test: set_parent() accepted a parenting loop." << std::endl;
+    failed++;
+  }
+
+  hierarchy.set_parent(child, entt::null);
+  if (hierarchy.parent(child) != entt::null ||
+      !test_world_location(child, glm::vec3(0.0f, 0.0f, 1.0f)))
+  {
+    std::cerr << "ECS Test: clearing the parent did not restore the local location." << std::endl;
+    failed++;
+  }
+
+  /* Destroying a parent leaves its children as roots. */
+  hierarchy.set_parent(child, parent);
+  kernel::destroy_entity(parent);
+  if (hierarchy.parent(child) != entt::null ||
+      !test_world_location(child, glm::vec3(0.0f, 0.0f, 1.0f)))
+  {
+    std::cerr << "ECS Test: the child of a destroyed object is not a root." << std::endl;
+    failed++;
+  }
+  kernel::destroy_entity(child);
+  return failed;
+}
+
+static int test_transform_edit()
+{
+  const entt::entity parent = test_object_create("Moved Empty");
+  const entt::entity child = test_object_create("Follower Empty", glm::vec3(1.0f, 0.0f, 0.0f));
+  if (parent == entt::null || child == entt::null) {
+    std::cerr << "ECS Test: a new object is not in the name index." << std::endl;
+    return 1;
+  }
+  kernel::ECSRegistry &ecs = kernel::ECSRegistry::instance();
+  ecs.hierarchy().set_parent(child, parent);
+
+  /* Written the way the properties panel does, without touching object_to_world. */
+  dna::Transform transform;
+  transform.location = glm::vec3(2.0f, 0.0f, -1.0f);
+  transform.scale = glm::vec3(2.0f);
+  kernel::set_entity_transform(parent, transform);
+
+  int failed = 0;
+  if (!test_world_location(parent, glm::vec3(2.0f, 0.0f, -1.0f))) {
+    std::cerr << "ECS Test: an edited location did not reach object_to_world." << std::endl;
+    failed++;
+  }
+  const glm::mat4 &world = ecs.get_component<dna::Object>(parent).object_to_world;
+  if (std::abs(glm::length(glm::vec3(world[0])) - 2.0f) > 1e-5f) {
+    std::cerr << "ECS Test: an edited scale did not reach object_to_world." << std::endl;
+    failed++;
+  }
+  /* The child's local offset is scaled by its parent. */
+  if (!test_world_location(child, glm::vec3(4.0f, 0.0f, -1.0f))) {
+    std::cerr << "ECS Test: a child did not follow the edited parent." << std::endl;
+    failed++;
+  }
+
+  kernel::destroy_entity(child);
+  kernel::destroy_entity(parent);
+  return failed;
+}
+
+extern "C" int ecs_test_main(int argc, char **argv)
+{
+  bool should_run = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--tests") {
+      should_run = true;
+      break;
+    }
+  }
+
+  if (!should_run) {
+    std::cout << "ECS Test: Use --tests to run." << std::endl;
+    return 0;
+  }
+
+  int failed = 0;
+  failed += test_rename();
+  failed += test_reparent();
+  failed += test_transform_edit();
+  return failed;
+}
@@ -0,0 +1,110 @@
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+
+#include "../runtime/creator_global.h"
+#include "../runtime/dna/DNA_object_type.h"
+#include "../runtime/draw/DRW_manager.hh"
+#include "../runtime/kernel/ecs/ECS_registry.h"
+
+/* Renders a cube through the draw manager and picks it with the ID buffer. Runs headless, e.g.
+ * `QT_QPA_PLATFORM=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./bin/tests_main` on Mesa. */
+
+#define TEST_SIZE 128
+#define TEST_MAX_FRAMES 16
+
+static bool pick(
+    int x, int y, const glm::mat4 &view, const glm::mat4 &projection, entt::entity *r_hit)
+{
+  if (!vektor::draw::DRW_select_buffer_request(x, y, 2)) {
+    return false;
+  }
+  for (int frame = 0; frame < TEST_MAX_FRAMES; frame++) {
+    vektor::draw::DRW_draw_view(nullptr, nullptr, view, projection, TEST_SIZE, TEST_SIZE, 0.0f);
+    QOpenGLContext::currentContext()->functions()->glFinish();
+    if (vektor::draw::DRW_select_buffer_poll(r_hit)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+extern "C" int gpu_select_test_main(int argc, char **argv)
+{
+  bool should_run = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--tests") {
+      should_run = true;
+      break;
+    }
+  }
+
+  if (!should_run) {
+    std::cout << "GPU Select Test: Use --tests to run." << std::endl;
+    return 0;
+  }
+
+  QGuiApplication *app = nullptr;
+  if (!QGuiApplication::instance()) {
+    static int app_argc = 1;
+    app = new QGuiApplication(app_argc, argv);
+  }
+
+  QSurfaceFormat format;
+  format.setVersion(4, 1);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+
+  QOpenGLContext context;
+  context.setFormat(format);
+  QOffscreenSurface surface;
+  surface.setFormat(format);
+  surface.create();
+  if (!context.create() || !context.makeCurrent(&surface)) {
+    std::cerr << "GPU Select Test: no OpenGL 4.1 context available." << std::endl;
+    delete app;
+    return 1;
+  }
+
+  vektor::creator::G.gpu_backend = vektor::creator::GPU_BACKEND_OPENGL;
+  vektor::kernel::create_entity(nullptr,
+                                nullptr,
+                                "Cube",
+                                "Pick target",
+                                (int)vektor::dna::ObjectType::Mesh,
+                                0.0f,
+                                0.0f,
+                                0.0f,
+                                0.8f,
+                                0.8f,
+                                0.8f);
+  auto &registry = vektor::kernel::ECSRegistry::instance().registry();
+  const entt::entity cube = registry.view<vektor::dna::Object>().front();
+  /* The viewport evaluates these in DRW_prepare_view(). */
+  vektor::kernel::ECSRegistry::instance().hierarchy().update_world_matrices();
+
+  const glm::mat4 view = glm::lookAt(
+      glm::vec3(0.0f, 0.0f, 6.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+
+  int failed = 0;
+  entt::entity hit = entt::null;
+
+  if (!pick(TEST_SIZE / 2, TEST_SIZE / 2, view, projection, &hit) || hit != cube) {
+    std::cerr << "GPU Select Test: center pick missed the cube." << std::endl;
+    failed++;
+  }
+
+  hit = cube;
+  if (!pick(2, 2, view, projection, &hit) || hit != entt::null) {
+    std::cerr << "GPU Select Test: corner pick should hit nothing." << std::endl;
+    failed++;
+  }
+
+  context.doneCurrent();
+  delete app;
+
+  return failed;
+}
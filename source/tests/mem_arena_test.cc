@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "MEM_arena.h"
+
+/* Checks the linear arenas: alignment, nested markers, reuse of the blocks kept by a pop and
+ * std::pmr containers on top of MEM_ArenaResource. */
+
+static bool test_alignment()
+{
+  mem::MEM_Arena arena(256);
+  for (size_t alignment = 1; alignment <= 256; alignment *= 2) {
+    /* An odd sized allocation first, so every alignment has to be fixed up. */
+    void *odd = arena.alloc(3, 1);
+    void *ptr = arena.alloc(24, alignment);
+    if (!odd || !ptr || ((uintptr_t)ptr & (alignment - 1))) {
+      std::cerr << "MEM Arena Test: block not aligned to " << alignment << std::endl;
+      return false;
+    }
+    std::memset(ptr, 0xAB, 24);
+  }
+  /* Larger than a block, it gets a block of its own. */
+  void *large = arena.alloc(4096, 64);
+  if (!large || ((uintptr_t)large & 63)) {
+    std::cerr << "MEM Arena Test: large block not aligned" << std::endl;
+    return false;
+  }
+  std::memset(large, 0xCD, 4096);
+  return true;
+}
+
+static bool test_markers()
+{
+  mem::MEM_Arena arena(1024);
+  const mem::MEM_ArenaMarker start = arena.push_marker();
+  int *outer = arena.alloc_array<int>(16);
+  outer[0] = 42;
+  const size_t outer_used = arena.bytes_used();
+
+  const mem::MEM_ArenaMarker inner = arena.push_marker();
+  /* Spill over several blocks. */
+  for (int i = 0; i < 32; i++) {
+    std::memset(arena.alloc(512), i, 512);
+  }
+  const size_t reserved = arena.bytes_reserved();
+  arena.pop_to_marker(inner);
+  if (arena.bytes_used() != outer_used || outer[0] != 42) {
+    std::cerr << "MEM Arena Test: popping the inner marker lost the outer allocation"
+              << std::endl;
+    return false;
+  }
+
+  /* The same work again fits in the blocks kept by the pop. */
+  for (int i = 0; i < 32; i++) {
+    std::memset(arena.alloc(512), i, 512);
+  }
+  if (arena.bytes_reserved() != reserved) {
+    std::cerr << "MEM Arena Test: blocks kept by pop_to_marker() were not reused" << std::endl;
+    return false;
+  }
+
+  arena.pop_to_marker(start);
+  if (arena.bytes_used() != 0 || arena.alloc_array<int>(16) != outer) {
+    std::cerr << "MEM Arena Test: popping the first marker did not rewind the arena"
+              << std::endl;
+    return false;
+  }
+
+  arena.release();
+  if (arena.bytes_reserved() != 0 || !arena.alloc(64)) {
+    std::cerr << "MEM Arena Test: release() did not leave an empty, usable arena" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static bool test_pmr_vector()
+{
+  mem::MEM_ArenaScope scope;
+  mem::MEM_ArenaResource resource(scope.arena());
+  std::pmr::vector<uint32_t> values(&resource);
+  for (uint32_t i = 0; i < 10000; i++) {
+    values.push_back(i * 3);
+  }
+  for (uint32_t i = 0; i < 10000; i++) {
+    if (values[i] != i * 3) {
+      std::cerr << "MEM Arena Test: pmr vector lost its contents while growing" << std::endl;
+      return false;
+    }
+  }
+
+  /* Containers of containers take the resource along. */
+  std::pmr::vector<std::pmr::vector<uint32_t>> nested(&resource);
+  nested.resize(4);
+  nested[3].assign(values.begin(), values.begin() + 100);
+  if (nested[3].get_allocator().resource() != &resource || nested[3][99] != 297) {
+    std::cerr << "MEM Arena Test: nested pmr vector does not use the arena" << std::endl;
+    return false;
+  }
+
+  /* Destroyed before anything else is allocated, its storage goes straight back. */
+  mem::MEM_Arena arena;
+  mem::MEM_ArenaResource arena_resource(arena);
+  if (!arena.alloc(16)) {
+    return false;
+  }
+  const size_t used = arena.bytes_used();
+  {
+    std::pmr::vector<uint64_t> last(64, 0, &arena_resource);
+  }
+  if (arena.bytes_used() != used) {
+    std::cerr << "MEM Arena Test: the last allocation was not given back" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+extern "C" int mem_arena_test_main(int argc, char **argv)
+{
+  bool should_run = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--tests") {
+      should_run = true;
+      break;
+    }
+  }
+
+  if (!should_run) {
+    std::cout << "MEM Arena Test: Use --tests to run." << std::endl;
+    return 0;
+  }
+
+  int failed = 0;
+  failed += test_alignment() ? 0 : 1;
+  failed += test_markers() ? 0 : 1;
+  failed += test_pmr_vector() ? 0 : 1;
+  return failed;
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MEM_profile_format.h"
+
+/* Summarises a timeline written with `--profile-memory-timeline <file>`:
+ *
+ *   ./bin/mem_profile_view editor.memprof [count]
+ *
+ * Prints the memory in use over the session, the frames that allocated the most and the
+ * allocation names that allocated the most and that grew the most, `count` rows each. */
+
+#define VIEW_DEFAULT_ROWS 10
+
+struct ViewTag {
+  std::string name;
+  int64_t first_bytes = 0;
+  int64_t last_bytes = 0;
+  int64_t peak_bytes = 0;
+  int64_t allocated_bytes = 0;
+  int64_t allocated_blocks = 0;
+  bool seen = false;
+};
+
+struct ViewFrame {
+  uint64_t frame;
+  uint64_t time_ns;
+  int64_t allocated_bytes;
+  int64_t allocated_blocks;
+};
+
+static double to_mib(int64_t bytes)
+{
+  return (double)bytes / (1024.0 * 1024.0);
+}
+
+template<typename T> static bool read_value(FILE *file, T *r_value)
+{
+  return fread(r_value, sizeof(T), 1, file) == 1;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <timeline> [rows]\n", argv[0]);
+    return 1;
+  }
+  const size_t rows = argc > 2 ? (size_t)std::max(atoi(argv[2]), 1) : VIEW_DEFAULT_ROWS;
+
+  FILE *file = fopen(argv[1], "rb");
+  if (!file) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  MEM_ProfileFileHeader header;
+  if (!read_value(file, &header) ||
+      memcmp(header.magic, MEM_PROFILE_MAGIC, sizeof(header.magic)) != 0)
+  {
+    fprintf(stderr, "%s is not a memory profile timeline\n", argv[1]);
+    fclose(file);
+    return 1;
+  }
+  if (header.version != MEM_PROFILE_VERSION) {
+    fprintf(stderr, "Unsupported timeline version %u\n", header.version);
+    fclose(file);
+    return 1;
+  }
+
+  std::vector<ViewTag> tags(header.tag_capacity);
+  std::vector<ViewFrame> frames;
+  int64_t first_bytes = 0, last_bytes = 0, peak_bytes = 0;
+  uint64_t peak_frame = 0;
+  bool truncated = false;
+
+  uint32_t type;
+  while (read_value(file, &type)) {
+    if (type == MEM_PROFILE_RECORD_TAG) {
+      MEM_ProfileTagRecord record;
+      if (!read_value(file, &record) || record.tag >= tags.size()) {
+        truncated = true;
+        break;
+      }
+      std::string name(record.name_len, '\0');
+      if (record.name_len && fread(name.data(), record.name_len, 1, file) != 1) {
+        truncated = true;
+        break;
+      }
+      tags[record.tag].name = name;
+      tags[record.tag].first_bytes = record.bytes_at_begin;
+      tags[record.tag].peak_bytes = record.bytes_at_begin;
+    }
+    else if (type == MEM_PROFILE_RECORD_FRAME) {
+      MEM_ProfileFrameRecord record;
+      if (!read_value(file, &record)) {
+        truncated = true;
+        break;
+      }
+      if (frames.empty()) {
+        first_bytes = record.bytes_in_use;
+      }
+      last_bytes = record.bytes_in_use;
+      if (record.bytes_in_use > peak_bytes) {
+        peak_bytes = record.bytes_in_use;
+        peak_frame = record.frame;
+      }
+      frames.push_back(
+          {record.frame, record.time_ns, record.allocated_bytes, record.allocated_blocks});
+
+      for (uint32_t i = 0; i < record.tag_count; i++) {
+        MEM_ProfileTagSample sample;
+        if (!read_value(file, &sample) || sample.tag >= tags.size()) {
+          truncated = true;
+          break;
+        }
+        ViewTag &tag = tags[sample.tag];
+        tag.seen = true;
+        tag.last_bytes = sample.bytes_in_use;
+        tag.peak_bytes = std::max(tag.peak_bytes, sample.bytes_in_use);
+        tag.allocated_bytes += sample.allocated_bytes;
+        tag.allocated_blocks += sample.allocated_blocks;
+      }
+      if (truncated) {
+        break;
+      }
+    }
+    else {
+      fprintf(stderr, "Unknown record type %u, stopping\n", type);
+      truncated = true;
+      break;
+    }
+  }
+  fclose(file);
+
+  if (frames.empty()) {
+    printf("No frames recorded.\n");
+    return truncated ? 1 : 0;
+  }
+
+  const double seconds = (double)frames.back().time_ns * 1e-9;
+  int64_t total_allocated = 0, total_blocks = 0;
+  for (const ViewFrame &frame : frames) {
+    total_allocated += frame.allocated_bytes;
+    total_blocks += frame.allocated_blocks;
+  }
+
+  printf("%zu frames over %.1f s%s\n", frames.size(), seconds, truncated ? " (truncated)" : "");
+  printf("In use: %.2f MiB at start, %.2f MiB at end, peak %.2f MiB at frame %llu\n",
+         to_mib(first_bytes),
+         to_mib(last_bytes),
+         to_mib(peak_bytes),
+         (unsigned long long)peak_frame);
+  printf("Allocated: %.2f MiB in %lld blocks, %.2f MiB/s, %.1f blocks per frame\n",
+         to_mib(total_allocated),
+         (long long)total_blocks,
+         seconds > 0.0 ? to_mib(total_allocated) / seconds : 0.0,
+         (double)total_blocks / (double)frames.size());
+
+  std::vector<ViewFrame> hot = frames;
+  std::sort(hot.begin(), hot.end(), [](const ViewFrame &a, const ViewFrame &b) {
+    return a.allocated_bytes > b.allocated_bytes;
+  });
+  hot.resize(std::min(hot.size(), rows));
+  printf("\nFrames allocating the most:\n %10s %10s %12s %10s\n",
+         "frame",
+         "time s",
+         "MiB",
+         "blocks");
+  for (const ViewFrame &frame : hot) {
+    printf(" %10llu %10.2f %12.3f %10lld\n",
+           (unsigned long long)frame.frame,
+           (double)frame.time_ns * 1e-9,
+           to_mib(frame.allocated_bytes),
+           (long long)frame.allocated_blocks);
+  }
+
+  /* The same name can come from several slots, merge by content. */
+  std::map<std::string, ViewTag> merged;
+  for (const ViewTag &tag : tags) {
+    if (!tag.seen) {
+      continue;
+    }
+    ViewTag &entry = merged[tag.name];
+    entry.name = tag.name;
+    entry.first_bytes += tag.first_bytes;
+    entry.last_bytes += tag.last_bytes;
+    entry.peak_bytes += tag.peak_bytes;
+    entry.allocated_bytes += tag.allocated_bytes;
+    entry.allocated_blocks += tag.allocated_blocks;
+  }
+  std::vector<ViewTag> ranked;
+  for (auto &item : merged) {
+    ranked.push_back(item.second);
+  }
+
+  auto print_tags = [&](const char *title) {
+    printf("\n%s:\n %12s %12s %12s %10s  %s\n",
+           title,
+           "alloc MiB",
+           "growth KiB",
+           "peak KiB",
+           "allocs",
+           "name");
+    for (size_t i = 0; i < std::min(ranked.size(), rows); i++) {
+      const ViewTag &tag = ranked[i];
+      printf(" %12.3f %12.2f %12.2f %10lld  %s\n",
+             to_mib(tag.allocated_bytes),
+             (double)(tag.last_bytes - tag.first_bytes) / 1024.0,
+             (double)tag.peak_bytes / 1024.0,
+             (long long)tag.allocated_blocks,
+             tag.name.c_str());
+    }
+  };
+
+  std::sort(ranked.begin(), ranked.end(), [](const ViewTag &a, const ViewTag &b) {
+    return a.allocated_bytes > b.allocated_bytes;
+  });
+  print_tags("Names allocating the most");
+
+  std::sort(ranked.begin(), ranked.end(), [](const ViewTag &a, const ViewTag &b) {
+    return (a.last_bytes - a.first_bytes) > (b.last_bytes - b.first_bytes);
+  });
+  print_tags("Names growing the most");
+
+  return truncated ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MEM_gaurdalloc.h"
+
+/* Checks the slab pools: distinct and aligned blocks for every size class, frees from another
+ * thread and the typed helpers. Throughput against malloc is in vektor_bench. */
+
+using mem_guarded::internal::g_slab_allocator;
+
+struct TestBlock {
+  void *ptr;
+  size_t size;
+};
+
+static bool test_correctness()
+{
+  /* Every size class hands out distinct, writable, 16 byte aligned blocks. */
+  std::vector<TestBlock> blocks;
+  for (size_t size = 1; size <= mem_guarded::internal::MEM_SLAB_MAX_SIZE; size += 7) {
+    void *ptr = g_slab_allocator.alloc(size);
+    if (!ptr || ((uintptr_t)ptr & 15)) {
+      std::cerr << "MEM Slab Test: bad block for " << size << " bytes" << std::endl;
+      return false;
+    }
+    std::memset(ptr, (int)(size & 0xFF), size);
+    blocks.push_back({ptr, size});
+  }
+  for (const TestBlock &block : blocks) {
+    const auto *bytes = (const unsigned char *)block.ptr;
+    for (size_t i = 0; i < block.size; i++) {
+      if (bytes[i] != (block.size & 0xFF)) {
+        std::cerr << "MEM Slab Test: overlapping blocks at " << block.size << " bytes"
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+
+  /* Blocks allocated on one thread and freed on another end up back in the shared pool. */
+  std::thread producer([&]() {
+    for (TestBlock &block : blocks) {
+      g_slab_allocator.free(block.ptr, block.size);
+    }
+  });
+  producer.join();
+
+  struct Pooled {
+    std::string name;
+    float value[4];
+  };
+  Pooled *pooled = mem::MEM_pool_new<Pooled>();
+  pooled->name = "pooled object with a heap allocated name";
+  mem::MEM_pool_delete(pooled);
+
+  std::shared_ptr<Pooled> shared = mem::MEM_make_shared<Pooled>();
+  shared->value[3] = 1.0f;
+  return shared.use_count() == 1;
+}
+
+extern "C" int mem_slab_test_main(int argc, char **argv)
+{
+  bool should_run = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--tests") {
+      should_run = true;
+      break;
+    }
+  }
+
+  if (!should_run) {
+    std::cout << "MEM Slab Test: Use --tests to run." << std::endl;
+    return 0;
+  }
+
+  return test_correctness() ? 0 : 1;
+}
@@ -8,6 +8,10 @@
 // Forward declarations of test functions
 // These will be implemented in their respective test files
 extern "C" int vpi_event_test_main(int argc, char **argv);
+extern "C" int gpu_select_test_main(int argc, char **argv);
+extern "C" int mem_slab_test_main(int argc, char **argv);
+extern "C" int mem_arena_test_main(int argc, char **argv);
+extern "C" int ecs_test_main(int argc, char **argv);
 
 struct TestDef {
   std::string name;
@@ -25,7 +29,11 @@ int main(int argc, char **argv)
   }
 
   std::vector<TestDef> tests = {
-      {"VPI Event Test", reinterpret_cast<int (*)(int, char **)>(vpi_event_test_main), true}};
+      {"VPI Event Test", reinterpret_cast<int (*)(int, char **)>(vpi_event_test_main), true},
+      {"GPU Select Test", reinterpret_cast<int (*)(int, char **)>(gpu_select_test_main), true},
+      {"MEM Slab Test", reinterpret_cast<int (*)(int, char **)>(mem_slab_test_main), false},
+      {"MEM Arena Test", reinterpret_cast<int (*)(int, char **)>(mem_arena_test_main), false},
+      {"ECS Test", reinterpret_cast<int (*)(int, char **)>(ecs_test_main), true}};
 
   std::cout << "Starting Vektor Parallel Test Runner..." << std::endl;
   if (!run_all) {
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CLG_log.h"
+
+#include "../runtime/lib/VLI_compute.h"
+#include "bench_harness.h"
+
+/* Micro benchmarks of engine hot paths, see bench_engine.cc and bench_compute.cc:
+ *
+ *   ./bin/vektor_bench [--filter <text>] [--json <file>] [--min-time <seconds>]
+ *                      [--repetitions <count>] [--compute-threads <count>] [--list]
+ *
+ * Prints one row per benchmark with the time per iteration, `--json` also writes the results
+ * for `bench_compare.py`. */
+
+#define BENCH_DEFAULT_MIN_TIME 0.2
+#define BENCH_DEFAULT_REPETITIONS 5
+#define BENCH_MAX_ITERATIONS 1000000000
+
+namespace bench {
+
+std::vector<Benchmark> &benchmarks()
+{
+  static std::vector<Benchmark> list;
+  return list;
+}
+
+int register_benchmark(const char *name, BenchFn fn, std::vector<int64_t> args)
+{
+  /* `bench_` is implied. */
+  std::string base = name;
+  if (base.rfind("bench_", 0) == 0) {
+    base = base.substr(6);
+  }
+  if (args.empty()) {
+    benchmarks().push_back({base, fn, 0});
+  }
+  for (const int64_t arg : args) {
+    benchmarks().push_back({base + "/" + std::to_string(arg), fn, arg});
+  }
+  return 0;
+}
+
+}  // namespace bench
+
+struct BenchResult {
+  std::string name;
+  std::string skip_reason;
+  int64_t iterations = 0;
+  int64_t items_per_iteration = 0;
+  /** Nanoseconds per iteration, one entry per repetition. */
+  std::vector<double> samples;
+  double min_ns = 0.0;
+  double median_ns = 0.0;
+  double mean_ns = 0.0;
+  double stddev_ns = 0.0;
+};
+
+static double bench_run_once(const bench::Benchmark &benchmark,
+                             int64_t iterations,
+                             BenchResult &r_result)
+{
+  bench::State state(benchmark.arg, iterations);
+  benchmark.fn(state);
+  r_result.skip_reason = state.skip_reason();
+  r_result.items_per_iteration = state.items_per_iteration();
+  return state.elapsed_ns();
+}
+
+static BenchResult bench_run(const bench::Benchmark &benchmark,
+                             double min_time,
+                             int repetitions)
+{
+  BenchResult result;
+  result.name = benchmark.name;
+
+  /* Grow the iteration count until one run is long enough to time reliably. */
+  const double min_ns = min_time * 1e9;
+  int64_t iterations = 1;
+  double elapsed = bench_run_once(benchmark, iterations, result);
+  while (result.skip_reason.empty() && elapsed < min_ns && iterations < BENCH_MAX_ITERATIONS) {
+    const double scale = elapsed > 0.0 ? std::min(min_ns * 1.4 / elapsed, 10.0) : 10.0;
+    iterations = std::min<int64_t>(std::max<int64_t>(int64_t(iterations * scale), iterations + 1),
+                                   BENCH_MAX_ITERATIONS);
+    elapsed = bench_run_once(benchmark, iterations, result);
+  }
+  if (!result.skip_reason.empty()) {
+    return result;
+  }
+  result.iterations = iterations;
+
+  for (int i = 0; i < repetitions; i++) {
+    result.samples.push_back(bench_run_once(benchmark, iterations, result) / double(iterations));
+  }
+
+  std::vector<double> sorted = result.samples;
+  std::sort(sorted.begin(), sorted.end());
+  const size_t n = sorted.size();
+  result.min_ns = sorted.front();
+  result.median_ns = (n % 2) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) * 0.5;
+  for (const double sample : sorted) {
+    result.mean_ns += sample / double(n);
+  }
+  for (const double sample : sorted) {
+    result.stddev_ns += (sample - result.mean_ns) * (sample - result.mean_ns);
+  }
+  result.stddev_ns = n > 1 ? std::sqrt(result.stddev_ns / double(n - 1)) : 0.0;
+  return result;
+}
+
+static void bench_format_time(double ns, char *r_buffer, size_t buffer_size)
+{
+  if (ns < 1e3) {
+    snprintf(r_buffer, buffer_size, "%.1f ns", ns);
+  }
+  else if (ns < 1e6) {
+    snprintf(r_buffer, buffer_size, "%.2f us", ns / 1e3);
+  }
+  else if (ns < 1e9) {
+    snprintf(r_buffer, buffer_size, "%.2f ms", ns / 1e6);
+  }
+  else {
+    snprintf(r_buffer, buffer_size, "%.2f s", ns / 1e9);
+  }
+}
+
+static void bench_print_row(const BenchResult &result)
+{
+  if (!result.skip_reason.empty()) {
+    printf("%-44s skipped: %s\n", result.name.c_str(), result.skip_reason.c_str());
+    return;
+  }
+  char median[32], min[32];
+  bench_format_time(result.median_ns, median, sizeof(median));
+  bench_format_time(result.min_ns, min, sizeof(min));
+  const double spread = result.mean_ns > 0.0 ? result.stddev_ns / result.mean_ns * 100.0 : 0.0;
+  printf("%-44s %12s %12s %7.1f%% %12lld", result.name.c_str(), median, min, spread,
+         (long long)result.iterations);
+  if (result.items_per_iteration > 0) {
+    const double per_second = double(result.items_per_iteration) / result.median_ns * 1e9;
+    if (per_second >= 1e9) {
+      printf(" %10.2fG/s", per_second / 1e9);
+    }
+    else if (per_second >= 1e6) {
+      printf(" %10.2fM/s", per_second / 1e6);
+    }
+    else {
+      printf(" %10.2fk/s", per_second / 1e3);
+    }
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+static void bench_json_string(FILE *file, const std::string &text)
+{
+  fputc('"', file);
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      fputc('\\', file);
+    }
+    fputc(c, file);
+  }
+  fputc('"', file);
+}
+
+static bool bench_write_json(const char *filepath,
+                             const std::vector<BenchResult> &results,
+                             double min_time,
+                             int repetitions)
+{
+  FILE *file = fopen(filepath, "w");
+  if (!file) {
+    fprintf(stderr, "Cannot open %s\n", filepath);
+    return false;
+  }
+  char date[64];
+  const time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  fprintf(file, "{\n  \"context\": {\n");
+  fprintf(file, "    \"date\": \"%s\",\n", date);
+  fprintf(file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+  fprintf(file, "    \"compute_threads\": %d,\n", vektor::lib::compute_threads_num());
+#ifdef NDEBUG
+  fprintf(file, "    \"build_type\": \"release\",\n");
+#else
+  fprintf(file, "    \"build_type\": \"debug\",\n");
+#endif
+  fprintf(file, "    \"min_time\": %g,\n", min_time);
+  fprintf(file, "    \"repetitions\": %d\n", repetitions);
+  fprintf(file, "  },\n  \"benchmarks\": [");
+
+  bool first = true;
+  for (const BenchResult &result : results) {
+    if (!result.skip_reason.empty()) {
+      continue;
+    }
+    fprintf(file, "%s\n    {\"name\": ", first ? "" : ",");
+    bench_json_string(file, result.name);
+    fprintf(file,
+            ", \"iterations\": %lld, \"median_ns\": %.3f, \"min_ns\": %.3f, \"mean_ns\": %.3f, "
+            "\"stddev_ns\": %.3f, \"items_per_second\": %.1f, \"samples_ns\": [",
+            (long long)result.iterations,
+            result.median_ns,
+            result.min_ns,
+            result.mean_ns,
+            result.stddev_ns,
+            result.items_per_iteration > 0 ?
+                double(result.items_per_iteration) / result.median_ns * 1e9 :
+                0.0);
+    for (size_t i = 0; i < result.samples.size(); i++) {
+      fprintf(file, "%s%.3f", i ? ", " : "", result.samples[i]);
+    }
+    fprintf(file, "]}");
+    first = false;
+  }
+  fprintf(file, "\n  ]\n}\n");
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  const char *filter = nullptr;
+  const char *json_path = nullptr;
+  double min_time = BENCH_DEFAULT_MIN_TIME;
+  int repetitions = BENCH_DEFAULT_REPETITIONS;
+  int compute_threads = -1;
+  bool list = false;
+
+  for (int i = 1; i < argc; i++) {
+    const bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--filter") == 0 && has_value) {
+      filter = argv[++i];
+    }
+    else if (strcmp(argv[i], "--json") == 0 && has_value) {
+      json_path = argv[++i];
+    }
+    else if (strcmp(argv[i], "--min-time") == 0 && has_value) {
+      min_time = std::max(atof(argv[++i]), 0.001);
+    }
+    else if (strcmp(argv[i], "--repetitions") == 0 && has_value) {
+      repetitions = std::max(atoi(argv[++i]), 1);
+    }
+    else if (strcmp(argv[i], "--compute-threads") == 0 && has_value) {
+      compute_threads = std::max(atoi(argv[++i]), 0);
+    }
+    else if (strcmp(argv[i], "--list") == 0) {
+      list = true;
+    }
+    else {
+      fprintf(stderr,
+              "Usage: %s [--filter <text>] [--json <file>] [--min-time <seconds>] "
+              "[--repetitions <count>] [--compute-threads <count>] [--list]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  /* Engine code logs warnings, keep them off the table. */
+  clog::CLG_init();
+  clog::CLG_output_set(stderr);
+
+  if (compute_threads >= 0) {
+    vektor::lib::ComputeSettings settings;
+    settings.threads = compute_threads;
+    std::string error;
+    if (!vektor::lib::compute_init(settings, &error)) {
+      fprintf(stderr, "Cannot start the compute threads: %s\n", error.c_str());
+      return 1;
+    }
+  }
+
+  std::vector<const bench::Benchmark *> selected;
+  for (const bench::Benchmark &benchmark : bench::benchmarks()) {
+    if (!filter || benchmark.name.find(filter) != std::string::npos) {
+      selected.push_back(&benchmark);
+    }
+  }
+  if (list) {
+    for (const bench::Benchmark *benchmark : selected) {
+      printf("%s\n", benchmark->name.c_str());
+    }
+    return 0;
+  }
+
+  printf("%-44s %12s %12s %8s %12s %12s\n", "benchmark", "median", "min", "spread",
+         "iterations", "items");
+  std::vector<BenchResult> results;
+  for (const bench::Benchmark *benchmark : selected) {
+    results.push_back(bench_run(*benchmark, min_time, repetitions));
+    bench_print_row(results.back());
+  }
+
+  const bool written = !json_path || bench_write_json(json_path, results, min_time, repetitions);
+  clog::CLG_exit();
+  return written ? 0 : 1;
+}